@@ -8,15 +8,19 @@
 #ifdef HAVE_GETOPT_LONG
        #include <getopt.h>   // for getopt_long()
 #endif
+#include <errno.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <stdbool.h>
 #include <string.h>
 #include <stdarg.h>
+#include <sys/wait.h>                 // for waitpid()
+#include <time.h>                     // for nanosleep()
 #include <unistd.h>
 
 #include "../include/gpsd.h"         // for MAX_PACKET_LENGTH, etc
 #include "../include/bits.h"
+#include "../include/capture.h"
 #include "../include/gps_json.h"
 #include "../include/strfuncs.h"
 
@@ -655,8 +659,8 @@ static void decode(FILE *fpin, FILE *fpout)
                         continue;
                     }
                 }
-                json_data_report(changed, &session, &policy,
-                                 buf, sizeof(buf));
+                json_data_report(changed, &session, &policy, GPS_CLASS_ALL,
+                                 false, buf, sizeof(buf));
                 (void)fputs(buf, fpout);
             }
 #ifdef AIVDM_ENABLE
@@ -696,6 +700,62 @@ static void decode(FILE *fpin, FILE *fpout)
     }
 }
 
+/* replay(): write the data of a capture to fd
+ *
+ * scale is the speed, 1 for the original timing, 0 for as fast as
+ * possible.  start is seconds into the capture to begin at.
+ *
+ * Return: 0 = OK
+ *         1 = capture unreadable
+ */
+static int replay(const char *path, double scale, double start, int fd)
+{
+    static unsigned char buf[CAPTURE_PAYLOAD_MAX];
+    struct capture_reader_t reader;
+    struct capture_rec_t rec;
+    int64_t first = 0;
+    timespec_t base;
+    int ret;
+
+    if (!capture_reader_open(&reader, path)) {
+        (void)fprintf(stderr, "gpsdecode: %s is not a capture: %s\n",
+                      path, strerror(errno));
+        return 1;
+    }
+    if (0 < start) {
+        (void)capture_reader_seek(&reader,
+            reader.mono_ns + (int64_t)(start * NS_IN_SEC));
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &base);
+    while (1 == (ret = capture_reader_next(&reader, &rec,
+                                           buf, sizeof(buf)))) {
+        if (0 == first) {
+            first = rec.mono_ns;
+        }
+        if (0 < scale) {
+            // sleep until this read is due
+            int64_t due = (int64_t)((rec.mono_ns - first) / scale);
+            timespec_t now, delay;
+
+            (void)clock_gettime(CLOCK_MONOTONIC, &now);
+            due -= timespec_diff_ns(now, base);
+            if (0 < due) {
+                delay.tv_sec = (time_t)(due / NS_IN_SEC);
+                delay.tv_nsec = (long)(due % NS_IN_SEC);
+                (void)nanosleep(&delay, NULL);
+            }
+        }
+        if ((ssize_t)rec.len != write(fd, buf, rec.len)) {
+            break;
+        }
+    }
+    if (0 > ret) {
+        (void)fprintf(stderr, "gpsdecode: %s: bad record\n", path);
+    }
+    capture_reader_close(&reader);
+    return 0;
+}
+
 // JSON format on fpin to JSON on fpout - idempotency test
 static void encode(FILE *fpin, FILE *fpout)
 {
@@ -733,7 +793,7 @@ static void encode(FILE *fpin, FILE *fpout)
             exit(EXIT_FAILURE);
         }
         json_data_report(session.gpsdata.set, &session, &policy,
-                         inbuf, sizeof(inbuf));
+                         GPS_CLASS_ALL, false, inbuf, sizeof(inbuf));
         (void)fputs(inbuf, fpout);
     }
 }
@@ -748,6 +808,7 @@ static void usage(void)
           "\n"
 #ifdef HAVE_GETOPT_LONG
           "  --ais              AIS dump format with an ASCII pipe separator.\n"
+          "  --capture FILE     Decode the gpsd -C capture FILE.\n"
           "  --debug DEBUG      Set debug level.\n"
           "  --decode           Decode\n"
           "  --encode           Encode\n"
@@ -755,13 +816,17 @@ static void usage(void)
           "  --json             JSON.\n"
           "  --minlength        Minimum length, no JSON.\n"
           "  --nmea             pseudo NMEA\n"
+          "  --replay SCALE     Replay the capture at SCALE times real time,\n"
+          "                     0 for as fast as possible.  Default 0\n"
           "  --split24          split24\n"
+          "  --start SECONDS    Start SECONDS into the capture\n"
           "  --types TYPES      Types\n"
           "  --unscaled         Unscaled\n"
           "  --verbose          Verbose.\n"
           "  --version          Print version, then exit\n"
 #endif
           "  -?                 Show this help, then exit\n"
+          "  -C FILE            Decode the gpsd -C capture FILE.\n"
           "  -c                 AIS dump format with an ASCII pipe separator.\n"
           "  -D DEBUG           Set debug level.\n"
           "  -d                 Decode \n"
@@ -770,6 +835,8 @@ static void usage(void)
           "  -j                 JSON.\n"
           "  -m                 Minimum length, no JSON\n"
           "  -n                 pseudo NMEA\n"
+          "  -R SCALE           Replay the capture at SCALE times real time\n"
+          "  -S SECONDS         Start SECONDS into the capture\n"
           "  -s                 split24 \n"
           "  -t TYPES           Types, comma separated.\n"
           "  -u                 Unscaled\n"
@@ -781,11 +848,15 @@ static void usage(void)
 
 int main(int argc, char **argv)
 {
-    const char *optstring = "?cdehjmnst:uvVD:";
+    const char *optstring = "?C:cdehjmnR:S:st:uvVD:";
     enum { doencode, dodecode } mode = dodecode;
+    const char *capture = NULL;
+    double scale = 0.0;
+    double start = 0.0;
 #ifdef HAVE_GETOPT_LONG
     int option_index = 0;
     static struct option long_options[] = {
+        {"capture", required_argument, NULL, 'C'},
         {"debug", required_argument, NULL, 'D'},
         {"decode", no_argument, NULL, 'd'},
         {"encode", no_argument, NULL, 'e'},
@@ -794,7 +865,9 @@ int main(int argc, char **argv)
         {"minlength", no_argument, NULL, 'm'},
         {"nmea", no_argument, NULL, 'n'},
         {"nojson", no_argument, NULL, 'c'},
+        {"replay", required_argument, NULL, 'R'},
         {"split24", no_argument, NULL, 's'},
+        {"start", required_argument, NULL, 'S'},
         {"types", required_argument, NULL, 't'},
         {"unscaled", no_argument, NULL, 'u' },
         {"verbose", no_argument, NULL, 'v' },
@@ -818,6 +891,10 @@ int main(int argc, char **argv)
         }
 
         switch (ch) {
+        case 'C':
+            capture = optarg;
+            break;
+
         case 'c':
             json = false;
             break;
@@ -848,6 +925,14 @@ int main(int argc, char **argv)
             pseudonmea = true;
             break;
 
+        case 'R':
+            scale = safe_atof(optarg);
+            break;
+
+        case 'S':
+            start = safe_atof(optarg);
+            break;
+
         case 's':
             split24 = true;
             break;
@@ -900,6 +985,35 @@ int main(int argc, char **argv)
     }
     if (mode == doencode) {
         encode(stdin, stdout);
+    } else if (NULL != capture) {
+        // a child feeds the capture through a pipe, at its pace
+        int pipefd[2];
+        int status = 0;
+        pid_t pid;
+        FILE *fpin;
+
+        if (0 != pipe(pipefd) ||
+            0 > (pid = fork())) {
+            (void)fprintf(stderr, "gpsdecode: pipe()/fork(): %s\n",
+                          strerror(errno));
+            exit(EXIT_FAILURE);
+        }
+        if (0 == pid) {
+            (void)close(pipefd[0]);
+            _exit(replay(capture, scale, start, pipefd[1]));
+        }
+        (void)close(pipefd[1]);
+        fpin = fdopen(pipefd[0], "r");
+        if (NULL == fpin) {
+            exit(EXIT_FAILURE);
+        }
+        decode(fpin, stdout);
+        (void)fclose(fpin);
+        (void)waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) ||
+            0 != WEXITSTATUS(status)) {
+            exit(EXIT_FAILURE);
+        }
     } else {
         decode(stdin, stdout);
     }
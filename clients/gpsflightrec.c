@@ -0,0 +1,278 @@
+/* gpsflightrec.c -- print the gpsd flight recorder ring
+ *
+ * Attaches, read only, to the segment gpsd -R records into, see
+ * flightrec.h, and prints the records in it.  With -f it keeps
+ * printing new records as they come.
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+#include "../include/gpsd_config.h"  // must be before all includes
+
+#include <errno.h>
+#ifdef HAVE_GETOPT_LONG
+       #include <getopt.h>
+#endif
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/compiler.h"      // for FALLTHROUGH, memory_barrier()
+#include "../include/flightrec.h"
+#include "../include/gpsd.h"          // for packet_type_names[]
+#include "../include/timespec.h"
+
+static const char *event_names[FLIGHTREC_EVENTS] = {
+    "?", "OPEN", "CLOSE", "READ", "READERR", "PACKET", "BADPACKET",
+    "DRIVER", "POLL", "WRITE"};
+
+static void usage(void)
+{
+    (void)fprintf(stderr,
+        "usage: gpsflightrec [OPTIONS]\n\n"
+#ifdef HAVE_GETOPT_LONG
+        "  --device DEVICE     Only records of DEVICE\n"
+        "  --follow            Keep printing new records\n"
+        "  --help              Print this help, then exit\n"
+        "  --hex               Print all payloads in hex\n"
+        "  --version           Show version, then exit\n"
+#endif
+        "  -?                  Print this help and exit.\n"
+        "  -d DEVICE           Only records of DEVICE\n"
+        "  -f                  Keep printing new records\n"
+        "  -h                  Print this help and exit.\n"
+        "  -x                  Print all payloads in hex\n"
+        "  -V                  Print version and exit.\n"
+        "\nThe segment key is GPSD_FLIGHTREC_KEY, default 0x%x\n",
+        FLIGHTREC_KEY);
+    exit(EXIT_SUCCESS);
+}
+
+// print one record, its payload follows it
+static void print_record(const struct flightrec_t *fr,
+                         const struct flightrec_rec *rec,
+                         const unsigned char *payload, bool hex)
+{
+    static char dump[FLIGHTREC_PAYLOAD * 2 + 1];
+    char ts_buf[TIMESPEC_LEN];
+    const char *event = "?";
+    const char *text = "";
+    char arg[64];
+    timespec_t ts;
+    int64_t real_ns = rec->mono_ns + fr->real_ns;
+    size_t len = rec->len;
+
+    ts.tv_sec = (time_t)(real_ns / NS_IN_SEC);
+    ts.tv_nsec = (long)(real_ns % NS_IN_SEC);
+    if (FLIGHTREC_EVENTS > rec->event) {
+        event = event_names[rec->event];
+    }
+    arg[0] = '\0';
+    switch (rec->event) {
+    case FLIGHTREC_OPEN:
+        FALLTHROUGH
+    case FLIGHTREC_CLOSE:
+        (void)snprintf(arg, sizeof(arg), "fd %lld", (long long)rec->arg);
+        break;
+    case FLIGHTREC_READERR:
+        (void)snprintf(arg, sizeof(arg), "%s(%llu)",
+                       strerror((int)rec->arg),
+                       (unsigned long long)rec->arg);
+        break;
+    case FLIGHTREC_PACKET:
+        FALLTHROUGH
+    case FLIGHTREC_BADPACKET:
+        if (PACKET_TYPES > rec->arg) {
+            (void)snprintf(arg, sizeof(arg), "%s %zu",
+                           packet_type_names[rec->arg], len);
+        } else {
+            (void)snprintf(arg, sizeof(arg), "type %llu %zu",
+                           (unsigned long long)rec->arg, len);
+        }
+        break;
+    case FLIGHTREC_POLL:
+        (void)snprintf(arg, sizeof(arg), "%s",
+                       gps_maskdump((gps_mask_t)rec->arg));
+        break;
+    default:
+        // READ, WRITE, their length; DRIVER, the driver index
+        (void)snprintf(arg, sizeof(arg), "%llu",
+                       (unsigned long long)rec->arg);
+        break;
+    }
+    if (0 < len) {
+        if (hex) {
+            text = gps_hexdump(dump, sizeof(dump), payload, len);
+        } else {
+            text = gpsd_packetdump(dump, sizeof(dump), payload, len);
+            // the line ends here, not in the payload
+            while (0 < len &&
+                   ('\r' == dump[len - 1] || '\n' == dump[len - 1])) {
+                dump[--len] = '\0';
+            }
+        }
+    }
+    (void)printf("%s %s %s %s%s%s\n",
+                 timespec_str(&ts, ts_buf, sizeof(ts_buf)),
+                 fr->devices[rec->device % FLIGHTREC_DEVICES], event, arg,
+                 '\0' == text[0] ? "" : " ", text);
+}
+
+int main(int argc, char **argv)
+{
+    long key = getenv("GPSD_FLIGHTREC_KEY") ?
+                   strtol(getenv("GPSD_FLIGHTREC_KEY"), NULL, 0) :
+                   FLIGHTREC_KEY;
+    const char *device = NULL;
+    bool follow = false;
+    bool hex = false;
+    const struct flightrec_t *fr;
+    unsigned char *ring;
+    uint64_t last = 0;
+    char *whoami;
+    int shmid;
+    const char *optstring = "?d:fhxV";
+#ifdef HAVE_GETOPT_LONG
+    int option_index = 0;
+    static struct option long_options[] = {
+        {"device", required_argument, NULL, 'd'},
+        {"follow", no_argument, NULL, 'f'},
+        {"help", no_argument, NULL, 'h'},
+        {"hex", no_argument, NULL, 'x'},
+        {"version", no_argument, NULL, 'V' },
+        {NULL, 0, NULL, 0},
+    };
+#endif
+
+    // strip path from program name
+    (whoami = strrchr(argv[0], '/')) ? ++whoami : (whoami = argv[0]);
+
+    while (1) {
+        int ch;
+#ifdef HAVE_GETOPT_LONG
+        ch = getopt_long(argc, argv, optstring, long_options, &option_index);
+#else
+        ch = getopt(argc, argv, optstring);
+#endif
+
+        if (-1 == ch) {
+            break;
+        }
+
+        switch (ch) {
+        case 'd':
+            device = optarg;
+            break;
+        case 'f':
+            follow = true;
+            break;
+        case 'x':
+            hex = true;
+            break;
+        case 'V':
+            (void)fprintf(stderr, "%s: version %s (revision %s)\n",
+                          whoami, VERSION, REVISION);
+            exit(EXIT_SUCCESS);
+        default:
+            // unknown option
+            FALLTHROUGH
+        case '?':
+            FALLTHROUGH
+        case 'h':
+            usage();
+            // never returns but shut up compiler warnings
+            break;
+        }
+    }
+
+    shmid = shmget((key_t)key, sizeof(struct flightrec_t), 0);
+    if (-1 == shmid) {
+        (void)fprintf(stderr, "%s: no flight recorder at 0x%lx: %s\n",
+                      whoami, key, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    fr = (const struct flightrec_t *)shmat(shmid, 0, SHM_RDONLY);
+    if ((void *)-1 == fr) {
+        (void)fprintf(stderr, "%s: shmat(): %s\n", whoami, strerror(errno));
+        exit(EXIT_FAILURE);
+    }
+    if (FLIGHTREC_MAGIC != fr->magic ||
+        FLIGHTREC_VERSION != fr->version ||
+        FLIGHTREC_RING != fr->ring_size) {
+        (void)fprintf(stderr, "%s: segment 0x%lx is not a version %d "
+                      "flight recorder\n", whoami, key, FLIGHTREC_VERSION);
+        exit(EXIT_FAILURE);
+    }
+    ring = malloc(FLIGHTREC_RING);
+    if (NULL == ring) {
+        (void)fprintf(stderr, "%s: out of memory\n", whoami);
+        exit(EXIT_FAILURE);
+    }
+    setvbuf(stdout, NULL, _IOLBF, 0);
+
+    while (1) {
+        uint64_t head, tail, pos;
+        struct timespec delay;
+
+        // head, then the copy, then tail, see flightrec.h
+        head = fr->head;
+        memory_barrier();
+        (void)memcpy(ring, fr->ring, FLIGHTREC_RING);
+        memory_barrier();
+        tail = fr->tail;
+        if (tail > head ||
+            FLIGHTREC_RING < head - tail) {
+            // lapped during the copy, try again
+            continue;
+        }
+        if (last > head) {
+            // gpsd restarted
+            last = 0;
+        }
+        if (last < tail) {
+            if (0 != last) {
+                (void)printf("# lost %llu bytes of records\n",
+                             (unsigned long long)(tail - last));
+            }
+            last = tail;
+        }
+        for (pos = last; pos < head; ) {
+            struct flightrec_rec rec;
+            unsigned char payload[FLIGHTREC_PAYLOAD];
+            size_t off = (size_t)(pos & (FLIGHTREC_RING - 1));
+            size_t i;
+
+            // records are 8 aligned, so a header never wraps
+            (void)memcpy(&rec, ring + off, sizeof(rec));
+            for (i = 0; i < rec.len && i < sizeof(payload); i++) {
+                payload[i] = ring[(off + sizeof(rec) + i) &
+                                  (FLIGHTREC_RING - 1)];
+            }
+            if (NULL == device ||
+                0 == strcmp(device,
+                            fr->devices[rec.device % FLIGHTREC_DEVICES])) {
+                print_record(fr, &rec, payload, hex);
+            }
+            pos += FLIGHTREC_ALIGN(sizeof(rec) + rec.len);
+        }
+        last = head;
+        if (!follow) {
+            break;
+        }
+        // 100 mSec
+        delay.tv_sec = 0;
+        delay.tv_nsec = 100000000L;
+        (void)nanosleep(&delay, NULL);
+    }
+
+    (void)shmdt((const void *)fr);
+    free(ring);
+    exit(EXIT_SUCCESS);
+}
+
+// vim: set expandtab shiftwidth=4
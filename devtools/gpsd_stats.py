@@ -0,0 +1,188 @@
+#!/usr/bin/env python3
+#
+# This file is Copyright by the GPSD project
+# SPDX-License-Identifier: BSD-2-Clause
+#
+# This code runs compatibly under Python 2 and 3.x for x >= 2.
+# Preserve this property!
+"""Scrape the gpsd performance counters, see ?STATS in gpsd_json(5).
+
+gpsd_stats.py [-b stage=usec] [-c control-socket] [-i interval] [-j]
+              [host[:port]]
+
+Asks gpsd for ?STATS, over TCP or through the control socket, and
+prints a summary.  With -i it repeats, showing rates since the last
+scrape.  With -j it prints the raw STATS objects, one per line.
+
+-b sets a latency budget: exit with status 1 if the 99th percentile of
+the stage (lex, parse, report or write) of any device is over usec
+microseconds.  It may be repeated.
+"""
+
+from __future__ import absolute_import, print_function, division
+
+import getopt
+import json
+import socket
+import sys
+import time
+
+
+def scrape(host, port, control):
+    """Return the list of STATS objects gpsd sends."""
+    if control:
+        sock = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        sock.connect(control)
+        sock.sendall(b'?stats\n')
+        last = b'{"class":"OK"}'
+    else:
+        sock = socket.create_connection((host, port))
+        sock.sendall(b'?STATS;\n')
+        last = None
+    sock.settimeout(2)
+    data = b''
+    reports = []
+    try:
+        while True:
+            chunk = sock.recv(65536)
+            if not chunk:
+                break
+            data += chunk
+            while b'\n' in data:
+                (line, data) = data.split(b'\n', 1)
+                line = line.strip()
+                if last == line:
+                    sock.close()
+                    return reports
+                if line:
+                    report = json.loads(line.decode('ascii'))
+                    if 'STATS' != report.get('class'):
+                        continue
+                    reports.append(report)
+                    if not control and 'device' not in report:
+                        # device objects follow the daemon one at once
+                        sock.settimeout(0.2)
+    except socket.timeout:
+        pass
+    sock.close()
+    return reports
+
+
+def percentile(hist, fraction):
+    """Upper bound, in microseconds, of the bin holding the fraction."""
+    total = sum(hist)
+    if 0 == total:
+        return 0
+    seen = 0
+    for (i, count) in enumerate(hist):
+        seen += count
+        if seen >= fraction * total:
+            return 1 << i
+    return 1 << len(hist)
+
+
+def show(reports, prev, elapsed):
+    """Print a summary, rates against prev if there is one."""
+    def rate(key, new, old):
+        if old is None or key not in old:
+            return "%d" % new[key]
+        return "%d (%.1f/s)" % (new[key], (new[key] - old[key]) / elapsed)
+
+    olds = dict((r.get('device'), r) for r in prev)
+    for report in reports:
+        old = olds.get(report.get('device'))
+        if 'device' not in report:
+            print("daemon: wakeups %s timeouts %s clients %d "
+                  "accepted %d detached %d" %
+                  (rate('wakeups', report, old), report['timeouts'],
+                   len(report['clients']), report['accepted'],
+                   report['detached']))
+            for client in report['clients']:
+                print("  client %d: written %d eagain %d queued %s" %
+                      (client['client'], client['written'],
+                       client['eagain'], client.get('queued', '?')))
+            continue
+        print("%s: bytes %s cycles %s bad %d resyncs %d switches %d" %
+              (report['device'], rate('bytes', report, old),
+               rate('cycles', report, old), report['bad'],
+               report['resyncs'], report['switches']))
+        print("  packets %s" %
+              " ".join("%s=%d" % kv for kv in
+                       sorted(report['packets'].items())))
+        for hist in ('lex', 'parse', 'report', 'write'):
+            if hist in report:
+                print("  %s latency p50 <%d uS, p90 <%d uS, p99 <%d uS" %
+                      (hist, percentile(report[hist], 0.5),
+                       percentile(report[hist], 0.9),
+                       percentile(report[hist], 0.99)))
+
+
+def over_budget(reports, budgets):
+    """Print the stages over their budgets, return whether any are."""
+    over = False
+    for report in reports:
+        for (hist, usec) in budgets.items():
+            if 'device' not in report or hist not in report:
+                continue
+            p99 = percentile(report[hist], 0.99)
+            if p99 > usec:
+                print("%s: %s latency p99 <%d uS, over %d uS" %
+                      (report['device'], hist, p99, usec))
+                over = True
+    return over
+
+
+def main():
+    """Scrape, once or every interval."""
+    (host, port, control) = ('localhost', 2947, None)
+    (interval, raw, budgets) = (0, False, {})
+    try:
+        (options, arguments) = getopt.getopt(sys.argv[1:], "b:c:hi:j")
+    except getopt.GetoptError as err:
+        sys.stderr.write("gpsd_stats.py: %s\n" % err)
+        sys.exit(1)
+    for (switch, val) in options:
+        if '-b' == switch:
+            (hist, usec) = val.split('=', 1)
+            budgets[hist] = int(usec)
+        elif '-c' == switch:
+            control = val
+        elif '-i' == switch:
+            interval = float(val)
+        elif '-j' == switch:
+            raw = True
+        else:
+            print(__doc__)
+            sys.exit(0)
+    if arguments:
+        host = arguments[0]
+        if ':' in host:
+            (host, port) = host.rsplit(':', 1)
+            port = int(port)
+
+    prev = []
+    before = time.time()
+    while True:
+        reports = scrape(host, port, control)
+        now = time.time()
+        if raw:
+            for report in reports:
+                print(json.dumps(report))
+        else:
+            show(reports, prev, now - before)
+        if over_budget(reports, budgets):
+            sys.exit(1)
+        if 0 >= interval:
+            break
+        (prev, before) = (reports, now)
+        time.sleep(interval)
+        print()
+
+
+if __name__ == '__main__':
+    try:
+        main()
+    except KeyboardInterrupt:
+        pass
+
+# vim: set expandtab shiftwidth=4
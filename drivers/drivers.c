@@ -17,6 +17,7 @@
 #include "../include/bits.h"    // for getbeu16(), to extract big-endian words
 #include "../include/compiler.h"   // for FALLTHROUGH
 #include "../include/gpsd.h"
+#include "../include/gps_binary.h"  // needs gpsd.h
 #include "../include/strfuncs.h"
 
 // This handles only bad, comment, and maybe NMEA packets.
@@ -1607,8 +1608,9 @@ static gps_mask_t json_pass_packet(struct gps_device_t *session)
     GPSD_LOG(LOG_IO, &session->context->errout,
              "<= GPS: %s\n", (char *)session->lexer.outbuffer);
 
-    if (strstr(session->gpsdata.dev.path, ":/") != NULL &&
-        strstr(session->gpsdata.dev.path, "localhost") == NULL) {
+    if (SERVICE_RELAY == session->servicetype ||
+        (strstr(session->gpsdata.dev.path, ":/") != NULL &&
+         strstr(session->gpsdata.dev.path, "localhost") == NULL)) {
         // devices and paths need to be edited
         if (strstr((char *)session->lexer.outbuffer, "DEVICE") != NULL) {
             path_rewrite(session, "\"path\":\"");
@@ -1664,6 +1666,78 @@ const struct gps_type_t driver_json_passthrough = {
 // *INDENT-ON*
 
 
+/**************************************************************************
+ *
+ * relay:// driver, the binary report frames of another gpsd
+ *
+ **************************************************************************/
+
+/* Count the frames the feed lost, by their numbers, and put the feed
+ * path in front of the device path, like path_rewrite() does.  The
+ * frame is not decoded, the daemon passes it on as it is. */
+static gps_mask_t relay_parse(struct gps_device_t *session)
+{
+    char *buf = (char *)session->lexer.outbuffer;
+    char prefix[GPS_PATH_MAX];
+    unsigned long seq;
+
+    if (JSON_PACKET == session->lexer.type) {
+        // the classes that have no frames come as JSON
+        return json_pass_packet(session);
+    }
+
+    seq = gpsb_seq_get(buf, session->lexer.outbuflen);
+    if (0 != seq) {
+        if (0 != session->relay.seq &&
+            seq > session->relay.seq + 1) {
+            GPSD_LOG(LOG_WARN, &session->context->errout,
+                     "RELAY: %s lost frames %lu to %lu\n",
+                     session->gpsdata.dev.path, session->relay.seq + 1,
+                     seq - 1);
+            session->stats.relay_lost += seq - session->relay.seq - 1;
+        } else if (seq <= session->relay.seq) {
+            GPSD_LOG(LOG_INF, &session->context->errout,
+                     "RELAY: %s restarted, frame %lu\n",
+                     session->gpsdata.dev.path, seq);
+        }
+        session->relay.seq = seq;
+    }
+
+    (void)strlcpy(prefix, session->gpsdata.dev.path, sizeof(prefix));
+    prefix[strcspn(prefix, "#")] = '\0';
+    session->lexer.outbuflen =
+        gpsb_device_prefix(buf, session->lexer.outbuflen,
+                           sizeof(session->lexer.outbuffer), prefix);
+    GPSD_LOG(LOG_IO, &session->context->errout,
+             "RELAY: %s frame %lu, class %u, %zu bytes\n",
+             session->gpsdata.dev.path, seq, getub(buf, 2),
+             session->lexer.outbuflen);
+    return PASSTHROUGH_IS;
+}
+
+// *INDENT-OFF*
+const struct gps_type_t driver_relay = {
+    .type_name      = "GPSD relay",     // full name of type
+    .packet_type    = GPSB_PACKET,      // associated lexer packet type
+    .flags          = DRIVER_NOFLAGS,   // don't remember this
+    .trigger        = NULL,             // it's the default
+    .channels       = 0,                // not used
+    .probe_detect   = NULL,             // no probe
+    .get_packet     = packet_get1,      // use generic packet getter
+    .parse_packet   = relay_parse,      // how to interpret a packet
+    .rtcm_writer    = NULL,             // write RTCM data straight
+    .init_query     = NULL,             // non-perturbing initial query
+    .event_hook     = NULL,             // lifetime event handler
+    .speed_switcher = NULL,             // no speed switcher
+    .mode_switcher  = NULL,             // no mode switcher
+    .rate_switcher  = NULL,             // no sample-rate switcher
+    .min_cycle.tv_sec  = 1,             // not relevant, no rate switch
+    .min_cycle.tv_nsec = 0,             // not relevant, no rate switch
+    .control_send   = NULL,             // how to send control strings
+    .time_offset     = NULL,            // no method for NTP fudge factor
+};
+// *INDENT-ON*
+
 // *INDENT-OFF*
 const struct gps_type_t driver_pps = {
     .type_name      = "PPS",            // full name of type
@@ -1793,6 +1867,7 @@ static const struct gps_type_t *gpsd_driver_array[] = {
 #endif  // GARMINTXT_ENABLE
 
     &driver_json_passthrough,
+    &driver_relay,
     &driver_pps,
     NULL,
 };
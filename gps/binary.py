@@ -0,0 +1,215 @@
+# This file is Copyright by the GPSD project
+# SPDX-License-Identifier: BSD-2-Clause
+#
+# This code run compatibly under Python 2 and 3.x for x >= 2.
+# Preserve this property!
+# Codacy D203 and D211 conflict, I choose D203
+# Codacy D212 and D213 conflict, I choose D212
+
+"""Decode gpsd binary report frames, see gps_binary.h.
+
+A watcher that sets "binary":true gets TPV, SKY, ATT, IMU and RAW
+reports as frames.  unpack() turns a frame into the dictionary the
+JSON report would have given, with the same keys.
+
+The tables here must match those in libgps/libgps_binary.c.
+"""
+
+from __future__ import absolute_import, print_function, division
+
+import struct
+import time
+
+SYNC1 = 0xe7
+SYNC2 = 0x67
+VERSION = 1
+HEADER = 8
+MAX = 10240         # GPS_JSON_RESPONSE_MAX
+
+# item types
+(BOOL, U8, I8, I16, I32, U32, I64, U64, F32, F64, TS, STR, NEXT) = \
+    range(1, 14)
+
+# struct formats of the fixed length types
+FORMATS = {BOOL: '<?', U8: '<B', I8: '<b', I16: '<h', I32: '<i',
+           U32: '<I', I64: '<q', U64: '<Q', F32: '<f', F64: '<d',
+           TS: '<qi', NEXT: ''}
+
+TAG_DEVICE = 0xf0
+TAG_LEAP = 0xf1
+TAG_NSAT = 0xf2
+TAG_NEXT = 0xff
+
+# The index in a table is the tag on the wire, None is not decoded.
+TPV_FIELDS = (
+    (TS, 'time'), (I32, 'mode'), (I32, 'status'), (F32, 'ept'),
+    (F64, 'lat'), (F64, 'lon'), (F64, 'altHAE'), (F64, 'altMSL'),
+    (F32, 'epx'), (F32, 'epy'), (F32, 'epv'), (F32, 'track'),
+    (F32, 'magtrack'), (F32, 'magvar'), (F32, 'speed'), (F32, 'climb'),
+    (F32, 'epd'), (F32, 'eps'), (F32, 'epc'),
+    (F64, 'ecefx'), (F64, 'ecefy'), (F64, 'ecefz'),
+    (F32, 'ecefvx'), (F32, 'ecefvy'), (F32, 'ecefvz'),
+    (F32, 'ecefpAcc'), (F32, 'ecefvAcc'),
+    (F64, 'relN'), (F64, 'relE'), (F64, 'relD'), (F64, 'relL'),
+    (F64, 'relH'), (F32, 'velN'), (F32, 'velE'), (F32, 'velD'),
+    (F32, 'geoidSep'), (F32, 'eph'), (F32, 'sep'), (STR, 'datum'),
+    (F32, 'depth'), (F32, 'dgpsAge'), (I32, 'dgpsSta'),
+    (I32, 'baseS'), (F64, 'baseE'), (F64, 'baseN'), (F64, 'baseU'),
+    (F64, 'baseL'), (F32, 'baseC'), (F32, 'dgpsRatio'),
+    (F32, 'wanglem'), (F32, 'wangler'), (F32, 'wanglet'),
+    (F32, 'wspeedr'), (F32, 'wspeedt'), (F32, 'wtemp'), (F32, 'temp'),
+    (I32, 'ant'), (I32, 'jam'), (I64, 'clockbias'), (I64, 'clockdrift'),
+)
+
+SKY_FIELDS = (
+    (TS, 'time'), (F32, 'xdop'), (F32, 'ydop'), (F32, 'pdop'),
+    (F32, 'hdop'), (F32, 'vdop'), (F32, 'tdop'), (F32, 'gdop'),
+)
+
+SAT_FIELDS = (
+    (I16, 'PRN'), (U8, 'gnssid'), (U8, 'svid'), (U8, 'sigid'),
+    (I8, 'freqid'), (F32, 'az'), (F32, 'el'), (F64, 'pr'),
+    (F32, 'prRate'), (F32, 'prRes'), (I8, 'qual'), (F32, 'ss'),
+    (BOOL, 'used'), (U8, 'health'),
+)
+
+ATT_FIELDS = (
+    (TS, 'time'), (U64, 'timeTag'), (STR, 'msg'),
+    (F32, 'acc_len'), (F32, 'acc_x'), (F32, 'acc_y'), (F32, 'acc_z'),
+    (F32, 'depth'), (F32, 'dip'), (F32, 'gyro_temp'), (F32, 'gyro_x'),
+    (F32, 'gyro_y'), (F32, 'gyro_z'), (F32, 'heading'), (F32, 'mheading'),
+    (F32, 'mag_len'), (F32, 'mag_x'), (F32, 'mag_y'), (F32, 'mag_z'),
+    (F32, 'pitch'), (F32, 'roll'), (F32, 'rot'), (F32, 'temp'),
+    (F32, 'yaw'), (I8, 'mag_st'), (I8, 'pitch_st'), (I8, 'roll_st'),
+    (I8, 'yaw_st'), (I32, 'baseS'), (F64, 'baseE'), (F64, 'baseN'),
+    (F64, 'baseU'), (F64, 'baseL'), (F32, 'baseC'), (F32, None),
+)
+
+RAW_FIELDS = ((TS, 'time'),)
+
+MEAS_FIELDS = (
+    (U8, 'gnssid'), (U8, 'svid'), (U8, 'sigid'), (U8, 'snr'),
+    (U8, 'freqid'), (U8, 'lli'), (STR, 'obs'), (F64, 'codephase'),
+    (F64, 'carrierphase'), (F64, 'pseudorange'), (F64, 'deltarange'),
+    (F64, 'doppler'), (U32, 'locktime'), (F64, 'l2c'), (F64, 'c2c'),
+    (U32, 'satstat'),
+)
+
+# class: (name, fields, array name, element fields)
+CLASSES = {
+    1: ('TPV', TPV_FIELDS, None, None),
+    2: ('SKY', SKY_FIELDS, 'satellites', SAT_FIELDS),
+    3: ('ATT', ATT_FIELDS, None, None),
+    4: ('IMU', ATT_FIELDS, None, None),
+    5: ('RAW', RAW_FIELDS, 'rawdata', MEAS_FIELDS),
+}
+
+
+class binary_error(BaseException):
+
+    """Class for a garbled binary frame."""
+
+    def __init__(self, explanation):
+        """Init binary_error."""
+        BaseException.__init__(self)
+        self.explanation = explanation
+
+
+def frame_len(buf):
+    """Length of the frame at the start of buf.
+
+Return: the whole length, 0 if it is not all there yet.
+Raise binary_error if it is not a frame this version can read."""
+    if HEADER > len(buf):
+        return 0
+    (sync1, sync2, _cls, version, length) = struct.unpack_from('<BBBBI',
+                                                               buf)
+    if ((SYNC1 != sync1 or SYNC2 != sync2 or VERSION != version or
+         MAX < length + HEADER)):
+        raise binary_error("not a binary frame")
+    if length + HEADER > len(buf):
+        return 0
+    return length + HEADER
+
+
+def isotime(sec, nsec):
+    """ISO 8601 time to the millisecond, like gpsd's JSON."""
+    return (time.strftime("%Y-%m-%dT%H:%M:%S", time.gmtime(sec)) +
+            ".%03dZ" % (nsec // 1000000))
+
+
+def unpack(buf):
+    """Decode the frame buf, return a dictionary like the JSON report.
+
+Returns None for a class this version does not know."""
+    length = frame_len(buf)
+    if 0 == length:
+        raise binary_error("short frame")
+    cls = bytearray(buf[2:3])[0]
+    if cls not in CLASSES:
+        return None
+    (name, fields, array, efields) = CLASSES[cls]
+    report = {'class': name}
+    target = report
+    table = fields
+    offset = HEADER
+    while offset + 2 <= length:
+        (tag, kind) = struct.unpack_from('<BB', buf, offset)
+        offset += 2
+        if STR == kind:
+            if offset >= length:
+                raise binary_error("truncated item")
+            slen = bytearray(buf[offset:offset + 1])[0]
+            value = buf[offset + 1:offset + 1 + slen].decode('ascii',
+                                                             'replace')
+            size = 1 + slen
+        elif kind in FORMATS:
+            size = struct.calcsize(FORMATS[kind])
+            value = struct.unpack_from(FORMATS[kind], buf, offset) \
+                if size else None
+        else:
+            raise binary_error("unknown type %d" % kind)
+        if offset + size > length:
+            raise binary_error("truncated item")
+        offset += size
+
+        if TAG_NEXT == tag:
+            if array is not None:
+                target = {}
+                report.setdefault(array, []).append(target)
+                table = efields
+            continue
+        if TAG_DEVICE == tag:
+            report['device'] = value
+            continue
+        if TAG_LEAP == tag:
+            report['leapseconds'] = value[0]
+            continue
+        if TAG_NSAT == tag:
+            report.setdefault(array, [])
+            continue
+        if tag >= len(table) or table[tag][0] != kind or not table[tag][1]:
+            # newer, or garbled
+            continue
+        key = table[tag][1]
+        if TS == kind:
+            if 'RAW' == name:
+                (target['time'], target['nsec']) = value
+            else:
+                target[key] = isotime(*value)
+        elif STR == kind:
+            target[key] = value
+        else:
+            target[key] = value[0]
+
+    if 'TPV' == name:
+        # JSON always has the mode
+        report.setdefault('mode', 0)
+    if 'satellites' in report:
+        for sat in report['satellites']:
+            sat.setdefault('used', False)
+        report['nSat'] = len(report['satellites'])
+        report['uSat'] = len([s for s in report['satellites'] if s['used']])
+    return report
+
+# vim: set expandtab shiftwidth=4
@@ -19,10 +19,13 @@ import sys
 import time
 
 import gps          # for VERB_*
+from . import binary
 from .misc import polystr, polybytes
 from .watch_options import *
 
 GPSD_PORT = "2947"
+# the first byte of a binary frame, never of a JSON object
+BINARY_SYNC = b'\xe7'
 
 
 class gpscommon(object):
@@ -141,8 +144,8 @@ class gpscommon(object):
                 return -1
             self.stream()
 
-        eol = self.linebuffer.find(b'\n')
-        if -1 == eol:
+        eol = self._message_len()
+        if 0 == eol:
             # RTCM3 JSON can be over 4.4k long, so go big
             if self.input_fd:
                 frag = self.input_fd.read(8192)
@@ -158,8 +161,8 @@ class gpscommon(object):
 
             self.linebuffer += frag
 
-            eol = self.linebuffer.find(b'\n')
-            if -1 == eol:
+            eol = self._message_len()
+            if 0 == eol:
                 if 1 < self.verbose:
                     sys.stderr.write("poll: partial message: returning 0.\n")
                 # Read succeeded, but only got a fragment
@@ -170,21 +173,35 @@ class gpscommon(object):
             if 1 < self.verbose:
                 sys.stderr.write("poll: fetching from buffer.\n")
 
-        # We got a line
-        eol += 1
+        # We got a line, or a binary frame
         # Provide the response in both 'str' and 'bytes' form
         self.bresponse = self.linebuffer[:eol]
-        self.response = polystr(self.bresponse)
+        if self.bresponse.startswith(BINARY_SYNC):
+            # binary.unpack() it, there is no text
+            self.response = ''
+        else:
+            self.response = polystr(self.bresponse)
         self.linebuffer = self.linebuffer[eol:]
 
         # Can happen if daemon terminates while we're reading.
-        if not self.response:
+        if not self.bresponse:
             return -1
         if 1 < self.verbose:
             sys.stderr.write("poll: data is %s\n" % repr(self.response))
         self.received = time.time()
-        # We got a \n-terminated line
-        return len(self.response)
+        # We got a \n-terminated line, or a frame
+        return len(self.bresponse)
+
+    def _message_len(self):
+        """Length of the whole message at the front of the buffer, or 0."""
+        if self.linebuffer.startswith(BINARY_SYNC):
+            try:
+                return binary.frame_len(self.linebuffer)
+            except binary.binary_error:
+                # no way to resync in a frame, drop what we have
+                self.linebuffer = b''
+                return 0
+        return self.linebuffer.find(b'\n') + 1
 
     # Note that the 'data' method is sometimes shadowed by a name
     # collision, rendering it unusable.  The documentation recommends
@@ -249,6 +266,20 @@ class gpsjson(object):
             self.data.satellites = [dictwrapper(x)
                                     for x in self.data.satellites]
 
+    def unpack_binary(self, buf):
+        """Unpack a binary frame, into the same form as unpack()."""
+        try:
+            report = binary.unpack(buf)
+        except binary.binary_error as e:
+            raise json_error(buf, e.explanation)
+        if report is None:
+            # a class from the future
+            report = {'class': 'UNKNOWN'}
+        self.data = dictwrapper(report)
+        if hasattr(self.data, "satellites"):
+            self.data.satellites = [dictwrapper(x)
+                                    for x in self.data.satellites]
+
     def stream(self, flags=0, devpath=None):
         """Control streaming reports from the daemon,"""
         if 0 < flags:
@@ -311,6 +342,10 @@ class gpsjson(object):
                 arg += ',"split24":false'
             if flags & WATCH_PPS:
                 arg += ',"pps":false'
+            if flags & WATCH_BINARY:
+                arg += ',"binary":false'
+            if flags & WATCH_TRACE:
+                arg += ',"trace":false'
         else:  # flags & WATCH_ENABLE:
             arg = '?WATCH={"enable":true'
             if flags & WATCH_JSON:
@@ -329,6 +364,10 @@ class gpsjson(object):
                 arg += ',"split24":true'
             if flags & WATCH_PPS:
                 arg += ',"pps":true'
+            if flags & WATCH_BINARY:
+                arg += ',"binary":true'
+            if flags & WATCH_TRACE:
+                arg += ',"trace":true'
             if flags & WATCH_DEVICE:
                 arg += ',"device":"%s"' % devpath
         arg += "}"
@@ -54,7 +54,8 @@ Valgrind notifications).
 Each FakeGPS instance tries to packetize the data from the logfile it
 is initialized with. It uses the same packet-getter as the daemon.
 Exception: if there is a Delay-Cookie line in a header comment, that
-delimiter is used to split up the test load.
+delimiter is used to split up the test load.  A gpsd -C capture is
+split into the chunks gpsd read, and fed with their original timing.
 
 The TestSession code maintains a run queue of FakeGPS and gps.gs
 (client- session) objects. It repeatedly cycles through the run queue.
@@ -87,6 +88,7 @@ import select
 import signal
 import socket
 import stat
+import struct
 import subprocess
 import sys
 import termios  # fcntl, array, struct
@@ -127,6 +129,12 @@ WRITE_PAD_SLOWDOWN = 0.01
 # If a test takes longer than this, we deem it to have timed out
 TEST_TIMEOUT = 60
 
+# gpsd -C capture files, see include/capture.h
+CAPTURE_MAGIC = b"GPSDCAP1"
+CAPTURE_REC = struct.Struct("<IH2xqq")     # len, type, realtime, monotonic
+CAPTURE_DATA = 1
+CAPTURE_INDEX = 2
+
 
 def GetDelay(slow=False):
     """Get appropriate per-line delay."""
@@ -154,9 +162,12 @@ class TestLoad(object):
 
     """Digest a logfile into a list of sentences we can cycle through."""
 
-    def __init__(self, logfp, predump=False, slow=False, oneshot=False):
+    def __init__(self, logfp, predump=False, slow=False, oneshot=False,
+                 replay=1.0):
         """Initialize Class TestLoad."""
         self.sentences = []  # This is the interesting part
+        self.stamps = None   # monotonic nS of each sentence, for captures
+        self.replay = replay
         if isinstance(logfp, str):
             logfp = open(logfp, "rb")
         self.name = logfp.name
@@ -169,6 +180,9 @@ class TestLoad(object):
         self.delimiter = None
         # Stash away a copy in case we need to resplit
         text = logfp.read()
+        if text.startswith(CAPTURE_MAGIC):
+            self.load_capture(text, oneshot)
+            return
         logfp = open(logfp.name, 'rb')
         # Grab the packets in the normal way
         getter = sniffer.Device(logfp.fileno())
@@ -250,6 +264,32 @@ class TestLoad(object):
         if oneshot:
             self.sentences.append(b"# EOF\n")
 
+    def load_capture(self, text, oneshot):
+        """Digest a gpsd -C capture, one sentence per read()."""
+        self.stamps = []
+        (hlen,) = struct.unpack_from("<I", text, 12)
+        offset = hlen
+        while offset + CAPTURE_REC.size <= len(text):
+            (length, rtype, _real, mono) = CAPTURE_REC.unpack_from(text,
+                                                                   offset)
+            offset += CAPTURE_REC.size
+            if CAPTURE_INDEX == rtype:
+                break
+            if CAPTURE_DATA == rtype:
+                self.sentences.append(text[offset:offset + length])
+                self.stamps.append(mono)
+            offset += length
+        if not self.sentences:
+            raise TestLoadError("empty capture %s" % self.name)
+        if self.predump:
+            for packet in self.sentences:
+                print(repr(packet))
+        self.textual = self.sentences[0][:1] in (b"$", b"!")
+        self.legend = "gpsfake: read %d: "
+        if oneshot:
+            self.sentences.append(b"# EOF\n")
+            self.stamps.append(self.stamps[-1])
+
 
 class PacketError(TestError):
 
@@ -284,7 +324,18 @@ class FakeGPS(object):
             time.sleep(int(delay))
         # self.write has to be set by the derived class
         self.write(line)
-        time.sleep(self.testload.delay)
+        stamps = self.testload.stamps
+        if stamps and 0 < self.testload.replay:
+            # a capture, keep its timing, scaled
+            now = self.index % len(stamps)
+            nxt = (self.index + 1) % len(stamps)
+            if 0 < nxt:
+                time.sleep(max(0, stamps[nxt] - stamps[now]) / 1e9 /
+                           self.testload.replay)
+            else:
+                time.sleep(self.testload.delay)
+        else:
+            time.sleep(self.testload.delay)
         self.index += 1
 
 
@@ -644,9 +695,10 @@ class TestSession(object):
 
     def __init__(self, prefix=None, port=None, options=None, verbose=0,
                  predump=False, udp=False, tcp=False, slow=False,
-                 timeout=None):
+                 timeout=None, replay=1.0):
         """Initialize the test session by launching the daemon."""
         self.prefix = prefix
+        self.replay = replay
         self.options = options
         self.verbose = verbose
         self.predump = predump
@@ -690,7 +742,7 @@ class TestSession(object):
         self.progress("gpsfake: gps_add(%s, %d)\n" % (logfile, speed))
         if logfile not in self.fakegpslist:
             testload = TestLoad(logfile, predump=self.predump, slow=self.slow,
-                                oneshot=oneshot)
+                                oneshot=oneshot, replay=self.replay)
             if "UDP" == testload.sourcetype or self.udp:
                 newgps = FakeUDP(testload, ipaddr="127.0.0.1",
                                  port=freeport(socket.SOCK_DGRAM),
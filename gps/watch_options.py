@@ -11,6 +11,8 @@ WATCH_TIMING = 0x000200        # timing information
 WATCH_DEVICE = 0x000800        # watch specific device
 WATCH_SPLIT24 = 0x001000       # split AIS Type 24s
 WATCH_PPS = 0x002000           # enable PPS JSON
+WATCH_BINARY = 0x004000        # TPV, SKY, etc. as binary frames
+WATCH_TRACE = 0x008000         # latency trace stages in TPV
 
 WATCH_NEWSTYLE = 0x010000      # force JSON streaming
 WATCH_OLDSTYLE = 0x020000      # force old-style streaming
@@ -0,0 +1,505 @@
+/*
+ * capture.c - raw input capture files, see capture.h for the format
+ *
+ * The main thread copies each read() into a fill buffer.  A writer
+ * thread per capture writes full buffers out, so the main loop never
+ * waits on the disk.  If the writer falls a whole buffer behind, new
+ * reads are dropped and counted rather than blocking the main loop.
+ *
+ * The reader half is for gpsdecode, gpsfake reads captures itself.
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+#include "../include/gpsd_config.h"   // must be before all includes
+
+#include <ctype.h>                    // for isalnum()
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdlib.h>                   // for malloc()
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/gpsd.h"
+#include "../include/bits.h"
+#include "../include/capture.h"
+#include "../include/strfuncs.h"
+#include "../include/timespec.h"
+
+// bytes per buffer, the writer thread writes this much at a time
+#define CAPTURE_BUFFER          (256 * 1024)
+// hand a partial buffer to the writer once it is this old
+#define CAPTURE_FLUSH_NS        1000000000LL
+// files for one device opened in one second, before giving up
+#define CAPTURE_SEQ_MAX         100
+
+struct capture_index_t {
+    int64_t mono_ns;
+    uint64_t offset;
+};
+
+struct capture_t {
+    int fd;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    unsigned char *fill;                // the main thread appends here
+    size_t filllen;
+    int64_t fill_ns;                    // monotonic time of first append
+    unsigned char *flush;               // the writer thread writes this
+    size_t flushlen;                    // 0 when the writer is idle
+    bool closing;
+    int write_errno;                    // first write() error, or 0
+    uint64_t offset;                    // file offset of the next record
+    int64_t next_index_ns;              // monotonic time of next index
+    struct capture_index_t *index;
+    size_t nindex, maxindex;
+    unsigned long long dropped;         // reads not captured
+};
+
+// a timespec as nanoseconds
+static int64_t ts_ns(const timespec_t *ts)
+{
+    return (int64_t)ts->tv_sec * NS_IN_SEC + ts->tv_nsec;
+}
+
+// write all of buf, return errno or 0
+static int write_all(int fd, const unsigned char *buf, size_t len)
+{
+    while (0 < len) {
+        ssize_t n = write(fd, buf, len);
+
+        if (0 > n) {
+            if (EINTR == errno) {
+                continue;
+            }
+            return errno;
+        }
+        buf += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+// the writer thread, writes out each buffer it is handed
+static void *capture_writer(void *arg)
+{
+    struct capture_t *cap = (struct capture_t *)arg;
+    int err;
+
+    (void)pthread_mutex_lock(&cap->mutex);
+    for (;;) {
+        while (0 == cap->flushlen &&
+               !cap->closing) {
+            (void)pthread_cond_wait(&cap->cond, &cap->mutex);
+        }
+        if (0 == cap->flushlen) {
+            // closing, and nothing left
+            break;
+        }
+        // the main thread does not touch flush while flushlen is set
+        (void)pthread_mutex_unlock(&cap->mutex);
+        err = write_all(cap->fd, cap->flush, cap->flushlen);
+        (void)pthread_mutex_lock(&cap->mutex);
+        if (0 != err &&
+            0 == cap->write_errno) {
+            cap->write_errno = err;
+        }
+        cap->flushlen = 0;
+        // capture_close() may be waiting for this
+        (void)pthread_cond_broadcast(&cap->cond);
+    }
+    (void)pthread_mutex_unlock(&cap->mutex);
+    return NULL;
+}
+
+// hand the fill buffer to the writer, if it is idle.  Mutex held.
+static bool capture_swap(struct capture_t *cap)
+{
+    unsigned char *tmp;
+
+    if (0 != cap->flushlen) {
+        return false;
+    }
+    tmp = cap->flush;
+    cap->flush = cap->fill;
+    cap->flushlen = cap->filllen;
+    cap->fill = tmp;
+    cap->filllen = 0;
+    (void)pthread_cond_broadcast(&cap->cond);
+    return true;
+}
+
+/* start capturing a device into a new file in dir
+ *
+ * The file is named for the device path and the time, so a device
+ * that is closed and reopened gets a new file.  One reopened within
+ * the same second gets a -1, -2, ... suffix, a file is never appended.
+ */
+void capture_open(struct gps_device_t *session, const char *dir)
+{
+    struct capture_t *cap;
+    unsigned char header[CAPTURE_HEADER_LEN];
+    char name[GPS_PATH_MAX], path[GPS_PATH_MAX * 2 + 48];
+    timespec_t mono, real;
+    struct tm tm;
+    size_t i;
+    int err, seq;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &mono);
+    (void)clock_gettime(CLOCK_REALTIME, &real);
+    (void)strlcpy(name, session->gpsdata.dev.path, sizeof(name));
+    for (i = 0; '\0' != name[i]; i++) {
+        if (!isalnum((unsigned char)name[i]) &&
+            '.' != name[i] &&
+            '-' != name[i]) {
+            name[i] = '_';
+        }
+    }
+    (void)gmtime_r(&real.tv_sec, &tm);
+
+    cap = calloc(1, sizeof(struct capture_t));
+    if (NULL == cap) {
+        return;
+    }
+    cap->fill = malloc(CAPTURE_BUFFER);
+    cap->flush = malloc(CAPTURE_BUFFER);
+    for (seq = 0; seq < CAPTURE_SEQ_MAX; seq++) {
+        char suffix[16] = "";
+
+        if (0 < seq) {
+            (void)snprintf(suffix, sizeof(suffix), "-%d", seq);
+        }
+        (void)snprintf(path, sizeof(path),
+                       "%s/%s-%04d%02d%02dT%02d%02d%02d%s.gpscap",
+                       dir, name, tm.tm_year + 1900, tm.tm_mon + 1,
+                       tm.tm_mday, tm.tm_hour, tm.tm_min, tm.tm_sec, suffix);
+        cap->fd = open(path, O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+        if (0 <= cap->fd ||
+            EEXIST != errno) {
+            break;
+        }
+    }
+    if (NULL == cap->fill ||
+        NULL == cap->flush ||
+        0 > cap->fd) {
+        GPSD_LOG(LOG_ERROR, &session->context->errout,
+                 "CAPTURE: can't capture %s to %s: %s(%d)\n",
+                 session->gpsdata.dev.path, path, strerror(errno), errno);
+        goto fail;
+    }
+
+    (void)memset(header, 0, sizeof(header));
+    (void)memcpy(header + CAPTURE_H_MAGIC, CAPTURE_MAGIC, 8);
+    putle32(header, CAPTURE_H_VERSION, CAPTURE_VERSION);
+    putle32(header, CAPTURE_H_LEN, CAPTURE_HEADER_LEN);
+    putle64(header, CAPTURE_H_REAL, ts_ns(&real));
+    putle64(header, CAPTURE_H_MONO, ts_ns(&mono));
+    (void)strlcpy((char *)header + CAPTURE_H_DEVICE,
+                  session->gpsdata.dev.path, CAPTURE_PATH);
+    err = write_all(cap->fd, header, sizeof(header));
+    if (0 != err) {
+        GPSD_LOG(LOG_ERROR, &session->context->errout,
+                 "CAPTURE: write(%s) failed: %s(%d)\n",
+                 path, strerror(err), err);
+        goto fail;
+    }
+    cap->offset = CAPTURE_HEADER_LEN;
+
+    (void)pthread_mutex_init(&cap->mutex, NULL);
+    (void)pthread_cond_init(&cap->cond, NULL);
+    err = pthread_create(&cap->thread, NULL, capture_writer, cap);
+    if (0 != err) {
+        GPSD_LOG(LOG_ERROR, &session->context->errout,
+                 "CAPTURE: pthread_create() failed: %s(%d)\n",
+                 strerror(err), err);
+        (void)pthread_cond_destroy(&cap->cond);
+        (void)pthread_mutex_destroy(&cap->mutex);
+        goto fail;
+    }
+    session->capture = cap;
+    GPSD_LOG(LOG_INF, &session->context->errout,
+             "CAPTURE: capturing %s to %s\n",
+             session->gpsdata.dev.path, path);
+    return;
+
+  fail:
+    if (0 <= cap->fd) {
+        (void)close(cap->fd);
+    }
+    free(cap->fill);
+    free(cap->flush);
+    free(cap);
+}
+
+/* append the bytes of one read() to the capture
+ * Use the CAPTURE() macro, it costs nothing when capture is off. */
+void capture_write(struct gps_device_t *session, const void *data,
+                   size_t len)
+{
+    struct capture_t *cap = session->capture;
+    size_t need = CAPTURE_REC_LEN + len;
+    timespec_t mono, real;
+    int64_t mono_ns;
+    unsigned char *rec;
+
+    if (0 == len) {
+        return;
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &mono);
+    (void)clock_gettime(CLOCK_REALTIME, &real);
+    mono_ns = ts_ns(&mono);
+
+    (void)pthread_mutex_lock(&cap->mutex);
+    if (CAPTURE_BUFFER - cap->filllen < need ||
+        (0 < cap->filllen &&
+         CAPTURE_FLUSH_NS < mono_ns - cap->fill_ns)) {
+        (void)capture_swap(cap);
+    }
+    if (CAPTURE_BUFFER - cap->filllen < need) {
+        // the writer is a buffer behind, or a huge read
+        cap->dropped++;
+        (void)pthread_mutex_unlock(&cap->mutex);
+        return;
+    }
+    if (0 == cap->filllen) {
+        cap->fill_ns = mono_ns;
+    }
+    (void)pthread_mutex_unlock(&cap->mutex);
+
+    // only the main thread touches fill
+    if (mono_ns >= cap->next_index_ns) {
+        if (cap->nindex == cap->maxindex) {
+            size_t max = 0 == cap->maxindex ? 64 : cap->maxindex * 2;
+            struct capture_index_t *index;
+
+            index = realloc(cap->index, max * sizeof(*index));
+            if (NULL != index) {
+                cap->index = index;
+                cap->maxindex = max;
+            }
+        }
+        if (cap->nindex < cap->maxindex) {
+            cap->index[cap->nindex].mono_ns = mono_ns;
+            cap->index[cap->nindex].offset = cap->offset;
+            cap->nindex++;
+        }
+        cap->next_index_ns = mono_ns + CAPTURE_INDEX_NS;
+    }
+    rec = cap->fill + cap->filllen;
+    (void)memset(rec, 0, CAPTURE_REC_LEN);
+    putle32(rec, CAPTURE_R_LEN, len);
+    putle16(rec, CAPTURE_R_TYPE, CAPTURE_DATA);
+    putle64(rec, CAPTURE_R_REAL, ts_ns(&real));
+    putle64(rec, CAPTURE_R_MONO, mono_ns);
+    (void)memcpy(rec + CAPTURE_REC_LEN, data, len);
+    cap->offset += need;
+
+    (void)pthread_mutex_lock(&cap->mutex);
+    cap->filllen += need;
+    (void)pthread_mutex_unlock(&cap->mutex);
+}
+
+// flush the capture, write its index and close it
+void capture_close(struct gps_device_t *session)
+{
+    struct capture_t *cap = session->capture;
+    unsigned char entry[CAPTURE_IDX_LEN];
+    unsigned char rec[CAPTURE_REC_LEN];
+    unsigned char trailer[CAPTURE_TRAILER_LEN];
+    uint64_t index_offset;
+    timespec_t mono, real;
+    size_t i;
+    int err;
+
+    if (NULL == cap) {
+        return;
+    }
+    session->capture = NULL;
+
+    // let the writer finish what it has, then hand it the rest
+    (void)pthread_mutex_lock(&cap->mutex);
+    while (0 < cap->filllen) {
+        if (!capture_swap(cap)) {
+            (void)pthread_cond_wait(&cap->cond, &cap->mutex);
+        }
+    }
+    cap->closing = true;
+    (void)pthread_cond_broadcast(&cap->cond);
+    (void)pthread_mutex_unlock(&cap->mutex);
+    (void)pthread_join(cap->thread, NULL);
+
+    // the writer is gone, write the index here
+    err = cap->write_errno;
+    (void)clock_gettime(CLOCK_MONOTONIC, &mono);
+    (void)clock_gettime(CLOCK_REALTIME, &real);
+    index_offset = cap->offset;
+    (void)memset(rec, 0, sizeof(rec));
+    putle32(rec, CAPTURE_R_LEN, cap->nindex * CAPTURE_IDX_LEN);
+    putle16(rec, CAPTURE_R_TYPE, CAPTURE_INDEX);
+    putle64(rec, CAPTURE_R_REAL, ts_ns(&real));
+    putle64(rec, CAPTURE_R_MONO, ts_ns(&mono));
+    if (0 == err) {
+        err = write_all(cap->fd, rec, sizeof(rec));
+    }
+    for (i = 0; 0 == err && i < cap->nindex; i++) {
+        putle64(entry, CAPTURE_I_MONO, cap->index[i].mono_ns);
+        putle64(entry, CAPTURE_I_OFFSET, cap->index[i].offset);
+        err = write_all(cap->fd, entry, sizeof(entry));
+    }
+    (void)memcpy(trailer + CAPTURE_T_MAGIC, CAPTURE_TRAILER_MAGIC, 8);
+    putle64(trailer, CAPTURE_T_OFFSET, index_offset);
+    if (0 == err) {
+        err = write_all(cap->fd, trailer, sizeof(trailer));
+    }
+    if (0 != err) {
+        GPSD_LOG(LOG_ERROR, &session->context->errout,
+                 "CAPTURE: %s capture write failed: %s(%d)\n",
+                 session->gpsdata.dev.path, strerror(err), err);
+    }
+    if (0 < cap->dropped) {
+        GPSD_LOG(LOG_WARN, &session->context->errout,
+                 "CAPTURE: %s capture dropped %llu reads\n",
+                 session->gpsdata.dev.path, cap->dropped);
+    }
+    (void)close(cap->fd);
+    (void)pthread_cond_destroy(&cap->cond);
+    (void)pthread_mutex_destroy(&cap->mutex);
+    free(cap->index);
+    free(cap->fill);
+    free(cap->flush);
+    free(cap);
+}
+
+// open a capture for reading, check its header
+bool capture_reader_open(struct capture_reader_t *reader, const char *path)
+{
+    unsigned char header[CAPTURE_HEADER_LEN];
+    unsigned long hlen;
+
+    (void)memset(reader, 0, sizeof(*reader));
+    reader->fp = fopen(path, "rb");
+    if (NULL == reader->fp) {
+        return false;
+    }
+    if (1 != fread(header, CAPTURE_H_DEVICE + CAPTURE_PATH, 1, reader->fp) ||
+        0 != memcmp(header + CAPTURE_H_MAGIC, CAPTURE_MAGIC, 8) ||
+        CAPTURE_VERSION != getleu32(header, CAPTURE_H_VERSION)) {
+        (void)fclose(reader->fp);
+        reader->fp = NULL;
+        errno = EINVAL;
+        return false;
+    }
+    hlen = getleu32(header, CAPTURE_H_LEN);
+    reader->real_ns = getles64(header, CAPTURE_H_REAL);
+    reader->mono_ns = getles64(header, CAPTURE_H_MONO);
+    (void)memcpy(reader->device, header + CAPTURE_H_DEVICE, CAPTURE_PATH);
+    reader->device[CAPTURE_PATH - 1] = '\0';
+    if (0 != fseek(reader->fp, (long)hlen, SEEK_SET)) {
+        (void)fclose(reader->fp);
+        reader->fp = NULL;
+        return false;
+    }
+    return true;
+}
+
+/* seek to the last data record at or before mono_ns
+ *
+ * Uses the index if there is one, else scans from the start.
+ */
+bool capture_reader_seek(struct capture_reader_t *reader, int64_t mono_ns)
+{
+    unsigned char buf[CAPTURE_REC_LEN];
+    long offset = -1;
+    long pos;
+
+    if (0 == fseek(reader->fp, -CAPTURE_TRAILER_LEN, SEEK_END) &&
+        1 == fread(buf, CAPTURE_TRAILER_LEN, 1, reader->fp) &&
+        0 == memcmp(buf + CAPTURE_T_MAGIC, CAPTURE_TRAILER_MAGIC, 8) &&
+        0 == fseek(reader->fp, (long)getleu64(buf, CAPTURE_T_OFFSET),
+                   SEEK_SET) &&
+        1 == fread(buf, CAPTURE_REC_LEN, 1, reader->fp) &&
+        CAPTURE_INDEX == getleu16(buf, CAPTURE_R_TYPE)) {
+        unsigned long n = getleu32(buf, CAPTURE_R_LEN) / CAPTURE_IDX_LEN;
+
+        while (0 < n-- &&
+               1 == fread(buf, CAPTURE_IDX_LEN, 1, reader->fp) &&
+               getles64(buf, CAPTURE_I_MONO) <= mono_ns) {
+            offset = (long)getleu64(buf, CAPTURE_I_OFFSET);
+        }
+        if (0 > offset) {
+            // before the first entry
+            offset = CAPTURE_HEADER_LEN;
+        }
+        return 0 == fseek(reader->fp, offset, SEEK_SET);
+    }
+
+    // no index, scan
+    if (0 != fseek(reader->fp, CAPTURE_HEADER_LEN, SEEK_SET)) {
+        return false;
+    }
+    for (;;) {
+        pos = ftell(reader->fp);
+        if (1 != fread(buf, CAPTURE_REC_LEN, 1, reader->fp) ||
+            (CAPTURE_DATA == getleu16(buf, CAPTURE_R_TYPE) &&
+             getles64(buf, CAPTURE_R_MONO) >= mono_ns)) {
+            break;
+        }
+        if (0 != fseek(reader->fp, (long)getleu32(buf, CAPTURE_R_LEN),
+                       SEEK_CUR)) {
+            break;
+        }
+    }
+    return 0 == fseek(reader->fp, pos, SEEK_SET);
+}
+
+/* read the next data record, its payload into buf
+ *
+ * Return: 1 = got one
+ *         0 = end of capture
+ *         -1 = bad record, or larger than buflen
+ */
+int capture_reader_next(struct capture_reader_t *reader,
+                        struct capture_rec_t *rec,
+                        unsigned char *buf, size_t buflen)
+{
+    unsigned char header[CAPTURE_REC_LEN];
+
+    for (;;) {
+        if (1 != fread(header, CAPTURE_REC_LEN, 1, reader->fp)) {
+            return 0;
+        }
+        rec->len = getleu32(header, CAPTURE_R_LEN);
+        rec->real_ns = getles64(header, CAPTURE_R_REAL);
+        rec->mono_ns = getles64(header, CAPTURE_R_MONO);
+        if (CAPTURE_DATA != getleu16(header, CAPTURE_R_TYPE)) {
+            // the index, or something newer
+            if (CAPTURE_INDEX == getleu16(header, CAPTURE_R_TYPE)) {
+                return 0;
+            }
+            if (0 != fseek(reader->fp, (long)rec->len, SEEK_CUR)) {
+                return -1;
+            }
+            continue;
+        }
+        if (buflen < rec->len ||
+            (0 < rec->len &&
+             1 != fread(buf, rec->len, 1, reader->fp))) {
+            return -1;
+        }
+        return 1;
+    }
+}
+
+void capture_reader_close(struct capture_reader_t *reader)
+{
+    if (NULL != reader->fp) {
+        (void)fclose(reader->fp);
+        reader->fp = NULL;
+    }
+}
+
+// vim: set expandtab shiftwidth=4
@@ -0,0 +1,253 @@
+/*
+ * dev_async.c - device bring-up that does not stall the main loop
+ *
+ * Activating a serial device opens it, sets the port, flushes it with
+ * a 200 ms settle, sends the wakeup strings, and runs the driver
+ * probes, some of which wait up to a second for an answer.  One device
+ * at a time, twenty receivers, or a USB hub coming back, hold the main
+ * loop, and every client, for many seconds.
+ *
+ * The daemon activates device nodes in a pool of DEVASYNC_WORKERS
+ * threads instead.  While a worker has a device, session->opening is
+ * set, its fd reads as PLACEHOLDING_FD, and the main loop leaves it
+ * alone.  The worker writes each result, whole, into a pipe the main
+ * loop selects on.  devasync_poll() hands the device back and calls the
+ * daemon to finish the open, as netasync_poll() does for name lookups.
+ *
+ * Writes from a worker are the blocking gpsd_serial_write(), and the
+ * flight recorder sees the device from when it is handed back.
+ *
+ * Without devasync_init(), as in gpsmon and gpsctl, gpsd_activate()
+ * opens the device itself, as before.
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+#include "../include/gpsd_config.h"   // must be before all includes
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>                   // for calloc()
+#include <string.h>
+#include <sys/select.h>               // for pselect() per POSIX
+#include <unistd.h>
+
+#include "../include/gpsd.h"
+
+#define DEVASYNC_WORKERS        4       // devices brought up at once
+#define DEVASYNC_QUEUE          MAX_DEVICES
+
+struct devasync_req_t {
+    struct gps_device_t *session;
+    int mode;
+};
+
+// a result, smaller than PIPE_BUF, so one write() is atomic
+struct devasync_reply_t {
+    struct gps_device_t *session;
+    int activated;                      // what gpsd_activate1() returned
+};
+
+struct devasync_t {
+    pthread_t threads[DEVASYNC_WORKERS];
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    struct devasync_req_t queue[DEVASYNC_QUEUE];
+    unsigned head, tail;                // head - tail requests waiting
+    int pending;                        // devices out with the workers
+    int pipefd[2];                      // results, workers to main loop
+    void (*opened)(struct gps_device_t *, int);
+};
+
+// a worker, one device at a time
+static void *devasync_worker(void *arg)
+{
+    struct devasync_t *da = (struct devasync_t *)arg;
+
+    for (;;) {
+        struct devasync_req_t req;
+        struct devasync_reply_t reply;
+
+        (void)pthread_mutex_lock(&da->mutex);
+        while (da->head == da->tail) {
+            (void)pthread_cond_wait(&da->cond, &da->mutex);
+        }
+        req = da->queue[da->tail % DEVASYNC_QUEUE];
+        da->tail++;
+        (void)pthread_mutex_unlock(&da->mutex);
+
+        (void)memset(&reply, 0, sizeof(reply));
+        reply.session = req.session;
+        reply.activated = gpsd_activate1(req.session, req.mode);
+        while (0 > write(da->pipefd[1], &reply, sizeof(reply)) &&
+               EINTR == errno) {
+            continue;
+        }
+    }
+    return NULL;
+}
+
+/* start the bring-up workers
+ * opened -- called in the main loop when a worker is done with a
+ *           device, with what gpsd_activate() would have returned
+ *
+ * Return: the fd to select() on for results, then call devasync_poll()
+ *         -1 on failure, devices then open in the main loop as before
+ */
+int devasync_init(struct gps_context_t *context,
+                  void (*opened)(struct gps_device_t *, int))
+{
+    struct devasync_t *da;
+    sigset_t all, old;
+    int err = 0;
+    int i;
+
+    da = (struct devasync_t *)calloc(1, sizeof(struct devasync_t));
+    if (NULL == da) {
+        GPSD_LOG(LOG_ERROR, &context->errout,
+                 "DEVASYNC: out of memory\n");
+        return -1;
+    }
+    if (0 != pipe(da->pipefd)) {
+        GPSD_LOG(LOG_ERROR, &context->errout,
+                 "DEVASYNC: pipe() failed: %s(%d)\n",
+                 strerror(errno), errno);
+        free(da);
+        return -1;
+    }
+    // the main loop drains the pipe until it would block
+    (void)fcntl(da->pipefd[0], F_SETFL,
+                fcntl(da->pipefd[0], F_GETFL) | O_NONBLOCK);
+    (void)fcntl(da->pipefd[0], F_SETFD, FD_CLOEXEC);
+    (void)fcntl(da->pipefd[1], F_SETFD, FD_CLOEXEC);
+    da->opened = opened;
+    (void)pthread_mutex_init(&da->mutex, NULL);
+    (void)pthread_cond_init(&da->cond, NULL);
+
+    // signals are for the main loop, the workers inherit this mask
+    (void)sigfillset(&all);
+    (void)pthread_sigmask(SIG_BLOCK, &all, &old);
+    for (i = 0; i < DEVASYNC_WORKERS; i++) {
+        err = pthread_create(&da->threads[i], NULL, devasync_worker, da);
+        if (0 != err) {
+            break;
+        }
+        (void)pthread_detach(da->threads[i]);
+    }
+    (void)pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (0 == i) {
+        GPSD_LOG(LOG_ERROR, &context->errout,
+                 "DEVASYNC: pthread_create() failed: %s(%d)\n",
+                 strerror(err), err);
+        (void)pthread_cond_destroy(&da->cond);
+        (void)pthread_mutex_destroy(&da->mutex);
+        (void)close(da->pipefd[0]);
+        (void)close(da->pipefd[1]);
+        free(da);
+        return -1;
+    }
+    // fewer workers than asked for still work
+    context->devasync = da;
+    GPSD_LOG(LOG_PROG, &context->errout,
+             "DEVASYNC: %d bring-up workers started, results on fd %d\n",
+             i, da->pipefd[0]);
+    return da->pipefd[0];
+}
+
+/* hand the activation of a device node to a worker
+ *
+ * Return: true if a worker has it, the daemon is called back when it
+ *         is done
+ *         false if the caller should activate it, not a device node,
+ *         no workers, or the queue is full
+ */
+bool devasync_open(struct gps_device_t *session, const int mode)
+{
+    struct devasync_t *da = session->context->devasync;
+    struct devasync_req_t *req;
+
+    // network sources have net_async.c
+    if (NULL == da ||
+        '/' != session->gpsdata.dev.path[0]) {
+        return false;
+    }
+    (void)pthread_mutex_lock(&da->mutex);
+    if (DEVASYNC_QUEUE <= da->head - da->tail) {
+        (void)pthread_mutex_unlock(&da->mutex);
+        return false;
+    }
+    req = &da->queue[da->head % DEVASYNC_QUEUE];
+    req->session = session;
+    req->mode = mode;
+    da->head++;
+    // before the worker can see it
+    session->opening = true;
+    session->gpsdata.gps_fd = PLACEHOLDING_FD;
+    (void)pthread_cond_signal(&da->cond);
+    (void)pthread_mutex_unlock(&da->mutex);
+    da->pending++;
+    GPSD_LOG(LOG_PROG, &session->context->errout,
+             "DEVASYNC: %s handed to a worker, %d out\n",
+             session->gpsdata.dev.path, da->pending);
+    return true;
+}
+
+// read the results of the workers, call the daemon back on each
+void devasync_poll(struct gps_context_t *context)
+{
+    struct devasync_t *da = context->devasync;
+    struct devasync_reply_t reply;
+
+    if (NULL == da) {
+        return;
+    }
+    while ((ssize_t)sizeof(reply) ==
+           read(da->pipefd[0], &reply, sizeof(reply))) {
+        struct gps_device_t *session = reply.session;
+
+        // the pipe ordered the worker's writes before this
+        session->opening = false;
+        da->pending--;
+        GPSD_LOG(LOG_PROG, &context->errout,
+                 "DEVASYNC: %s back from a worker, fd %d\n",
+                 session->gpsdata.dev.path, reply.activated);
+        if (0 <= reply.activated &&
+            NULL != context->flightrec) {
+            flightrec_open(session);
+        }
+        if (NULL != da->opened) {
+            da->opened(session, reply.activated);
+        }
+    }
+}
+
+/* wait for the workers to be done with all the devices handed to
+ * them, as the daemon does before it drops privileges.  This takes
+ * as long as the slowest of them. */
+void devasync_wait(struct gps_context_t *context)
+{
+    struct devasync_t *da = context->devasync;
+
+    if (NULL == da) {
+        return;
+    }
+    while (0 < da->pending) {
+        fd_set rfds;
+
+        FD_ZERO(&rfds);
+        FD_SET(da->pipefd[0], &rfds);
+        if (0 > pselect(da->pipefd[0] + 1, &rfds, NULL, NULL, NULL, NULL) &&
+            EINTR != errno) {
+            GPSD_LOG(LOG_ERROR, &context->errout,
+                     "DEVASYNC: pselect() failed: %s(%d)\n",
+                     strerror(errno), errno);
+            return;
+        }
+        devasync_poll(context);
+    }
+}
+
+// vim: set expandtab shiftwidth=4
@@ -0,0 +1,177 @@
+/*
+ * flightrec.c - the flight recorder, a binary trace ring in shared memory
+ *
+ * See flightrec.h for the layout.  Only the main thread records.
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+#include "../include/gpsd_config.h"   // must be before all includes
+
+#include <errno.h>
+#include <stdlib.h>                   // for getenv()
+#include <string.h>
+#include <sys/ipc.h>
+#include <sys/shm.h>
+
+#include "../include/flightrec.h"
+#include "../include/gpsd.h"
+
+/* attach the flight recorder segment, create it if needed
+ *
+ * The segment outlives the daemon, so the ring can be read after a
+ * crash.  A restart starts a new ring in it.
+ *
+ * Return: true = OK
+ *         false: failed
+ */
+bool flightrec_acquire(struct gps_context_t *context)
+{
+    long key = getenv("GPSD_FLIGHTREC_KEY") ?
+                   strtol(getenv("GPSD_FLIGHTREC_KEY"), NULL, 0) :
+                   FLIGHTREC_KEY;
+    struct flightrec_t *fr;
+    timespec_t mono, real;
+    int shmid;
+
+    shmid = shmget((key_t)key, sizeof(struct flightrec_t),
+                   (int)(IPC_CREAT | 0644));
+    if (-1 == shmid) {
+        GPSD_LOG(LOG_ERROR, &context->errout,
+                 "FLIGHTREC: shmget(0x%lx, %zd, 0644) failed: %s(%d)\n",
+                 key, sizeof(struct flightrec_t), strerror(errno), errno);
+        return false;
+    }
+    fr = (struct flightrec_t *)shmat(shmid, 0, 0);
+    if ((void *)-1 == fr) {
+        GPSD_LOG(LOG_ERROR, &context->errout,
+                 "FLIGHTREC: shmat() failed: %s(%d)\n",
+                 strerror(errno), errno);
+        return false;
+    }
+
+    // invalidate the old ring before anything else
+    fr->magic = 0;
+    memory_barrier();
+    (void)memset(fr->devices, 0, sizeof(fr->devices));
+    fr->head = 0;
+    fr->tail = 0;
+    fr->version = FLIGHTREC_VERSION;
+    fr->ring_size = FLIGHTREC_RING;
+    (void)clock_gettime(CLOCK_MONOTONIC, &mono);
+    (void)clock_gettime(CLOCK_REALTIME, &real);
+    fr->real_ns = timespec_diff_ns(real, mono);
+    memory_barrier();
+    fr->magic = FLIGHTREC_MAGIC;
+
+    context->flightrec = fr;
+    GPSD_LOG(LOG_PROG, &context->errout,
+             "FLIGHTREC: recording to segment 0x%lx, %d byte ring\n",
+             key, FLIGHTREC_RING);
+    return true;
+}
+
+// detach the flight recorder, leave the segment for readers
+void flightrec_release(struct gps_context_t *context)
+{
+    if (NULL != context->flightrec) {
+        (void)shmdt((const void *)context->flightrec);
+        context->flightrec = NULL;
+    }
+}
+
+// copy len bytes into the ring at pos, wrapping
+static void ring_put(struct flightrec_t *fr, uint64_t pos,
+                     const void *data, size_t len)
+{
+    size_t off = (size_t)(pos & (FLIGHTREC_RING - 1));
+    size_t first = FLIGHTREC_RING - off;
+
+    if (first >= len) {
+        (void)memcpy(fr->ring + off, data, len);
+    } else {
+        (void)memcpy(fr->ring + off, data, first);
+        (void)memcpy(fr->ring, (const char *)data + first, len - first);
+    }
+}
+
+// the length of the record at pos, alignment included
+static uint64_t ring_reclen(const struct flightrec_t *fr, uint64_t pos)
+{
+    size_t off = (size_t)(pos & (FLIGHTREC_RING - 1));
+    uint16_t len;
+
+    // records are 8 aligned, so the len field never wraps
+    (void)memcpy(&len, fr->ring + off, sizeof(len));
+    return FLIGHTREC_ALIGN(sizeof(struct flightrec_rec) + len);
+}
+
+// record that a device was opened, give it a slot in the device table
+void flightrec_open(struct gps_device_t *session)
+{
+    struct flightrec_t *fr = session->context->flightrec;
+    int i, slot = -1;
+
+    for (i = 0; i < FLIGHTREC_DEVICES; i++) {
+        if (0 == strncmp(fr->devices[i], session->gpsdata.dev.path,
+                         sizeof(fr->devices[i]))) {
+            slot = i;
+            break;
+        }
+        if (0 > slot &&
+            '\0' == fr->devices[i][0]) {
+            slot = i;
+        }
+    }
+    if (0 > slot) {
+        // table full, share the last slot
+        slot = FLIGHTREC_DEVICES - 1;
+    }
+    (void)strlcpy(fr->devices[slot], session->gpsdata.dev.path,
+                  sizeof(fr->devices[slot]));
+    session->flightrec_slot = slot;
+    flightrec_record(session, FLIGHTREC_OPEN,
+                     (uint64_t)session->gpsdata.gps_fd, NULL, 0);
+}
+
+/* append a record, dropping the oldest ones to make room
+ * Use the FLIGHTREC() macro, it costs nothing when the recorder is off. */
+void flightrec_record(struct gps_device_t *session, int event, uint64_t arg,
+                      const void *data, size_t len)
+{
+    struct flightrec_t *fr = session->context->flightrec;
+    struct flightrec_rec rec;
+    timespec_t now;
+    uint64_t head = fr->head;
+    uint64_t tail = fr->tail;
+    uint64_t need;
+
+    if (FLIGHTREC_PAYLOAD < len) {
+        len = FLIGHTREC_PAYLOAD;
+    }
+    need = FLIGHTREC_ALIGN(sizeof(rec) + len);
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    rec.len = (uint16_t)len;
+    rec.event = (uint8_t)event;
+    rec.device = (uint8_t)session->flightrec_slot;
+    rec.reserved = 0;
+    rec.mono_ns = (int64_t)now.tv_sec * NS_IN_SEC + now.tv_nsec;
+    rec.arg = arg;
+
+    // move tail past what gets overwritten, before overwriting it
+    while (head + need - tail > FLIGHTREC_RING) {
+        tail += ring_reclen(fr, tail);
+    }
+    fr->tail = tail;
+    memory_barrier();
+    ring_put(fr, head, &rec, sizeof(rec));
+    if (0 < len) {
+        ring_put(fr, head + sizeof(rec), data, len);
+    }
+    memory_barrier();
+    fr->head = head + need;
+}
+
+// vim: set expandtab shiftwidth=4
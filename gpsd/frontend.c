@@ -0,0 +1,764 @@
+/*
+ * frontend.c - client front ends on one core, for the daemon
+ *
+ * One gpsd process parses the devices, and renders and writes the
+ * reports of every client, on one CPU.  With -W the daemon forks that
+ * many front ends.  The core keeps the devices, the front ends the
+ * clients.  Each front end listens on the gpsd port, on a socket of its
+ * own with SO_REUSEPORT, so the kernel spreads the connections over
+ * them, and does ?WATCH, ?POLL and the rest, the rendering, and the
+ * writes, for its own clients.
+ *
+ * The core publishes each report, each change of a device, and each
+ * notify_watchers(), into a ring in shared memory, and wakes the front
+ * ends, through a pipe each, once a pass of its main loop.  A report is
+ * not the whole device, only what the reports of the clients need of
+ * it, see frontend_pack(): the gps_data_t, the packet, the statistics,
+ * and the DEVICE object as the core renders it.  No fds, pointers, or
+ * thread state, those are the core's.  Each record has the bookends of
+ * shmexport.c.  A front end that falls so far behind that a record is
+ * written over drops what it missed, the next report of a device brings
+ * its copy up to date.
+ *
+ * ?DEVICE= and ?TSTATS go to the core, on a datagram socket the front
+ * ends share.  The answer comes back in the ring.
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+#include "../include/gpsd_config.h"  // must be before all includes
+
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stddef.h>                  // for offsetof()
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../include/gpsd.h"
+#include "../include/gps_json.h"         // needs gpsd.h
+
+#ifndef MAP_ANONYMOUS
+#define MAP_ANONYMOUS   MAP_ANON     // older BSD
+#endif
+
+#define FRONTEND_SLOTS  64           // records the ring keeps
+// a message, or a whole reply of the core, ?TSTATS may be long
+#define FRONTEND_TEXT   (GPS_JSON_RESPONSE_MAX + 1)
+
+// what a record is
+#define FRONTEND_REPORT         0    // a device, and what changed
+#define FRONTEND_MESSAGE        1    // a notify_watchers() of the core
+#define FRONTEND_REPLY          2    // the answer to a forwarded request
+
+/* a device, as much of it as the front ends report, frontend_pack()
+ * fills it, frontend_unpack() takes it into the device of a front end */
+struct frontend_dev_t {
+    struct gps_data_t gpsdata;       // gps_fd is UNALLOCATED_FD
+    bool open;                       // the core has it open
+    bool opening;
+    int driver;                      // index in gpsd_drivers[], -1 none
+    servicetype_t servicetype;
+    int observed;
+    bool cycle_end_reliable;
+    timespec_t sor;
+    unsigned long chars;
+    unsigned gga_sats_used;
+    unsigned long relay_seq;
+    struct devstats_t stats;
+    int rtcm_queued;                 // rtcm_sink.count
+    size_t pending;                  // gpsd_serial_pending()
+    int ppsout_count;
+    struct timedelta_t pps_out;
+#ifdef ZODIAC_ENABLE
+    unsigned int Zs[ZODIAC_CHANNELS];
+    unsigned int Zv[ZODIAC_CHANNELS];
+#endif  // ZODIAC_ENABLE
+#ifdef AIVDM_ENABLE
+    char ais_channel;
+#endif  // AIVDM_ENABLE
+    char json[GPS_JSON_RESPONSE_MAX];   // json_device_dump()
+    int lextype;
+    size_t outbuflen;
+    // last, only outbuflen of it, and the NUL, is copied
+    unsigned char outbuffer[MAX_PACKET_LENGTH * 2 + 1];
+};
+
+// what a record is, and who for
+struct frontend_head_t {
+    int kind;
+    int devidx;                      // REPORT, MESSAGE: the device
+    gps_mask_t changed;              // REPORT: 0 if only the device changed
+    // REPORT: the timekeeping of the core, the reports use it
+    int valid;
+    int leap_seconds;
+    unsigned short gps_week;
+    timespec_t gps_tow;
+    int century;
+    int rollovers;
+    bool onjson;                     // MESSAGE: for JSON watchers
+    bool onpps;                      // ... for PPS watchers
+    unsigned int cls;                // ... its GPS_CLASS_*
+    int frontend;                    // REPLY: for this front end
+    int sub;                         // ... and this client of it
+    int fd;                          // ... while it is on this fd
+};
+
+struct frontend_rec_t {
+    volatile unsigned long bookend1;
+    struct frontend_head_t head;
+    union {
+        struct frontend_dev_t dev;   // REPORT
+        char text[FRONTEND_TEXT];    // MESSAGE, REPLY
+    } u;
+    volatile unsigned long bookend2;
+};
+
+struct frontend_ring_t {
+    volatile unsigned long head;     // the last record published
+    struct frontend_rec_t recs[FRONTEND_SLOTS];
+};
+
+// a request of a client of a front end, for the core
+struct frontend_req_t {
+    int frontend;
+    int sub;
+    int fd;
+    bool reply;                      // false if nothing goes back
+    char text[BUFSIZ];
+};
+
+static struct frontend_ring_t *ring;    // shared, made before the forks
+static int nfrontends;
+static struct frontend_t {
+    pid_t pid;                       // 0 if gone
+    int wakefd[2];                   // the core wakes it
+} frontends[FRONTENDS_MAX];
+static int reqfd[2] = {-1, -1};      // requests, front ends to the core
+static int self = -1;                // the front end this is, -1 the core
+static struct gps_context_t *context;
+static struct gps_device_t *devices;
+static int ndevices;
+static int ndrivers;                 // in gpsd_drivers[]
+static struct frontend_hooks_t hooks;
+// core: the PPS threads publish too
+static pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+static bool published;               // core: records since the last wake
+// core: each device as last published, allocated and open or not
+static struct {
+    bool allocated;
+    int fd;
+} seen[MAX_DEVICES];
+// front end: the last record read
+static unsigned long cursor;
+// front end: each device as the core last published it
+static struct {
+    bool open;
+    char json[GPS_JSON_RESPONSE_MAX];   // its DEVICE object
+} shown[MAX_DEVICES];
+
+/* make the ring, the pipes, and the request socket, for n front ends,
+ * before frontend_fork()
+ *
+ * Return: the fd the core gets requests on, then call
+ *         frontend_requests()
+ *         -1 on failure
+ */
+int frontend_init(int n, struct gps_context_t *ctx,
+                  struct gps_device_t *devs, int ndevs,
+                  const struct frontend_hooks_t *h)
+{
+    int i;
+
+    context = ctx;
+    devices = devs;
+    ndevices = MAX_DEVICES < ndevs ? MAX_DEVICES : ndevs;
+    hooks = *h;
+    for (ndrivers = 0; NULL != gpsd_drivers[ndrivers]; ndrivers++) {
+        continue;
+    }
+    ring = mmap(NULL, sizeof(struct frontend_ring_t), PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (MAP_FAILED == ring) {
+        GPSD_LOG(LOG_ERROR, &context->errout,
+                 "FRONTEND: mmap(%zu) failed: %s(%d)\n",
+                 sizeof(struct frontend_ring_t), strerror(errno), errno);
+        ring = NULL;
+        return -1;
+    }
+    if (0 != socketpair(AF_UNIX, SOCK_DGRAM, 0, reqfd)) {
+        GPSD_LOG(LOG_ERROR, &context->errout,
+                 "FRONTEND: socketpair() failed: %s(%d)\n",
+                 strerror(errno), errno);
+        return -1;
+    }
+    (void)fcntl(reqfd[0], F_SETFL, fcntl(reqfd[0], F_GETFL) | O_NONBLOCK);
+    (void)fcntl(reqfd[1], F_SETFL, fcntl(reqfd[1], F_GETFL) | O_NONBLOCK);
+    for (i = 0; i < n && i < FRONTENDS_MAX; i++) {
+        if (0 != pipe(frontends[i].wakefd)) {
+            GPSD_LOG(LOG_ERROR, &context->errout,
+                     "FRONTEND: pipe() failed: %s(%d)\n",
+                     strerror(errno), errno);
+            return -1;
+        }
+        // neither end waits, a wakeup already there will do
+        (void)fcntl(frontends[i].wakefd[0], F_SETFL,
+                    fcntl(frontends[i].wakefd[0], F_GETFL) | O_NONBLOCK);
+        (void)fcntl(frontends[i].wakefd[1], F_SETFL,
+                    fcntl(frontends[i].wakefd[1], F_GETFL) | O_NONBLOCK);
+    }
+    nfrontends = i;
+    for (i = 0; i < ndevices; i++) {
+        seen[i].allocated = '\0' != devices[i].gpsdata.dev.path[0];
+        seen[i].fd = devices[i].gpsdata.gps_fd;
+    }
+    GPSD_LOG(LOG_PROG, &context->errout,
+             "FRONTEND: ring of %d records, %zu bytes, for %d front ends\n",
+             FRONTEND_SLOTS, sizeof(struct frontend_ring_t), nfrontends);
+    return reqfd[0];
+}
+
+/* fork front end i, after frontend_init()
+ *
+ * Return: as fork(), 0 in the front end
+ */
+pid_t frontend_fork(int i)
+{
+    pid_t pid;
+    int j;
+
+    // the PPS threads write to clients under it, do not fork it held
+    gpsd_acquire_reporting_lock();
+    pid = fork();
+    gpsd_release_reporting_lock();
+    if (0 > pid) {
+        GPSD_LOG(LOG_ERROR, &context->errout,
+                 "FRONTEND: fork() failed: %s(%d)\n", strerror(errno), errno);
+        return pid;
+    }
+    if (0 < pid) {
+        frontends[i].pid = pid;
+        (void)close(frontends[i].wakefd[0]);
+        frontends[i].wakefd[0] = -1;
+        if (nfrontends - 1 == i) {
+            // that is all of them, the core does not send requests
+            (void)close(reqfd[1]);
+            reqfd[1] = -1;
+        }
+        GPSD_LOG(LOG_INF, &context->errout,
+                 "FRONTEND: front end %d is pid %ld\n", i, (long)pid);
+        return pid;
+    }
+
+    // the front end, the others' pipes are not its
+    self = i;
+    for (j = 0; j < nfrontends; j++) {
+        if (j != i &&
+            0 <= frontends[j].wakefd[0]) {
+            (void)close(frontends[j].wakefd[0]);
+        }
+        (void)close(frontends[j].wakefd[1]);
+        frontends[j].wakefd[1] = -1;
+        frontends[j].pid = 0;
+    }
+    (void)close(reqfd[0]);
+    reqfd[0] = -1;
+    // the core writes, the front ends only read
+    (void)mprotect(ring, sizeof(struct frontend_ring_t), PROT_READ);
+    cursor = ring->head;
+    return 0;
+}
+
+// the next record to write, under the mutex, its second bookend first
+static struct frontend_rec_t *frontend_next(int kind)
+{
+    unsigned long seq = ring->head + 1;
+    struct frontend_rec_t *rec = &ring->recs[seq % FRONTEND_SLOTS];
+
+    rec->bookend2 = seq;
+    memory_barrier();
+    rec->head.kind = kind;
+    return rec;
+}
+
+// the record is written, the first bookend, then the front ends see it
+static void frontend_done(struct frontend_rec_t *rec)
+{
+    unsigned long seq = rec->bookend2;
+
+    memory_barrier();
+    rec->bookend1 = seq;
+    memory_barrier();
+    ring->head = seq;
+    published = true;
+}
+
+// core: the index of a driver in gpsd_drivers[], -1 for none
+static int frontend_driver(const struct gps_type_t *type)
+{
+    int i;
+
+    if (NULL == type) {
+        return -1;
+    }
+    for (i = 0; NULL != gpsd_drivers[i]; i++) {
+        if (type == gpsd_drivers[i]) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// core: what the front ends report of device, into pub
+static void frontend_pack(struct frontend_dev_t *pub,
+                          struct gps_device_t *device)
+{
+    size_t len = device->lexer.outbuflen;
+
+    pub->gpsdata = device->gpsdata;
+    // the fd is the core's, in a front end the number is some other fd
+    pub->gpsdata.gps_fd = UNALLOCATED_FD;
+    pub->open = !BAD_SOCKET(device->gpsdata.gps_fd);
+    pub->opening = device->opening;
+    pub->driver = frontend_driver(device->device_type);
+    pub->servicetype = device->servicetype;
+    pub->observed = device->observed;
+    pub->cycle_end_reliable = device->cycle_end_reliable;
+    pub->sor = device->sor;
+    pub->chars = device->chars;
+    pub->gga_sats_used = device->nmea.gga_sats_used;
+    pub->relay_seq = device->relay.seq;
+    pub->stats = device->stats;
+    pub->rtcm_queued = device->rtcm_sink.count;
+    pub->pending = gpsd_serial_pending(device);
+    pub->ppsout_count = pps_thread_ppsout(&device->pps_thread,
+                                          &pub->pps_out);
+#ifdef ZODIAC_ENABLE
+    (void)memcpy(pub->Zs, device->driver.zodiac.Zs, sizeof(pub->Zs));
+    (void)memcpy(pub->Zv, device->driver.zodiac.Zv, sizeof(pub->Zv));
+#endif  // ZODIAC_ENABLE
+#ifdef AIVDM_ENABLE
+    pub->ais_channel = device->driver.aivdm.ais_channel;
+#endif  // AIVDM_ENABLE
+    pub->json[0] = '\0';
+    if ('\0' != device->gpsdata.dev.path[0]) {
+        json_device_dump(device, pub->json, sizeof(pub->json));
+    }
+    pub->lextype = device->lexer.type;
+    if (sizeof(pub->outbuffer) <= len) {
+        len = sizeof(pub->outbuffer) - 1;
+    }
+    pub->outbuflen = len;
+    (void)memcpy(pub->outbuffer, device->lexer.outbuffer, len);
+    pub->outbuffer[len] = '\0';
+}
+
+// core: publish device, and what changed in it, 0 if only the device
+static void frontend_publish(struct gps_device_t *device, gps_mask_t changed)
+{
+    struct frontend_rec_t *rec = frontend_next(FRONTEND_REPORT);
+
+    rec->head.devidx = (int)(device - devices);
+    rec->head.changed = changed;
+    rec->head.valid = context->valid;
+    rec->head.leap_seconds = context->leap_seconds;
+    rec->head.gps_week = context->gps_week;
+    rec->head.gps_tow = context->gps_tow;
+    rec->head.century = context->century;
+    rec->head.rollovers = context->rollovers;
+    frontend_pack(&rec->u.dev, device);
+    frontend_done(rec);
+}
+
+// core: publish a report of a device, for the clients of the front ends
+void frontend_report(struct gps_device_t *device, gps_mask_t changed)
+{
+    if (NULL == ring ||
+        0 <= self) {
+        return;
+    }
+    (void)pthread_mutex_lock(&mutex);
+    frontend_publish(device, changed);
+    (void)pthread_mutex_unlock(&mutex);
+}
+
+// the core wakes the front ends, under the mutex
+static void frontend_wake1(void)
+{
+    int i;
+
+    if (!published) {
+        return;
+    }
+    published = false;
+    for (i = 0; i < nfrontends; i++) {
+        if (0 == frontends[i].pid ||
+            0 < write(frontends[i].wakefd[1], "", 1) ||
+            EAGAIN == errno ||
+            EINTR == errno) {
+            // a full pipe is a wakeup not yet read
+            continue;
+        }
+        GPSD_LOG(LOG_ERROR, &context->errout,
+                 "FRONTEND: front end %d, pid %ld, is gone: %s(%d)\n",
+                 i, (long)frontends[i].pid, strerror(errno), errno);
+        (void)waitpid(frontends[i].pid, NULL, WNOHANG);
+        (void)close(frontends[i].wakefd[1]);
+        frontends[i].wakefd[1] = -1;
+        frontends[i].pid = 0;
+    }
+}
+
+/* core: publish a notify_watchers() about device, for the watchers of
+ * the front ends, and wake them at once, it may be a PPS */
+void frontend_message(struct gps_device_t *device, bool onjson, bool onpps,
+                      unsigned int cls, const char *text)
+{
+    struct frontend_rec_t *rec;
+
+    if (NULL == ring ||
+        0 <= self) {
+        return;
+    }
+    (void)pthread_mutex_lock(&mutex);
+    rec = frontend_next(FRONTEND_MESSAGE);
+    rec->head.devidx = (int)(device - devices);
+    rec->head.onjson = onjson;
+    rec->head.onpps = onpps;
+    rec->head.cls = cls;
+    (void)strlcpy(rec->u.text, text, sizeof(rec->u.text));
+    frontend_done(rec);
+    frontend_wake1();
+    (void)pthread_mutex_unlock(&mutex);
+}
+
+// core: the answer to a request from client sub, on fd, of front end fe
+void frontend_reply(int fe, int sub, int fd, const char *text)
+{
+    struct frontend_rec_t *rec;
+
+    if (NULL == ring ||
+        0 <= self) {
+        return;
+    }
+    (void)pthread_mutex_lock(&mutex);
+    rec = frontend_next(FRONTEND_REPLY);
+    rec->head.frontend = fe;
+    rec->head.sub = sub;
+    rec->head.fd = fd;
+    (void)strlcpy(rec->u.text, text, sizeof(rec->u.text));
+    frontend_done(rec);
+    (void)pthread_mutex_unlock(&mutex);
+}
+
+/* core: publish the devices that came or went, or opened or closed,
+ * since the last time, then wake the front ends if there is news.
+ * Once a pass of the main loop.  A device a bring-up worker has is
+ * published once devasync_poll() hands it back. */
+void frontend_wake(void)
+{
+    int i;
+
+    if (NULL == ring ||
+        0 <= self) {
+        return;
+    }
+    (void)pthread_mutex_lock(&mutex);
+    for (i = 0; i < ndevices; i++) {
+        struct gps_device_t *device = &devices[i];
+        bool allocated = '\0' != device->gpsdata.dev.path[0];
+
+        if (device->opening) {
+            // the worker is writing it
+            continue;
+        }
+        if (allocated == seen[i].allocated &&
+            (!allocated ||
+             device->gpsdata.gps_fd == seen[i].fd)) {
+            continue;
+        }
+        seen[i].allocated = allocated;
+        seen[i].fd = device->gpsdata.gps_fd;
+        frontend_publish(device, 0);
+    }
+    frontend_wake1();
+    (void)pthread_mutex_unlock(&mutex);
+}
+
+// core: read the requests of the front ends, hand each to the daemon
+void frontend_requests(void)
+{
+    struct frontend_req_t req;
+    ssize_t len;
+
+    while (0 < (len = recv(reqfd[0], &req, sizeof(req), 0))) {
+        if ((ssize_t)offsetof(struct frontend_req_t, text) >= len) {
+            continue;
+        }
+        req.text[len - offsetof(struct frontend_req_t, text) - 1] = '\0';
+        GPSD_LOG(LOG_CLIENT, &context->errout,
+                 "FRONTEND: <= front end %d client(%d): %s\n",
+                 req.frontend, req.sub, req.text);
+        if (NULL != hooks.request) {
+            hooks.request(req.frontend, req.sub, req.fd, req.reply,
+                          req.text);
+        }
+    }
+}
+
+// core: stop the front ends, at exit
+void frontend_stop(void)
+{
+    int i;
+
+    for (i = 0; i < nfrontends; i++) {
+        if (0 < frontends[i].pid) {
+            (void)kill(frontends[i].pid, SIGTERM);
+            (void)waitpid(frontends[i].pid, NULL, 0);
+            frontends[i].pid = 0;
+        }
+    }
+}
+
+// front end: the fd the core wakes it on, then call frontend_read()
+int frontend_wakefd(void)
+{
+    if (0 > self) {
+        return -1;
+    }
+    return frontends[self].wakefd[0];
+}
+
+/* front end: hand the request text of len bytes, from client sub on fd,
+ * to the core.  With reply, the answer comes back to the reply hook.
+ *
+ * Return: false if the core did not take it
+ */
+bool frontend_forward(int sub, int fd, bool reply, const char *text,
+                      size_t len)
+{
+    struct frontend_req_t req;
+
+    if (0 > self ||
+        sizeof(req.text) <= len) {
+        return false;
+    }
+    memset(&req, 0, offsetof(struct frontend_req_t, text));
+    req.frontend = self;
+    req.sub = sub;
+    req.fd = fd;
+    req.reply = reply;
+    (void)memcpy(req.text, text, len);
+    req.text[len] = '\0';
+    return 0 < send(reqfd[1], &req,
+                    offsetof(struct frontend_req_t, text) + len + 1, 0);
+}
+
+/* front end: is device open in the core?  awaken() can not know, the
+ * fds are the core's */
+bool frontend_open(const struct gps_device_t *device)
+{
+    int i = (int)(device - devices);
+
+    if (0 > self ||
+        0 > i ||
+        ndevices <= i) {
+        return false;
+    }
+    return shown[i].open;
+}
+
+/* front end: the DEVICE object of device, as the core rendered it, into
+ * reply.  Only the core can ask the tty of the device.
+ *
+ * Return: false in the core, or if the core did not publish it yet
+ */
+bool frontend_device_dump(const struct gps_device_t *device, char *reply,
+                          size_t replylen)
+{
+    int i = (int)(device - devices);
+
+    if (0 > self ||
+        0 > i ||
+        ndevices <= i ||
+        '\0' == shown[i].json[0]) {
+        return false;
+    }
+    (void)strlcpy(reply, shown[i].json, replylen);
+    return true;
+}
+
+// front end: take pub, from the ring, into device, the only copy of it
+static void frontend_unpack(struct gps_device_t *device,
+                            const struct frontend_dev_t *pub)
+{
+    int i = (int)(device - devices);
+    size_t len;
+
+    device->gpsdata = pub->gpsdata;
+    // added after the fork, it was never gpsd_init()ed here
+    device->context = context;
+    shown[i].open = pub->open;
+    device->opening = pub->opening;
+    // checked, the record may be torn
+    if (0 <= pub->driver &&
+        ndrivers > pub->driver) {
+        device->device_type = gpsd_drivers[pub->driver];
+    } else {
+        device->device_type = NULL;
+    }
+    device->servicetype = pub->servicetype;
+    device->observed = pub->observed;
+    device->cycle_end_reliable = pub->cycle_end_reliable;
+    device->sor = pub->sor;
+    device->chars = pub->chars;
+    device->nmea.gga_sats_used = pub->gga_sats_used;
+    device->relay.seq = pub->relay_seq;
+    device->stats = pub->stats;
+    device->rtcm_sink.count = pub->rtcm_queued;
+    // a front end writes nothing to the device, only the count is left
+    device->outq.len = pub->pending;
+    device->pps_thread.ppsout_count = pub->ppsout_count;
+    device->pps_thread.pps_out = pub->pps_out;
+#ifdef ZODIAC_ENABLE
+    (void)memcpy(device->driver.zodiac.Zs, pub->Zs, sizeof(pub->Zs));
+    (void)memcpy(device->driver.zodiac.Zv, pub->Zv, sizeof(pub->Zv));
+#endif  // ZODIAC_ENABLE
+#ifdef AIVDM_ENABLE
+    device->driver.aivdm.ais_channel = pub->ais_channel;
+#endif  // AIVDM_ENABLE
+    len = strnlen(pub->json, sizeof(pub->json) - 1);
+    (void)memcpy(shown[i].json, pub->json, len);
+    shown[i].json[len] = '\0';
+    len = pub->outbuflen;
+    device->lexer.type = pub->lextype;
+    if (sizeof(device->lexer.outbuffer) <= len) {
+        len = sizeof(device->lexer.outbuffer) - 1;
+    }
+    device->lexer.outbuflen = len;
+    (void)memcpy(device->lexer.outbuffer, pub->outbuffer, len);
+    device->lexer.outbuffer[len] = '\0';
+}
+
+// front end: call the hooks for a record, as read
+static void frontend_take(const struct frontend_head_t *head,
+                          const char *text)
+{
+    struct gps_device_t *device = NULL;
+
+    if (FRONTEND_REPLY != head->kind) {
+        device = &devices[head->devidx];
+    }
+    switch (head->kind) {
+    case FRONTEND_REPORT:
+        context->valid = head->valid;
+        context->leap_seconds = head->leap_seconds;
+        context->gps_week = head->gps_week;
+        context->gps_tow = head->gps_tow;
+        context->century = head->century;
+        context->rollovers = head->rollovers;
+        if (0 != head->changed &&
+            NULL != hooks.report) {
+            hooks.report(device, head->changed);
+        }
+        break;
+    case FRONTEND_MESSAGE:
+        if (NULL != hooks.message) {
+            hooks.message(device, head->onjson, head->onpps, head->cls,
+                          text);
+        }
+        break;
+    case FRONTEND_REPLY:
+        if (self == head->frontend &&
+            NULL != hooks.reply) {
+            hooks.reply(head->sub, head->fd, text);
+        }
+        break;
+    default:
+        // can not happen
+        break;
+    }
+}
+
+/* front end: take what the core published since the last time, when
+ * the fd of frontend_wakefd() is readable
+ *
+ * Return: false if the core is gone
+ */
+bool frontend_read(void)
+{
+    char buf[64];
+    char text[FRONTEND_TEXT];
+    ssize_t n;
+    unsigned long lost = 0;
+
+    while (0 < (n = read(frontends[self].wakefd[0], buf, sizeof(buf)))) {
+        continue;
+    }
+    if (0 == n) {
+        // end of file, the core closed its end
+        return false;
+    }
+    for (;;) {
+        unsigned long head = ring->head;
+        unsigned long seq;
+        const struct frontend_rec_t *rec;
+        struct frontend_head_t what;
+
+        memory_barrier();
+        if (cursor >= head) {
+            break;
+        }
+        if (FRONTEND_SLOTS <= head - cursor) {
+            // written over, and the next one may be being written
+            lost += head - cursor - (FRONTEND_SLOTS - 1);
+            cursor = head - (FRONTEND_SLOTS - 1);
+        }
+        seq = cursor + 1;
+        cursor = seq;
+        rec = &ring->recs[seq % FRONTEND_SLOTS];
+        if (seq != rec->bookend1) {
+            lost++;
+            continue;
+        }
+        memory_barrier();
+        what = rec->head;
+        text[0] = '\0';
+        if (FRONTEND_REPLY != what.kind &&
+            (0 > what.devidx ||
+             ndevices <= what.devidx)) {
+            continue;
+        }
+        if (FRONTEND_REPORT == what.kind) {
+            /* straight into the device, written over while it is read
+             * the device is torn until its next report */
+            frontend_unpack(&devices[what.devidx], &rec->u.dev);
+        } else {
+            size_t len = strnlen(rec->u.text, sizeof(text) - 1);
+
+            (void)memcpy(text, rec->u.text, len);
+            text[len] = '\0';
+        }
+        memory_barrier();
+        if (seq != rec->bookend2) {
+            // written over while it was read
+            lost++;
+            continue;
+        }
+        frontend_take(&what, text);
+    }
+    if (0 < lost) {
+        GPSD_LOG(LOG_WARN, &context->errout,
+                 "FRONTEND: front end %d fell behind, %lu records lost\n",
+                 self, lost);
+    }
+    return true;
+}
+
+// vim: set expandtab shiftwidth=4
@@ -35,6 +35,7 @@
     // defunct, draft POSIX.1e Standard: 25.2 Capabilities
     #include <sys/capability.h>      // for cap_get_flag()
 #endif
+#include <sys/ioctl.h>               // for ioctl(), TIOCOUTQ
 #include <sys/param.h>               // for setgroups()
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -50,6 +51,7 @@
 #endif  // INADDR_ANY
 
 #include "../include/gpsd.h"
+#include "../include/gps_binary.h"       // needs gpsd.h
 #include "../include/gps_json.h"         // needs gpsd.h
 #include "../include/strfuncs.h"
 
@@ -136,6 +138,35 @@ static fd_set all_fds;
 static int highwater;
 static bool listen_global = false;
 static int maxfd;
+// answers of the resolver thread come in here
+static int netasync_fd = -1;
+static int devasync_fd = -1;
+/* -W front ends, each with its listening sockets.  The core reads their
+ * requests on frontend_fd, in a front end in_frontend is set. */
+static int frontends = 0;
+static socket_t frontend_socks[FRONTENDS_MAX][AFCOUNT];
+static int frontend_fd = -1;
+static bool in_frontend = false;
+// daemon wide performance counters, for ?STATS, main thread only
+static struct metrics_daemon_t daemon_stats;
+// the -M metrics listener, and its connections waiting for a request
+static char *metrics_service = NULL;
+static socket_t metrics_socks[AFCOUNT] = {-1, -1};
+#define METRICS_CONNS   4
+#define METRICS_TIMEOUT 5       // seconds to wait for a request
+static struct metrics_conn_t {
+    socket_t fd;                // -1 if unused
+    time_t since;               // accepted, or last write progress
+    size_t len;
+    char request[512];
+    char *out;                  // the reply not yet written, or NULL
+    size_t outlen;
+    size_t sent;                // ... of it written
+} metrics_conns[METRICS_CONNS];
+// the -c NTRIP caster listener, and its rovers
+static char *caster_service = NULL;
+static socket_t caster_socks[AFCOUNT] = {-1, -1};
+static struct caster_rover_t caster_rovers[CASTER_ROVERS];
 #ifdef FORCE_NOWAIT
     static bool nowait = true;
 #else  // FORCE_NOWAIT
@@ -230,12 +261,16 @@ static void usage(void)
     (void)printf("usage: gpsd [OPTIONS] device...\n\n\
   Options include: \n\
   -?, -h, --help            = help message\n\
+  -B, --batchsock           = coalesce chrony SOCK clock samples\n\
   -b, --readonly            = bluetooth-safe: open data sources read-only\n\
+  -C, --capture DIR         = capture raw device input to files in DIR\n\
+  -c, --caster PORT         = serve RTCM3 as an NTRIP caster on PORT\n\
   -D, --debug integer       = set debug level, default 0 \n\
   -F, --sockfile sockfile   = specify control socket location, default none\n\
   -f, --framing FRAMING     = fix device framing to FRAMING (8N1, 8O1, etc.)\n\
   -G, --listenany           = make gpsd listen on INADDR_ANY\n\
   -l, --drivers             = list compiled in drivers, and exit.\n\
+  -M, --metrics PORT        = serve OpenMetrics on PORT, default none\n\
   -n, --nowait              = don't wait for client connects to poll GPS\n"
 #ifdef FORCE_NOWAIT
 "                             forced on in this binary\n"
@@ -243,10 +278,14 @@ static void usage(void)
 "  -N, --foreground          = don't go into background\n\
   -P, --pidfile pidfile     = set file to record process ID\n\
   -p, --passive             = do not reconfigure the receiver automatically\n\
+  -R, --flightrec           = record device traffic to the flight recorder\n\
   -r, --badtime             = use GPS time even if no fix\n\
   -S, --port PORT           = set port for daemon, default %s\n\
   -s, --speed SPEED         = fix device speed to SPEED, default none\n\
-  -V, --version             = emit version and exit.\n"
+  -U, --udpout DEST         = send reports to DEST, {json|nmea}://host:port\n\
+                              [:CLASSES], may be repeated\n\
+  -V, --version             = emit version and exit.\n\
+  -W, --workers N           = serve clients from N front end processes\n"
 "\nA device may be a local serial device for GNSS input, plus an optional\n\
 PPS device, or a URL in one of the following forms:\n\
      tcp://host[:port]\n\
@@ -301,7 +340,13 @@ static socket_t filesock(char *filename)
 
 #define sub_index(s) (int)((s) - subscribers)
 #define allocated_device(devp)   ('\0' != (devp)->gpsdata.dev.path[0])
-#define free_device(devp)        (devp)->gpsdata.dev.path[0] = '\0'
+// one a bring-up worker has is freed when it is back, device_brought_up()
+#define free_device(devp)                                       \
+    do {                                                        \
+        if (!(devp)->opening) {                                 \
+            (devp)->gpsdata.dev.path[0] = '\0';                 \
+        }                                                       \
+    } while (0)
 #define initialized_device(devp) (NULL != (devp)->context)
 
 /*
@@ -334,9 +379,17 @@ static void adjust_max_fd(int fd, bool on)
 #  define IPTOS_LOWDELAY 0x10
 #endif  // !IPTOS_LOWDELAY
 
-// bind a passive command socket for the daemon
+// FreeBSD spreads the connections over the sockets only with _LB
+#if defined(SO_REUSEPORT_LB)
+#  define GPSD_REUSEPORT SO_REUSEPORT_LB
+#elif defined(SO_REUSEPORT)
+#  define GPSD_REUSEPORT SO_REUSEPORT
+#endif
+
+/* bind a passive command socket for the daemon
+ * shared -- more sockets bind the port, one for each -W front end */
 static socket_t passivesock_af(int af, char *service, char *tcp_or_udp,
-                               int qlen)
+                               int qlen, bool shared)
 {
     volatile socket_t s;
     /*
@@ -474,6 +527,17 @@ static socket_t passivesock_af(int af, char *service, char *tcp_or_udp,
         (void)close(s);
         return -1;
     }
+#ifdef GPSD_REUSEPORT
+    if (shared &&
+        -1 == setsockopt(s, SOL_SOCKET, GPSD_REUSEPORT, (char *)&one,
+                         (socklen_t)sizeof(one))) {
+        GPSD_LOG(LOG_ERROR, &context.errout,
+                 "Error: SETSOCKOPT SO_REUSEPORT %s(%d)\n",
+                 strerror(errno), errno);
+        (void)close(s);
+        return -1;
+    }
+#endif  // GPSD_REUSEPORT
     if (0 > bind(s, &sat.sa, (socklen_t)sin_len)) {
         GPSD_LOG(LOG_ERROR, &context.errout,
                  "Can't bind to %s/%s port %s(%d), %s(%d)\n", af_str,
@@ -522,12 +586,14 @@ static int passivesocks(char *service, char *tcp_or_udp,
 
     if (AF_UNSPEC == af_allowed ||
         AF_INET == af_allowed) {
-        socks[0] = passivesock_af(AF_INET, service, tcp_or_udp, qlen);
+        socks[0] = passivesock_af(AF_INET, service, tcp_or_udp, qlen,
+                                  0 < frontends);
     }
 
     if (AF_UNSPEC == af_allowed ||
         AF_INET6 == af_allowed) {
-        socks[1] = passivesock_af(AF_INET6, service, tcp_or_udp, qlen);
+        socks[1] = passivesock_af(AF_INET6, service, tcp_or_udp, qlen,
+                                  0 < frontends);
     }
 
     for (i = 0; i < AFCOUNT; i++) {
@@ -546,10 +612,22 @@ struct subscriber_t
     int fd;                       // client file descriptor. -1 if unused
     time_t active;                // when subscriber last polled for data
     struct gps_policy_t policy;   // configurable bits
+    unsigned int skip_classes;    // GPS_CLASS_* not to send
+    bool binary;                  // GPSB_CLASSES as binary frames
+    bool relay;                   // ... numbered, of all devices, relay://
+    bool trace;                   // add the trace stages to TPV
+    struct watch_rate_t rate;     // ?WATCH rate control
+    // per device, per class, CLOCK_MONOTONIC seconds the next report is due
+    double rate_next[MAX_DEVICES][WATCH_RATE_CLASSES];
+    // per device, classes held back for coalescing
+    gps_mask_t rate_pending[MAX_DEVICES];
+    unsigned long written;        // bytes written, for ?STATS
+    unsigned long eagain;         // writes that would have blocked
     pthread_mutex_t mutex;        // serialize access to fd
 };
 
-#define subscribed(sub, devp)    (sub->policy.watcher && (sub->policy.devpath[0]=='\0' || strcmp(sub->policy.devpath, devp->gpsdata.dev.path)==0))
+#define subscribed_path(sub, path)    (sub->policy.watcher && (sub->policy.devpath[0]=='\0' || strcmp(sub->policy.devpath, path)==0))
+#define subscribed(sub, devp)    subscribed_path(sub, devp->gpsdata.dev.path)
 
 // indexed by client file descriptor
 static struct subscriber_t subscribers[MAX_CLIENTS];
@@ -621,7 +699,15 @@ static void detach_client(struct subscriber_t *sub)
     sub->policy.timing = false;
     sub->policy.split24 = false;
     sub->policy.devpath[0] = '\0';
+    sub->skip_classes = 0;
+    sub->binary = false;
+    sub->relay = false;
+    sub->trace = false;
+    memset(&sub->rate, 0, sizeof(sub->rate));
+    sub->written = 0;
+    sub->eagain = 0;
     sub->fd = UNALLOCATED_FD;
+    daemon_stats.detached++;
     unlock_subscriber(sub);
 }
 
@@ -660,6 +746,16 @@ static ssize_t throttled_write(struct subscriber_t *sub, const char *buf,
 
     gpsd_acquire_reporting_lock();
     status = write(sub->fd, buf, len);
+    // count under the reporting lock, the PPS thread writes too
+    if (0 < status) {
+        sub->written += status;
+        daemon_stats.written += status;
+    } else if (0 > status &&
+               (EAGAIN == errno ||
+                EWOULDBLOCK == errno)) {
+        sub->eagain++;
+        daemon_stats.eagain++;
+    }
 #ifdef __UNUSED__  // debug
     if (unlikely(LOG_IO <= context.errout.debug)) {
         // flush buffers if high debug level
@@ -701,9 +797,365 @@ static ssize_t throttled_write(struct subscriber_t *sub, const char *buf,
     return status;
 }
 
-// notify all JSON-watching clients of a given device about an event
+/* dump the daemon performance counters, one STATS object for the
+ * daemon and its clients, then one per device.  The clients, and the
+ * devices, that do not fit are left off, the rest stays valid JSON. */
+static void stats_dump(char *reply, size_t replylen)
+{
+    // too big for the stack
+    static char tail[GPS_JSON_RESPONSE_MAX];
+    struct subscriber_t *sub;
+    struct gps_device_t *devp;
+    size_t len;
+
+    // the end of the daemon object, its room is kept
+    (void)strlcpy(tail, "]", sizeof(tail));
+    udpout_stats(tail, sizeof(tail));
+    (void)strlcat(tail, "}\r\n", sizeof(tail));
+
+    (void)snprintf(reply, replylen,
+                   "{\"class\":\"STATS\",\"wakeups\":%lu,"
+                   "\"timeouts\":%lu,\"accepted\":%lu,\"detached\":%lu,"
+                   "\"clients\":[",
+                   daemon_stats.wakeups, daemon_stats.timeouts,
+                   daemon_stats.accepted, daemon_stats.detached);
+    for (sub = subscribers; sub < subscribers + MAX_CLIENTS; sub++) {
+        char entry[128];
+        int queued = -1;
+
+        if (0 == sub->active) {
+            continue;
+        }
+#if defined(TIOCOUTQ)
+        // bytes the kernel has not sent yet
+        if (0 != ioctl(sub->fd, TIOCOUTQ, &queued)) {
+            queued = -1;
+        }
+#elif defined(FIONWRITE)
+        if (0 != ioctl(sub->fd, FIONWRITE, &queued)) {
+            queued = -1;
+        }
+#endif  // TIOCOUTQ
+        (void)snprintf(entry, sizeof(entry),
+                       "{\"client\":%d,\"written\":%lu,\"eagain\":%lu",
+                       sub_index(sub), sub->written, sub->eagain);
+        if (0 <= queued) {
+            str_appendf(entry, sizeof(entry), ",\"queued\":%d", queued);
+        }
+        (void)strlcat(entry, "},", sizeof(entry));
+        len = strnlen(reply, replylen);
+        if (replylen <= len + strlen(entry) + strlen(tail)) {
+            GPSD_LOG(LOG_WARN, &context.errout,
+                     "?STATS: no room for client(%d), and after\n",
+                     sub_index(sub));
+            break;
+        }
+        (void)strlcat(reply, entry, replylen);
+    }
+    str_rstrip_char(reply, ',');
+    (void)strlcat(reply, tail, replylen);
+
+    for (devp = devices; devp < devices + MAX_DEVICES; devp++) {
+        // a bring-up worker is writing the device
+        if (!allocated_device(devp) ||
+            devp->opening) {
+            continue;
+        }
+        len = strnlen(reply, replylen);
+        if (!json_stats_dump(devp, reply + len, replylen - len)) {
+            GPSD_LOG(LOG_WARN, &context.errout,
+                     "?STATS: no room for %s, and after\n",
+                     devp->gpsdata.dev.path);
+            break;
+        }
+    }
+}
+
+// close a metrics connection
+static void metrics_close(struct metrics_conn_t *conn)
+{
+    free(conn->out);
+    conn->out = NULL;
+    (void)close(conn->fd);
+    FD_CLR(conn->fd, &all_fds);
+    adjust_max_fd(conn->fd, false);
+    INVALIDATE_SOCKET(conn->fd);
+}
+
+// accept a connection to the metrics listener, the request comes later
+static void metrics_accept(socket_t lsock)
+{
+    struct metrics_conn_t *conn;
+    socket_t ssock = accept(lsock, NULL, NULL);
+
+    if (BAD_SOCKET(ssock)) {
+        GPSD_LOG(LOG_ERROR, &context.errout,
+                 "metrics accept: %s(%d)\n", strerror(errno), errno);
+        return;
+    }
+    for (conn = metrics_conns; conn < metrics_conns + METRICS_CONNS; conn++) {
+        if (BAD_SOCKET(conn->fd)) {
+            break;
+        }
+    }
+    if (metrics_conns + METRICS_CONNS <= conn ||
+        0 > fcntl(ssock, F_SETFL, fcntl(ssock, F_GETFL) | O_NONBLOCK)) {
+        GPSD_LOG(LOG_WARN, &context.errout,
+                 "metrics connection on fd %ld refused\n", (long)ssock);
+        (void)close(ssock);
+        return;
+    }
+    conn->fd = ssock;
+    conn->since = time(NULL);
+    conn->len = 0;
+    conn->out = NULL;
+    FD_SET(ssock, &all_fds);
+    adjust_max_fd(ssock, true);
+}
+
+/* write what is left of the reply of a metrics connection, close it
+ * once all is written.  The main loop waits for it to be writable. */
+static void metrics_flush(struct metrics_conn_t *conn)
+{
+    ssize_t wr = write(conn->fd, conn->out + conn->sent,
+                       conn->outlen - conn->sent);
+
+    if (0 > wr) {
+        if (EAGAIN != errno &&
+            EINTR != errno) {
+            GPSD_LOG(LOG_WARN, &context.errout,
+                     "metrics(%ld) write: %s(%d)\n",
+                     (long)conn->fd, strerror(errno), errno);
+            metrics_close(conn);
+        }
+        return;
+    }
+    conn->sent += wr;
+    conn->since = time(NULL);
+    if (conn->outlen <= conn->sent) {
+        metrics_close(conn);
+    }
+}
+
+// read the request of a metrics connection, answer once it is all in
+static void metrics_serve(struct metrics_conn_t *conn)
+{
+    static char reply[METRICS_MAX + 256];
+    struct metrics_daemon_t counts = daemon_stats;
+    struct subscriber_t *sub;
+    ssize_t rd;
+    size_t len;
+    int sndbuf;
+
+    rd = read(conn->fd, conn->request + conn->len,
+              sizeof(conn->request) - 1 - conn->len);
+    if (0 >= rd) {
+        if (0 == rd ||
+            (EAGAIN != errno &&
+             EINTR != errno)) {
+            metrics_close(conn);
+        }
+        return;
+    }
+    conn->len += rd;
+    conn->request[conn->len] = '\0';
+    if (NULL == strstr(conn->request, "\r\n\r\n") &&
+        NULL == strstr(conn->request, "\n\n") &&
+        sizeof(conn->request) - 1 > conn->len) {
+        // wait for the end of the headers, we only need the first line
+        return;
+    }
+    GPSD_LOG(LOG_CLIENT, &context.errout, "<= metrics(%ld): %.*s\n",
+             (long)conn->fd, (int)strcspn(conn->request, "\r\n"),
+             conn->request);
+
+    for (sub = subscribers; sub < subscribers + MAX_CLIENTS; sub++) {
+        if (0 != sub->active) {
+            counts.clients++;
+            if (sub->policy.watcher) {
+                counts.watchers++;
+            }
+        }
+    }
+    len = metrics_http(conn->request, &counts, devices, MAX_DEVICES,
+                       reply, sizeof(reply));
+    // room for the page in one write, most times
+    sndbuf = (int)len;
+    (void)setsockopt(conn->fd, SOL_SOCKET, SO_SNDBUF, &sndbuf,
+                     (socklen_t)sizeof(sndbuf));
+    // the request is all in, nothing more to read
+    FD_CLR(conn->fd, &all_fds);
+    conn->out = malloc(len);
+    if (NULL == conn->out) {
+        GPSD_LOG(LOG_ERROR, &context.errout,
+                 "metrics(%ld) no memory for %zu\n", (long)conn->fd, len);
+        metrics_close(conn);
+        return;
+    }
+    (void)memcpy(conn->out, reply, len);
+    conn->outlen = len;
+    conn->sent = 0;
+    metrics_flush(conn);
+    if (NULL != conn->out) {
+        GPSD_LOG(LOG_IO, &context.errout,
+                 "metrics(%ld) %zu of %zu written, the rest later\n",
+                 (long)conn->fd, conn->sent, len);
+    }
+}
+
+// service the metrics listener and its connections
+static void metrics_poll(fd_set *rfds, fd_set *wfds)
+{
+    struct metrics_conn_t *conn;
+    time_t now = time(NULL);
+    int i;
+
+    for (i = 0; i < AFCOUNT; i++) {
+        if (0 <= metrics_socks[i] &&
+            FD_ISSET(metrics_socks[i], rfds)) {
+            metrics_accept(metrics_socks[i]);
+            FD_CLR(metrics_socks[i], rfds);
+        }
+    }
+    for (conn = metrics_conns; conn < metrics_conns + METRICS_CONNS; conn++) {
+        if (BAD_SOCKET(conn->fd)) {
+            continue;
+        }
+        if (NULL != conn->out) {
+            if (FD_ISSET(conn->fd, wfds)) {
+                metrics_flush(conn);
+                continue;
+            }
+        } else if (FD_ISSET(conn->fd, rfds)) {
+            FD_CLR(conn->fd, rfds);
+            metrics_serve(conn);
+            continue;
+        }
+        // waiting for a request, or for the client to take the reply
+        if (METRICS_TIMEOUT < now - conn->since) {
+            GPSD_LOG(LOG_INF, &context.errout,
+                     "metrics(%ld) timed out\n", (long)conn->fd);
+            metrics_close(conn);
+        }
+    }
+}
+
+// close a caster connection
+static void caster_close(struct caster_rover_t *rover)
+{
+    if (rover->streaming) {
+        GPSD_LOG(LOG_INF, &context.errout,
+                 "caster(%ld): rover on %s gone, %lu frames, %lu dropped\n",
+                 (long)rover->fd, rover->mount, rover->frames,
+                 rover->dropped);
+    }
+    (void)close(rover->fd);
+    FD_CLR(rover->fd, &all_fds);
+    adjust_max_fd(rover->fd, false);
+    INVALIDATE_SOCKET(rover->fd);
+}
+
+// accept a rover, its request comes later
+static void caster_accept(socket_t lsock)
+{
+    struct caster_rover_t *rover;
+    socket_t ssock = accept(lsock, NULL, NULL);
+
+    if (BAD_SOCKET(ssock)) {
+        GPSD_LOG(LOG_ERROR, &context.errout,
+                 "caster accept: %s(%d)\n", strerror(errno), errno);
+        return;
+    }
+    for (rover = caster_rovers; rover < caster_rovers + CASTER_ROVERS;
+         rover++) {
+        if (BAD_SOCKET(rover->fd)) {
+            break;
+        }
+    }
+    if (caster_rovers + CASTER_ROVERS <= rover ||
+        0 > fcntl(ssock, F_SETFL, fcntl(ssock, F_GETFL) | O_NONBLOCK)) {
+        GPSD_LOG(LOG_WARN, &context.errout,
+                 "caster connection on fd %ld refused\n", (long)ssock);
+        (void)close(ssock);
+        return;
+    }
+    (void)memset(rover, 0, sizeof(*rover) - sizeof(rover->buf));
+    rover->fd = ssock;
+    rover->since = time(NULL);
+    FD_SET(ssock, &all_fds);
+    adjust_max_fd(ssock, true);
+}
+
+// service the caster listener and its rovers
+static void caster_poll(fd_set *rfds, fd_set *wfds)
+{
+    struct caster_rover_t *rover;
+    time_t now = time(NULL);
+    int i;
+
+    for (i = 0; i < AFCOUNT; i++) {
+        if (0 <= caster_socks[i] &&
+            FD_ISSET(caster_socks[i], rfds)) {
+            caster_accept(caster_socks[i]);
+            FD_CLR(caster_socks[i], rfds);
+        }
+    }
+    for (rover = caster_rovers; rover < caster_rovers + CASTER_ROVERS;
+         rover++) {
+        if (BAD_SOCKET(rover->fd)) {
+            continue;
+        }
+        if (FD_ISSET(rover->fd, wfds) &&
+            !caster_flush(rover)) {
+            caster_close(rover);
+            continue;
+        }
+        if (FD_ISSET(rover->fd, rfds)) {
+            FD_CLR(rover->fd, rfds);
+            if (!caster_read(rover, devices, MAX_DEVICES, &context.errout)) {
+                caster_close(rover);
+                continue;
+            }
+        }
+        // waiting for a request, or stuck behind its backlog
+        if ((!rover->streaming ||
+             0 < rover->len) &&
+            CASTER_TIMEOUT < now - rover->since) {
+            GPSD_LOG(LOG_INF, &context.errout,
+                     "caster(%ld) timed out\n", (long)rover->fd);
+            caster_close(rover);
+        }
+    }
+}
+
+// send an RTCM3 frame of device to its rovers
+static void caster_relay(struct gps_device_t *device)
+{
+    struct caster_rover_t *rover;
+    char mount[GPS_PATH_MAX];
+
+    mount[0] = '\0';
+    for (rover = caster_rovers; rover < caster_rovers + CASTER_ROVERS;
+         rover++) {
+        if (BAD_SOCKET(rover->fd) ||
+            !rover->streaming) {
+            continue;
+        }
+        if ('\0' == mount[0]) {
+            caster_mountpoint(device, mount, sizeof(mount));
+        }
+        if (0 == strcmp(mount, rover->mount) &&
+            !caster_frame(rover, device->lexer.outbuffer,
+                          device->lexer.outbuflen)) {
+            caster_close(rover);
+        }
+    }
+}
+
+/* notify all JSON-watching clients of a given device about an event
+ * cls is the GPS_CLASS_* of the event, 0 if it is always sent */
 static void notify_watchers(struct gps_device_t *device,
-                            bool onjson, bool onpps,
+                            bool onjson, bool onpps, unsigned int cls,
                             const char *sentence, ...)
 {
     va_list ap;
@@ -718,10 +1170,13 @@ static void notify_watchers(struct gps_device_t *device,
         // uh, oh
         return;
     }
+    // with -W, the watchers are in the front ends
+    frontend_message(device, onjson, onpps, cls, buf);
 
     for (sub = subscribers; sub < subscribers + MAX_CLIENTS; sub++) {
         if (0 != sub->active &&
-            subscribed(sub, device)) {
+            subscribed(sub, device) &&
+            0 == (sub->skip_classes & cls)) {
             if ((onjson &&
                  sub->policy.json) ||
                 (onpps && sub->policy.pps)) {
@@ -735,10 +1190,15 @@ static void notify_watchers(struct gps_device_t *device,
 // deactivate device, but leave it in the pool (do not free it)
 static void deactivate_device(struct gps_device_t *device)
 {
-    notify_watchers(device, true, false,
+    notify_watchers(device, true, false, 0,
                     "{\"class\":\"DEVICE\",\"path\":\"%s\","
                     "\"activated\":0}\r\n",
                     device->gpsdata.dev.path);
+    if (device->opening) {
+        // a worker has it, device_brought_up() closes it
+        device->unwanted = true;
+        return;
+    }
     if (!BAD_SOCKET(device->gpsdata.gps_fd)) {
         FD_CLR(device->gpsdata.gps_fd, &all_fds);
         adjust_max_fd(device->gpsdata.gps_fd, false);
@@ -776,10 +1236,14 @@ static struct gps_device_t *find_device(const char *device_name)
 }
 
 /* open the input device
+ * mode -- O_OPTIMIZE, or O_CONTINUE when the open goes on after a
+ *         name lookup
  * return: false on failure
  *         true on success
  */
-static bool open_device( struct gps_device_t *device)
+static bool device_activated(struct gps_device_t *device, int activated);
+
+static bool open_device1(struct gps_device_t *device, const int mode)
 {
     int activated = -1;
 
@@ -793,7 +1257,20 @@ static bool open_device( struct gps_device_t *device)
              device->gpsdata.dev.path,
              (long)device->gpsdata.gps_fd);
 
-    activated = gpsd_activate(device, O_OPTIMIZE);
+    activated = gpsd_activate(device, mode);
+    if (device->opening) {
+        // a bring-up worker has it, device_brought_up() gets back to it
+        return true;
+    }
+    return device_activated(device, activated);
+}
+
+/* carry on opening a device gpsd_activate() returned activated for
+ * return: false on failure
+ *         true on success
+ */
+static bool device_activated(struct gps_device_t *device, int activated)
+{
     if (0 > activated &&
         PLACEHOLDING_FD != activated) {
         // failed to open device, and not a /dev/ppsX or ntrip://, etc.
@@ -802,8 +1279,9 @@ static bool open_device( struct gps_device_t *device)
         return false;
     }
 
-    // do not open ntpshm for NTRIP
-    if (SERVICE_NTRIP != device->servicetype) {
+    // do not open ntpshm for NTRIP, or before the name is looked up
+    if (SERVICE_NTRIP != device->servicetype &&
+        !device->netconn.resolving) {
         /*
          * Now is the right time to grab the shared memory segment(s)
          * to communicate the navigation message derived and (possibly)
@@ -836,12 +1314,61 @@ static bool open_device( struct gps_device_t *device)
             return true;
         }
     }
+    if (0 > device->gpsdata.gps_fd) {
+        // name lookup in progress, device_resolved() gets back to it
+        return true;
+    }
     FD_SET(device->gpsdata.gps_fd, &all_fds);
     adjust_max_fd(device->gpsdata.gps_fd, true);
     ++highwater;
     return true;
 }
 
+static bool open_device(struct gps_device_t *device)
+{
+    return open_device1(device, O_OPTIMIZE);
+}
+
+// a bring-up worker is done with a device, carry on opening it
+static void device_brought_up(struct gps_device_t *device, int activated)
+{
+    if (device->unwanted) {
+        // removed while the worker had it
+        device->unwanted = false;
+        GPSD_LOG(LOG_INF, &context.errout,
+                 "CORE: %s removed while opening, closing it\n",
+                 device->gpsdata.dev.path);
+        if (0 <= activated) {
+            gpsd_deactivate(device);
+        }
+        free_device(device);
+        return;
+    }
+    if (!device_activated(device, activated)) {
+        GPSD_LOG(LOG_WARN, &context.errout, "%s: open failed\n",
+                 device->gpsdata.dev.path);
+    }
+}
+
+// the resolver thread answered, carry on opening the device
+static void device_resolved(struct gps_device_t *device)
+{
+    if (!allocated_device(device)) {
+        return;
+    }
+    if (SERVICE_NTRIP == device->servicetype) {
+        // ntrip_open() puts the fd in all_fds itself
+        (void)ntrip_open(device, "");
+        return;
+    }
+    if (PLACEHOLDING_FD == device->gpsdata.gps_fd &&
+        !open_device1(device, O_CONTINUE)) {
+        GPSD_LOG(LOG_ERROR, &context.errout,
+                 "CORE: %s open failed after name lookup\n",
+                 device->gpsdata.dev.path);
+    }
+}
+
 /* add a device to the pool; open it right away if in nowait mode
  * return: false on failure
  *         true on success
@@ -875,7 +1402,7 @@ bool gpsd_add_device(const char *device_name, bool flag_nowait)
                 devp->gpsdata.gps_fd = UNALLOCATED_FD;
                 ret = true;
             }
-            notify_watchers(devp, true, false,
+            notify_watchers(devp, true, false, 0,
                             "{\"class\":\"DEVICE\",\"path\":\"%s\","
                             "\"activated\":\"%s\"}\r\n",
                             devp->gpsdata.dev.path,
@@ -915,7 +1442,7 @@ static const char *write_gps(char *device, char *hex, size_t len) {
     GPSD_LOG(LOG_INF, &context.errout,
              "GPS <=: writing %zd bytes fromhex(%s) to %s\n",
              st, hex, device);
-    if (0 >= write(devp->gpsdata.gps_fd, buf, (size_t)st)) {
+    if (0 >= gpsd_write(devp, (const char *)buf, (size_t)st)) {
         GPSD_LOG(LOG_WARN, &context.errout,
                  "GPS <=: write to device failed. %s(%d)\n",
                  strerror(errno), errno);
@@ -1013,8 +1540,8 @@ static void handle_control(int sfd, char *buf)
                     GPSD_LOG(LOG_INF, &context.errout,
                              "<= control(%d): writing to %s \n", sfd,
                              stash);
-                    if (0 >= write(devp->gpsdata.gps_fd, eq,
-                                   (end - (buf + 1)) - (eq - stash))) {
+                    if (0 >= gpsd_write(devp, eq,
+                                        (end - (buf + 1)) - (eq - stash))) {
                         GPSD_LOG(LOG_WARN, &context.errout,
                                  "<= control(%d): device write failed %s(%d)\n",
                                  sfd, strerror(errno), errno);
@@ -1051,6 +1578,13 @@ static void handle_control(int sfd, char *buf)
                 ignore_return(write(sfd, ERROR, sizeof(ERROR) - 1));
             }
         }
+    } else if (strstr(buf, "?stats") == buf) {
+        // write back the performance counters followed by OK
+        char reply[GPS_JSON_RESPONSE_MAX];
+
+        stats_dump(reply, sizeof(reply));
+        ignore_return(write(sfd, reply, strnlen(reply, sizeof(reply))));
+        ignore_return(write(sfd, OK, sizeof(OK) - 1));
     } else if (strstr(buf, "?devices") == buf) {
         // write back devices list followed by OK
         for (devp = devices; devp < devices + MAX_DEVICES; devp++) {
@@ -1082,6 +1616,15 @@ static bool awaken(struct gps_device_t *device)
              (int)(device - devices),
              (long)device->gpsdata.gps_fd, device->gpsdata.dev.path);
 
+    if (device->opening) {
+        // a bring-up worker has it
+        return true;
+    }
+    if (in_frontend) {
+        // the core has the devices, awake there or not
+        return frontend_open(device);
+    }
+
     // open that device
     if ((!initialized_device(device) &&
          !open_device(device))) {
@@ -1224,6 +1767,17 @@ static void set_serial(struct gps_device_t *device,
     }
 }
 
+// the DEVICE object of devp, in a front end as the core rendered it
+static void device_dump(const struct gps_device_t *devp, char *reply,
+                        size_t replylen)
+{
+    if (!frontend_device_dump(devp, reply, replylen)) {
+        json_device_dump(devp, reply, replylen);
+    }
+}
+
+/* the DEVICES list, without the devices a bring-up worker has, they
+ * are listed once they are open */
 static void json_devicelist_dump(char *reply, size_t replylen)
 {
     struct gps_device_t *devp;
@@ -1233,9 +1787,10 @@ static void json_devicelist_dump(char *reply, size_t replylen)
         size_t reply_len = strnlen(reply, GPS_JSON_RESPONSE_MAX - 3);
         size_t path_len = strnlen(devp->gpsdata.dev.path, GPS_PATH_MAX);
         if (allocated_device(devp) &&
+            !devp->opening &&
             (reply_len + path_len + 3) < (replylen - 1)) {
             char *cp;
-            json_device_dump(devp, reply + reply_len, replylen - reply_len);
+            device_dump(devp, reply + reply_len, replylen - reply_len);
             cp = reply + strnlen(reply, GPS_JSON_RESPONSE_MAX - 3);
             *--cp = '\0';
             *--cp = '\0';
@@ -1259,6 +1814,55 @@ static void rstrip(char *str, size_t replylen)
     }
 }
 
+// send a relay:// feed the frames after seq that are still kept
+static void relay_send(struct subscriber_t *sub, unsigned long seq)
+{
+    const char *frames;
+    size_t len;
+
+    while (NULL != (frames = relay_replay(&seq, &len))) {
+        if (0 == throttled_write(sub, frames, len)) {
+            break;
+        }
+    }
+}
+
+/* a watcher is a relay:// feed, send it the frames after resume, none
+ * if resume is 0 */
+static void relay_watch(struct subscriber_t *sub, unsigned long resume)
+{
+    int sndbuf = 2 * RELAY_BACKLOG;   // room for a replay of all of them
+
+    sub->binary = true;
+    relay_start();
+    (void)setsockopt(sub->fd, SOL_SOCKET, SO_SNDBUF, &sndbuf,
+                     sizeof(sndbuf));
+    if (0 == resume) {
+        return;
+    }
+    GPSD_LOG(LOG_INF, &context.errout,
+             "client(%d) relay resumes after frame %lu\n",
+             sub_index(sub), resume);
+    relay_send(sub, resume);
+}
+
+/* a front end: pass the ?WATCH of client sub, len bytes at start, on to
+ * the core, which has the gpsd:// sources to pass it on to */
+static void watch_forward(struct subscriber_t *sub, const char *start,
+                          size_t len)
+{
+    struct gps_device_t *devp;
+
+    for (devp = devices; devp < devices + MAX_DEVICES; devp++) {
+        if (allocated_device(devp) &&
+            SOURCE_GPSD == devp->sourcetype) {
+            (void)frontend_forward(sub_index(sub), sub->fd, false, start,
+                                   len);
+            return;
+        }
+    }
+}
+
 static void handle_request(struct subscriber_t *sub, const char *buf,
                            size_t bufsize, const char **after,
                            char *reply, size_t replylen)
@@ -1282,7 +1886,22 @@ static void handle_request(struct subscriber_t *sub, const char *buf,
             ++buf;
         } else {
             char *host, *port, *device;  // for parse_uri_dest()
-            int status = json_watch_read(buf + 1, &sub->policy, &end);
+            struct watch_request_t req;
+            int status = json_watch_read(buf + 1, &sub->policy, &req, &end);
+
+            if (0 == status) {
+                sub->skip_classes = req.skip;
+                sub->binary = req.binary;
+                sub->trace = req.trace;
+                sub->relay = req.relay;
+                if (sub->relay) {
+                    relay_watch(sub, req.resume);
+                }
+                sub->rate = req.rate;   // struct copy
+                // restart the schedules
+                memset(sub->rate_next, 0, sizeof(sub->rate_next));
+                memset(sub->rate_pending, 0, sizeof(sub->rate_pending));
+            }
 
             if (NULL == end) {
                 buf += strnlen(buf, bufsize - 1);
@@ -1301,12 +1920,16 @@ static void handle_request(struct subscriber_t *sub, const char *buf,
                 GPSD_LOG(LOG_ERROR, &context.errout, "response: %s\n", reply);
             } else if (sub->policy.watcher) {
                 // enable:true
+                if (in_frontend) {
+                    watch_forward(sub, start, (size_t)(end - start));
+                }
                 if (sub->policy.devpath[0] == '\0') {
                     // awaken all devices
                     for (devp = devices; devp < devices + MAX_DEVICES; devp++)
                         if (allocated_device(devp)) {
                             (void)awaken(devp);
-                            if (SOURCE_GPSD == devp->sourcetype) {
+                            if (SOURCE_GPSD == devp->sourcetype &&
+                                !in_frontend) {
                                 // wake all, so no devpath/remote issues
                                 (void)gpsd_write(devp, start,
                                                  (size_t)(end-start));
@@ -1316,7 +1939,10 @@ static void handle_request(struct subscriber_t *sub, const char *buf,
                     // awaken specific device
 #ifdef __UNUSED__
                     char outbuf[GPS_JSON_RESPONSE_MAX];
-                    json_watch_dump(&sub->policy, outbuf, sizeof(outbuf));
+                    json_watch_dump(&sub->policy, &sub->rate,
+                                    sub->skip_classes, sub->binary,
+                                    sub->trace, outbuf,
+                                    sizeof(outbuf));
                     GPSD_LOG(0, &context.errout, "policy: %s\n", outbuf);
 #endif
                     devp = find_device(sub->policy.devpath);
@@ -1329,7 +1955,8 @@ static void handle_request(struct subscriber_t *sub, const char *buf,
                                  "response: %s\n", reply);
                         goto bailout;
                     } else if (awaken(devp)) {
-                        if (SOURCE_GPSD == devp->sourcetype) {
+                        if (SOURCE_GPSD == devp->sourcetype &&
+                            !in_frontend) {
                             /* FIXME: the device into this daemon is
                              * not the device to pass to the remote daemon.
                              * local device = gpsd://host::/device
@@ -1371,13 +1998,15 @@ static void handle_request(struct subscriber_t *sub, const char *buf,
         // return a device list and the user's policy
         json_devicelist_dump(reply + strnlen(reply, replylen),
                              replylen - strnlen(reply, replylen));
-        json_watch_dump(&sub->policy,
+        json_watch_dump(&sub->policy, &sub->rate, sub->skip_classes,
+                        sub->binary, sub->trace,
                         reply + strnlen(reply, replylen),
                         replylen - strnlen(reply, replylen));
     } else if (str_starts_with(buf, "?DEVICE") &&
                (';' == buf[7] ||
                 '=' == buf[7])) {
         struct devconfig_t devconf;
+        const char *start = buf;
 
         buf += 7;
         devconf.path[0] = '\0';    // initially, no device selection
@@ -1385,9 +2014,10 @@ static void handle_request(struct subscriber_t *sub, const char *buf,
             ++buf;
         } else {
             struct gps_device_t *device;
+            const char *devjson = buf + 1;
 
             // first, select a device to operate on
-            int status = json_device_read(buf + 1, &devconf, &end);
+            int status = json_device_read(devjson, &devconf, &end);
             if (NULL == end) {
                 buf += strnlen(buf, bufsize);
             } else {
@@ -1404,6 +2034,18 @@ static void handle_request(struct subscriber_t *sub, const char *buf,
                                json_error_string(status));
                 GPSD_LOG(LOG_ERROR, &context.errout, "response: %s\n", reply);
                 goto bailout;
+            } else if (in_frontend) {
+                // the core has the devices, it answers
+                if (!frontend_forward(sub_index(sub), sub->fd, true, start,
+                                      (size_t)(buf - start))) {
+                    (void)snprintf(reply, replylen,
+                                   "{\"class\":\"ERROR\","
+                                   "\"message\":\"DEVICE not sent to the "
+                                   "core.\"}\r\n");
+                    GPSD_LOG(LOG_ERROR, &context.errout,
+                             "response: %s\n", reply);
+                }
+                goto bailout;
             } else {
                 if ('\0' != devconf.path[0]) {
                     // user specified a path, try to assign it
@@ -1448,7 +2090,22 @@ static void handle_request(struct subscriber_t *sub, const char *buf,
                     }
                     // we should have exactly one device now
                 }
-                if (NULL == device->device_type) {
+                if (0 != json_device_rtcm_read(devjson, device)) {
+                    (void)snprintf(reply, replylen,
+                                   "{\"class\":\"ERROR\","
+                                   "\"message\":\"Invalid DEVICE rtcm\"}"
+                                   "\r\n");
+                    GPSD_LOG(LOG_ERROR, &context.errout,
+                             "response: %s\n", reply);
+                    goto bailout;
+                }
+                if (device->opening) {
+                    str_appendf(reply, replylen,
+                                   "{\"class\":\"ERROR\","
+                                   "\"message\":\"%s is still opening.\""
+                                   "}\r\n",
+                                   device->gpsdata.dev.path);
+                } else if (NULL == device->device_type) {
                     str_appendf(reply, replylen,
                                    "{\"class\":\"ERROR\","
                                    "\"message\":\"Type of %s is unknown.\""
@@ -1526,14 +2183,15 @@ static void handle_request(struct subscriber_t *sub, const char *buf,
         // dump a response for each selected channel
         len = strnlen(reply, replylen);
         for (devp = devices; devp < devices + MAX_DEVICES; devp++) {
-            if (!allocated_device(devp)) {
+            if (!allocated_device(devp) ||
+                devp->opening) {
                 continue;
             }
             if ('\0' != devconf.path[0] &&
                 0 != strcmp(devp->gpsdata.dev.path, devconf.path)) {
                 continue;
             }
-            json_device_dump(devp, reply + len, replylen - len);
+            device_dump(devp, reply + len, replylen - len);
         }
     } else if (str_starts_with(buf, "?POLL;")) {
         char tbuf[JSON_DATE_MAX+1];
@@ -1555,7 +2213,7 @@ static void handle_request(struct subscriber_t *sub, const char *buf,
         for (devp = devices; devp < devices + MAX_DEVICES; devp++) {
             if (allocated_device(devp) && subscribed(sub, devp)) {
                 if (0 != (devp->observed & GPS_TYPEMASK)) {
-                    json_tpv_dump(NAVDATA_SET, devp, &sub->policy,
+                    json_tpv_dump(NAVDATA_SET, devp, &sub->policy, false,
                                   reply + strnlen(reply, replylen),
                                   replylen - strnlen(reply, replylen));
                     rstrip(reply, replylen);
@@ -1594,6 +2252,37 @@ static void handle_request(struct subscriber_t *sub, const char *buf,
     } else if (str_starts_with(buf, "?VERSION;")) {
         buf += 9;
         json_version_dump(reply, replylen);
+    } else if (str_starts_with(buf, "?TSTATS;")) {
+        buf += 8;
+        if (in_frontend) {
+            // the time statistics are the core's, it answers
+            if (!frontend_forward(sub_index(sub), sub->fd, true, buf - 8,
+                                  8)) {
+                (void)snprintf(reply, replylen,
+                               "{\"class\":\"ERROR\","
+                               "\"message\":\"TSTATS not sent to the "
+                               "core.\"}\r\n");
+                GPSD_LOG(LOG_ERROR, &context.errout,
+                         "response: %s\n", reply);
+            }
+            goto bailout;
+        }
+        // one TSTATS object per device
+        for (devp = devices; devp < devices + MAX_DEVICES; devp++) {
+            if (!allocated_device(devp)) {
+                continue;
+            }
+            len = strnlen(reply, replylen);
+            if (!json_tstats_dump(devp, reply + len, replylen - len)) {
+                GPSD_LOG(LOG_WARN, &context.errout,
+                         "?TSTATS: no room for %s, and after\n",
+                         devp->gpsdata.dev.path);
+                break;
+            }
+        }
+    } else if (str_starts_with(buf, "?STATS;")) {
+        buf += 7;
+        stats_dump(reply, replylen);
     } else {
         const char *errend;
         // a buffer to put the "quoted" bad json into
@@ -1714,21 +2403,336 @@ static void pseudonmea_report(struct subscriber_t *sub,
     }
 }
 
-// report on the current packet from a specified device
-static void all_reports(struct gps_device_t *device, gps_mask_t changed)
+/* Report the GPSB_CLASSES as binary frames, in the order
+ * json_data_report() would, with one write for all of them.
+ * Return: the GPS_CLASS_* that are left for JSON */
+static unsigned int binary_report(struct subscriber_t *sub,
+                                  gps_mask_t changed,
+                                  struct gps_device_t *device,
+                                  unsigned int classes)
 {
-    struct subscriber_t *sub;
+    struct gps_data_t *datap = &device->gpsdata;
+    char buf[GPSB_MAX * 4];
+    size_t len = 0;
+    int i;
 
-    GPSD_LOG(LOG_DATA, &context.errout, "all_reports(): changed %s\n",
-             gps_maskdump(changed));
+// room left for the next frame
+#define GPSB_ROOM MIN(sizeof(buf) - len, GPSB_MAX)
 
-    // add any just-identified device to watcher lists
-    if (0 != (changed & DRIVER_IS)) {
-        bool listeners = false;
+    if (0 != (changed & REPORT_IS)) {
+        if (0 != (classes & GPS_CLASS_TPV)) {
+            int leap = -1;
 
-        for (sub = subscribers;
-             sub < subscribers + MAX_CLIENTS; sub++) {
-            if (0 != sub->active &&
+            if (LEAP_SECOND_VALID == (context.valid & LEAP_SECOND_VALID)) {
+                leap = context.leap_seconds;
+            }
+            len += gpsb_tpv_dump(datap, leap, buf + len, GPSB_ROOM);
+        }
+        if (0 != (changed & ATTITUDE_SET) &&
+            0 != (classes & GPS_CLASS_ATT)) {
+            len += gpsb_att_dump(datap, &datap->attitude, GPSB_ATT,
+                                 buf + len, GPSB_ROOM);
+        }
+    }
+    if (0 != (changed & (DOP_SET | SATELLITE_SET)) &&
+        0 != (classes & GPS_CLASS_SKY)) {
+        len += gpsb_sky_dump(datap, buf + len, GPSB_ROOM);
+    }
+    if (0 != (changed & RAW_IS) &&
+        0 != (classes & GPS_CLASS_RAW)) {
+        len += gpsb_raw_dump(datap, buf + len, GPSB_ROOM);
+    }
+    if (0 != (changed & IMU_SET) &&
+        0 != (classes & GPS_CLASS_IMU)) {
+        for (i = 0; i < (int)ROWS(datap->imu); i++) {
+            if ('\0' == datap->imu[i].msg[0]) {
+                break;
+            }
+            len += gpsb_att_dump(datap, &datap->imu[i], GPSB_IMU,
+                                 buf + len, GPSB_ROOM);
+        }
+    }
+#undef GPSB_ROOM
+
+    if (0 < len) {
+        GPSD_LOG(LOG_IO, &context.errout,
+                 "<= GPS (binary frames) %s: %zu bytes\n",
+                 datap->dev.path, len);
+        (void)throttled_write(sub, buf, len);
+    }
+    return classes & ~GPSB_CLASSES;
+}
+
+/* Decode the relay:// frame the device just read, for the watchers that
+ * want JSON.  The path of the device is that of the frame, until the
+ * caller puts it back.
+ * Return: the changed bits json_data_report() reports its class on */
+static gps_mask_t relay_unpack(struct gps_device_t *device,
+                               unsigned int frame_class)
+{
+    if (0 != libgps_binary_unpack((const char *)device->lexer.outbuffer,
+                                  device->lexer.outbuflen,
+                                  &device->gpsdata)) {
+        GPSD_LOG(LOG_WARN, &context.errout,
+                 "RELAY: %s garbled frame\n", device->gpsdata.dev.path);
+        return 0;
+    }
+    switch (frame_class) {
+    case GPS_CLASS_TPV:
+        return REPORT_IS;
+    case GPS_CLASS_SKY:
+        return DOP_SET | SATELLITE_SET;
+    case GPS_CLASS_ATT:
+        return REPORT_IS | ATTITUDE_SET;
+    case GPS_CLASS_IMU:
+        return IMU_SET;
+    case GPS_CLASS_RAW:
+        return RAW_IS;
+    default:
+        // a class from the future
+        return 0;
+    }
+}
+
+/* the changed bits that trigger each rate controlled class, and the
+ * bits its report depends on, in json_data_report() */
+static const struct {
+    gps_mask_t trigger;
+    gps_mask_t carry;
+} watch_rate_masks[WATCH_RATE_CLASSES] = {
+    {REPORT_IS, REPORT_IS | NAVDATA_SET | ATTITUDE_SET},   // TPV, ATT
+    {DOP_SET | SATELLITE_SET, DOP_SET | SATELLITE_SET},    // SKY
+    {GST_SET, GST_SET},                                     // GST
+    {IMU_SET, IMU_SET},                                     // IMU
+    {RAW_IS, RAW_IS},                                       // RAW
+};
+
+/* Remove from changed the classes this subscriber is not due for.
+ * The schedule is a grid, so the long term rate is exact.
+ * With coalesce a held back class is reported, from the latest data,
+ * on the first report from the device after it comes due. */
+static gps_mask_t watch_rate_filter(struct subscriber_t *sub,
+                                    const struct gps_device_t *device,
+                                    gps_mask_t changed, double now)
+{
+    int devidx = (int)(device - devices);
+    int i;
+
+    for (i = 0; i < WATCH_RATE_CLASSES; i++) {
+        double ival = sub->rate.interval[i];
+        double *next = &sub->rate_next[devidx][i];
+        gps_mask_t carry = watch_rate_masks[i].carry;
+        gps_mask_t want = changed & carry;
+
+        if (0.0 >= ival) {
+            continue;
+        }
+        if (sub->rate.coalesce) {
+            want |= sub->rate_pending[devidx] & carry;
+        }
+        if (0 == (want & watch_rate_masks[i].trigger)) {
+            continue;
+        }
+        if (now + ival * WATCH_RATE_SLACK < *next) {
+            // not yet
+            changed &= ~carry;
+            if (sub->rate.coalesce) {
+                sub->rate_pending[devidx] |= want;
+            }
+            continue;
+        }
+        *next += ival;
+        if (*next <= now) {
+            // first report, or we fell behind, restart the grid
+            *next = now + ival;
+        }
+        if (sub->rate.coalesce) {
+            changed |= want;
+            sub->rate_pending[devidx] &= ~carry;
+        }
+    }
+    return changed;
+}
+
+/* report on the current packet from a specified device to the clients,
+ * in the core, or in a -W front end from the copy the core published */
+static void client_reports(struct gps_device_t *device, gps_mask_t changed)
+{
+    struct subscriber_t *sub;
+    struct timespec ts_now;
+    double now = 0.0;       // CLOCK_MONOTONIC, for ?WATCH rate control
+    unsigned long relay_from;       // the relay frame before this report
+    bool framed = false;            // a frame from a relay:// feed
+    unsigned int frame_class = 0;   // ... its GPS_CLASS_*
+    bool decoded = false;           // ... into device->gpsdata
+    // the path of the device, a decoded frame sets its own
+    char devpath[GPS_PATH_MAX];
+
+    (void)strlcpy(devpath, device->gpsdata.dev.path, sizeof(devpath));
+    if (GPSB_PACKET == device->lexer.type &&
+        0 != (changed & PASSTHROUGH_IS)) {
+        // a frame from a relay:// feed, it goes on as it is
+        framed = true;
+        frame_class = gpsb_frame_class((const char *)device->lexer.outbuffer);
+        relay_from = relay_forward(device);
+        for (sub = subscribers; sub < (subscribers + MAX_CLIENTS); sub++) {
+            if (0 != sub->active &&
+                subscribed(sub, device) &&
+                sub->policy.json &&
+                !sub->relay &&
+                (!sub->binary ||
+                 sub->rate.limited)) {
+                break;
+            }
+        }
+        if (sub < (subscribers + MAX_CLIENTS)) {
+            // a watcher wants JSON, only then decode it
+            changed = relay_unpack(device, frame_class);
+            decoded = true;
+        }
+    } else {
+        int leap = -1;
+
+        if (LEAP_SECOND_VALID == (context.valid & LEAP_SECOND_VALID)) {
+            leap = context.leap_seconds;
+        }
+        relay_from = relay_report(device, changed, leap);
+    }
+
+    // update all subscribers associated with this device
+    for (sub = subscribers; sub < (subscribers + MAX_CLIENTS); sub++) {
+        if (0 == sub->active ||
+            !subscribed_path(sub, devpath)) {
+            continue;
+        }
+
+        if (framed) {
+            if (sub->relay) {
+                relay_send(sub, relay_from);
+                continue;
+            }
+            if (sub->policy.json &&
+                sub->binary &&
+                !sub->rate.limited) {
+                // the frame, as it came, it has all they want
+                if (0 == (sub->skip_classes & frame_class)) {
+                    (void)throttled_write(sub,
+                                          (char *)device->lexer.outbuffer,
+                                          device->lexer.outbuflen);
+                }
+                continue;
+            }
+            if (!decoded) {
+                // nothing to send it
+                continue;
+            }
+        } else if (sub->relay) {
+            relay_send(sub, relay_from);
+        }
+
+        // this is for passing through JSON packets
+        if (0 != (changed & PASSTHROUGH_IS)) {
+            (void)strlcat((char *)device->lexer.outbuffer, "\r\n",
+                          sizeof(device->lexer.outbuffer));
+            (void)throttled_write(sub,
+                                  (char *)device->lexer.outbuffer,
+                                  device->lexer.outbuflen+2);
+            continue;
+        }
+
+        // report raw packets to users subscribed to those
+        raw_report(sub, device);
+
+        // FIXME: get rid of this define, used only once.
+#define DATA_IS ~(ONLINE_SET | PACKET_SET | CLEAR_IS | REPORT_IS)
+
+        // some listeners may be in watcher mode
+        if (sub->policy.watcher) {
+            if ((changed & DATA_IS) ||
+                (changed & REPORT_IS)) {
+                GPSD_LOG(LOG_PROG, &context.errout,
+                         "Changed mask: %s with %sreliable "
+                         "cycle detection\n",
+                         gps_maskdump(changed),
+                         device->cycle_end_reliable ? "" : "un");
+                if (0 != (changed & REPORT_IS)) {
+                    GPSD_LOG(LOG_PROG, &context.errout,
+                             "time to report a fix\n");
+                }
+
+                if (sub->policy.nmea) {
+                    pseudonmea_report(sub, changed, device);
+                }
+
+                if (sub->policy.json) {
+                    char buf[GPS_JSON_RESPONSE_MAX * 4];
+                    gps_mask_t due = changed;
+                    unsigned int classes;
+
+                    if (0 != (changed & AIS_SET) &&
+                        24 == device->gpsdata.ais.type &&
+                        device->gpsdata.ais.type24.part != both &&
+                        !sub->policy.split24) {
+                        continue;
+                    }
+
+                    if (sub->rate.limited) {
+                        if (0.0 == now) {
+                            (void)clock_gettime(CLOCK_MONOTONIC, &ts_now);
+                            now = TSTONS(&ts_now);
+                        }
+                        due = watch_rate_filter(sub, device, changed, now);
+                    }
+                    classes = ~sub->skip_classes;
+                    if (decoded) {
+                        classes &= frame_class;
+                    } else if (sub->relay) {
+                        // it got those as numbered frames
+                        classes &= ~GPSB_CLASSES;
+                    } else if (sub->binary) {
+                        classes = binary_report(sub, due, device, classes);
+                    }
+                    json_data_report(due, device, &sub->policy, classes,
+                                     sub->trace, buf, sizeof(buf));
+                    if ('\0' != buf[0]) {
+                        (void)throttled_write(sub, buf,
+                                              strnlen(buf, sizeof(buf)));
+                    }
+                    if (0 != (due & REPORT_IS) &&
+                        0 == (sub->skip_classes & GPS_CLASS_TPV)) {
+                        // from the read(), to this watcher's TPV write
+                        gpsd_latency_add(&device->stats.write,
+                                         &device->stats.pkt_read);
+                    }
+                }
+            }
+        }
+    }   // subscribers
+    if (decoded) {
+        (void)strlcpy(device->gpsdata.dev.path, devpath,
+                      sizeof(device->gpsdata.dev.path));
+    }
+    if (0 != (changed & REPORT_IS)) {
+        // from the lexer returning the packet, to the last client write
+        gpsd_latency_add(&device->stats.report, &device->stats.pkt_mono);
+    }
+}
+
+// report on the current packet from a specified device
+static void all_reports(struct gps_device_t *device, gps_mask_t changed)
+{
+    struct subscriber_t *sub;
+
+    GPSD_LOG(LOG_DATA, &context.errout, "all_reports(): changed %s\n",
+             gps_maskdump(changed));
+
+    // add any just-identified device to watcher lists
+    if (0 != (changed & DRIVER_IS)) {
+        bool listeners = false;
+
+        for (sub = subscribers;
+             sub < subscribers + MAX_CLIENTS; sub++) {
+            if (0 != sub->active &&
                 sub->policy.watcher &&
                 subscribed(sub, device)) {
                 listeners = true;
@@ -1750,7 +2754,7 @@ static void all_reports(struct gps_device_t *device, gps_mask_t changed)
             char id2[GPS_JSON_RESPONSE_MAX];
 
             json_device_dump(device, id2, sizeof(id2));
-            notify_watchers(device, true, false, id2);
+            notify_watchers(device, true, false, 0, id2);
         }
     }
 
@@ -1778,32 +2782,10 @@ static void all_reports(struct gps_device_t *device, gps_mask_t changed)
                      "overlong RTCM3 packet %zd bytes (%d max)\n",
                      device->lexer.outbuflen, RTCM3_MAX);
         } else {
-            struct gps_device_t *dp;
-            for (dp = devices; dp < (devices + MAX_DEVICES); dp++) {
-                if (!allocated_device(dp) ||
-                    0 > device->gpsdata.gps_fd) {
-                    continue;
-                }
-                if (NULL != dp->device_type &&
-                    NULL != dp->device_type->rtcm_writer) {
-                    // FIXME: don't write back to source
-                    ssize_t ret = dp->device_type->rtcm_writer(dp,
-                                     (const char *)device->lexer.outbuffer,
-                                     device->lexer.outbuflen);
-                    if (0 < ret) {
-                        GPSD_LOG(LOG_IO, &context.errout,
-                                 "<= DGPS/NTRIP: %zd bytes of RTCM relayed.\n",
-                                 device->lexer.outbuflen);
-                    } else if (0 == ret) {
-                        // nothing written, probably read_only
-                    } else {
-                        GPSD_LOG(LOG_ERROR, &context.errout,
-                                 "<= DGPS/NTRIP: Write to RTCM sink failed, "
-                                 " type %s\n",
-                                 dp->device_type->type_name);
-                    }
-                }
+            if (RTCM3_PACKET == device->lexer.type) {
+                caster_relay(device);
             }
+            rtcm_relay(device, devices, MAX_DEVICES);
         }
     }
 
@@ -1875,7 +2857,7 @@ static void all_reports(struct gps_device_t *device, gps_mask_t changed)
         // delay and allows the PPS samples to be sent at a higher rate
         // than the message-based samples sent here
 
-        notify_watchers(device, false, true,
+        notify_watchers(device, false, true, GPS_CLASS_TOFF,
                         "{\"class\":\"TOFF\",\"device\":\"%s\",\"real_sec\":"
                         "%lld, \"real_nsec\":%ld,\"clock_sec\":%lld,"
                         "\"clock_nsec\":%ld,\"precision\":%d,"
@@ -1945,67 +2927,10 @@ static void all_reports(struct gps_device_t *device, gps_mask_t changed)
              gps_maskdump(changed),
              gps_maskdump(device->gpsdata.set_pending));
 
-    // update all subscribers associated with this device
-    for (sub = subscribers; sub < (subscribers + MAX_CLIENTS); sub++) {
-        if (0 == sub->active ||
-            !subscribed(sub, device)) {
-            continue;
-        }
-
-        // this is for passing through JSON packets
-        if (0 != (changed & PASSTHROUGH_IS)) {
-            (void)strlcat((char *)device->lexer.outbuffer, "\r\n",
-                          sizeof(device->lexer.outbuffer));
-            (void)throttled_write(sub,
-                                  (char *)device->lexer.outbuffer,
-                                  device->lexer.outbuflen+2);
-            continue;
-        }
-
-        // report raw packets to users subscribed to those
-        raw_report(sub, device);
-
-        // FIXME: get rid of this define, used only once.
-#define DATA_IS ~(ONLINE_SET | PACKET_SET | CLEAR_IS | REPORT_IS)
-
-        // some listeners may be in watcher mode
-        if (sub->policy.watcher) {
-            if ((changed & DATA_IS) ||
-                (changed & REPORT_IS)) {
-                GPSD_LOG(LOG_PROG, &context.errout,
-                         "Changed mask: %s with %sreliable "
-                         "cycle detection\n",
-                         gps_maskdump(changed),
-                         device->cycle_end_reliable ? "" : "un");
-                if (0 != (changed & REPORT_IS)) {
-                    GPSD_LOG(LOG_PROG, &context.errout,
-                             "time to report a fix\n");
-                }
-
-                if (sub->policy.nmea) {
-                    pseudonmea_report(sub, changed, device);
-                }
-
-                if (sub->policy.json) {
-                    char buf[GPS_JSON_RESPONSE_MAX * 4];
-
-                    if (0 != (changed & AIS_SET) &&
-                        24 == device->gpsdata.ais.type &&
-                        device->gpsdata.ais.type24.part != both &&
-                        !sub->policy.split24) {
-                        continue;
-                    }
-
-                    json_data_report(changed, device, &sub->policy,
-                                     buf, sizeof(buf));
-                    if ('\0' != buf[0]) {
-                        (void)throttled_write(sub, buf,
-                                              strnlen(buf, sizeof(buf)));
-                    }
-                }
-            }
-        }
-    }   // subscribers
+    // the -U destinations get the same reports, and the -W front ends
+    udpout_report(device, changed);
+    frontend_report(device, changed);
+    client_reports(device, changed);
 }
 
 /* Execute GPSD requests (?POLL, ?WATCH, etc.) from a buffer.
@@ -2070,7 +2995,7 @@ static void ship_pps_message(struct gps_device_t *session, int unit,
                     session->gpsdata.qErr);
     }
     (void)strlcat(buf, "}\r\n", sizeof(buf));
-    notify_watchers(session, true, true, buf);
+    notify_watchers(session, true, true, GPS_CLASS_PPS, buf);
 
     /*
      * PPS receipt resets the device's timeout.  This keeps PPS-only
@@ -2183,6 +3108,309 @@ static void gpsd_terminate(struct gps_context_t *context)
     context->pps_hook = NULL;   // tell any PPS-watcher thread to die
 }
 
+// a new client on a listening socket
+static void client_accept(socket_t lsock)
+{
+    sockaddr_t fsin = {0};
+
+    socklen_t alen = (socklen_t)sizeof(fsin);
+    socket_t ssock = accept(lsock, &fsin.sa, &alen);
+
+    if (BAD_SOCKET(ssock)) {
+        // with -W, another front end may have taken it
+        if (EAGAIN != errno &&
+            EWOULDBLOCK != errno) {
+            GPSD_LOG(LOG_ERROR, &context.errout,
+                     "accept: fail: %s(%d)\n", strerror(errno), errno);
+        }
+    } else {
+        struct subscriber_t *client = NULL;
+        int opts = fcntl(ssock, F_GETFL);
+        struct linger linger = {1, RELEASE_TIMEOUT};
+        char ip[INET6_ADDRSTRLEN];
+
+        if (0 > opts) {
+            GPSD_LOG(LOG_ERROR, &context.errout,
+                     "accept: fcntl(F_GETFL): %s(%d)\n",
+                     strerror(errno), errno);
+        } else {
+            opts = fcntl(ssock, F_SETFL, opts | O_NONBLOCK);
+            if (0 > opts) {
+                // supposedly can never happen.
+                GPSD_LOG(LOG_ERROR, &context.errout,
+                         "accept: fcntl(F_SETFL): %s(%d)\n",
+                         strerror(errno), errno);
+            }
+        }
+
+        (void)socka2a(&fsin, ip, sizeof(ip));
+        client = allocate_client();
+        if (NULL == client) {
+            // cast for 32-bit intptr_t
+            GPSD_LOG(LOG_ERROR, &context.errout,
+                     "Client %s connect on fd %ld -"
+                     "no subscriber slots available\n", ip,
+                      (long)ssock);
+            (void)close(ssock);
+        } else if (-1 == setsockopt(ssock,
+                                    SOL_SOCKET, SO_LINGER,
+                                    (char *)&linger,
+                                    (int)sizeof(struct linger))) {
+            GPSD_LOG(LOG_ERROR, &context.errout,
+                     "Error: SETSOCKOPT SO_LINGER. %s(%d)\n",
+                     strerror(errno), errno);
+            (void)close(ssock);
+        } else {
+            char announce[GPS_JSON_RESPONSE_MAX];
+            FD_SET(ssock, &all_fds);
+            adjust_max_fd(ssock, true);
+            client->fd = ssock;
+            client->active = time(NULL);
+            daemon_stats.accepted++;
+            // cast for 32-bit intptr_t
+            GPSD_LOG(LOG_SPIN, &context.errout,
+                     "client %s (%d) connect on fd %ld\n", ip,
+                     sub_index(client), (long)ssock);
+            json_version_dump(announce, sizeof(announce));
+            (void)throttled_write(client, announce,
+                                  strnlen(announce,
+                                          sizeof(announce)));
+        }
+    }
+}
+
+// read and execute the commands of the clients that sent some
+static void clients_serve(fd_set *rfds)
+{
+    struct subscriber_t *sub;
+
+    for (sub = subscribers; sub < subscribers + MAX_CLIENTS; sub++) {
+        if (0 == sub->active) {
+            continue;
+        }
+
+        lock_subscriber(sub);
+        if (FD_ISSET(sub->fd, rfds)) {
+            char buf[BUFSIZ];
+            ssize_t buflen;
+
+            unlock_subscriber(sub);
+
+            GPSD_LOG(LOG_PROG, &context.errout,
+                     "checking client(%d)\n",
+                     sub_index(sub));
+            buflen = recv(sub->fd, buf, sizeof(buf) - 1, 0);
+            if (0 > buflen) {
+                // recv() error, give up.
+                detach_client(sub);
+                GPSD_LOG(LOG_CLIENT, &context.errout,
+                         "<= client(%d): error read\n", sub_index(sub));
+            } else if (0 == buflen) {
+                /* Ugh, "man recv" says recv() returns 0 on disconnect!
+                 * So we have to disconnect client.
+                 * But somehow, dormant serial connections also
+                 * return 0.  Should FD_ISSET() have prevented getting
+                 * here in that case?
+                 */
+                detach_client(sub);
+                GPSD_LOG(LOG_CLIENT, &context.errout,
+                         "<= client(%d): eof read\n", sub_index(sub));
+            } else {
+                if ('\n' != buf[buflen - 1]) {
+                    buf[buflen++] = '\n';
+                }
+                buf[buflen] = '\0';
+                GPSD_LOG(LOG_CLIENT, &context.errout,
+                         "<= client(%d): %s\n", sub_index(sub), buf);
+
+                /*
+                 * When a command comes in, update subscriber.active to
+                 * timestamp() so we don't close the connection
+                 * after COMMAND_TIMEOUT seconds. This makes
+                 * COMMAND_TIMEOUT useful.
+                 */
+                sub->active = time(NULL);
+                if (0 > handle_gpsd_request(sub, buf, sizeof(buf))) {
+                    detach_client(sub);
+                }
+            }
+        } else {
+            unlock_subscriber(sub);
+
+            if (!sub->policy.watcher &&
+                COMMAND_TIMEOUT < (time(NULL) - sub->active)) {
+                GPSD_LOG(LOG_WARN, &context.errout,
+                         "client(%d) timed out on command wait.\n",
+                         sub_index(sub));
+                detach_client(sub);
+            }
+        }
+    }
+}
+
+// the core: a request of client si, on fd, of front end fe
+static void frontend_asked(int fe, int si, int fd, bool reply,
+                           const char *text)
+{
+    // the core answers it as a client of its own that is never written
+    static struct subscriber_t proxy;
+    char buf[GPS_JSON_RESPONSE_MAX + 1];
+    const char *end;
+
+    (void)memset(&proxy, 0, sizeof(proxy));
+    proxy.fd = UNALLOCATED_FD;
+    buf[0] = '\0';
+    for (end = text; '\0' != *text; text = end) {
+        if (isspace((unsigned char)*text)) {
+            end = text + 1;
+        } else {
+            size_t len = strnlen(buf, sizeof(buf));
+
+            handle_request(&proxy, text, strlen(text) + 1, &end,
+                           buf + len, sizeof(buf) - len);
+        }
+    }
+    if (reply) {
+        frontend_reply(fe, si, fd, buf);
+    }
+}
+
+// a front end: a notify_watchers() of the core, for its watchers
+static void frontend_notified(struct gps_device_t *device, bool onjson,
+                              bool onpps, unsigned int cls, const char *text)
+{
+    notify_watchers(device, onjson, onpps, cls, "%s", text);
+}
+
+// a front end: the answer of the core to client si, if it is still on fd
+static void frontend_answered(int si, int fd, const char *text)
+{
+    struct subscriber_t *sub;
+
+    if (0 > si ||
+        MAX_CLIENTS <= si) {
+        return;
+    }
+    sub = &subscribers[si];
+    if (0 == sub->active ||
+        fd != sub->fd) {
+        // gone
+        return;
+    }
+    (void)throttled_write(sub, text, strnlen(text, GPS_JSON_RESPONSE_MAX));
+}
+
+static const struct frontend_hooks_t frontend_hooks = {
+    frontend_asked,
+    client_reports,
+    frontend_notified,
+    frontend_answered,
+};
+
+/* front end i of -W, forked by the core, serves the clients on socks
+ * until the core is gone.  Never returns. */
+static void frontend_main(int i, socket_t *socks)
+{
+    struct gps_device_t *device;
+    struct subscriber_t *sub;
+    int wakefd = frontend_wakefd();
+    int j, k;
+
+    in_frontend = true;
+    // the core has the devices and the other listeners
+    for (device = devices; device < devices + MAX_DEVICES; device++) {
+        if (allocated_device(device) &&
+            !device->opening &&
+            0 <= device->gpsdata.gps_fd) {
+            (void)close(device->gpsdata.gps_fd);
+        }
+        // the numbers are the core's, the clients may get them here
+        device->gpsdata.gps_fd = UNALLOCATED_FD;
+    }
+    for (j = 0; j < AFCOUNT; j++) {
+        if (0 <= metrics_socks[j]) {
+            (void)close(metrics_socks[j]);
+        }
+        if (0 <= caster_socks[j]) {
+            (void)close(caster_socks[j]);
+        }
+        for (k = 0; k < frontends; k++) {
+            if (0 <= frontend_socks[k][j] &&
+                frontend_socks[k][j] != socks[j]) {
+                (void)close(frontend_socks[k][j]);
+            }
+        }
+    }
+    if (0 <= netasync_fd) {
+        (void)close(netasync_fd);
+    }
+    if (0 <= devasync_fd) {
+        (void)close(devasync_fd);
+    }
+    if (0 <= frontend_fd) {
+        (void)close(frontend_fd);
+    }
+
+    FD_ZERO(&all_fds);
+    maxfd = 0;
+    for (j = 0; j < AFCOUNT; j++) {
+        if (0 <= socks[j]) {
+            // the others may take a connection first
+            (void)fcntl(socks[j], F_SETFL,
+                        fcntl(socks[j], F_GETFL) | O_NONBLOCK);
+            FD_SET(socks[j], &all_fds);
+            adjust_max_fd(socks[j], true);
+        }
+    }
+    FD_SET(wakefd, &all_fds);
+    adjust_max_fd(wakefd, true);
+    // the core restarts on SIGHUP, the front ends go on
+    (void)signal(SIGHUP, SIG_IGN);
+    // so the relay:// frames are numbered alike in all of them
+    relay_start();
+    GPSD_LOG(LOG_INF, &context.errout,
+             "front end %d (pid %ld) serving clients\n",
+             i, (long)getpid());
+
+    while (0 == signalled) {
+        static const timespec_t ts_timeout = {2, 0};
+        fd_set rfds, wfds, efds;
+        int await;
+
+        FD_ZERO(&wfds);
+        await = gpsd_await_data(&rfds, &wfds, &efds, maxfd, &all_fds,
+                                &context.errout, ts_timeout);
+        if (AWAIT_FAILED == await) {
+            break;
+        }
+        if (AWAIT_NOT_READY == await) {
+            // a signal, or a client fd gone bad
+            continue;
+        }
+        if (FD_ISSET(wakefd, &rfds) &&
+            !frontend_read()) {
+            GPSD_LOG(LOG_WARN, &context.errout,
+                     "front end %d: the core is gone\n", i);
+            break;
+        }
+        for (j = 0; j < AFCOUNT; j++) {
+            if (0 <= socks[j] &&
+                FD_ISSET(socks[j], &rfds)) {
+                client_accept(socks[j]);
+            }
+        }
+        clients_serve(&rfds);
+    }
+
+    for (sub = subscribers; sub < (subscribers + MAX_CLIENTS); sub++) {
+        if (0 != sub->active) {
+            detach_client(sub);
+        }
+    }
+    // not exit(), the atexit() handlers are the core's
+    _exit(EXIT_SUCCESS);
+}
+
 int main(int argc, char *argv[])
 {
     // some of these statics suppress -W warnings due to longjmp()
@@ -2201,6 +3429,7 @@ int main(int argc, char *argv[])
     socket_t msocks[2] = {-1, -1};
     bool device_opened = false;
     bool go_background = true;
+    bool flightrec = false;
     volatile bool in_restart;
     struct timespec now, delta;
     const char *sudo = getenv("SUDO_COMMAND");
@@ -2208,6 +3437,8 @@ int main(int argc, char *argv[])
 
 
     gps_context_init(&context, "gpsd");
+    // the main loop drains what devices do not take at once
+    context.async_write = true;
 
 #ifdef CONTROL_SOCKET_ENABLE
     INVALIDATE_SOCKET(csock);
@@ -2215,19 +3446,24 @@ int main(int argc, char *argv[])
 #endif  // CONTROL_SOCKET_ENABLE
 
     while (1) {
-        const char *optstring = "?bD:F:f:GhlNnpP:rS:s:V";
+        const char *optstring = "?BbC:c:D:F:f:GhlM:NnpP:RrS:s:U:VW:";
         int ch;
 
 #ifdef HAVE_GETOPT_LONG
         int option_index = 0;
         static struct option long_options[] = {
             {"badtime", no_argument, NULL, 'r'},
+            {"batchsock", no_argument, NULL, 'B'},
+            {"capture", required_argument, NULL, 'C'},
+            {"caster", required_argument, NULL, 'c'},
             {"debug", required_argument, NULL, 'D'},
             {"drivers", no_argument, NULL, 'l'},
+            {"flightrec", no_argument, NULL, 'R'},
             {"foreground", no_argument, NULL, 'N'},
             {"framing", required_argument, NULL, 'f'},
             {"help", no_argument, NULL, 'h'},
             {"listenany", no_argument, NULL, 'G' },
+            {"metrics", required_argument, NULL, 'M'},
             {"nowait", no_argument, NULL, 'n' },
             {"readonly", no_argument, NULL, 'b'},
             {"passive", no_argument, NULL, 'p'},
@@ -2235,7 +3471,9 @@ int main(int argc, char *argv[])
             {"port", required_argument, NULL, 'S'},
             {"sockfile", required_argument, NULL, 'F'},
             {"speed", required_argument, NULL, 's'},
+            {"udpout", required_argument, NULL, 'U'},
             {"version", no_argument, NULL, 'V' },
+            {"workers", required_argument, NULL, 'W' },
             {NULL, 0, NULL, 0},
         };
 
@@ -2248,9 +3486,24 @@ int main(int argc, char *argv[])
         }
 
         switch (ch) {
+        case 'B':
+            context.batch_refclock = true;
+            break;
         case 'b':
             context.readonly = true;
             break;
+        case 'C':
+            // absolute, os_daemon() does chdir("/")
+            context.capture_dir = realpath(optarg, NULL);
+            if (NULL == context.capture_dir) {
+                GPSD_LOG(LOG_ERROR, &context.errout,
+                         "-C %s: %s(%d)\n", optarg, strerror(errno), errno);
+                exit(EXIT_FAILURE);
+            }
+            break;
+        case 'c':
+            caster_service = optarg;
+            break;
         case 'D':
             // accept decimal, octal and hex
             context.errout.debug = (int)strtol(optarg, 0, 0);
@@ -2296,13 +3549,24 @@ int main(int argc, char *argv[])
         case 'P':
             pid_file = optarg;
             break;
+        case 'R':
+            flightrec = true;
+            break;
         case 'r':
             // -r, --badtime, remove fix checks for good time. DANGEROUS
             context.batteryRTC = true;
             break;
+        case 'M':
+            metrics_service = optarg;
+            break;
         case 'S':
             gpsd_service = optarg;
             break;
+        case 'U':
+            if (0 != udpout_add(optarg, &context.errout)) {
+                exit(EXIT_FAILURE);
+            }
+            break;
         case 's':
             {
                 char *endptr;
@@ -2329,6 +3593,18 @@ int main(int argc, char *argv[])
         case 'V':
             (void)printf("%s: %s (revision %s)\n", argv[0], VERSION, REVISION);
             exit(EXIT_SUCCESS);
+        case 'W':
+            frontends = atoi(optarg);
+            if (1 > frontends ||
+                FRONTENDS_MAX < frontends) {
+                GPSD_LOG(LOG_ERROR, &context.errout,
+                         "-W %s, front ends must be 1 to %d\n",
+                         optarg, FRONTENDS_MAX);
+                exit(EXIT_FAILURE);
+            }
+            // there are no clients in the core to wake the devices
+            nowait = true;
+            break;
         case 'h':
             FALLTHROUGH
         case '?':
@@ -2595,6 +3871,73 @@ int main(int argc, char *argv[])
     }
     GPSD_LOG(LOG_INF, &context.errout, "listening on port %s\n",
                        gpsd_service);
+    for (i = 0; i < frontends; i++) {
+        frontend_socks[i][0] = msocks[0];
+        frontend_socks[i][1] = msocks[1];
+#ifdef GPSD_REUSEPORT
+        // a socket each, the kernel spreads the connections
+        if (0 < i &&
+            1 > passivesocks(gpsd_service, "tcp", QLEN,
+                             frontend_socks[i])) {
+            GPSD_LOG(LOG_ERROR, &context.errout,
+                     "front end %d sockets creation failed\n", i);
+            exit(EXIT_FAILURE);
+        }
+#endif  // GPSD_REUSEPORT
+    }
+    for (i = 0; i < METRICS_CONNS; i++) {
+        INVALIDATE_SOCKET(metrics_conns[i].fd);
+    }
+    if (NULL != metrics_service) {
+        // not passivesocks(), systemd only hands us the gpsd port
+        if (AF_UNSPEC == af_allowed ||
+            AF_INET == af_allowed) {
+            metrics_socks[0] = passivesock_af(AF_INET, metrics_service,
+                                              "tcp", QLEN, false);
+        }
+        if (AF_UNSPEC == af_allowed ||
+            AF_INET6 == af_allowed) {
+            metrics_socks[1] = passivesock_af(AF_INET6, metrics_service,
+                                              "tcp", QLEN, false);
+        }
+        if (0 > metrics_socks[0] &&
+            0 > metrics_socks[1]) {
+            GPSD_LOG(LOG_ERROR, &context.errout,
+                     "metrics socket creation failed\n");
+            if (NULL != pid_file) {
+                (void)unlink(pid_file);
+            }
+            exit(EXIT_FAILURE);
+        }
+        GPSD_LOG(LOG_INF, &context.errout, "metrics on port %s\n",
+                 metrics_service);
+    }
+    for (i = 0; i < CASTER_ROVERS; i++) {
+        INVALIDATE_SOCKET(caster_rovers[i].fd);
+    }
+    if (NULL != caster_service) {
+        if (AF_UNSPEC == af_allowed ||
+            AF_INET == af_allowed) {
+            caster_socks[0] = passivesock_af(AF_INET, caster_service,
+                                             "tcp", QLEN, false);
+        }
+        if (AF_UNSPEC == af_allowed ||
+            AF_INET6 == af_allowed) {
+            caster_socks[1] = passivesock_af(AF_INET6, caster_service,
+                                             "tcp", QLEN, false);
+        }
+        if (0 > caster_socks[0] &&
+            0 > caster_socks[1]) {
+            GPSD_LOG(LOG_ERROR, &context.errout,
+                     "caster socket creation failed\n");
+            if (NULL != pid_file) {
+                (void)unlink(pid_file);
+            }
+            exit(EXIT_FAILURE);
+        }
+        GPSD_LOG(LOG_INF, &context.errout, "NTRIP caster on port %s\n",
+                 caster_service);
+    }
 
     if (0 == getuid()) {
         errno = 0;
@@ -2630,6 +3973,14 @@ int main(int argc, char *argv[])
     // create the shared segment as root so readers can't mess with it
     (void)shm_acquire(&context);
 #endif  // SHM_EXPORT_ENABLE
+    if (flightrec) {
+        // before the devices open, so the recorder sees them open
+        (void)flightrec_acquire(&context);
+    }
+    // before the devices open, network sources look names up in it
+    netasync_fd = netasync_init(&context, device_resolved);
+    // and device nodes are brought up in these
+    devasync_fd = devasync_init(&context, device_brought_up);
 
     /*
      * We open devices specified on the command line *before* dropping
@@ -2645,6 +3996,8 @@ int main(int argc, char *argv[])
                      "initial GPS device %s open failed\n", argv[i]);
         }
     }
+    // they open in parallel, all before privileges are dropped
+    devasync_wait(&context);
 
     if (
 #ifdef CONTROL_SOCKET_ENABLE
@@ -2794,6 +4147,46 @@ int main(int argc, char *argv[])
         (void)signal(SIGPIPE, SIG_IGN);
     }
 
+    if (0 < frontends) {
+        frontend_fd = frontend_init(frontends, &context, devices, MAX_DEVICES,
+                                    &frontend_hooks);
+        if (0 > frontend_fd) {
+            exit(EXIT_FAILURE);
+        }
+        for (i = 0; i < frontends; i++) {
+            pid_t pid = frontend_fork(i);
+
+            if (0 > pid) {
+                exit(EXIT_FAILURE);
+            }
+            if (0 == pid) {
+#ifdef CONTROL_SOCKET_ENABLE
+                if (-1 < csock) {
+                    (void)close(csock);
+                }
+#endif  // CONTROL_SOCKET_ENABLE
+                frontend_main(i, frontend_socks[i]);
+            }
+        }
+        // the front ends have the clients
+        for (i = 1; i < frontends; i++) {
+            int j;
+
+            for (j = 0; j < AFCOUNT; j++) {
+                if (0 <= frontend_socks[i][j] &&
+                    msocks[j] != frontend_socks[i][j]) {
+                    (void)close(frontend_socks[i][j]);
+                }
+            }
+        }
+        for (i = 0; i < AFCOUNT; i++) {
+            if (0 <= msocks[i]) {
+                (void)close(msocks[i]);
+                INVALIDATE_SOCKET(msocks[i]);
+            }
+        }
+    }
+
     // daemon got termination or interrupt signal
     if (0 < setjmp(restartbuf)) {
         gpsd_terminate(&context);
@@ -2808,6 +4201,26 @@ int main(int argc, char *argv[])
             FD_SET(msocks[i], &all_fds);
             adjust_max_fd(msocks[i], true);
         }
+        if (0 <= metrics_socks[i]) {
+            FD_SET(metrics_socks[i], &all_fds);
+            adjust_max_fd(metrics_socks[i], true);
+        }
+        if (0 <= caster_socks[i]) {
+            FD_SET(caster_socks[i], &all_fds);
+            adjust_max_fd(caster_socks[i], true);
+        }
+    }
+    if (0 <= netasync_fd) {
+        FD_SET(netasync_fd, &all_fds);
+        adjust_max_fd(netasync_fd, true);
+    }
+    if (0 <= devasync_fd) {
+        FD_SET(devasync_fd, &all_fds);
+        adjust_max_fd(devasync_fd, true);
+    }
+    if (0 <= frontend_fd) {
+        FD_SET(frontend_fd, &all_fds);
+        adjust_max_fd(frontend_fd, true);
     }
 #ifdef CONTROL_SOCKET_ENABLE
     FD_ZERO(&control_fds);
@@ -2833,6 +4246,7 @@ int main(int argc, char *argv[])
 
     while (0 == signalled) {
         fd_set efds;
+        fd_set wfds;                    // connects in progress
         // static here suppresses longjmp warning
         static const timespec_t ts_timeout = {2, 0};   // timeout for pselect()
         timespec_t before, after;        // time before/after gpsd_await_data()
@@ -2841,9 +4255,41 @@ int main(int argc, char *argv[])
 
         time_warp = false;
         GPSD_LOG(LOG_RAW1, &context.errout, "await data\n");
+        // a non-blocking connect() is done when its fd becomes writable
+        FD_ZERO(&wfds);
+        for (device = devices; device < devices + MAX_DEVICES; device++) {
+            if (allocated_device(device) &&
+                device->connecting &&
+                0 < device->gpsdata.gps_fd) {
+                FD_SET(device->gpsdata.gps_fd, &wfds);
+            }
+        }
+        // output and RTCM relayed to a device wait for it to take more
+        for (device = devices; device < devices + MAX_DEVICES; device++) {
+            if (allocated_device(device) &&
+                (0 < device->rtcm_sink.count ||
+                 0 < device->outq.len) &&
+                0 < device->gpsdata.gps_fd) {
+                FD_SET(device->gpsdata.gps_fd, &wfds);
+            }
+        }
+        // and a metrics client can take the rest of its reply
+        for (i = 0; i < METRICS_CONNS; i++) {
+            if (!BAD_SOCKET(metrics_conns[i].fd) &&
+                NULL != metrics_conns[i].out) {
+                FD_SET(metrics_conns[i].fd, &wfds);
+            }
+        }
+        // and a rover with a backlog can take more
+        for (i = 0; i < CASTER_ROVERS; i++) {
+            if (!BAD_SOCKET(caster_rovers[i].fd) &&
+                0 < caster_rovers[i].len) {
+                FD_SET(caster_rovers[i].fd, &wfds);
+            }
+        }
         (void)clock_gettime(CLOCK_REALTIME, &before);
-        await = gpsd_await_data(&rfds, &efds, maxfd, &all_fds, &context.errout,
-                                ts_timeout);
+        await = gpsd_await_data(&rfds, &wfds, &efds, maxfd, &all_fds,
+                                &context.errout, ts_timeout);
         (void)clock_gettime(CLOCK_REALTIME, &after);
         TS_SUB(&delta, &after, &before);
         if ((1 + ts_timeout.tv_sec) <= llabs(delta.tv_sec)) {
@@ -2853,10 +4299,12 @@ int main(int argc, char *argv[])
                      (long long)delta.tv_sec);
             time_warp = true;
         }
+        daemon_stats.wakeups++;
         switch(await) {
         case AWAIT_GOT_INPUT:
-            FALLTHROUGH
+            break;
         case AWAIT_TIMEOUT:
+            daemon_stats.timeouts++;
             break;
         case AWAIT_NOT_READY:
             for (device = devices; device < devices + MAX_DEVICES; device++) {
@@ -2866,6 +4314,7 @@ int main(int argc, char *argv[])
                  * implementation error in FD_ISSET().
                  */
                 if (allocated_device(device) &&
+                    !device->opening &&
                     0 <= device->gpsdata.gps_fd &&
                     (socket_t)FD_SETSIZE > device->gpsdata.gps_fd &&
                     FD_ISSET(device->gpsdata.gps_fd, &efds)) {
@@ -2878,75 +4327,34 @@ int main(int argc, char *argv[])
             exit(EXIT_FAILURE);
         }
 
+        // name lookups done by the resolver thread
+        if (0 <= netasync_fd &&
+            FD_ISSET(netasync_fd, &rfds)) {
+            netasync_poll(&context);
+        }
+
+        // devices the bring-up workers are done with
+        if (0 <= devasync_fd &&
+            FD_ISSET(devasync_fd, &rfds)) {
+            devasync_poll(&context);
+        }
+
+        // requests the front ends pass on
+        if (0 <= frontend_fd &&
+            FD_ISSET(frontend_fd, &rfds)) {
+            frontend_requests();
+        }
+
         // always be open to new client connections
         for (i = 0; i < AFCOUNT; i++) {
             if (0 <= msocks[i] &&
                 FD_ISSET(msocks[i], &rfds)) {
-                sockaddr_t fsin = {0};
-
-                socklen_t alen = (socklen_t)sizeof(fsin);
-                socket_t ssock =
-                    accept(msocks[i], &fsin.sa, &alen);
-
-                if (BAD_SOCKET(ssock)) {
-                    GPSD_LOG(LOG_ERROR, &context.errout,
-                             "accept: fail: %s(%d)\n", strerror(errno), errno);
-                } else {
-                    struct subscriber_t *client = NULL;
-                    int opts = fcntl(ssock, F_GETFL);
-                    struct linger linger = {1, RELEASE_TIMEOUT};
-                    char ip[INET6_ADDRSTRLEN];
-
-                    if (0 > opts) {
-                        GPSD_LOG(LOG_ERROR, &context.errout,
-                                 "accept: fcntl(F_GETFL): %s(%d)\n",
-                                 strerror(errno), errno);
-                    } else {
-                        opts = fcntl(ssock, F_SETFL, opts | O_NONBLOCK);
-                        if (0 > opts) {
-                            // supposedly can never happen.
-                            GPSD_LOG(LOG_ERROR, &context.errout,
-                                     "accept: fcntl(F_SETFL): %s(%d)\n",
-                                     strerror(errno), errno);
-                        }
-                    }
-
-                    (void)socka2a(&fsin, ip, sizeof(ip));
-                    client = allocate_client();
-                    if (NULL == client) {
-                        // cast for 32-bit intptr_t
-                        GPSD_LOG(LOG_ERROR, &context.errout,
-                                 "Client %s connect on fd %ld -"
-                                 "no subscriber slots available\n", ip,
-                                  (long)ssock);
-                        (void)close(ssock);
-                    } else if (-1 == setsockopt(ssock,
-                                                SOL_SOCKET, SO_LINGER,
-                                                (char *)&linger,
-                                                (int)sizeof(struct linger))) {
-                        GPSD_LOG(LOG_ERROR, &context.errout,
-                                 "Error: SETSOCKOPT SO_LINGER. %s(%d)\n",
-                                 strerror(errno), errno);
-                        (void)close(ssock);
-                    } else {
-                        char announce[GPS_JSON_RESPONSE_MAX];
-                        FD_SET(ssock, &all_fds);
-                        adjust_max_fd(ssock, true);
-                        client->fd = ssock;
-                        client->active = time(NULL);
-                        // cast for 32-bit intptr_t
-                        GPSD_LOG(LOG_SPIN, &context.errout,
-                                 "client %s (%d) connect on fd %ld\n", ip,
-                                 sub_index(client), (long)ssock);
-                        json_version_dump(announce, sizeof(announce));
-                        (void)throttled_write(client, announce,
-                                              strnlen(announce,
-                                                      sizeof(announce)));
-                    }
-                }
+                client_accept(msocks[i]);
                 FD_CLR(msocks[i], &rfds);
             }
         }
+        metrics_poll(&rfds, &wfds);
+        caster_poll(&rfds, &wfds);
 
 #ifdef CONTROL_SOCKET_ENABLE
         // also be open to new control-socket connections
@@ -3006,19 +4414,39 @@ int main(int argc, char *argv[])
             int multipoll_ret;
 
             if (!allocated_device(device) ||
+                device->opening ||
                 0 >= device->gpsdata.gps_fd) {
                 continue;
             }
 
-            multipoll_ret = gpsd_multipoll(FD_ISSET(device->gpsdata.gps_fd,
-                                           &rfds), device, all_reports,
-                                           DEVICE_REAWAKE);
+            if (device->connecting) {
+                // nothing to read before the connect() is done
+                if (!FD_ISSET(device->gpsdata.gps_fd, &wfds)) {
+                    continue;
+                }
+                multipoll_ret = netasync_connected(device);
+            } else {
+                bool data_ready = FD_ISSET(device->gpsdata.gps_fd, &rfds);
+
+                if (FD_ISSET(device->gpsdata.gps_fd, &wfds)) {
+                    // the RTCM frame part way out, then the output queue
+                    rtcm_relay_drain(device);
+                    (void)gpsd_serial_drain(device);
+                }
+
+                multipoll_ret = gpsd_multipoll(data_ready, device,
+                                               all_reports, DEVICE_REAWAKE);
+            }
             // cast for 32-bit intptr_t
             GPSD_LOG(LOG_DATA, &context.errout,
                      "gpsd_multipoll(%ld) = %d\n",
                      (long)device->gpsdata.gps_fd, multipoll_ret);
             switch (multipoll_ret) {
             case DEVICE_READY:
+                if (0 > device->gpsdata.gps_fd) {
+                    // ntrip:// between connections
+                    break;
+                }
                 FD_SET(device->gpsdata.gps_fd, &all_fds);
                 adjust_max_fd(device->gpsdata.gps_fd, true);
                 break;
@@ -3045,6 +4473,11 @@ int main(int argc, char *argv[])
                  * gpsd_next_hunt_setting() will try next hunt speed
                  * if device is a tty. */
 
+                if (SERVICE_NTRIP == device->servicetype &&
+                    ntrip_stale(device)) {
+                    // it went quiet, now on the next mountpoint
+                    break;
+                }
                 // This device has either never received a message.
                 (void)clock_gettime(CLOCK_REALTIME, &now);
                 if (0 == device->lexer.pkt_time.tv_sec) {
@@ -3091,6 +4524,9 @@ int main(int argc, char *argv[])
             }
         }
 
+        // ship any clock samples coalesced during this pass
+        chrony_flush(&context, false);
+
 #ifdef __UNUSED_AUTOCONNECT__
         if (0 < context.fixcnt &&
             !context.autconnect) {
@@ -3107,68 +4543,7 @@ int main(int argc, char *argv[])
 #endif  // __UNUSED_AUTOCONNECT_
 
         // accept and execute commands for all clients
-        for (sub = subscribers; sub < subscribers + MAX_CLIENTS; sub++) {
-            if (0 == sub->active) {
-                continue;
-            }
-
-            lock_subscriber(sub);
-            if (FD_ISSET(sub->fd, &rfds)) {
-                char buf[BUFSIZ];
-                ssize_t buflen;
-
-                unlock_subscriber(sub);
-
-                GPSD_LOG(LOG_PROG, &context.errout,
-                         "checking client(%d)\n",
-                         sub_index(sub));
-                buflen = recv(sub->fd, buf, sizeof(buf) - 1, 0);
-                if (0 > buflen) {
-                    // recv() error, give up.
-                    detach_client(sub);
-                    GPSD_LOG(LOG_CLIENT, &context.errout,
-                             "<= client(%d): error read\n", sub_index(sub));
-                } else if (0 == buflen) {
-                    /* Ugh, "man recv" says recv() returns 0 on disconnect!
-                     * So we have to disconnect client.
-                     * But somehow, dormant serial connections also
-                     * return 0.  Should FD_ISSET() have prevented getting
-                     * here in that case?
-                     */
-                    detach_client(sub);
-                    GPSD_LOG(LOG_CLIENT, &context.errout,
-                             "<= client(%d): eof read\n", sub_index(sub));
-                } else {
-                    if ('\n' != buf[buflen - 1]) {
-                        buf[buflen++] = '\n';
-                    }
-                    buf[buflen] = '\0';
-                    GPSD_LOG(LOG_CLIENT, &context.errout,
-                             "<= client(%d): %s\n", sub_index(sub), buf);
-
-                    /*
-                     * When a command comes in, update subscriber.active to
-                     * timestamp() so we don't close the connection
-                     * after COMMAND_TIMEOUT seconds. This makes
-                     * COMMAND_TIMEOUT useful.
-                     */
-                    sub->active = time(NULL);
-                    if (0 > handle_gpsd_request(sub, buf, sizeof(buf))) {
-                        detach_client(sub);
-                    }
-                }
-            } else {
-                unlock_subscriber(sub);
-
-                if (!sub->policy.watcher &&
-                    COMMAND_TIMEOUT < (time(NULL) - sub->active)) {
-                    GPSD_LOG(LOG_WARN, &context.errout,
-                             "client(%d) timed out on command wait.\n",
-                             sub_index(sub));
-                    detach_client(sub);
-                }
-            }
-        }
+        clients_serve(&rfds);
 
         /*
          * Mark devices with an identified packet type but no
@@ -3181,7 +4556,8 @@ int main(int argc, char *argv[])
         for (device = devices; device < devices + MAX_DEVICES; device++) {
             bool device_needed = nowait;
 
-            if (!allocated_device(device)) {
+            if (!allocated_device(device) ||
+                device->opening) {
                 continue;
             }
             if (!device_needed) {
@@ -3245,9 +4621,11 @@ int main(int argc, char *argv[])
          * subscribers and the last GPS has unplugged, and the point
          * of the last check is to prevent shutdown when the daemon
          * has been launched but not yet received its first device
-         * over the socket.
+         * over the socket.  With -W the subscribers are in the front
+         * ends, the core does not see them, so it stays.
          */
         if (argc == optind &&
+            0 == frontends &&
             0 < highwater) {
             int subcount = 0, devcount = 0;
             for (sub = subscribers; sub < (subscribers + MAX_CLIENTS); sub++) {
@@ -3267,6 +4645,9 @@ int main(int argc, char *argv[])
                 goto shutdown;
             }
         }
+
+        // what the front ends have not seen yet
+        frontend_wake();
     }
 
     // if we make it here, we got a signal... deal with it
@@ -3278,6 +4659,7 @@ int main(int argc, char *argv[])
     GPSD_LOG(LOG_WARN, &context.errout,
              "received terminating signal %d.\n", (int)signalled);
 shutdown:
+    frontend_stop();
     gpsd_terminate(&context);
 
     GPSD_LOG(LOG_WARN, &context.errout, "exiting.\n");
@@ -3297,6 +4679,7 @@ shutdown:
 #ifdef SHM_EXPORT_ENABLE
     shm_release(&context);
 #endif  // SHM_EXPORT_ENABLE
+    flightrec_release(&context);
 
 #ifdef CONTROL_SOCKET_ENABLE
     if (control_socket) {
@@ -247,7 +247,7 @@ static void json_base_dump(const struct baseline_t *base,
 }
 
 void json_tpv_dump(const gps_mask_t changed, struct gps_device_t *session,
-                   const struct gps_policy_t *policy,
+                   const struct gps_policy_t *policy, const bool trace,
                    char *reply, size_t replylen)
 {
     struct gps_data_t *gpsdata = &session->gpsdata;
@@ -532,6 +532,22 @@ void json_tpv_dump(const gps_mask_t changed, struct gps_device_t *session,
     if (STATUS_UNK != gpsdata->fix.base.status) {
         json_base_dump(&gpsdata->fix.base, reply, replylen);
     }
+    if (trace &&
+        0 != session->stats.pkt_read.tv_sec) {
+        // uS from the read() that completed the packet to each stage
+        timespec_t now;
+        const timespec_t *start = &session->stats.pkt_read;
+
+        (void)clock_gettime(CLOCK_MONOTONIC, &now);
+        str_appendf(reply, replylen,
+                    ",\"traceLex\":%lld,\"traceParse\":%lld,"
+                    "\"traceRender\":%lld",
+                    (long long)(timespec_diff_ns(session->stats.pkt_mono,
+                                                 *start) / 1000),
+                    (long long)(timespec_diff_ns(session->stats.parse_mono,
+                                                 *start) / 1000),
+                    (long long)(timespec_diff_ns(now, *start) / 1000));
+    }
     (void)strlcat(reply, "}\r\n", replylen);
 }
 
@@ -754,6 +770,40 @@ void json_device_dump(const struct gps_device_t *device,
     if (device->context->readonly) {
         (void)strlcat(reply, ",\"readonly\":\"true\"", replylen);
     }
+    if (0 < device->rtcm_sink.ntypes) {
+        int i;
+
+        (void)strlcat(reply, ",\"rtcm\":\"", replylen);
+        for (i = 0; i < device->rtcm_sink.ntypes; i++) {
+            str_appendf(reply, replylen, "%u,", device->rtcm_sink.types[i]);
+        }
+        str_rstrip_char(reply, ',');
+        (void)strlcat(reply, "\"", replylen);
+    }
+    if (SERVICE_NTRIP == device->servicetype &&
+        0 < device->ntrip.nmounts) {
+        int i;
+
+        (void)strlcat(reply, ",\"ntrip\":[", replylen);
+        for (i = 0; i < device->ntrip.nmounts; i++) {
+            const struct ntrip_mount_t *mount = &device->ntrip.mounts[i];
+
+            str_appendf(reply, replylen, "{\"mountpoint\":\"%s\",",
+                        json_stringify(buf1, sizeof(buf1),
+                                       mount->stream.mountpoint));
+            str_appendf(reply, replylen,
+                        "\"host\":\"%s\",\"active\":%s,\"packets\":%lu,"
+                        "\"bytes\":%lu,\"latency\":%.3f,"
+                        "\"failovers\":%lu},",
+                        json_stringify(buf1, sizeof(buf1),
+                                       mount->stream.host),
+                        i == device->ntrip.mount ? "true" : "false",
+                        mount->packets, mount->bytes, mount->latency,
+                        mount->failovers);
+        }
+        str_rstrip_char(reply, ',');
+        (void)strlcat(reply, "]", replylen);
+    }
     /*
      * There's an assumption here: Anything that we type SERVICE_SENSOR is
      * a serial device with the usual control parameters.
@@ -807,9 +857,45 @@ void json_device_dump(const struct gps_device_t *device,
     (void)strlcat(reply, "}\r\n", replylen);
 }
 
+/* parse the "rtcm" field of a ?DEVICE, the comma separated RTCM message
+ * types the device takes, into the relay filter of session.  The rest
+ * is json_device_read()'s business.  Without the field the filter is
+ * left alone.
+ *
+ * Return: 0 = OK
+ *         a JSON_ERR_*, or -1 for a bad list
+ */
+int json_device_rtcm_read(const char *buf, struct gps_device_t *session)
+{
+    char list[128] = "?";
+    // *INDENT-OFF*
+    const struct json_attr_t rtcm_attrs[] = {
+        {"rtcm",           t_string,   .addr.string = list,
+                                          .len = sizeof(list),
+                                          .nodefault = true},
+        // the devconfig fields
+        {"", t_ignore},
+        {NULL},
+    };
+    // *INDENT-ON*
+    int status;
+
+    status = json_read_object(buf, rtcm_attrs, NULL);
+    if (0 != status ||
+        0 == strcmp(list, "?")) {
+        return status;
+    }
+    return rtcm_relay_filter(&session->rtcm_sink, list);
+}
+
 void json_watch_dump(const struct gps_policy_t *ccp,
-                     char *reply, size_t replylen)
+                     const struct watch_rate_t *rate,
+                     const unsigned int skip, const bool binary,
+                     const bool trace, char *reply, size_t replylen)
 {
+    static const char *rate_names[WATCH_RATE_CLASSES] = {
+        "tpv", "sky", "gst", "imu", "raw"};
+
     (void)snprintf(reply, replylen,
                    "{\"class\":\"WATCH\",\"enable\":%s,\"json\":%s,"
                    "\"nmea\":%s,\"raw\":%d,\"scaled\":%s,\"timing\":%s,"
@@ -826,6 +912,32 @@ void json_watch_dump(const struct gps_policy_t *ccp,
     if ('\0' != ccp->devpath[0]) {
         str_appendf(reply, replylen, ",\"device\":\"%s\"", ccp->devpath);
     }
+    if (NULL != rate &&
+        rate->limited) {
+        int i;
+
+        for (i = 0; i < WATCH_RATE_CLASSES; i++) {
+            if (0.0 < rate->interval[i]) {
+                str_appendf(reply, replylen, ",\"%s_interval\":%.3f",
+                            rate_names[i], rate->interval[i]);
+            }
+        }
+        if (rate->coalesce) {
+            (void)strlcat(reply, ",\"coalesce\":true", replylen);
+        }
+    }
+    if (0 != skip) {
+        char list[128];
+
+        json_class_list(~skip & GPS_CLASS_ALL, list, sizeof(list));
+        str_appendf(reply, replylen, ",\"classes\":\"%s\"", list);
+    }
+    if (binary) {
+        (void)strlcat(reply, ",\"binary\":true", replylen);
+    }
+    if (trace) {
+        (void)strlcat(reply, ",\"trace\":true", replylen);
+    }
     (void)strlcat(reply, "}\r\n", replylen);
 }
 
@@ -4725,10 +4837,210 @@ void json_oscillator_dump(const struct gps_data_t *datap,
 }
 #endif  // OSCILLATOR_ENABLE
 
+// dump one time statistics series, a member of a TSTATS object
+static void json_tstats_series_dump(const char *name,
+                                    const struct tstats_series_t *series,
+                                    char *reply, size_t replylen)
+{
+    double mean = series->sum / series->count;
+    double rms = sqrt(series->sumsq / series->count);
+    int i;
+
+    str_appendf(reply, replylen,
+                ",\"%s\":{\"count\":%lu,\"missed\":%lu,"
+                "\"mean\":%.9f,\"rms\":%.9f,\"min\":%.9f,\"max\":%.9f,"
+                "\"jitter\":[",
+                name, series->count, series->missed,
+                mean, rms, series->min, series->max);
+    for (i = 0; i < TSTATS_JITTER_BINS; i++) {
+        str_appendf(reply, replylen, "%lu,", series->jitter[i]);
+    }
+    str_rstrip_char(reply, ',');
+    (void)strlcat(reply, "],\"adev\":[", replylen);
+    // taus are 2^i seconds, stop at the first one without data
+    for (i = 0; i < TSTATS_LEVELS; i++) {
+        double adev = tstats_adev(series, i);
+
+        if (0 == isfinite(adev)) {
+            break;
+        }
+        str_appendf(reply, replylen, "%.4e,", adev);
+    }
+    str_rstrip_char(reply, ',');
+    (void)strlcat(reply, "],\"tdev\":[", replylen);
+    for (i = 0; i < TSTATS_LEVELS; i++) {
+        double tdev = tstats_tdev(series, i);
+
+        if (0 == isfinite(tdev)) {
+            break;
+        }
+        str_appendf(reply, replylen, "%.4e,", tdev);
+    }
+    str_rstrip_char(reply, ',');
+    (void)strlcat(reply, "]}", replylen);
+}
+
+// dump the delivery counters of one refclock, a member of a TSTATS object
+static void json_refclock_dump(const char *name, int unit,
+                               const struct refclock_count_t *count,
+                               char *reply, size_t replylen)
+{
+    str_appendf(reply, replylen,
+                ",\"%s\":{\"delivered\":%lu,\"dropped\":%lu",
+                name, count->delivered, count->dropped);
+    if (0 <= unit) {
+        str_appendf(reply, replylen, ",\"shm\":\"NTP%d\"", unit);
+    }
+    (void)strlcat(reply, "}", replylen);
+}
+
+/* dump the time quality statistics of a device
+ *
+ * Return: false, and nothing in reply, if it does not fit
+ */
+bool json_tstats_dump(const struct gps_device_t *device,
+                      char *reply, size_t replylen)
+{
+    struct timestats_t stats;
+
+    timestats_snapshot(&device->timestats, &stats);
+    (void)snprintf(reply, replylen,
+                   "{\"class\":\"TSTATS\",\"device\":\"%s\"",
+                   device->gpsdata.dev.path);
+    if (0 < stats.toff.count) {
+        json_tstats_series_dump("toff", &stats.toff, reply, replylen);
+    }
+    if (0 < stats.pps.count) {
+        json_tstats_series_dump("pps", &stats.pps, reply, replylen);
+    }
+    if (0 < stats.ppsq.count) {
+        json_tstats_series_dump("ppsq", &stats.ppsq, reply, replylen);
+    }
+    if (VALID_UNIT(device->shm_clock_unit)) {
+        json_refclock_dump("shm_clock", device->shm_clock_unit,
+                           &device->shm_clock_count, reply, replylen);
+    }
+    if (VALID_UNIT(device->shm_pps_unit)) {
+        json_refclock_dump("shm_pps", device->shm_pps_unit,
+                           &device->shm_pps_count, reply, replylen);
+    }
+    if (0 < device->chrony_clock_fd) {
+        json_refclock_dump("sock_clock", -1,
+                           &device->chrony_clock_count, reply, replylen);
+    }
+    if (0 < device->chrony_pps_fd) {
+        json_refclock_dump("sock_pps", -1,
+                           &device->chrony_pps_count, reply, replylen);
+    }
+    if (replylen <= strlcat(reply, "}\r\n", replylen)) {
+        // cut short somewhere, better none than broken JSON
+        reply[0] = '\0';
+        return false;
+    }
+    return true;
+}
+
+/* names of the packet types, for STATS, indexed by packet type.
+ * Must be kept synced with the *_PACKET defines in gpsd.h */
+const char *packet_type_names[PACKET_TYPES] = {
+    "COMMENT", "NMEA", "AIVDM", "GARMINTXT", "SIRF", "ZODIAC", "TSIP",
+    "EVERMORE", "ITALK", "GARMIN", "NAVCOM", "UBX", "SUPERSTAR2",
+    "ONCORE", "GEOSTAR", "NMEA2000", "GREIS", "SKY", "ALLYSTAR",
+    "CASIC", "IS", "RTCM2", "RTCM3", "JSON", "GPSB",
+};
+
+// dump one latency histogram, a member of a STATS object
+static void json_latency_dump(const char *name, const unsigned long *hist,
+                              char *reply, size_t replylen)
+{
+    int i, last;
+
+    // trailing empty bins are not sent
+    for (last = STATS_LATENCY_BINS - 1; 0 < last; last--) {
+        if (0 != hist[last]) {
+            break;
+        }
+    }
+    str_appendf(reply, replylen, ",\"%s\":[", name);
+    for (i = 0; i <= last; i++) {
+        str_appendf(reply, replylen, "%lu,", hist[i]);
+    }
+    str_rstrip_char(reply, ',');
+    (void)strlcat(reply, "]", replylen);
+}
+
+/* dump the daemon performance counters of a device
+ *
+ * Return: false, and nothing in reply, if it does not fit
+ */
+bool json_stats_dump(const struct gps_device_t *device,
+                     char *reply, size_t replylen)
+{
+    const struct devstats_t *stats = &device->stats;
+    int i;
+
+    (void)snprintf(reply, replylen,
+                   "{\"class\":\"STATS\",\"device\":\"%s\","
+                   "\"bytes\":%lu,\"packets\":{",
+                   device->gpsdata.dev.path, stats->bytes_read);
+    for (i = 0; i < PACKET_TYPES; i++) {
+        if (0 != stats->packets[i]) {
+            str_appendf(reply, replylen, "\"%s\":%lu,",
+                        packet_type_names[i], stats->packets[i]);
+        }
+    }
+    str_rstrip_char(reply, ',');
+    str_appendf(reply, replylen,
+                "},\"bad\":%lu,\"resyncs\":%lu,\"discards\":%lu,"
+                "\"switches\":%lu,\"cycles\":%lu",
+                stats->bad_packets, stats->resyncs, stats->discards,
+                stats->driver_switches, stats->cycles);
+    if (0 != stats->rtcm_relayed ||
+        0 != stats->rtcm_dropped ||
+        0 != stats->rtcm_filtered) {
+        str_appendf(reply, replylen,
+                    ",\"rtcm\":{\"relayed\":%lu,\"dropped\":%lu,"
+                    "\"filtered\":%lu,\"queued\":%d}",
+                    stats->rtcm_relayed, stats->rtcm_dropped,
+                    stats->rtcm_filtered, device->rtcm_sink.count);
+    }
+    if (0 != stats->out_written ||
+        0 != stats->out_queued) {
+        str_appendf(reply, replylen,
+                    ",\"out\":{\"written\":%lu,\"queued\":%lu,"
+                    "\"waits\":%lu,\"max\":%zu,\"pending\":%zu}",
+                    stats->out_written, stats->out_queued,
+                    stats->out_waits, stats->out_max,
+                    gpsd_serial_pending(device));
+    }
+    if (0 != stats->udp_dropped ||
+        0 != stats->udp_truncated) {
+        str_appendf(reply, replylen,
+                    ",\"udp\":{\"dropped\":%lu,\"truncated\":%lu}",
+                    stats->udp_dropped, stats->udp_truncated);
+    }
+    if (SERVICE_RELAY == device->servicetype) {
+        str_appendf(reply, replylen,
+                    ",\"relay\":{\"seq\":%lu,\"lost\":%lu}",
+                    device->relay.seq, stats->relay_lost);
+    }
+    json_latency_dump("lex", stats->lex.bins, reply, replylen);
+    json_latency_dump("parse", stats->parse.bins, reply, replylen);
+    json_latency_dump("report", stats->report.bins, reply, replylen);
+    json_latency_dump("write", stats->write.bins, reply, replylen);
+    // whatever was cut short before, this is too
+    if (replylen <= strlcat(reply, "}\r\n", replylen)) {
+        reply[0] = '\0';
+        return false;
+    }
+    return true;
+}
+
 // report a session state in JSON
 void json_data_report(const gps_mask_t changed,
                       struct gps_device_t *session,
                       const struct gps_policy_t *policy,
+                      const unsigned int classes, const bool trace,
                       char *buf, size_t buflen)
 {
     struct gps_data_t *datap = &session->gpsdata;
@@ -4742,38 +5054,46 @@ void json_data_report(const gps_mask_t changed,
     if (0 != (changed & REPORT_IS)) {
         buf_len = strnlen(buf, MAX_PACKET_LENGTH);
 
-        json_tpv_dump(changed, session, policy,
-                      buf + buf_len, buflen - buf_len);
+        if (0 != (classes & GPS_CLASS_TPV)) {
+            json_tpv_dump(changed, session, policy, trace,
+                          buf + buf_len, buflen - buf_len);
+        }
         // attitude is syncronous to epoch, so report like TPV.
-        if (0 != (changed & ATTITUDE_SET)) {
+        if (0 != (changed & ATTITUDE_SET) &&
+            0 != (classes & GPS_CLASS_ATT)) {
             buf_len = strnlen(buf, MAX_PACKET_LENGTH);
             json_att_dump(datap, buf + buf_len, buflen - buf_len,
                           &datap->attitude, "ATT");
         }
     }
 
-    if (0 != (changed & GST_SET)) {
+    if (0 != (changed & GST_SET) &&
+        0 != (classes & GPS_CLASS_GST)) {
         buf_len = strnlen(buf, MAX_PACKET_LENGTH);
         json_noise_dump(datap, buf + buf_len, buflen - buf_len);
     }
 
-    if (0 != (changed & (DOP_SET | SATELLITE_SET))) {
+    if (0 != (changed & (DOP_SET | SATELLITE_SET)) &&
+        0 != (classes & GPS_CLASS_SKY)) {
         buf_len = strnlen(buf, MAX_PACKET_LENGTH);
         json_sky_dump(session, buf + buf_len, buflen - buf_len);
     }
 
-    if (0 != (changed & SUBFRAME_SET)) {
+    if (0 != (changed & SUBFRAME_SET) &&
+        0 != (classes & GPS_CLASS_SUBFRAME)) {
         buf_len = strnlen(buf, MAX_PACKET_LENGTH);
         json_subframe_dump(datap, policy->scaled, buf + buf_len,
                            buflen - buf_len);
     }
 
-    if (0 != (changed & RAW_IS)) {
+    if (0 != (changed & RAW_IS) &&
+        0 != (classes & GPS_CLASS_RAW)) {
         buf_len = strnlen(buf, MAX_PACKET_LENGTH);
         json_raw_dump(datap, buf + buf_len, buflen - buf_len);
     }
 
-    if (0 != (changed & IMU_SET)) {
+    if (0 != (changed & IMU_SET) &&
+        0 != (classes & GPS_CLASS_IMU)) {
         int max_imu, cur_imu = 0;
 
         max_imu = sizeof(datap->imu) / sizeof(struct attitude_t);
@@ -4787,20 +5107,23 @@ void json_data_report(const gps_mask_t changed,
         }
     }
 
-    if (0 != (changed & RTCM2_SET)) {
+    if (0 != (changed & RTCM2_SET) &&
+        0 != (classes & GPS_CLASS_RTCM2)) {
         buf_len = strnlen(buf, MAX_PACKET_LENGTH);
         json_rtcm2_dump(&datap->rtcm2, datap->dev.path,
                         buf + buf_len, buflen - buf_len);
     }
 
-    if (0 != (changed & RTCM3_SET)) {
+    if (0 != (changed & RTCM3_SET) &&
+        0 != (classes & GPS_CLASS_RTCM3)) {
         buf_len = strnlen(buf, MAX_PACKET_LENGTH);
         json_rtcm3_dump(&datap->rtcm3, datap->dev.path,
                         buf + buf_len, buflen - buf_len);
     }
 
 #ifdef AIVDM_ENABLE
-    if (0 != (changed & AIS_SET)) {
+    if (0 != (changed & AIS_SET) &&
+        0 != (classes & GPS_CLASS_AIS)) {
         buf_len = strnlen(buf, MAX_PACKET_LENGTH);
         json_aivdm_dump(&datap->ais, datap->dev.path,
                         policy->scaled,
@@ -4809,12 +5132,14 @@ void json_data_report(const gps_mask_t changed,
 #endif  // AIVDM_ENABLE
 
 #ifdef OSCILLATOR_ENABLE
-    if (0 != (changed & OSCILLATOR_SET)) {
+    if (0 != (changed & OSCILLATOR_SET) &&
+        0 != (classes & GPS_CLASS_OSC)) {
         buf_len = strnlen(buf, MAX_PACKET_LENGTH);
         json_oscillator_dump(datap, buf + buf_len, buflen - buf_len);
     }
 #endif // OSCILLATOR_ENABLE
-    if (0 != (changed & LOG_SET)) {
+    if (0 != (changed & LOG_SET) &&
+        0 != (classes & GPS_CLASS_LOG)) {
         buf_len = strnlen(buf, MAX_PACKET_LENGTH);
         json_log_dump(session, buf + buf_len, buflen - buf_len);
     }
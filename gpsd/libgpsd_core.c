@@ -32,6 +32,7 @@
 #include <time.h>
 #include <unistd.h>
 
+#include "../include/flightrec.h"
 #include "../include/gpsd.h"
 #include "../include/matrix.h"
 #include "../include/strfuncs.h"
@@ -45,6 +46,7 @@ ssize_t gpsd_write(struct gps_device_t *session,
                    const char *buf,
                    const size_t len)
 {
+    FLIGHTREC(session, FLIGHTREC_WRITE, len, buf, len);
     return session->context->serial_write(session, buf, len);
 }
 
@@ -279,6 +281,9 @@ int gpsd_switch_driver(struct gps_device_t *session, char *type_name)
             gpsd_assert_sync(session);
             session->device_type = *dp;
             session->driver_index = i;
+            session->stats.driver_switches++;
+            FLIGHTREC(session, FLIGHTREC_DRIVER, i, type_name,
+                      strlen(type_name));
             session->gpsdata.dev.mincycle = session->device_type->min_cycle;
             // reconfiguration might be required
             if (first_sync &&
@@ -372,6 +377,9 @@ void gpsd_deactivate(struct gps_device_t *session)
     GPSD_LOG(LOG_INF, &session->context->errout,
              "CORE: closing %s, fd %ld\n",
              session->gpsdata.dev.path, (long)session->gpsdata.gps_fd);
+    FLIGHTREC(session, FLIGHTREC_CLOSE, session->gpsdata.gps_fd, NULL, 0);
+    capture_close(session);
+    rtcm_relay_flush(session);
     if (SERVICE_NTRIP == session->servicetype) {
         ntrip_close(session);
     } else
@@ -384,6 +392,9 @@ void gpsd_deactivate(struct gps_device_t *session)
         // could be serial, udp://, tcp://, etc.
         gpsd_close(session);
     }
+    free(session->udp);
+    session->udp = NULL;
+    session->connecting = false;
     if (O_OPTIMIZE == session->mode) {
         gpsd_run_device_hook(&session->context->errout,
                              session->gpsdata.dev.path,
@@ -537,9 +548,84 @@ int parse_uri_dest(char *s, char **host, char **service, char **device)
     return 0;
 }
 
+/* ask the kernel to timestamp data received on a network source
+ * packet_get1() then uses recvmsg() to get the stamps.
+ */
+static void rx_timestamp_enable(struct gps_device_t *session)
+{
+    int on = 1;
+    int ret = -1;
+
+#if defined(SO_TIMESTAMPNS)
+    ret = setsockopt(session->gpsdata.gps_fd, SOL_SOCKET, SO_TIMESTAMPNS,
+                     &on, sizeof(on));
+#elif defined(SO_TIMESTAMP)
+    ret = setsockopt(session->gpsdata.gps_fd, SOL_SOCKET, SO_TIMESTAMP,
+                     &on, sizeof(on));
+#endif  // SO_TIMESTAMP
+    if (0 != ret) {
+        // cast for 32-bit ints
+        GPSD_LOG(LOG_PROG, &session->context->errout,
+                 "CORE: fd %ld no receive timestamps: %s(%d)\n",
+                 (long)session->gpsdata.gps_fd, strerror(errno), errno);
+        return;
+    }
+    session->rx_stamped = true;
+}
+
+/* a udp:// source can get bursts of many datagrams, give it a big
+ * receive buffer, and have the kernel count the datagrams it drops
+ * anyway.  packet_get1() takes the count from SO_RXQ_OVFL.  The batch
+ * slots packet_get1() reads into are freed by gpsd_deactivate().
+ */
+static void udp_rx_enable(struct gps_device_t *session)
+{
+    int rcvbuf = UDP_RCVBUF;
+    socklen_t optlen = sizeof(rcvbuf);
+
+    session->rxq_ovfl = 0;
+#ifdef HAVE_RECVMMSG
+    // without it the datagrams are read one at a time
+    if (NULL == session->udp) {
+        session->udp = calloc(1, sizeof(struct udp_batch_t));
+    }
+    if (NULL != session->udp) {
+        session->udp->next = 0;
+        session->udp->count = 0;
+    }
+#endif  // HAVE_RECVMMSG
+    // the kernel caps this at net.core.rmem_max, without an error
+    if (0 != setsockopt(session->gpsdata.gps_fd, SOL_SOCKET, SO_RCVBUF,
+                        &rcvbuf, sizeof(rcvbuf)) ||
+        0 != getsockopt(session->gpsdata.gps_fd, SOL_SOCKET, SO_RCVBUF,
+                        &rcvbuf, &optlen)) {
+        // cast for 32-bit ints
+        GPSD_LOG(LOG_WARN, &session->context->errout,
+                 "CORE: fd %ld SO_RCVBUF: %s(%d)\n",
+                 (long)session->gpsdata.gps_fd, strerror(errno), errno);
+    } else {
+        GPSD_LOG(LOG_PROG, &session->context->errout,
+                 "CORE: fd %ld receive buffer %d bytes\n",
+                 (long)session->gpsdata.gps_fd, rcvbuf);
+    }
+#ifdef SO_RXQ_OVFL
+    {
+        int on = 1;
+
+        if (0 != setsockopt(session->gpsdata.gps_fd, SOL_SOCKET,
+                            SO_RXQ_OVFL, &on, sizeof(on))) {
+            GPSD_LOG(LOG_PROG, &session->context->errout,
+                     "CORE: fd %ld no drop count: %s(%d)\n",
+                     (long)session->gpsdata.gps_fd, strerror(errno), errno);
+        }
+    }
+#endif  // SO_RXQ_OVFL
+}
+
 /* open a device for access to its data *
  * return: the opened file descriptor
- *         PLACEHOLDING_FD (-2) - for /dev/ppsX, ntrip waiting reconenct, etc.
+ *         PLACEHOLDING_FD (-2) - for /dev/ppsX, ntrip waiting reconenct,
+ *                                    name lookup in progress, etc.
  *         UNALLOCATED_FD (-1) - for open failure
  */
 int gpsd_open(struct gps_device_t *session)
@@ -550,6 +636,7 @@ int gpsd_open(struct gps_device_t *session)
              session->gpsdata.dev.path,
              (long)session->gpsdata.gps_fd);
 
+    session->rx_stamped = false;
     // special case: source may be a URI to a remote GNSS or DGPS service
     if (netgnss_uri_check(session->gpsdata.dev.path)) {
         session->gpsdata.gps_fd = netgnss_uri_open(session,
@@ -579,9 +666,14 @@ int gpsd_open(struct gps_device_t *session)
         GPSD_LOG(LOG_PROG, &session->context->errout,
                  "CORE: opening TCP feed at %s, port %s.\n", host,
                  port);
-        // open non-blocking
-        dsock = netlib_connectsock1(AF_UNSPEC, host, port, "tcp",
-                                    1, false, addrbuf, sizeof(addrbuf));
+        // open non-blocking, the name maybe looked up in the background
+        dsock = netasync_connectsock(session, host, port,
+                                     addrbuf, sizeof(addrbuf));
+        if (NL_PENDING == dsock) {
+            // netasync_poll() has the daemon open us again
+            session->gpsdata.gps_fd = PLACEHOLDING_FD;
+            return PLACEHOLDING_FD;
+        }
         if (0 > dsock) {
             // cast for 32-bit ints.
             GPSD_LOG(LOG_ERROR, &session->context->errout,
@@ -595,6 +687,9 @@ int gpsd_open(struct gps_device_t *session)
                      session->gpsdata.dev.path, addrbuf, (long)dsock);
         }
         session->gpsdata.gps_fd = dsock;
+        if (0 <= dsock) {
+            rx_timestamp_enable(session);
+        }
         return session->gpsdata.gps_fd;
     // or could be UDP
     } else if (str_starts_with(session->gpsdata.dev.path, "udp://")) {
@@ -613,8 +708,9 @@ int gpsd_open(struct gps_device_t *session)
         GPSD_LOG(LOG_PROG, &session->context->errout,
                  "CORE: opening UDP feed at %s, port %s.\n", host,
                  port);
+        // non-blocking, packet_get1() reads until the socket is empty
         if (0 > (dsock = netlib_connectsock1(AF_UNSPEC, host, port, "udp",
-                                             0, true, NULL, 0))) {
+                                             2, true, NULL, 0))) {
             // cast for 32-bit ints.
             GPSD_LOG(LOG_ERROR, &session->context->errout,
                      "CORE: UDP device open error %s(%ld).\n",
@@ -626,6 +722,8 @@ int gpsd_open(struct gps_device_t *session)
                      "CORE: UDP device opened on fd %ld\n", (long)dsock);
         }
         session->gpsdata.gps_fd = dsock;
+        rx_timestamp_enable(session);
+        udp_rx_enable(session);
         return session->gpsdata.gps_fd;
     }
     if (str_starts_with(session->gpsdata.dev.path, "gpsd://")) {
@@ -685,15 +783,10 @@ int gpsd_open(struct gps_device_t *session)
     return gpsd_serial_open(session);
 }
 
-/* acquire a connection to the GPS device
- * could be serial, udp://, tcp://, etc.
- *
- * Return: fd on success
- *         less than zero on failure
- *         UNALLOCATED_FD (-1)  -- give up
- *         PLACEHOLDING_FD (-2) -- retry possible
+/* acquire a connection to the GPS device, in the caller's thread,
+ * see gpsd_activate()
  */
-int gpsd_activate(struct gps_device_t *session, const int mode)
+int gpsd_activate1(struct gps_device_t *session, const int mode)
 {
     // cast for 32-bit ints
     GPSD_LOG(LOG_PROG, &session->context->errout,
@@ -726,6 +819,15 @@ int gpsd_activate(struct gps_device_t *session, const int mode)
         }
         return session->gpsdata.gps_fd;
     }
+    if (NULL != session->context->flightrec &&
+        !session->opening) {
+        // a bring-up worker leaves this to devasync_poll()
+        flightrec_open(session);
+    }
+    if (NULL != session->context->capture_dir &&
+        NULL == session->capture) {
+        capture_open(session, session->context->capture_dir);
+    }
 
     // if it's a sensor, it must be probed
     if ((SERVICE_SENSOR == session->servicetype) &&
@@ -777,6 +879,31 @@ foundit:
     return session->gpsdata.gps_fd;
 }
 
+/* acquire a connection to the GPS device
+ * could be serial, udp://, tcp://, etc.
+ *
+ * With the bring-up workers running, a device node is activated in
+ * one of them, see dev_async.c, the daemon is called back when it is
+ * done.
+ *
+ * Return: fd on success
+ *         less than zero on failure
+ *         UNALLOCATED_FD (-1)  -- give up
+ *         PLACEHOLDING_FD (-2) -- retry possible, or a worker has it
+ */
+int gpsd_activate(struct gps_device_t *session, const int mode)
+{
+    if (session->opening) {
+        // a worker has it already
+        return PLACEHOLDING_FD;
+    }
+    if (O_CONTINUE != mode &&
+        devasync_open(session, mode)) {
+        return PLACEHOLDING_FD;
+    }
+    return gpsd_activate1(session, mode);
+}
+
 
 /*****************************************************************************
 
@@ -1398,6 +1525,7 @@ static void gpsd_error_model(struct gps_device_t *session)
  * return: AWAIT_ value
  */
 int gpsd_await_data(fd_set *rfds,
+                    fd_set *wfds,
                     fd_set *efds,
                     int maxfd,
                     fd_set *all_fds,
@@ -1424,7 +1552,8 @@ int gpsd_await_data(fd_set *rfds,
      */
     errno = 0;
 
-    status = pselect(maxfd + 1, rfds, NULL, NULL, &ts_timeout, NULL);
+    // wfds, if any, is set by the caller, fds with a connect() in progress
+    status = pselect(maxfd + 1, rfds, wfds, NULL, &ts_timeout, NULL);
     if (-1 == status) {
         if (EINTR == errno) {
             // caught a signal
@@ -1538,6 +1667,31 @@ static bool hunt_failure(struct gps_device_t *session)
     return 1 < session->badcount++;
 }
 
+/* count the time since the CLOCK_MONOTONIC start, into one of
+ * STATS_LATENCY_BINS octave bins of microseconds */
+void gpsd_latency_add(struct latency_t *latency, const timespec_t *start)
+{
+    timespec_t now;
+    int64_t nsec, usec;
+    int bin = 0;
+
+    if (0 == start->tv_sec &&
+        0 == start->tv_nsec) {
+        // no packet yet
+        return;
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    nsec = timespec_diff_ns(now, *start);
+    latency->sum_ns += nsec;
+    usec = nsec / 1000;
+    while (0 < usec &&
+           (STATS_LATENCY_BINS - 1) > bin) {
+        usec >>= 1;
+        bin++;
+    }
+    latency->bins[bin]++;
+}
+
 // update the stuff in the scoreboard structure
 // Also used by gpsdecode.c
 gps_mask_t gpsd_poll(struct gps_device_t *session)
@@ -1641,6 +1795,36 @@ gps_mask_t gpsd_poll(struct gps_device_t *session)
     GPSD_LOG(LOG_RAW1, &session->context->errout,
              "CORE: %s sent %zd new characters\n",
              session->gpsdata.dev.path, newlen);
+    session->stats.resyncs += session->lexer.resync_counter;
+    session->lexer.resync_counter = 0;
+    session->stats.discards += session->lexer.discard_counter;
+    session->lexer.discard_counter = 0;
+    if (0 < newlen &&
+        0 != session->lexer.outbuflen) {
+        // start the latency clocks
+        (void)clock_gettime(CLOCK_MONOTONIC, &session->stats.pkt_mono);
+        if (0 == session->stats.read_mono.tv_sec &&
+            0 == session->stats.read_mono.tv_nsec) {
+            // a getter that does not go through packet_get1()
+            session->stats.pkt_read = session->stats.pkt_mono;
+        } else {
+            session->stats.pkt_read = session->stats.read_mono;
+        }
+        gpsd_latency_add(&session->stats.lex, &session->stats.pkt_read);
+        FLIGHTREC(session, BAD_PACKET == session->lexer.type ?
+                               FLIGHTREC_BADPACKET : FLIGHTREC_PACKET,
+                  session->lexer.type, session->lexer.outbuffer,
+                  session->lexer.outbuflen);
+        if (BAD_PACKET == session->lexer.type) {
+            session->stats.bad_packets++;
+        } else if (0 <= session->lexer.type &&
+                   PACKET_TYPES > session->lexer.type) {
+            session->stats.packets[session->lexer.type]++;
+            if (SERVICE_NTRIP == session->servicetype) {
+                ntrip_packet(session);
+            }
+        }
+    }
 
     (void)clock_gettime(CLOCK_REALTIME, &ts_now);
     TS_SUB(&delta, &ts_now, &session->gpsdata.online);
@@ -1677,7 +1861,13 @@ gps_mask_t gpsd_poll(struct gps_device_t *session)
         return NODATA_IS;
     }
     // else (0 < newlen), got at least something.
-    session->lexer.pkt_time = ts_now;
+    if (session->rx_stamped &&
+        0 < session->lexer.rx_time.tv_sec) {
+        // when the kernel got it, not when we got around to it
+        session->lexer.pkt_time = session->lexer.rx_time;
+    } else {
+        session->lexer.pkt_time = ts_now;
+    }
 
     GPSD_LOG(LOG_RAW, &session->context->errout,
              "CORE: packet sniff on %s finds type %d\n",
@@ -1730,13 +1920,17 @@ gps_mask_t gpsd_poll(struct gps_device_t *session)
             // QQQ: use STICKY() instead?
             bool dependent_nmea = (NMEA_PACKET == newtype &&
                                NULL != session->device_type->mode_switcher);
+            // a relay:// feed mixes frames and JSON, its driver takes both
+            bool dependent_json = (JSON_PACKET == newtype &&
+                        GPSB_PACKET == session->device_type->packet_type);
 
             /*
              * Compute whether to switch drivers.
              * If the previous driver type was sticky and this one
              * isn't, we'll revert after processing the packet.
              */
-            driver_change = new_packet_type && !dependent_nmea;
+            driver_change = new_packet_type && !dependent_nmea &&
+                            !dependent_json;
         }
         if (driver_change) {
             const struct gps_type_t **dp;
@@ -1957,6 +2151,13 @@ gps_mask_t gpsd_poll(struct gps_device_t *session)
         }
     }
 
+    if (0 != (session->gpsdata.set & REPORT_IS)) {
+        session->stats.cycles++;
+    }
+    gpsd_latency_add(&session->stats.parse, &session->stats.pkt_mono);
+    (void)clock_gettime(CLOCK_MONOTONIC, &session->stats.parse_mono);
+    FLIGHTREC(session, FLIGHTREC_POLL, session->gpsdata.set, NULL, 0);
+
     GPSD_LOG(LOG_DATA, &session->context->errout,
              "CORE: gpsd_poll(%s) %s\n",
              session->gpsdata.dev.path,
@@ -1979,23 +2180,11 @@ int gpsd_multipoll(const bool data_ready,
 
         /*
          * Strange special case - the opening transaction on an NTRIP
-         * connection may not yet be completed.
-         * Try to ratchet things forward.
+         * connection may not yet be completed.  The caster answered
+         * the probe or the GET, ratchet things forward.
          */
         if (SERVICE_NTRIP == device->servicetype &&
             NTRIP_CONN_ESTABLISHED != device->ntrip.conn_state) {
-
-            timespec_t ts_now;
-            double step;
-
-            (void)clock_gettime(CLOCK_REALTIME, &ts_now);
-
-            step = TS_SUB_D(&ts_now, &device->ntrip.stream.stream_time);
-            // wait 6 seconds between hitting ntrip_open()
-            if (6 > fabs(step)) {
-                return DEVICE_UNCHANGED;
-            }
-            device->ntrip.stream.stream_time = ts_now;
             (void)ntrip_open(device, "");
             if (NTRIP_CONN_ERR == device->ntrip.conn_state) {
                 GPSD_LOG(LOG_WARN, &device->context->errout,
@@ -2133,32 +2322,7 @@ int gpsd_multipoll(const bool data_ready,
         device->reawake = (time_t)0;
         device->zerokill = true;
         return DEVICE_READY;
-    } else if (SERVICE_NTRIP == device->servicetype &&
-               NTRIP_CONN_INPROGRESS == device->ntrip.conn_state) {
-
-            timespec_t ts_now;
-            double step;
-
-            (void)clock_gettime(CLOCK_REALTIME, &ts_now);
-
-            step = TS_SUB_D(&ts_now, &device->ntrip.stream.stream_time);
-            // wait 6 seconds between hitting ntrip_open()
-            if (6 > fabs(step)) {
-                return DEVICE_UNCHANGED;
-            }
-            device->ntrip.stream.stream_time = ts_now;
-            (void)ntrip_open(device, "");
-            if (NTRIP_CONN_ERR == device->ntrip.conn_state) {
-                GPSD_LOG(LOG_WARN, &device->context->errout,
-                         "CORE: 2 connection to ntrip server failed\n");
-                // FIXME: next stat after error should depend on if
-                // initial connect or reconenct...
-                device->ntrip.conn_state = NTRIP_CONN_CLOSED;
-                return DEVICE_ERROR;
-            }
-            //  else
-            return DEVICE_READY;
-        }
+    }
 
     // no change in device descriptor state
     return DEVICE_UNCHANGED;
@@ -2214,7 +2378,13 @@ void ntp_latch(struct gps_device_t *device, struct timedelta_t *td)
         return;
     }
 
-    (void)clock_gettime(CLOCK_REALTIME, &td->clock);
+    if (device->rx_stamped &&
+        0 < device->lexer.pkt_time.tv_sec) {
+        // network source, use the kernel receive time of the packet
+        td->clock = device->lexer.pkt_time;
+    } else {
+        (void)clock_gettime(CLOCK_REALTIME, &td->clock);
+    }
     // structure copy of time from GPS
     td->real = device->newdata.time;
 
@@ -2232,6 +2402,7 @@ void ntp_latch(struct gps_device_t *device, struct timedelta_t *td)
 
     // thread-safe update
     pps_thread_fixin(&device->pps_thread, td);
+    timestats_toff(&device->timestats, td);
 }
 
 // end
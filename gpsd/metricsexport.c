@@ -0,0 +1,468 @@
+/*
+ * metricsexport.c - OpenMetrics text export from the daemon
+ *
+ * Answers an HTTP/1.0 GET of /metrics, from the -M listener, with the
+ * device health, fix quality, satellite counts, time offsets, client
+ * counts and ?STATS counters, in the OpenMetrics text format that
+ * Prometheus scrapes.  The page is made on demand, in the main thread,
+ * from the same state the JSON reports use.
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+#include "../include/gpsd_config.h"  // must be before all includes
+
+#include <math.h>
+#include <stddef.h>                  // for offsetof()
+#include <stdio.h>
+#include <string.h>
+
+#include "../include/gpsd.h"
+#include "../include/strfuncs.h"
+
+#define METRICS_TYPE "application/openmetrics-text; version=1.0.0; " \
+                     "charset=utf-8"
+
+// device label, a device path with OpenMetrics escapes
+static void metrics_label(const struct gps_device_t *device,
+                          char *label, size_t labellen)
+{
+    const char *sp;
+    size_t n = 0;
+
+    for (sp = device->gpsdata.dev.path; '\0' != *sp; sp++) {
+        if (labellen <= n + 3) {
+            break;
+        }
+        if ('"' == *sp ||
+            '\\' == *sp) {
+            label[n++] = '\\';
+        } else if ('\n' == *sp) {
+            label[n++] = '\\';
+            label[n++] = 'n';
+            continue;
+        }
+        label[n++] = *sp;
+    }
+    label[n] = '\0';
+}
+
+// start a metric family
+static void metrics_family(char *reply, size_t replylen, const char *name,
+                           const char *type, const char *help)
+{
+    str_appendf(reply, replylen, "# TYPE gpsd_%s %s\n# HELP gpsd_%s %s\n",
+                name, type, name, help);
+}
+
+// one family of a double per active device, NAN samples are not sent
+static void metrics_device_gauge(char *reply, size_t replylen,
+                                 const struct gps_device_t *devices,
+                                 int ndevices, const char *name,
+                                 const char *help, size_t offset)
+{
+    int i;
+
+    metrics_family(reply, replylen, name, "gauge", help);
+    for (i = 0; i < ndevices; i++) {
+        const struct gps_device_t *devp = &devices[i];
+        double value = *(const double *)((const char *)devp + offset);
+        char label[GPS_PATH_MAX * 2];
+
+        if ('\0' == devp->gpsdata.dev.path[0] ||
+            0 == isfinite(value)) {
+            continue;
+        }
+        metrics_label(devp, label, sizeof(label));
+        str_appendf(reply, replylen, "gpsd_%s{device=\"%s\"} %.9g\n",
+                    name, label, value);
+    }
+}
+
+// one family of an int per active device
+static void metrics_device_int(char *reply, size_t replylen,
+                               const struct gps_device_t *devices,
+                               int ndevices, const char *name,
+                               const char *help, size_t offset)
+{
+    int i;
+
+    metrics_family(reply, replylen, name, "gauge", help);
+    for (i = 0; i < ndevices; i++) {
+        const struct gps_device_t *devp = &devices[i];
+        char label[GPS_PATH_MAX * 2];
+
+        if ('\0' == devp->gpsdata.dev.path[0]) {
+            continue;
+        }
+        metrics_label(devp, label, sizeof(label));
+        str_appendf(reply, replylen, "gpsd_%s{device=\"%s\"} %d\n",
+                    name, label,
+                    *(const int *)((const char *)devp + offset));
+    }
+}
+
+// one counter family from the devstats_t of each active device
+static void metrics_device_counter(char *reply, size_t replylen,
+                                   const struct gps_device_t *devices,
+                                   int ndevices, const char *name,
+                                   const char *help, size_t offset)
+{
+    int i;
+
+    metrics_family(reply, replylen, name, "counter", help);
+    for (i = 0; i < ndevices; i++) {
+        const struct gps_device_t *devp = &devices[i];
+        char label[GPS_PATH_MAX * 2];
+
+        if ('\0' == devp->gpsdata.dev.path[0]) {
+            continue;
+        }
+        metrics_label(devp, label, sizeof(label));
+        str_appendf(reply, replylen, "gpsd_%s_total{device=\"%s\"} %lu\n",
+                    name, label,
+                    *(const unsigned long *)((const char *)&devp->stats +
+                                             offset));
+    }
+}
+
+// a latency histogram family, in seconds, from the devstats_t bins
+static void metrics_device_latency(char *reply, size_t replylen,
+                                   const struct gps_device_t *devices,
+                                   int ndevices, const char *name,
+                                   const char *help, size_t offset)
+{
+    int i, bin;
+
+    metrics_family(reply, replylen, name, "histogram", help);
+    for (i = 0; i < ndevices; i++) {
+        const struct gps_device_t *devp = &devices[i];
+        const struct latency_t *latency;
+        unsigned long count = 0;
+        char label[GPS_PATH_MAX * 2];
+
+        if ('\0' == devp->gpsdata.dev.path[0]) {
+            continue;
+        }
+        latency = (const struct latency_t *)((const char *)&devp->stats +
+                                             offset);
+        metrics_label(devp, label, sizeof(label));
+        // bin n counts times under 2^n uS, the last bin is +Inf
+        for (bin = 0; bin < STATS_LATENCY_BINS - 1; bin++) {
+            count += latency->bins[bin];
+            str_appendf(reply, replylen,
+                        "gpsd_%s_bucket{device=\"%s\",le=\"%g\"} %lu\n",
+                        name, label, ldexp(1e-6, bin), count);
+        }
+        count += latency->bins[bin];
+        str_appendf(reply, replylen,
+                    "gpsd_%s_bucket{device=\"%s\",le=\"+Inf\"} %lu\n"
+                    "gpsd_%s_count{device=\"%s\"} %lu\n"
+                    "gpsd_%s_sum{device=\"%s\"} %.9f\n",
+                    name, label, count, name, label, count,
+                    name, label, (double)latency->sum_ns / 1e9);
+    }
+}
+
+/* the metrics page, without the HTTP header
+ *
+ * Return: false, and reply emptied, if it did not fit in replylen */
+static bool metrics_dump(const struct metrics_daemon_t *counts,
+                         const struct gps_device_t *devices, int ndevices,
+                         char *reply, size_t replylen)
+{
+    static struct timestats_t stats[MAX_DEVICES];
+    struct timespec now;
+    int i, type;
+
+    reply[0] = '\0';
+
+    // daemon wide
+    metrics_family(reply, replylen, "clients", "gauge",
+                   "Connected clients.");
+    str_appendf(reply, replylen, "gpsd_clients %d\n", counts->clients);
+    metrics_family(reply, replylen, "watchers", "gauge",
+                   "Connected clients with a ?WATCH enabled.");
+    str_appendf(reply, replylen, "gpsd_watchers %d\n", counts->watchers);
+    metrics_family(reply, replylen, "clients_accepted", "counter",
+                   "Client connections accepted.");
+    str_appendf(reply, replylen, "gpsd_clients_accepted_total %lu\n",
+                counts->accepted);
+    metrics_family(reply, replylen, "clients_detached", "counter",
+                   "Clients dropped, for any reason.");
+    str_appendf(reply, replylen, "gpsd_clients_detached_total %lu\n",
+                counts->detached);
+    metrics_family(reply, replylen, "client_written_bytes", "counter",
+                   "Bytes written to clients.");
+    str_appendf(reply, replylen, "gpsd_client_written_bytes_total %lu\n",
+                counts->written);
+    metrics_family(reply, replylen, "client_eagain", "counter",
+                   "Writes to clients dropped on a full socket.");
+    str_appendf(reply, replylen, "gpsd_client_eagain_total %lu\n",
+                counts->eagain);
+    metrics_family(reply, replylen, "wakeups", "counter",
+                   "Main loop wakeups.");
+    str_appendf(reply, replylen, "gpsd_wakeups_total %lu\n",
+                counts->wakeups);
+    metrics_family(reply, replylen, "await_timeouts", "counter",
+                   "Main loop wakeups with nothing to read.");
+    str_appendf(reply, replylen, "gpsd_await_timeouts_total %lu\n",
+                counts->timeouts);
+
+    // device health
+    (void)clock_gettime(CLOCK_REALTIME, &now);
+    metrics_family(reply, replylen, "device", "info",
+                   "Active devices and their drivers.");
+    for (i = 0; i < ndevices; i++) {
+        const struct gps_device_t *devp = &devices[i];
+        char label[GPS_PATH_MAX * 2];
+
+        if ('\0' == devp->gpsdata.dev.path[0]) {
+            continue;
+        }
+        metrics_label(devp, label, sizeof(label));
+        str_appendf(reply, replylen,
+                    "gpsd_device_info{device=\"%s\",driver=\"%s\"} 1\n",
+                    label, NULL == devp->device_type ? "" :
+                           devp->device_type->type_name);
+    }
+    metrics_family(reply, replylen, "device_online", "gauge",
+                   "1 if the device is sending data.");
+    for (i = 0; i < ndevices; i++) {
+        const struct gps_device_t *devp = &devices[i];
+        char label[GPS_PATH_MAX * 2];
+
+        if ('\0' == devp->gpsdata.dev.path[0]) {
+            continue;
+        }
+        metrics_label(devp, label, sizeof(label));
+        str_appendf(reply, replylen, "gpsd_device_online{device=\"%s\"} %d\n",
+                    label, 0 < devp->gpsdata.online.tv_sec);
+    }
+    metrics_family(reply, replylen, "device_seconds_since_data", "gauge",
+                   "Seconds since the device last sent data.");
+    for (i = 0; i < ndevices; i++) {
+        const struct gps_device_t *devp = &devices[i];
+        char label[GPS_PATH_MAX * 2];
+
+        if ('\0' == devp->gpsdata.dev.path[0] ||
+            0 >= devp->gpsdata.online.tv_sec) {
+            continue;
+        }
+        metrics_label(devp, label, sizeof(label));
+        str_appendf(reply, replylen,
+                    "gpsd_device_seconds_since_data{device=\"%s\"} %.3f\n",
+                    label,
+                    (double)timespec_diff_ns(now, devp->gpsdata.online) / 1e9);
+    }
+
+    // fix quality
+    metrics_device_int(reply, replylen, devices, ndevices, "fix_mode",
+                       "Fix mode, 0 unknown, 1 none, 2 2D, 3 3D.",
+                       offsetof(struct gps_device_t, gpsdata.fix.mode));
+    metrics_device_int(reply, replylen, devices, ndevices, "fix_status",
+                       "Fix status, as in TPV.",
+                       offsetof(struct gps_device_t, gpsdata.fix.status));
+    metrics_device_int(reply, replylen, devices, ndevices,
+                       "satellites_visible", "Satellites in view.",
+                       offsetof(struct gps_device_t,
+                                gpsdata.satellites_visible));
+    metrics_device_int(reply, replylen, devices, ndevices,
+                       "satellites_used", "Satellites used in the fix.",
+                       offsetof(struct gps_device_t,
+                                gpsdata.satellites_used));
+    metrics_device_gauge(reply, replylen, devices, ndevices,
+                         "fix_eph_meters",
+                         "Estimated horizontal position error.",
+                         offsetof(struct gps_device_t, gpsdata.fix.eph));
+    metrics_device_gauge(reply, replylen, devices, ndevices,
+                         "fix_epv_meters",
+                         "Estimated vertical position error.",
+                         offsetof(struct gps_device_t, gpsdata.fix.epv));
+    metrics_device_gauge(reply, replylen, devices, ndevices, "hdop",
+                         "Horizontal dilution of precision.",
+                         offsetof(struct gps_device_t, gpsdata.dop.hdop));
+    metrics_device_gauge(reply, replylen, devices, ndevices, "pdop",
+                         "Position dilution of precision.",
+                         offsetof(struct gps_device_t, gpsdata.dop.pdop));
+
+    // time offsets, the last sample of the TSTATS series
+    metrics_family(reply, replylen, "toff_seconds", "gauge",
+                   "Last in-band time offset, real - clock.");
+    for (i = 0; i < ndevices; i++) {
+        char label[GPS_PATH_MAX * 2];
+
+        if ('\0' == devices[i].gpsdata.dev.path[0]) {
+            continue;
+        }
+        timestats_snapshot(&devices[i].timestats, &stats[i]);
+        if (0 < stats[i].toff.count) {
+            metrics_label(&devices[i], label, sizeof(label));
+            str_appendf(reply, replylen,
+                        "gpsd_toff_seconds{device=\"%s\"} %.9f\n",
+                        label, stats[i].toff.last);
+        }
+    }
+    metrics_family(reply, replylen, "pps_offset_seconds", "gauge",
+                   "Last PPS offset, real - clock.");
+    for (i = 0; i < ndevices; i++) {
+        char label[GPS_PATH_MAX * 2];
+
+        if ('\0' == devices[i].gpsdata.dev.path[0]) {
+            continue;
+        }
+        if (0 < stats[i].pps.count) {
+            metrics_label(&devices[i], label, sizeof(label));
+            str_appendf(reply, replylen,
+                        "gpsd_pps_offset_seconds{device=\"%s\"} %.9f\n",
+                        label, stats[i].pps.last);
+        }
+    }
+
+    // ?STATS counters
+    metrics_device_counter(reply, replylen, devices, ndevices,
+                           "device_read_bytes", "Bytes read from the device.",
+                           offsetof(struct devstats_t, bytes_read));
+    metrics_family(reply, replylen, "device_packets", "counter",
+                   "Packets received, by packet type.");
+    for (i = 0; i < ndevices; i++) {
+        const struct gps_device_t *devp = &devices[i];
+        char label[GPS_PATH_MAX * 2];
+
+        if ('\0' == devp->gpsdata.dev.path[0]) {
+            continue;
+        }
+        metrics_label(devp, label, sizeof(label));
+        for (type = 0; type < PACKET_TYPES; type++) {
+            if (0 != devp->stats.packets[type]) {
+                str_appendf(reply, replylen,
+                            "gpsd_device_packets_total{device=\"%s\","
+                            "type=\"%s\"} %lu\n",
+                            label, packet_type_names[type],
+                            devp->stats.packets[type]);
+            }
+        }
+    }
+    metrics_device_counter(reply, replylen, devices, ndevices,
+                           "device_bad_packets",
+                           "Packets dropped for a bad checksum or length.",
+                           offsetof(struct devstats_t, bad_packets));
+    metrics_device_counter(reply, replylen, devices, ndevices,
+                           "device_resyncs",
+                           "Times the lexer lost sync part way into a packet.",
+                           offsetof(struct devstats_t, resyncs));
+    metrics_device_counter(reply, replylen, devices, ndevices,
+                           "device_driver_switches", "Driver selections.",
+                           offsetof(struct devstats_t, driver_switches));
+    metrics_device_counter(reply, replylen, devices, ndevices,
+                           "device_cycles", "Reporting cycles.",
+                           offsetof(struct devstats_t, cycles));
+    metrics_device_counter(reply, replylen, devices, ndevices,
+                           "device_rtcm_relayed",
+                           "RTCM frames relayed to the device.",
+                           offsetof(struct devstats_t, rtcm_relayed));
+    metrics_device_counter(reply, replylen, devices, ndevices,
+                           "device_rtcm_dropped",
+                           "RTCM frames for the device lost, its queue was "
+                           "full or the write failed.",
+                           offsetof(struct devstats_t, rtcm_dropped));
+    metrics_device_counter(reply, replylen, devices, ndevices,
+                           "device_rtcm_filtered",
+                           "RTCM frames not relayed to the device, of a type "
+                           "it does not take.",
+                           offsetof(struct devstats_t, rtcm_filtered));
+    metrics_device_counter(reply, replylen, devices, ndevices,
+                           "device_out_written",
+                           "Bytes written to the device.",
+                           offsetof(struct devstats_t, out_written));
+    metrics_device_counter(reply, replylen, devices, ndevices,
+                           "device_out_queued",
+                           "Bytes for the device that waited in its output "
+                           "queue.",
+                           offsetof(struct devstats_t, out_queued));
+    metrics_device_counter(reply, replylen, devices, ndevices,
+                           "device_out_waits",
+                           "Times the main loop waited for the device to "
+                           "take its output queue.",
+                           offsetof(struct devstats_t, out_waits));
+    metrics_device_counter(reply, replylen, devices, ndevices,
+                           "device_udp_dropped",
+                           "Datagrams from the device the kernel dropped, "
+                           "its receive buffer was full.",
+                           offsetof(struct devstats_t, udp_dropped));
+    metrics_device_counter(reply, replylen, devices, ndevices,
+                           "device_udp_truncated",
+                           "Datagrams from the device cut short, longer "
+                           "than one read takes.",
+                           offsetof(struct devstats_t, udp_truncated));
+    metrics_device_counter(reply, replylen, devices, ndevices,
+                           "device_relay_lost",
+                           "Frames of the relay:// feed it no longer had "
+                           "to resume with.",
+                           offsetof(struct devstats_t, relay_lost));
+    metrics_device_latency(reply, replylen, devices, ndevices,
+                           "device_lex_latency_seconds",
+                           "Time from the read() that completed a packet "
+                           "to the lexer returning it.",
+                           offsetof(struct devstats_t, lex));
+    metrics_device_latency(reply, replylen, devices, ndevices,
+                           "device_parse_latency_seconds",
+                           "Time from the lexer returning a packet to the "
+                           "end of its decode.",
+                           offsetof(struct devstats_t, parse));
+    metrics_device_latency(reply, replylen, devices, ndevices,
+                           "device_report_latency_seconds",
+                           "Time from the lexer returning the last packet "
+                           "of a cycle to the last client write.",
+                           offsetof(struct devstats_t, report));
+    metrics_device_latency(reply, replylen, devices, ndevices,
+                           "device_write_latency_seconds",
+                           "Time from the read() that completed a packet "
+                           "to the write() of its TPV to each watcher.",
+                           offsetof(struct devstats_t, write));
+    // whatever was cut short before, this is too
+    if (replylen <= strlcat(reply, "# EOF\n", replylen)) {
+        reply[0] = '\0';
+        return false;
+    }
+    return true;
+}
+
+/* answer one HTTP request to the metrics listener, a page too big
+ * for METRICS_MAX is a 500, not one cut short
+ *
+ * Return: the length of the whole response in reply */
+size_t metrics_http(const char *request,
+                    const struct metrics_daemon_t *counts,
+                    const struct gps_device_t *devices, int ndevices,
+                    char *reply, size_t replylen)
+{
+    static char body[METRICS_MAX];
+    const char *status = "200 OK";
+    const char *type = METRICS_TYPE;
+
+    if (str_starts_with(request, "GET /metrics ") ||
+        str_starts_with(request, "GET /metrics?")) {
+        if (!metrics_dump(counts, devices, ndevices, body, sizeof(body))) {
+            status = "500 Internal Server Error";
+            type = "text/plain";
+            (void)strlcpy(body, "Metrics page too big\n", sizeof(body));
+        }
+    } else if (str_starts_with(request, "GET ")) {
+        status = "404 Not Found";
+        type = "text/plain";
+        (void)strlcpy(body, "Try /metrics\n", sizeof(body));
+    } else {
+        status = "405 Method Not Allowed";
+        type = "text/plain";
+        (void)strlcpy(body, "Only GET\n", sizeof(body));
+    }
+    (void)snprintf(reply, replylen,
+                   "HTTP/1.0 %s\r\nContent-Type: %s\r\n"
+                   "Content-Length: %zu\r\nConnection: close\r\n\r\n%s",
+                   status, type, strnlen(body, sizeof(body)), body);
+    return strnlen(reply, replylen);
+}
+
+// vim: set expandtab shiftwidth=4
@@ -0,0 +1,456 @@
+/*
+ * net_async.c - name lookups and connects that do not stall the main loop
+ *
+ * getaddrinfo() blocks for as long as the resolver takes, seconds when
+ * a name server is slow or gone.  The daemon looks names up in one
+ * resolver thread instead.  The thread writes each answer, whole, into
+ * a pipe the main loop selects on.  netasync_poll() stores the answer
+ * in the device and calls the daemon back to carry on opening it.
+ *
+ * Connects are non-blocking.  The daemon selects the fd for writing
+ * while session->connecting, then netasync_connected() reads SO_ERROR
+ * and sends the NTRIP or DGPSIP request.  A connect that fails goes on
+ * to the next address of the answer, on the same fd, as
+ * netlib_connectsock1() does.  Only when all failed is the name looked
+ * up again.
+ *
+ * Answers are kept in the device, so a reconnect within NETASYNC_TTL
+ * does no lookup at all.  Numeric addresses never go to the thread.
+ *
+ * Without netasync_init(), as in gpsmon and gpsctl,
+ * netasync_connectsock() is the old blocking netlib_connectsock().
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+#include "../include/gpsd_config.h"   // must be before all includes
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdlib.h>                   // for calloc()
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/gpsd.h"
+#include "../include/strfuncs.h"
+
+#define NETASYNC_QUEUE          32      // lookups waiting for the thread
+#define NETASYNC_TTL            300     // seconds an answer is reused
+#define NETASYNC_RETRY          5       // seconds a failure is remembered
+
+struct netasync_req_t {
+    struct gps_device_t *session;
+    unsigned gen;
+    char host[GPS_PATH_MAX];
+    char service[32];
+};
+
+// an answer, smaller than PIPE_BUF, so one write() is atomic
+struct netasync_reply_t {
+    struct gps_device_t *session;
+    unsigned gen;
+    int status;                         // 0, or NL_*
+    int naddrs;
+    socklen_t addrlen[NETCONN_ADDRS];
+    struct sockaddr_storage addrs[NETCONN_ADDRS];
+};
+
+struct netasync_t {
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    struct netasync_req_t queue[NETASYNC_QUEUE];
+    unsigned head, tail;                // head - tail requests waiting
+    int pipefd[2];                      // answers, thread to main loop
+    void (*resolved)(struct gps_device_t *);
+};
+
+// getaddrinfo() into reply, flags are the ai_flags
+static void netasync_lookup(const char *host, const char *service,
+                            int flags, struct netasync_reply_t *reply)
+{
+    struct addrinfo hints = {0};
+    struct addrinfo *result = NULL;
+    struct addrinfo *rp;
+
+    reply->naddrs = 0;
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_protocol = IPPROTO_TCP;
+    hints.ai_flags = flags;
+    if (0 != getaddrinfo(host, service, &hints, &result)) {
+        if (NULL != result) {
+            // musl can not freeaddrinfo(NULL), see netlib_connectsock1()
+            freeaddrinfo(result);
+            result = NULL;
+        }
+        // was it the host or the service?
+        hints.ai_flags = 0;
+        if (0 != getaddrinfo(NULL, service, &hints, &result)) {
+            reply->status = NL_NOSERVICE;
+        } else {
+            reply->status = NL_NOHOST;
+        }
+        if (NULL != result) {
+            freeaddrinfo(result);
+        }
+        return;
+    }
+    // keep the RFC 3484 order getaddrinfo() returns
+    for (rp = result;
+         NULL != rp && NETCONN_ADDRS > reply->naddrs;
+         rp = rp->ai_next) {
+        if (sizeof(reply->addrs[0]) < rp->ai_addrlen) {
+            continue;
+        }
+        (void)memcpy(&reply->addrs[reply->naddrs], rp->ai_addr,
+                     rp->ai_addrlen);
+        reply->addrlen[reply->naddrs] = rp->ai_addrlen;
+        reply->naddrs++;
+    }
+    freeaddrinfo(result);
+    reply->status = 0 < reply->naddrs ? 0 : NL_NOHOST;
+}
+
+// keep an answer in the device
+static void netasync_store(struct netconn_t *nc,
+                           const struct netasync_reply_t *reply)
+{
+    nc->status = reply->status;
+    nc->naddrs = reply->naddrs;
+    nc->addr = 0;
+    (void)memcpy(nc->addrlen, reply->addrlen, sizeof(nc->addrlen));
+    (void)memcpy(nc->addrs, reply->addrs, sizeof(nc->addrs));
+    nc->resolved = time(NULL);
+}
+
+// the resolver thread, one lookup at a time
+static void *netasync_resolver(void *arg)
+{
+    struct netasync_t *na = (struct netasync_t *)arg;
+
+    for (;;) {
+        struct netasync_req_t req;
+        struct netasync_reply_t reply;
+
+        (void)pthread_mutex_lock(&na->mutex);
+        while (na->head == na->tail) {
+            (void)pthread_cond_wait(&na->cond, &na->mutex);
+        }
+        req = na->queue[na->tail % NETASYNC_QUEUE];
+        na->tail++;
+        (void)pthread_mutex_unlock(&na->mutex);
+
+        (void)memset(&reply, 0, sizeof(reply));
+        reply.session = req.session;
+        reply.gen = req.gen;
+        netasync_lookup(req.host, req.service, 0, &reply);
+        while (0 > write(na->pipefd[1], &reply, sizeof(reply)) &&
+               EINTR == errno) {
+            continue;
+        }
+    }
+    return NULL;
+}
+
+/* start the resolver thread
+ * resolved -- called in the main loop when a lookup for a device is done
+ *
+ * Return: the fd to select() on for answers, then call netasync_poll()
+ *         -1 on failure, lookups then block as before
+ */
+int netasync_init(struct gps_context_t *context,
+                  void (*resolved)(struct gps_device_t *))
+{
+    struct netasync_t *na;
+    sigset_t all, old;
+    int err;
+
+    na = (struct netasync_t *)calloc(1, sizeof(struct netasync_t));
+    if (NULL == na) {
+        GPSD_LOG(LOG_ERROR, &context->errout,
+                 "NETASYNC: out of memory\n");
+        return -1;
+    }
+    if (0 != pipe(na->pipefd)) {
+        GPSD_LOG(LOG_ERROR, &context->errout,
+                 "NETASYNC: pipe() failed: %s(%d)\n",
+                 strerror(errno), errno);
+        free(na);
+        return -1;
+    }
+    // the main loop drains the pipe until it would block
+    (void)fcntl(na->pipefd[0], F_SETFL,
+                fcntl(na->pipefd[0], F_GETFL) | O_NONBLOCK);
+    (void)fcntl(na->pipefd[0], F_SETFD, FD_CLOEXEC);
+    (void)fcntl(na->pipefd[1], F_SETFD, FD_CLOEXEC);
+    na->resolved = resolved;
+    (void)pthread_mutex_init(&na->mutex, NULL);
+    (void)pthread_cond_init(&na->cond, NULL);
+
+    // signals are for the main loop, the thread inherits this mask
+    (void)sigfillset(&all);
+    (void)pthread_sigmask(SIG_BLOCK, &all, &old);
+    err = pthread_create(&na->thread, NULL, netasync_resolver, na);
+    (void)pthread_sigmask(SIG_SETMASK, &old, NULL);
+    if (0 != err) {
+        GPSD_LOG(LOG_ERROR, &context->errout,
+                 "NETASYNC: pthread_create() failed: %s(%d)\n",
+                 strerror(err), err);
+        (void)pthread_cond_destroy(&na->cond);
+        (void)pthread_mutex_destroy(&na->mutex);
+        (void)close(na->pipefd[0]);
+        (void)close(na->pipefd[1]);
+        free(na);
+        return -1;
+    }
+    (void)pthread_detach(na->thread);
+    context->netasync = na;
+    GPSD_LOG(LOG_PROG, &context->errout,
+             "NETASYNC: resolver thread started, answers on fd %d\n",
+             na->pipefd[0]);
+    return na->pipefd[0];
+}
+
+// hand a lookup for session to the thread, false if the queue is full
+static bool netasync_queue(struct netasync_t *na,
+                           struct gps_device_t *session)
+{
+    struct netconn_t *nc = &session->netconn;
+    struct netasync_req_t *req;
+
+    (void)pthread_mutex_lock(&na->mutex);
+    if (NETASYNC_QUEUE <= na->head - na->tail) {
+        (void)pthread_mutex_unlock(&na->mutex);
+        return false;
+    }
+    req = &na->queue[na->head % NETASYNC_QUEUE];
+    req->session = session;
+    req->gen = ++nc->gen;
+    (void)strlcpy(req->host, nc->host, sizeof(req->host));
+    (void)strlcpy(req->service, nc->service, sizeof(req->service));
+    na->head++;
+    nc->resolving = true;
+    (void)pthread_cond_signal(&na->cond);
+    (void)pthread_mutex_unlock(&na->mutex);
+    return true;
+}
+
+/* start a connect() to the first address of nc, from the one at first,
+ * that takes it, and keep which one in nc->addr
+ *
+ * Return: socket, the connect() may still be in progress
+ *         less than zero on error (NL_*), then the name is looked up
+ *         again next time
+ */
+static socket_t netasync_start(struct netconn_t *nc, int first,
+                               char *addrbuf, size_t addrbuf_sz)
+{
+    socket_t s = NL_NOCONNECT;
+    int i;
+
+    for (i = first; i < nc->naddrs; i++) {
+        s = netlib_connectaddr((const struct sockaddr *)&nc->addrs[i],
+                               nc->addrlen[i], addrbuf, addrbuf_sz);
+        if (0 <= s) {
+            nc->addr = i;
+            return s;
+        }
+    }
+    // maybe the name moved
+    nc->resolved = 0;
+    return s;
+}
+
+/* connect to host:service over TCP, for a network source
+ * addrbuf -- 50 char buf to put string of IP address conencting
+ *            INET6_ADDRSTRLEN
+ * addrbuf_sz -- sizeof(adddrbuf)
+ *
+ * With the resolver thread running the connect() is non-blocking and
+ * session->connecting is set, the caller waits for the fd to become
+ * writable, then calls netasync_connected().  A name not looked up
+ * yet returns NL_PENDING, the daemon is called back when the answer
+ * is in, and the caller then calls again.
+ *
+ * Without the thread it is a blocking connect, as before.
+ *
+ * return socket on success
+ *        NL_PENDING while the name is looked up
+ *        less than zero on error (NL_*)
+ */
+socket_t netasync_connectsock(struct gps_device_t *session,
+                              const char *host, const char *service,
+                              char *addrbuf, size_t addrbuf_sz)
+{
+    struct netasync_t *na = session->context->netasync;
+    struct netconn_t *nc = &session->netconn;
+    time_t age;
+    socket_t s;
+
+    if (NULL != addrbuf) {
+        addrbuf[0] = '\0';
+    }
+    session->connecting = false;
+    if (NULL == na) {
+        return netlib_connectsock1(AF_UNSPEC, host, service, "tcp", 2,
+                                   false, addrbuf, addrbuf_sz);
+    }
+    if (0 != strcmp(nc->host, host) ||
+        0 != strcmp(nc->service, service)) {
+        // a different name, forget the old answer, and any lookup of it
+        (void)strlcpy(nc->host, host, sizeof(nc->host));
+        (void)strlcpy(nc->service, service, sizeof(nc->service));
+        nc->resolving = false;
+        nc->resolved = 0;
+        nc->naddrs = 0;
+        nc->status = 0;
+        nc->gen++;
+    }
+    if (nc->resolving) {
+        return NL_PENDING;
+    }
+    // llabs() in case the system time jumped
+    age = (time_t)llabs(time(NULL) - nc->resolved);
+    if (0 != nc->resolved &&
+        0 > nc->status &&
+        NETASYNC_RETRY > age) {
+        return nc->status;
+    }
+    if (0 == nc->resolved ||
+        0 == nc->naddrs ||
+        NETASYNC_TTL <= age) {
+        struct netasync_reply_t reply;
+
+        // a numeric address needs no resolver
+        netasync_lookup(host, service, AI_NUMERICHOST, &reply);
+        if (0 == reply.status) {
+            netasync_store(nc, &reply);
+        } else if (netasync_queue(na, session)) {
+            GPSD_LOG(LOG_PROG, &session->context->errout,
+                     "NETASYNC: looking up %s:%s for %s\n",
+                     host, service, session->gpsdata.dev.path);
+            return NL_PENDING;
+        } else {
+            GPSD_LOG(LOG_ERROR, &session->context->errout,
+                     "NETASYNC: lookup queue full, %s:%s\n",
+                     host, service);
+            return NL_NOHOST;
+        }
+    }
+
+    s = netasync_start(nc, 0, addrbuf, addrbuf_sz);
+    if (0 <= s) {
+        session->connecting = true;
+    }
+    return s;
+}
+
+// read the answers of the resolver thread, call the daemon back on each
+void netasync_poll(struct gps_context_t *context)
+{
+    struct netasync_t *na = context->netasync;
+    struct netasync_reply_t reply;
+
+    if (NULL == na) {
+        return;
+    }
+    while ((ssize_t)sizeof(reply) ==
+           read(na->pipefd[0], &reply, sizeof(reply))) {
+        struct gps_device_t *session = reply.session;
+        struct netconn_t *nc = &session->netconn;
+
+        if (!nc->resolving ||
+            reply.gen != nc->gen) {
+            // the device was closed, or asked for another name, since
+            continue;
+        }
+        nc->resolving = false;
+        netasync_store(nc, &reply);
+        if (0 > reply.status) {
+            GPSD_LOG(LOG_ERROR, &context->errout,
+                     "NETASYNC: %s:%s for %s, lookup failed: %s\n",
+                     nc->host, nc->service, session->gpsdata.dev.path,
+                     netlib_errstr(reply.status));
+        } else {
+            GPSD_LOG(LOG_PROG, &context->errout,
+                     "NETASYNC: %s:%s for %s, %d addresses\n",
+                     nc->host, nc->service, session->gpsdata.dev.path,
+                     reply.naddrs);
+        }
+        if (NULL != na->resolved) {
+            na->resolved(session);
+        }
+    }
+}
+
+/* the fd of a connecting session became writable, finish the connect
+ *
+ * Return: DEVICE_READY, or DEVICE_ERROR
+ *         DEVICE_UNCHANGED if it failed, and the next address is tried
+ */
+int netasync_connected(struct gps_device_t *session)
+{
+    int err = 0;
+    socklen_t len = sizeof(err);
+
+    session->connecting = false;
+    if (0 != getsockopt(session->gpsdata.gps_fd, SOL_SOCKET, SO_ERROR,
+                        (char *)&err, &len)) {
+        err = errno;
+    }
+    if (0 != err) {
+        struct netconn_t *nc = &session->netconn;
+        char addrbuf[50];
+        socket_t s;
+
+        // cast for 32-bit ints
+        GPSD_LOG(LOG_ERROR, &session->context->errout,
+                 "NETASYNC: connect(%s) on fd %ld failed: %s(%d)\n",
+                 session->gpsdata.dev.path, (long)session->gpsdata.gps_fd,
+                 strerror(err), err);
+        s = netasync_start(nc, nc->addr + 1, addrbuf, sizeof(addrbuf));
+        if (0 > s) {
+            // all of them failed, look the name up again next time
+            return DEVICE_ERROR;
+        }
+        // the next address, on the fd the daemon already selects on
+        if (0 > dup2(s, session->gpsdata.gps_fd)) {
+            (void)close(s);
+            nc->resolved = 0;
+            return DEVICE_ERROR;
+        }
+        (void)close(s);
+        session->connecting = true;
+        GPSD_LOG(LOG_PROG, &session->context->errout,
+                 "NETASYNC: %s, trying address %d of %d, %s\n",
+                 session->gpsdata.dev.path, nc->addr + 1, nc->naddrs,
+                 addrbuf);
+        return DEVICE_UNCHANGED;
+    }
+    // cast for 32-bit ints
+    GPSD_LOG(LOG_PROG, &session->context->errout,
+             "NETASYNC: connected %s on fd %ld\n",
+             session->gpsdata.dev.path, (long)session->gpsdata.gps_fd);
+
+    switch (session->servicetype) {
+    case SERVICE_NTRIP:
+        return 0 > ntrip_connected(session) ? DEVICE_ERROR : DEVICE_READY;
+    case SERVICE_DGPSIP:
+        return 0 > dgpsip_connected(session) ? DEVICE_ERROR : DEVICE_READY;
+    case SERVICE_RELAY:
+        return 0 > relay_connected(session) ? DEVICE_ERROR : DEVICE_READY;
+    default:
+        // tcp://, nothing to send, the device talks first
+        return DEVICE_READY;
+    }
+}
+
+// vim: set expandtab shiftwidth=4
@@ -21,19 +21,22 @@
 
 /* open a connection to a DGPSIP server
  * Return: socket on success
+ *         PLACEHOLDING_FD while the name is looked up
  *         less than zero on failure
  */
 socket_t dgpsip_open(struct gps_device_t *device, const char *dgpsserver)
 {
     char *colon, *dgpsport = "rtcm-sc104";
-    int opts;
-    char hn[256], buf[BUFSIZ];
+    char addrbuf[50];         // INET6_ADDRSTRLEN
+    char server[GPS_PATH_MAX];
     socket_t dsock;
-    ssize_t blen;
 
     device->servicetype = SERVICE_DGPSIP;
     device->dgpsip.reported = false;
-    if (NULL != (colon = strchr(dgpsserver, ':'))) {
+    // a copy, dgpsserver may be the device path, opened again later
+    (void)strlcpy(server, dgpsserver, sizeof(server));
+    dgpsserver = server;
+    if (NULL != (colon = strchr(server, ':'))) {
         dgpsport = colon + 1;
         *colon = '\0';
     }
@@ -41,7 +44,13 @@ socket_t dgpsip_open(struct gps_device_t *device, const char *dgpsserver)
         dgpsport = DEFAULT_RTCM_PORT;
     }
 
-    dsock = netlib_connectsock(AF_UNSPEC, dgpsserver, dgpsport, "tcp");
+    dsock = netasync_connectsock(device, dgpsserver, dgpsport,
+                                 addrbuf, sizeof(addrbuf));
+    if (NL_PENDING == dsock) {
+        // netasync_poll() has the daemon open us again
+        device->gpsdata.gps_fd = PLACEHOLDING_FD;
+        return PLACEHOLDING_FD;
+    }
     if (0 > dsock) {
         // cast for 32-bit ints
         GPSD_LOG(LOG_ERROR, &device->context->errout,
@@ -53,9 +62,27 @@ socket_t dgpsip_open(struct gps_device_t *device, const char *dgpsserver)
     }
     // cast for 32-bit ints
     GPSD_LOG(LOG_PROG, &device->context->errout,
-             "DGPS: connection to DGPS server %s established. fd=%ld\n",
-             dgpsserver, (long)dsock);
+             "DGPS: connection to DGPS server %s IP %s %s. fd=%ld\n",
+             dgpsserver, addrbuf,
+             device->connecting ? "in progress" : "established",
+             (long)dsock);
     device->gpsdata.gps_fd = (gps_fd_t)dsock;
+    if (!device->connecting) {
+        (void)dgpsip_connected(device);
+    }
+    return (socket_t)device->gpsdata.gps_fd;
+}
+
+/* the connection to the DGPSIP server is up, say hello
+ * Return: 0 on success
+ *         less than zero on failure
+ */
+int dgpsip_connected(struct gps_device_t *device)
+{
+    char hn[256], buf[BUFSIZ];
+    ssize_t blen;
+    int opts;
+
     (void)gethostname(hn, sizeof(hn));
     // greeting required by some RTCM104 servers; others will ignore it
     blen = snprintf(buf, sizeof(buf), "HELO %s gpsd %s\r\nR\r\n", hn,
@@ -64,7 +91,7 @@ socket_t dgpsip_open(struct gps_device_t *device, const char *dgpsserver)
         write(device->gpsdata.gps_fd, buf, blen) != blen) {
         GPSD_LOG(LOG_ERROR, &device->context->errout,
                  "DGPS: hello to DGPS server %s failed\n",
-                 dgpsserver);
+                 device->gpsdata.dev.path);
     }
     opts = fcntl(device->gpsdata.gps_fd, F_GETFL);
 
@@ -73,9 +100,9 @@ socket_t dgpsip_open(struct gps_device_t *device, const char *dgpsserver)
     } else {
         GPSD_LOG(LOG_ERROR, &device->context->errout,
                  "DGPS: fcntl %s failed. %s(%d)\n",
-                 dgpsserver, strerror(errno), errno);
+                 device->gpsdata.dev.path, strerror(errno), errno);
     }
-    return (socket_t)device->gpsdata.gps_fd;
+    return 0;
 }
 
 // may be time to ship a usage report to the DGPSIP server
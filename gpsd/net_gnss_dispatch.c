@@ -18,13 +18,15 @@
 
 #define NETGNSS_DGPSIP  "dgpsip://"
 #define NETGNSS_NTRIP   "ntrip://"
+#define NETGNSS_RELAY   "relay://"
 
 // is given string a valid URI for GNSS/DGPS service?
 bool netgnss_uri_check(char *name)
 {
     return
         str_starts_with(name, NETGNSS_NTRIP) ||
-        str_starts_with(name, NETGNSS_DGPSIP);
+        str_starts_with(name, NETGNSS_DGPSIP) ||
+        str_starts_with(name, NETGNSS_RELAY);
 }
 
 
@@ -43,6 +45,10 @@ gps_fd_t netgnss_uri_open(struct gps_device_t *dev, char *netgnss_service)
         return dgpsip_open(dev, netgnss_service + sizeof(NETGNSS_DGPSIP) - 1);
     }
 
+    if (str_starts_with(netgnss_service, NETGNSS_RELAY)) {
+        return relay_open(dev, netgnss_service + sizeof(NETGNSS_RELAY) - 1);
+    }
+
 #ifndef REQUIRE_DGNSS_PROTO
     return dgpsip_open(dev, netgnss_service);
 #else
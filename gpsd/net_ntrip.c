@@ -61,6 +61,7 @@ static const char *ntrip_state(unsigned state)
         "ERR",
         "CLOSED",
         "INPROGRESS",
+        "RESOLVING",
         "UNKNOWN",
     };
     unsigned num_states = sizeof(ntrip_states)/sizeof(ntrip_states[0]);
@@ -270,6 +271,15 @@ static int ntrip_sourcetable_parse(struct gps_device_t *device)
     char *line;
     char buf[BUFSIZ / 2];   // half of BUFSIZE, so we can GPSD_LOG() it
     socket_t fd = (socket_t)device->gpsdata.gps_fd;
+    struct gps_lexer_t *lexer = &device->lexer;
+
+    /* the socket is non-blocking, the sourcetable comes in as it comes,
+     * pick up the partial line the last call left in the idle lexer */
+    if (sizeof(buf) > lexer->inbuflen) {
+        len = (ssize_t)lexer->inbuflen;
+        (void)memcpy(buf, lexer->inbuffer, lexer->inbuflen);
+    }
+    lexer->inbuflen = 0;
 
     for (;;) {
         ssize_t rlen;
@@ -296,9 +306,10 @@ static int ntrip_sourcetable_parse(struct gps_device_t *device)
             if (EINTR == errno) {
                 continue;
             }
-            if (device->ntrip.sourcetable_parse &&
-                EAGAIN == errno) {
-                // not found a match, but there is no more data
+            if (EAGAIN == errno) {
+                // not found a match, but there is no more data, yet
+                (void)memcpy(lexer->inbuffer, buf, (size_t)len);
+                lexer->inbuflen = (size_t)len;
                 return 0;
             }
             // cast for 32-bit ints
@@ -329,6 +340,12 @@ static int ntrip_sourcetable_parse(struct gps_device_t *device)
         line[rlen] = '\0';      // pacify coverity that this is NUL terminated
 
         if (!device->ntrip.sourcetable_parse) {
+            char *body = strstr(line, NTRIP_BODY);
+
+            if (NULL == body) {
+                // the header is not all in yet
+                continue;
+            }
             /* For ntrip v1 the very first line s/b:
              *     "SOURCETABLE 200 OK\r\n"
              * For ntrip v2, the header should contain:
@@ -347,11 +364,7 @@ static int ntrip_sourcetable_parse(struct gps_device_t *device)
                          buf);
                 return -3;
             }
-            line = strstr(line, NTRIP_BODY);
-            if (NULL == line) {
-                return  -4;
-            }
-            line += 4;        // point to 1st line of body
+            line = body + 4;        // point to 1st line of body
             len = rlen - (line - buf);
         }
 
@@ -460,29 +473,19 @@ static int ntrip_sourcetable_parse(struct gps_device_t *device)
     return -9;
 }
 
-/* Connect to NTRIP caster
- *
- * Warning: Blocking.  if the host is unresponsive, this will hang forever.
+/* ask the NTRIP caster on connected dsock for its sourcetable
  *
- * Return: fntrip_stream_get_parseile descriptor of connection
+ * Return: 0 on success
  *         negative number on failure
  */
 static int ntrip_stream_req_probe(const struct ntrip_stream_t *stream,
-                                  struct gpsd_errout_t *errout)
+                                  const struct gpsd_errout_t *errout,
+                                  int dsock)
 {
-    int dsock;
     ssize_t r, blen;
     char buf[BUFSIZ];
     char outbuf[BUFSIZ];
 
-    // open blocking
-    dsock = netlib_connectsock(AF_UNSPEC, stream->host, stream->port, "tcp");
-    if (0 > dsock) {
-        GPSD_LOG(LOG_ERROR, errout,
-                 "NTRIP: ntrip_stream_req_probe(%s) connect error %s(%d)\n",
-                 stream->url, netlib_errstr(dsock), dsock);
-        return -1;
-    }
     blen = snprintf(buf, sizeof(buf),
                     "GET / HTTP/1.1\r\n"
                     "Ntrip-Version: Ntrip/2.0\r\n"
@@ -508,11 +511,9 @@ static int ntrip_stream_req_probe(const struct ntrip_stream_t *stream,
                  "NTRIP: stream write error %s(%d) on fd %d "
                  "during probe request %zd\n",
                  strerror(errno), errno, dsock, r);
-        (void)close(dsock);
         return -1;
     }
-    // coverity[leaked_handle] This is an intentional allocation
-    return dsock;
+    return 0;
 }
 
 /* ntrip_auth_encode() - compute the HTTP auth string, if required.
@@ -573,32 +574,19 @@ static int ntrip_auth_encode(struct ntrip_stream_t *stream)
     return ret;
 }
 
-/* netlib_connectsock() open a blockin socket to host.
+/* ask the NTRIP caster on connected dsock for our mountpoint
  *
- * Return: socket to ntrip server on success
+ * Return: 0 on success
  *         less than zero on error
  */
-static socket_t ntrip_stream_get_req(const struct ntrip_stream_t *stream,
-                                     const struct gpsd_errout_t *errout)
+static int ntrip_stream_get_req(const struct ntrip_stream_t *stream,
+                                const struct gpsd_errout_t *errout,
+                                int dsock)
 {
-    int dsock;
     char buf[BUFSIZ];
     char outbuf[BUFSIZ];
     ssize_t cnt, cnt1;
 
-    // open blocking
-    dsock = netlib_connectsock(AF_UNSPEC, stream->host, stream->port, "tcp");
-    if (BAD_SOCKET(dsock)) {
-        GPSD_LOG(LOG_ERROR, errout,
-                 "NTRIP: stream connect error %ss(%d)\n",
-                 netlib_errstr(dsock), dsock);
-        return -1;
-    }
-
-    GPSD_LOG(LOG_SPIN, errout,
-             "NTRIP: netlib_connectsock() returns socket on fd %d\n",
-             dsock);
-
     cnt = snprintf(buf, sizeof(buf),
                    "GET /%s HTTP/1.1\r\n"
                    "Ntrip-Version: Ntrip/2.0\r\n"
@@ -611,12 +599,12 @@ static socket_t ntrip_stream_get_req(const struct ntrip_stream_t *stream,
                    stream->authStr);
     if (1 > cnt) {
         GPSD_LOG(LOG_ERROR, errout,
-                 "NTRIP: netlib_connectsock() snprintf fail<\n");
+                 "NTRIP: ntrip_stream_get_req() snprintf fail<\n");
         return -1;
     }
 
     GPSD_LOG(LOG_IO, errout,
-             "NTRIP: netlib_connectsock() sending >%s<\n",
+             "NTRIP: ntrip_stream_get_req() fd %d sending >%s<\n", dsock,
              gps_visibilize(outbuf, sizeof(outbuf), buf, cnt));
 
     cnt1 = write(dsock, buf, cnt);
@@ -625,10 +613,9 @@ static socket_t ntrip_stream_get_req(const struct ntrip_stream_t *stream,
                  "NTRIP: stream write error %s(%d) on fd %d during "
                  "get request\n",
                  strerror(errno), errno, dsock);
-        (void)close(dsock);
         return -1;
     }
-    return dsock;
+    return 0;
 }
 
 /* lexer_getline() -- get one line, ending in \n or \0, from lexer->inbuffer,
@@ -994,71 +981,185 @@ int ntrip_parse_url(const struct gpsd_errout_t *errout,
     return 0;
 }
 
-/* reopen a nonblocking connection to an NTRIP broadcaster
- * Need to already have the sourcetable from a successful ntrip_open()
+/* parse the mountpoints of an ntrip:// source, "ntrip://" already
+ * stripped off: urls as ntrip_parse_url() takes, in priority order,
+ * separated by commas.  The ones after the first may have their own
+ * "ntrip://".
+ *
+ * Return: the number of mountpoints
+ *         less than zero on failure
+ */
+int ntrip_parse_mounts(const struct gpsd_errout_t *errout,
+                       struct ntrip_mount_t *mounts, int max,
+                       const char *list)
+{
+    char dup[GPS_PATH_MAX];
+    char *url, *next;
+    int n = 0;
+
+    (void)strlcpy(dup, list, sizeof(dup));
+    for (url = dup; NULL != url; url = next) {
+        next = strchr(url, ',');
+        if (NULL != next) {
+            *next++ = '\0';
+        }
+        if (str_starts_with(url, "ntrip://")) {
+            url += 8;
+        }
+        if (max <= n) {
+            GPSD_LOG(LOG_ERROR, errout,
+                     "NTRIP: %s has more than %d mountpoints\n", list, max);
+            return -1;
+        }
+        memset(&mounts[n], 0, sizeof(mounts[n]));
+        if (0 > ntrip_parse_url(errout, &mounts[n].stream, url)) {
+            return -1;
+        }
+        n++;
+    }
+    return n;
+}
+
+/* give up on the mountpoint in use, for the next one.  What the probe
+ * found is kept, so the next time it is not probed again.  The next
+ * one is tried at once, unless that is the first again. */
+static void ntrip_failover(struct gps_device_t *device)
+{
+    struct ntrip_mount_t *mounts = device->ntrip.mounts;
+    int next = (device->ntrip.mount + 1) % device->ntrip.nmounts;
+
+    mounts[device->ntrip.mount].failovers++;
+    mounts[device->ntrip.mount].stream = device->ntrip.stream;
+    GPSD_LOG(LOG_WARN, &device->context->errout,
+             "NTRIP: fail over from %s/%s to %s/%s\n",
+             device->ntrip.stream.host, device->ntrip.stream.mountpoint,
+             mounts[next].stream.host, mounts[next].stream.mountpoint);
+    device->ntrip.mount = next;
+    device->ntrip.stream = mounts[next].stream;
+    device->ntrip.sourcetable_parse = false;
+    if (0 == next) {
+        // all failed, wait as for a reconnect
+        (void)clock_gettime(CLOCK_REALTIME,
+                            &device->ntrip.stream.stream_time);
+    } else {
+        device->ntrip.stream.stream_time.tv_sec = 0;
+    }
+}
+
+/* connect to the NTRIP caster, for the sourcetable probe, or, once the
+ * sourcetable is in, for the stream itself
+ * The request goes out in ntrip_connected(), now if the connect was
+ * blocking, else when the fd becomes writable.
  *
  * Return: socket on success
  *         -1 on error
- *         PLACEHOLDING_FD (-2) on no connect
+ *         PLACEHOLDING_FD (-2) while the name is looked up, or on a
+ *         failed reconnect
  */
-static int ntrip_reconnect(struct gps_device_t *device)
+static socket_t ntrip_connect(struct gps_device_t *device)
 {
-#if defined(SOCK_NONBLOCK)
-    socket_t dsock = -1;
+    socket_t dsock;
     char addrbuf[50];         // INET6_ADDRSTRLEN
 
     GPSD_LOG(LOG_PROG, &device->context->errout,
-             "NTRIP: ntrip_reconnect() %.60s\n",
-             device->gpsdata.dev.path);
-    dsock = netlib_connectsock1(AF_UNSPEC, device->ntrip.stream.host,
-                                device->ntrip.stream.port,
-                                "tcp", 1, false,
-                                addrbuf, sizeof(addrbuf));
-    device->gpsdata.gps_fd = dsock;
-    // nonblocking means we have the fd, but the connection is not
-    // finished yet.  Connection may fail, later.
+             "NTRIP: ntrip_connect(%s) %s\n",
+             device->gpsdata.dev.path,
+             device->ntrip.stream.set ? "stream" : "probe");
+    dsock = netasync_connectsock(device, device->ntrip.stream.host,
+                                 device->ntrip.stream.port,
+                                 addrbuf, sizeof(addrbuf));
+    if (NL_PENDING == dsock) {
+        // netasync_poll() gets us back to NTRIP_CONN_RESOLVING
+        device->gpsdata.gps_fd = PLACEHOLDING_FD;
+        device->ntrip.conn_state = NTRIP_CONN_RESOLVING;
+        return PLACEHOLDING_FD;
+    }
     if (0 > dsock) {
-        /* no way to recover from this, except wait and try again later
-         * cast for 32-bit ints. */
+        // cast for 32-bit ints
         GPSD_LOG(LOG_ERROR, &device->context->errout,
-                 "NTRIP: ntrip_reconnect(%s) IP %s, failed: %s(%ld)\n",
+                 "NTRIP: ntrip_connect(%s) IP %s, failed: %s(%ld)\n",
                  device->gpsdata.dev.path, addrbuf,
                  netlib_errstr(dsock), (long)dsock);
-        // set time for retry
+        device->gpsdata.gps_fd = PLACEHOLDING_FD;
+        if (!device->ntrip.stream.set) {
+            device->ntrip.conn_state = NTRIP_CONN_ERR;
+            return -1;
+        }
+        /* no way to recover from this, except wait and try again later
+         * set time for retry */
         (void)clock_gettime(CLOCK_REALTIME, &device->ntrip.stream.stream_time);
         // leave in connextion closed state for later retry.
         device->ntrip.conn_state = NTRIP_CONN_CLOSED;
+        if (1 < device->ntrip.nmounts) {
+            // or retry with the next mountpoint
+            ntrip_failover(device);
+        }
         return PLACEHOLDING_FD;
     }
-    /* will have to wait for select() to confirm conenction, then send
-     * the ntrip request again.
-     * cast for 32-bit ints */
-    device->ntrip.conn_state = NTRIP_CONN_INPROGRESS;
-    GPSD_LOG(LOG_PROG, &device->context->errout,
-             "NTRIP: ntrip_reconnect(%s) IP %s, fd %ld "
-             "NTRIP_CONN_INPROGRESS \n",
-             device->gpsdata.dev.path, addrbuf, (long)dsock);
-#else  // no SOCK_NONBLOCK
-    GPSD_LOG(LOG_PROG, &device->context->errout,
-             "NTRIP: ntrip_reconnect(%s) no SOCK_NONBLOCK, can't reconnect.\n",
-             device->gpsdata.dev.path);
-    device->gpsdata.gps_fd = -1;
-#endif  // no SOCK_NONBLOCK
-    return (int)device->gpsdata.gps_fd;
+    // set timeouts to give time for caster to reply.
+    // cant use device->lexer.pkt_time and gpsd_clear() reset it
+    (void)clock_gettime(CLOCK_REALTIME, &device->ntrip.stream.stream_time);
+    device->gpsdata.gps_fd = (gps_fd_t)dsock;
+    if (device->connecting) {
+        /* will have to wait for select() to confirm the connection,
+         * then send the request.
+         * cast for 32-bit ints */
+        device->ntrip.conn_state = NTRIP_CONN_INPROGRESS;
+        GPSD_LOG(LOG_PROG, &device->context->errout,
+                 "NTRIP: ntrip_connect(%s) IP %s, fd %ld "
+                 "NTRIP_CONN_INPROGRESS\n",
+                 device->gpsdata.dev.path, addrbuf, (long)dsock);
+        return dsock;
+    }
+    if (0 > ntrip_connected(device)) {
+        (void)close(dsock);
+        device->gpsdata.gps_fd = PLACEHOLDING_FD;
+        return -1;
+    }
+    return dsock;
 }
 
-/* open a connection to a NTRIP broadcaster
- * orig contains full url
+/* the connection to the caster is up, send the probe, or the GET
  *
- * Return: 0 on success, or the new fd
+ * Return: 0 on success
  *         less than zero on failure
  */
-socket_t ntrip_open(struct gps_device_t *device, char *orig)
+int ntrip_connected(struct gps_device_t *device)
+{
+    // (int) to shut up cadacy about USE_QT.
+    int dsock = (int)device->gpsdata.gps_fd;
+
+    if (!device->ntrip.stream.set) {
+        if (0 > ntrip_stream_req_probe(&device->ntrip.stream,
+                                       &device->context->errout, dsock)) {
+            device->ntrip.conn_state = NTRIP_CONN_ERR;
+            return -1;
+        }
+        device->ntrip.conn_state = NTRIP_CONN_SENT_PROBE;
+        return 0;
+    }
+    if (0 > ntrip_stream_get_req(&device->ntrip.stream,
+                                 &device->context->errout, dsock)) {
+        device->ntrip.conn_state = NTRIP_CONN_ERR;
+        return -1;
+    }
+    device->ntrip.conn_state = NTRIP_CONN_SENT_GET;
+    if (0 < device->ntrip.nmounts) {
+        struct ntrip_mount_t *mount =
+            &device->ntrip.mounts[device->ntrip.mount];
+
+        // the data is fresh until NTRIP_STALE after this
+        (void)clock_gettime(CLOCK_MONOTONIC, &mount->sent);
+        mount->last.tv_sec = 0;
+        mount->last.tv_nsec = 0;
+    }
+    return 0;
+}
+
+// one step of ntrip_open()
+static socket_t ntrip_open1(struct gps_device_t *device, char *orig)
 {
     socket_t ret = -1;
-    char buf[BUFSIZ];
-    char outbuf[BUFSIZ];
-    ssize_t blen;
 
     // cast for 32-bit ints
     GPSD_LOG(LOG_PROG, &device->context->errout,
@@ -1078,32 +1179,23 @@ socket_t ntrip_open(struct gps_device_t *device, char *orig)
         device->ntrip.stream.set = false;
         device->gpsdata.gps_fd = PLACEHOLDING_FD;
 
-        ret = ntrip_parse_url(&device->context->errout, &device->ntrip.stream,
-                              orig);
+        ret = ntrip_parse_mounts(&device->context->errout,
+                                 device->ntrip.mounts, NTRIP_MOUNTS, orig);
         if (0 > ret) {
             // failed to parse url
             device->gpsdata.gps_fd = PLACEHOLDING_FD;
             device->ntrip.conn_state = NTRIP_CONN_ERR;
             return -1;
         }
+        device->ntrip.nmounts = (int)ret;
+        device->ntrip.mount = 0;
+        device->ntrip.stream = device->ntrip.mounts[0].stream;
 
-        ret = ntrip_stream_req_probe(&device->ntrip.stream,
-                                     &device->context->errout);
+        ret = ntrip_connect(device);
         // cast for 32-bit intptr_t
         GPSD_LOG(LOG_PROG, &device->context->errout,
-                 "NTRIP: ntrip_stream_req_probe(%s) ret %ld\n",
+                 "NTRIP: ntrip_connect(%s) ret %ld\n",
                  device->ntrip.stream.url, (long)ret);
-        if (-1 == ret) {
-            device->gpsdata.gps_fd = PLACEHOLDING_FD;
-            device->ntrip.conn_state = NTRIP_CONN_ERR;
-            return -1;
-        }
-        // set timeouts to give time for caster to reply.
-        // cant use device->lexer.pkt_time and gpsd_clear() reset it
-        (void)clock_gettime(CLOCK_REALTIME, &device->ntrip.stream.stream_time);
-
-        device->gpsdata.gps_fd = (gps_fd_t)ret;
-        device->ntrip.conn_state = NTRIP_CONN_SENT_PROBE;
         return ret;
     case NTRIP_CONN_SENT_PROBE:     // state = 1
         ret = ntrip_sourcetable_parse(device);
@@ -1141,29 +1233,12 @@ socket_t ntrip_open(struct gps_device_t *device, char *orig)
             device->ntrip.conn_state = NTRIP_CONN_ERR;
             return -1;
         }
-        ret = ntrip_stream_get_req(&device->ntrip.stream,
-                                   &device->context->errout);
-        if (-1 == ret) {
-            device->gpsdata.gps_fd = PLACEHOLDING_FD;
-            device->ntrip.conn_state = NTRIP_CONN_ERR;
-            return -1;
-        }
-        device->gpsdata.gps_fd = ret;
-        if (NULL != device->gpsdata.update_fd) {
-            device->gpsdata.update_fd(device->gpsdata.gps_fd, true);
-        }
-        device->ntrip.conn_state = NTRIP_CONN_SENT_GET;
-        break;
-    case NTRIP_CONN_SENT_GET:          // state = 2
-        ret = ntrip_stream_get_parse(device);
-        if (-1 == ret) {
-            (void)close(device->gpsdata.gps_fd);
-            device->gpsdata.gps_fd = PLACEHOLDING_FD;
-            device->ntrip.conn_state = NTRIP_CONN_ERR;
-            return -1;
+        // the same name, so no new lookup
+        ret = ntrip_connect(device);
+        if (0 <= ret &&
+            NULL != device->gpsdata.update_fd) {
+            device->gpsdata.update_fd(ret, true);
         }
-        device->ntrip.conn_state = NTRIP_CONN_ESTABLISHED;
-        device->ntrip.works = true;   // we know, this worked.
         break;
     case NTRIP_CONN_CLOSED:           // state = 5
         if (6 > llabs((time(NULL) - device->ntrip.stream.stream_time.tv_sec))) {
@@ -1171,53 +1246,28 @@ socket_t ntrip_open(struct gps_device_t *device, char *orig)
             ret = PLACEHOLDING_FD;
             break;
         }
-        ret = ntrip_reconnect(device);
+        FALLTHROUGH
+    case NTRIP_CONN_RESOLVING:        // state = 7
+        ret = ntrip_connect(device);
         if (0 <= ret &&
             NULL != device->gpsdata.update_fd) {
             device->gpsdata.update_fd(ret, true);
         }
         break;
-    case NTRIP_CONN_INPROGRESS:      // state = 6
-        // Need to send GET within about 40 seconds or caster tiems out.
-        // FIXME: partially duplicates  ntrip_stream_get_req()
-        // try a write, it will fail if connection still in process, or failed.
-        blen = snprintf(buf, sizeof(buf),
-                        "GET /%s HTTP/1.1\r\n"
-                        "Ntrip-Version: Ntrip/2.0\r\n"
-                        "User-Agent: NTRIP gpsd/%s\r\n"
-                        "Host: %s\r\n"
-                        "Accept: rtk/rtcm, dgps/rtcm\r\n"
-                        "%s"
-                        "Connection: close\r\n"
-                        "\r\n", device->ntrip.stream.mountpoint, VERSION,
-                        device->ntrip.stream.host,
-                        device->ntrip.stream.authStr);
-
-        if (1 > blen) {
-            GPSD_LOG(LOG_ERROR, &device->context->errout,
-                     "NTRIP: ntrip_open() snprintf fail<\n");
-            return -1;
-        }
-
-        GPSD_LOG(LOG_IO, &device->context->errout,
-                 "NTRIP: ntrip_open() sending >%s<\n",
-                  gps_visibilize(outbuf, sizeof(outbuf), buf, blen));
-
-        if (blen != write(device->gpsdata.gps_fd, buf, blen)) {
-            // cast for 32-bit intptr_t
-            GPSD_LOG(LOG_ERROR, &device->context->errout,
-                     "NTRIP: stream write error %s(%d) on fd %ld during "
-                     "get request\n",
-                     strerror(errno), errno, (long)device->gpsdata.gps_fd);
+    case NTRIP_CONN_SENT_GET:          // state = 2
+        ret = ntrip_stream_get_parse(device);
+        if (-1 == ret) {
+            (void)close(device->gpsdata.gps_fd);
+            device->gpsdata.gps_fd = PLACEHOLDING_FD;
             device->ntrip.conn_state = NTRIP_CONN_ERR;
-            // leave FD so deactivate_device() can remove from the
-            // select() loop
-        } else {
-            GPSD_LOG(LOG_ERROR, &device->context->errout,
-                     "NTRIP: stream write success get request\n");
-            device->ntrip.conn_state = NTRIP_CONN_SENT_GET;
+            return -1;
         }
-        ret = (int)device->gpsdata.gps_fd;
+        device->ntrip.conn_state = NTRIP_CONN_ESTABLISHED;
+        device->ntrip.works = true;   // we know, this worked.
+        break;
+    case NTRIP_CONN_INPROGRESS:      // state = 6
+        // netasync_connected() sends the request once the fd is writable
+        ret = (socket_t)device->gpsdata.gps_fd;
         break;
     case NTRIP_CONN_ESTABLISHED:     // state = 3
         FALLTHROUGH
@@ -1227,6 +1277,84 @@ socket_t ntrip_open(struct gps_device_t *device, char *orig)
     return ret;
 }
 
+/* open a connection to a NTRIP broadcaster
+ * orig contains full url, or several, see ntrip_parse_mounts()
+ *
+ * Return: 0 on success, or the new fd
+ *         less than zero on failure
+ */
+socket_t ntrip_open(struct gps_device_t *device, char *orig)
+{
+    bool failed = NTRIP_CONN_ERR == device->ntrip.conn_state;
+    socket_t ret = ntrip_open1(device, orig);
+
+    if (!failed &&
+        NTRIP_CONN_ERR == device->ntrip.conn_state &&
+        1 < device->ntrip.nmounts) {
+        // the reconnect tries the next mountpoint
+        ntrip_failover(device);
+    }
+    return ret;
+}
+
+// count a packet of the mountpoint in use, for ntrip_stale() and ?DEVICES
+void ntrip_packet(struct gps_device_t *device)
+{
+    struct ntrip_mount_t *mount;
+
+    if (0 == device->ntrip.nmounts) {
+        return;
+    }
+    mount = &device->ntrip.mounts[device->ntrip.mount];
+    if (0 == mount->last.tv_sec &&
+        0 == mount->last.tv_nsec) {
+        timespec_t delta;
+
+        TS_SUB(&delta, &device->stats.pkt_mono, &mount->sent);
+        mount->latency = TSTONS(&delta);
+    }
+    mount->last = device->stats.pkt_mono;
+    mount->packets++;
+    mount->bytes += device->lexer.outbuflen;
+}
+
+/* fail over to the next mountpoint when the one in use sent nothing for
+ * NTRIP_STALE seconds.  Called when the device had nothing to read.
+ *
+ * Return: true if it failed over
+ */
+bool ntrip_stale(struct gps_device_t *device)
+{
+    const struct ntrip_mount_t *mount;
+    timespec_t now, delta;
+
+    if (2 > device->ntrip.nmounts ||
+        NTRIP_CONN_ESTABLISHED != device->ntrip.conn_state) {
+        return false;
+    }
+    mount = &device->ntrip.mounts[device->ntrip.mount];
+    (void)clock_gettime(CLOCK_MONOTONIC, &now);
+    if (0 == mount->last.tv_sec &&
+        0 == mount->last.tv_nsec) {
+        TS_SUB(&delta, &now, &mount->sent);
+    } else {
+        TS_SUB(&delta, &now, &mount->last);
+    }
+    if (NTRIP_STALE > delta.tv_sec) {
+        return false;
+    }
+    GPSD_LOG(LOG_WARN, &device->context->errout,
+             "NTRIP: %s/%s sent nothing for %lld seconds\n",
+             device->ntrip.stream.host, device->ntrip.stream.mountpoint,
+             (long long)delta.tv_sec);
+    if (NULL != device->gpsdata.update_fd) {
+        device->gpsdata.update_fd(device->gpsdata.gps_fd, false);
+    }
+    ntrip_close(device);        // fails over
+    (void)ntrip_open(device, "");
+    return true;
+}
+
 // may be time to ship a GGA report to the NTRIP caster
 void ntrip_report(struct gps_context_t *context,
                   struct gps_device_t *gps,
@@ -1284,9 +1412,13 @@ void ntrip_report(struct gps_context_t *context,
     }
 }
 
-// Close an ntrip connection
+/* Close an ntrip connection.  With several mountpoints, the next one
+ * is tried when it is opened again. */
 void ntrip_close(struct gps_device_t *session)
 {
+    bool failover = 1 < session->ntrip.nmounts &&
+                    NTRIP_CONN_CLOSED != session->ntrip.conn_state;
+
     if (0 > session->gpsdata.gps_fd) {
         // UNALLOCATED_FD (-1) or PLACEHOLDING_FD (-2). Nothing to do.
         // cast for 32-bit intptr_t
@@ -1294,6 +1426,9 @@ void ntrip_close(struct gps_device_t *session)
                  "NTRIP: ntrip_close(%s), close(%ld) bad fd\n",
                  session->gpsdata.dev.path, (long)session->gpsdata.gps_fd);
         session->gpsdata.gps_fd = PLACEHOLDING_FD;
+        if (failover) {
+            ntrip_failover(session);
+        }
         return;
     }
 
@@ -1315,5 +1450,8 @@ void ntrip_close(struct gps_device_t *session)
 
     session->gpsdata.gps_fd = PLACEHOLDING_FD;
     session->ntrip.conn_state = NTRIP_CONN_CLOSED;
+    if (failover) {
+        ntrip_failover(session);
+    }
 }
 // vim: set expandtab shiftwidth=4
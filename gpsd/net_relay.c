@@ -0,0 +1,103 @@
+/* net_relay.c -- read another gpsd as a relay:// feed
+ *
+ * A relay:// feed is a gpsd that watches another one with
+ * "binary":true and "relay":true.  That one sends the TPV, SKY, ATT,
+ * IMU and RAW of all its devices as numbered binary frames, and the
+ * rest as JSON.  On each reconnect the watch asks to resume after the
+ * last frame got, so frames sent while the feed was down are not lost,
+ * as long as the other gpsd still has them.
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+#include "../include/gpsd_config.h"   // must be before all includes
+
+#include <errno.h>                    // for errno
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "../include/gpsd.h"
+#include "../include/strfuncs.h"
+
+/* open a relay:// feed, relayserver is host[:port]
+ * Return: socket on success
+ *         PLACEHOLDING_FD while the name is looked up
+ *         less than zero on failure
+ */
+socket_t relay_open(struct gps_device_t *device, const char *relayserver)
+{
+    char server[GPS_PATH_MAX], *host, *port, *remote;
+    char addrbuf[50];         // INET6_ADDRSTRLEN
+    socket_t dsock;
+
+    device->servicetype = SERVICE_RELAY;
+    // a copy, relayserver may be the device path, opened again later
+    (void)strlcpy(server, relayserver, sizeof(server));
+    if (-1 == parse_uri_dest(server, &host, &port, &remote)) {
+        GPSD_LOG(LOG_ERROR, &device->context->errout,
+                 "RELAY: malformed URI %s\n", device->gpsdata.dev.path);
+        return UNALLOCATED_FD;
+    }
+    if (NULL == port) {
+        port = DEFAULT_GPSD_PORT;
+    }
+
+    dsock = netasync_connectsock(device, host, port,
+                                 addrbuf, sizeof(addrbuf));
+    if (NL_PENDING == dsock) {
+        // netasync_poll() has the daemon open us again
+        device->gpsdata.gps_fd = PLACEHOLDING_FD;
+        return PLACEHOLDING_FD;
+    }
+    if (0 > dsock) {
+        // cast for 32-bit ints
+        GPSD_LOG(LOG_ERROR, &device->context->errout,
+                 "RELAY: can't connect to %s, netlib error %s(%ld).\n",
+                 device->gpsdata.dev.path, netlib_errstr(dsock),
+                 (long)dsock);
+        return dsock;
+    }
+    // cast for 32-bit ints
+    GPSD_LOG(LOG_PROG, &device->context->errout,
+             "RELAY: connection to %s IP %s %s, fd %ld\n",
+             device->gpsdata.dev.path, addrbuf,
+             device->connecting ? "in progress" : "established",
+             (long)dsock);
+    device->gpsdata.gps_fd = (gps_fd_t)dsock;
+    if (!device->connecting &&
+        0 > relay_connected(device)) {
+        return -1;
+    }
+    return (socket_t)device->gpsdata.gps_fd;
+}
+
+/* the connection to the other gpsd is up, watch it, from after the
+ * last frame got, if any
+ * Return: 0 on success
+ *         less than zero on failure
+ */
+int relay_connected(struct gps_device_t *device)
+{
+    char buf[BUFSIZ];
+    ssize_t blen;
+
+    blen = snprintf(buf, sizeof(buf),
+                    "?WATCH={\"enable\":true,\"json\":true,"
+                    "\"binary\":true,\"relay\":true,\"resume\":%lu};\r\n",
+                    device->relay.seq);
+    if (1 > blen ||
+        write(device->gpsdata.gps_fd, buf, blen) != blen) {
+        GPSD_LOG(LOG_ERROR, &device->context->errout,
+                 "RELAY: watch of %s failed: %s(%d)\n",
+                 device->gpsdata.dev.path, strerror(errno), errno);
+        return -1;
+    }
+    GPSD_LOG(LOG_PROG, &device->context->errout,
+             "RELAY: watching %s, resume after frame %lu\n",
+             device->gpsdata.dev.path, device->relay.seq);
+    return 0;
+}
+
+// vim: set expandtab shiftwidth=4
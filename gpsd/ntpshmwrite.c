@@ -22,30 +22,12 @@
 #include "../include/compiler.h"
 #include "../include/timespec.h"
 
-#define LEAP_NOWARNING  0x0     // normal, no leap second warning
-
-// put a received fix time into shared memory for NTP
+/* put a received fix time into shared memory for NTP
+ * leap_notify must already be limited to June and December,
+ * see leap_filter() in timehint.c */
 void ntp_write(volatile struct shmTime *shmseg,
                struct timedelta_t *td, int precision, int leap_notify)
 {
-    struct tm tm;
-
-    /*
-     * insist that leap seconds only happen in june and december
-     * GPS emits leap pending for 3 months prior to insertion
-     * NTP expects leap pending for only 1 month prior to insertion
-     * Per http://bugs.ntp.org/1090
-     *
-     * ITU-R TF.460-6, Section 2.1, says laep seconds can be primarily
-     * in Jun/Dec but may be in March or September
-     */
-    (void)gmtime_r(&(td->real.tv_sec), &tm);
-    if (5 != tm.tm_mon &&
-        11 != tm.tm_mon ) {
-        // Not june, not December, no way
-        leap_notify = LEAP_NOWARNING;
-    }
-
     /* we use the shmTime mode 1 protocol
      *
      * ntpd does this:
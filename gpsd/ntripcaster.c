@@ -0,0 +1,355 @@
+/*
+ * ntripcaster.c - an NTRIP 1.0 and 2.0 caster for the daemon
+ *
+ * With -c the daemon answers NTRIP rovers.  GET / returns a sourcetable
+ * with one mountpoint per device that has sent RTCM3, GET /mountpoint
+ * streams the raw RTCM3 frames of that device.  A frame goes to each
+ * rover straight from the lexer output buffer, one writev() per rover,
+ * wrapped in a chunk for NTRIP 2.0 rovers.  A rover that cannot keep up
+ * gets a small backlog, then loses whole frames, then is dropped by the
+ * daemon when it makes no progress for CASTER_TIMEOUT seconds.
+ *
+ * The sockets, and the timeouts, are handled in gpsd.c, like the -M
+ * listener.  No authentication is done.
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+#include "../include/gpsd_config.h"  // must be before all includes
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>                  // for uintptr_t
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>                 // for strncasecmp()
+#include <sys/types.h>
+#include <sys/uio.h>                 // for writev()
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/gpsd.h"
+#include "../include/strfuncs.h"
+
+#define CASTER_SERVER   "Server: NTRIP gpsd/" VERSION "\r\n"
+#define CASTER_V2       "Ntrip-Version: Ntrip/2.0\r\n"
+
+/* the mountpoint name of a device, its path without /dev/, and anything
+ * not safe in a URL path turned into _ */
+void caster_mountpoint(const struct gps_device_t *device, char *mount,
+                       size_t mountlen)
+{
+    const char *sp = device->gpsdata.dev.path;
+    size_t n = 0;
+
+    if (0 == strncmp(sp, "/dev/", 5)) {
+        sp += 5;
+    }
+    for (; '\0' != *sp && mountlen > n + 1; sp++) {
+        if (('a' <= *sp && 'z' >= *sp) ||
+            ('A' <= *sp && 'Z' >= *sp) ||
+            ('0' <= *sp && '9' >= *sp) ||
+            '-' == *sp ||
+            '.' == *sp) {
+            mount[n++] = *sp;
+        } else {
+            mount[n++] = '_';
+        }
+    }
+    mount[n] = '\0';
+}
+
+// the device of a mountpoint, NULL if none has sent RTCM3
+static const struct gps_device_t *caster_device(
+    const struct gps_device_t *devices, int ndevices, const char *mount)
+{
+    char name[GPS_PATH_MAX];
+    int i;
+
+    for (i = 0; i < ndevices; i++) {
+        if ('\0' == devices[i].gpsdata.dev.path[0] ||
+            0 == devices[i].stats.packets[RTCM3_PACKET]) {
+            continue;
+        }
+        caster_mountpoint(&devices[i], name, sizeof(name));
+        if (0 == strcmp(name, mount)) {
+            return &devices[i];
+        }
+    }
+    return NULL;
+}
+
+// the sourcetable body, one STR line per device that has sent RTCM3
+static void caster_sourcetable(const struct gps_device_t *devices,
+                               int ndevices, char *body, size_t bodylen)
+{
+    int i;
+
+    body[0] = '\0';
+    for (i = 0; i < ndevices; i++) {
+        const struct gps_device_t *dp = &devices[i];
+        char mount[GPS_PATH_MAX];
+        double lat = 0.0, lon = 0.0;
+
+        if ('\0' == dp->gpsdata.dev.path[0] ||
+            0 == dp->stats.packets[RTCM3_PACKET]) {
+            continue;
+        }
+        caster_mountpoint(dp, mount, sizeof(mount));
+        if (MODE_2D <= dp->gpsdata.fix.mode &&
+            0 != isfinite(dp->gpsdata.fix.latitude) &&
+            0 != isfinite(dp->gpsdata.fix.longitude)) {
+            lat = dp->gpsdata.fix.latitude;
+            lon = dp->gpsdata.fix.longitude;
+        }
+        /* STR;mountpoint;identifier;format;format-details;carrier;
+         * nav-system;network;country;latitude;longitude;nmea;solution;
+         * generator;compr-encryp;authentication;fee;bitrate;misc */
+        str_appendf(body, bodylen,
+                    "STR;%s;%s;RTCM 3;;0;GNSS;gpsd;;%.2f;%.2f;0;0;"
+                    "gpsd %s;none;N;N;0;\r\n",
+                    mount, dp->gpsdata.dev.path, lat, lon, VERSION);
+    }
+    str_appendf(body, bodylen, "ENDSOURCETABLE\r\n");
+}
+
+/* write iov to a rover, behind its backlog if it has one, queue what
+ * does not go now.  If the backlog has no room the whole write is lost.
+ *
+ * Return: true = OK
+ *         false: the connection failed
+ */
+static bool caster_writev(struct caster_rover_t *rover,
+                          const struct iovec *iov, int iovcnt)
+{
+    size_t total = 0, done;
+    ssize_t status = 0;
+    int i;
+
+    for (i = 0; i < iovcnt; i++) {
+        total += iov[i].iov_len;
+    }
+    if (0 == rover->len) {
+        status = writev(rover->fd, iov, iovcnt);
+        if (0 > status) {
+            if (EAGAIN != errno &&
+                EWOULDBLOCK != errno &&
+                EINTR != errno) {
+                return false;
+            }
+            status = 0;
+        }
+        if (0 < status) {
+            rover->since = time(NULL);
+        }
+        if ((size_t)status == total) {
+            return true;
+        }
+    }
+    if (sizeof(rover->buf) - rover->len < total - (size_t)status) {
+        rover->dropped++;
+        return true;
+    }
+    // queue the part not written
+    for (done = 0, i = 0; i < iovcnt; i++) {
+        size_t skip = 0;
+
+        if ((size_t)status >= done + iov[i].iov_len) {
+            done += iov[i].iov_len;
+            continue;
+        }
+        if ((size_t)status > done) {
+            skip = (size_t)status - done;
+        }
+        (void)memcpy(rover->buf + rover->len,
+                     (const char *)iov[i].iov_base + skip,
+                     iov[i].iov_len - skip);
+        rover->len += iov[i].iov_len - skip;
+        done += iov[i].iov_len;
+    }
+    return true;
+}
+
+// write a string to a rover
+static bool caster_write(struct caster_rover_t *rover, const char *str)
+{
+    struct iovec iov;
+
+    iov.iov_base = (void *)(uintptr_t)str;     // writev() does not write it
+    iov.iov_len = strlen(str);
+    return caster_writev(rover, &iov, 1);
+}
+
+/* read from a rover.  Answer its request once all in, discard what it
+ * sends after that, NMEA GGA from rovers that want a nearby base.
+ *
+ * Return: true = OK
+ *         false: close the connection
+ */
+bool caster_read(struct caster_rover_t *rover,
+                 const struct gps_device_t *devices, int ndevices,
+                 const struct gpsd_errout_t *errout)
+{
+    static char reply[4096];
+    char method[8], path[GPS_PATH_MAX];
+    const struct gps_device_t *device = NULL;
+    const char *line;
+    char discard[512];
+    bool v2 = false;
+    ssize_t rd;
+
+    if (rover->streaming ||
+        rover->closing) {
+        rd = read(rover->fd, discard, sizeof(discard));
+        if (0 < rd) {
+            GPSD_LOG(LOG_CLIENT, errout, "<= caster(%ld): %zd bytes\n",
+                     (long)rover->fd, rd);
+            return true;
+        }
+        return 0 > rd && (EAGAIN == errno || EINTR == errno);
+    }
+
+    rd = read(rover->fd, rover->buf + rover->len,
+              sizeof(rover->buf) - 1 - rover->len);
+    if (0 >= rd) {
+        return 0 > rd && (EAGAIN == errno || EINTR == errno);
+    }
+    rover->len += rd;
+    rover->buf[rover->len] = '\0';
+    if (NULL == strstr(rover->buf, "\r\n\r\n") &&
+        NULL == strstr(rover->buf, "\n\n")) {
+        // wait for the end of the headers
+        return sizeof(rover->buf) - 1 > rover->len;
+    }
+    GPSD_LOG(LOG_CLIENT, errout, "<= caster(%ld): %.*s\n",
+             (long)rover->fd, (int)strcspn(rover->buf, "\r\n"), rover->buf);
+
+    // the headers we care about
+    for (line = strchr(rover->buf, '\n'); NULL != line;
+         line = strchr(line, '\n')) {
+        line++;
+        if (0 == strncasecmp(line, "Ntrip-Version:", 14) &&
+            NULL != strstr(line, "Ntrip/2.")) {
+            v2 = true;
+        }
+    }
+    rover->chunked = v2;
+    rover->closing = true;
+    rover->len = 0;
+
+    method[0] = path[0] = '\0';
+    if (2 != sscanf(rover->buf, "%7s %127s", method, path) ||
+        0 != strcmp(method, "GET") ||
+        '/' != path[0]) {
+        return caster_write(rover, v2 ?
+                            "HTTP/1.1 400 Bad Request\r\n" CASTER_V2
+                            CASTER_SERVER "Connection: close\r\n\r\n" :
+                            "HTTP/1.0 400 Bad Request\r\n"
+                            CASTER_SERVER "\r\n") &&
+               0 < rover->len;
+    }
+    if ('\0' != path[1]) {
+        device = caster_device(devices, ndevices, path + 1);
+        if (NULL == device &&
+            v2) {
+            GPSD_LOG(LOG_WARN, errout,
+                     "caster(%ld): no mountpoint %s\n",
+                     (long)rover->fd, path + 1);
+            return caster_write(rover, "HTTP/1.1 404 Not Found\r\n"
+                                CASTER_V2 CASTER_SERVER
+                                "Connection: close\r\n\r\n") &&
+                   0 < rover->len;
+        }
+    }
+
+    if (NULL == device) {
+        // NTRIP 1.0 rovers get the sourcetable for an unknown mountpoint
+        static char body[sizeof(reply) - 256];
+
+        caster_sourcetable(devices, ndevices, body, sizeof(body));
+        if (v2) {
+            (void)snprintf(reply, sizeof(reply),
+                           "HTTP/1.1 200 OK\r\n" CASTER_V2 CASTER_SERVER
+                           "Content-Type: gnss/sourcetable\r\n"
+                           "Content-Length: %zu\r\n"
+                           "Connection: close\r\n\r\n%s",
+                           strlen(body), body);
+        } else {
+            (void)snprintf(reply, sizeof(reply),
+                           "SOURCETABLE 200 OK\r\n" CASTER_SERVER
+                           "Content-Type: text/plain\r\n"
+                           "Content-Length: %zu\r\n\r\n%s",
+                           strlen(body), body);
+        }
+        return caster_write(rover, reply) &&
+               0 < rover->len;
+    }
+
+    (void)strlcpy(rover->mount, path + 1, sizeof(rover->mount));
+    rover->closing = false;
+    rover->streaming = true;
+    GPSD_LOG(LOG_INF, errout, "caster(%ld): NTRIP %d rover on %s\n",
+             (long)rover->fd, v2 ? 2 : 1, device->gpsdata.dev.path);
+    return caster_write(rover, v2 ?
+                        "HTTP/1.1 200 OK\r\n" CASTER_V2 CASTER_SERVER
+                        "Content-Type: gnss/data\r\n"
+                        "Cache-Control: no-store, no-cache, max-age=0\r\n"
+                        "Transfer-Encoding: chunked\r\n"
+                        "Connection: close\r\n\r\n" :
+                        "ICY 200 OK\r\n" CASTER_SERVER "\r\n");
+}
+
+/* send one RTCM3 frame to a streaming rover, as is
+ *
+ * Return: true = OK
+ *         false: close the connection
+ */
+bool caster_frame(struct caster_rover_t *rover, const unsigned char *frame,
+                  size_t len)
+{
+    static char crlf[] = "\r\n";
+    char head[16];
+    struct iovec iov[3];
+
+    rover->frames++;
+    if (!rover->chunked) {
+        iov[0].iov_base = (void *)(uintptr_t)frame;
+        iov[0].iov_len = len;
+        return caster_writev(rover, iov, 1);
+    }
+    // one chunk per frame
+    (void)snprintf(head, sizeof(head), "%zx\r\n", len);
+    iov[0].iov_base = head;
+    iov[0].iov_len = strlen(head);
+    iov[1].iov_base = (void *)(uintptr_t)frame;
+    iov[1].iov_len = len;
+    iov[2].iov_base = crlf;
+    iov[2].iov_len = 2;
+    return caster_writev(rover, iov, 3);
+}
+
+/* write what can go of a rover's backlog, when its socket is writable
+ *
+ * Return: true = OK
+ *         false: close the connection, it failed or it is done
+ */
+bool caster_flush(struct caster_rover_t *rover)
+{
+    ssize_t status;
+
+    if (0 < rover->len) {
+        status = write(rover->fd, rover->buf, rover->len);
+        if (0 > status) {
+            return EAGAIN == errno || EWOULDBLOCK == errno || EINTR == errno;
+        }
+        if (0 < status) {
+            rover->since = time(NULL);
+            rover->len -= (size_t)status;
+            (void)memmove(rover->buf, rover->buf + status, rover->len);
+        }
+    }
+    return 0 < rover->len || !rover->closing;
+}
+
+// vim: set expandtab shiftwidth=4
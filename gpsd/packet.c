@@ -38,14 +38,17 @@ PERMISSIONS
 #include <stdio.h>
 #include <stdlib.h>             // for strtol()
 #include <string.h>
+#include <sys/socket.h>         // for recvmsg()
 #include <sys/time.h>           // for struct timeval
 #include <sys/types.h>
 #include <unistd.h>
 
 #include "../include/bits.h"
 #include "../include/driver_greis.h"
+#include "../include/flightrec.h"
 #include "../include/gpsd.h"
 #include "../include/crc24q.h"
+#include "../include/gps_binary.h"     // needs gpsd.h
 #include "../include/strfuncs.h"
 
 /*
@@ -444,6 +447,7 @@ static void character_discard(struct gps_lexer_t *lexer)
 {
     memmove(lexer->inbuffer, lexer->inbuffer + 1, (size_t)-- lexer->inbuflen);
     lexer->inbufptr = lexer->inbuffer;
+    lexer->discard_counter++;
     if (lexer->errout.debug >= LOG_RAW1) {
         char scratchbuf[MAX_PACKET_LENGTH*4+1];
 
@@ -567,6 +571,9 @@ static bool nextstate(struct gps_lexer_t *lexer, unsigned char c)
         case 0xD3:      // latin1 capital O acute
             lexer->state = RTCM3_LEADER_1;
             break;
+        case GPSB_SYNC1:   // latin1 small c cedilla, 0xe7
+            lexer->state = GPSB_LEADER_1;
+            break;
         case 0xf1:      // latin1 small letter N with tilde
             // got 1st, of 2, bytes of leader
             lexer->state = ALLY_LEADER_1;
@@ -2150,6 +2157,54 @@ static bool nextstate(struct gps_lexer_t *lexer, unsigned char c)
         }
         lexer->state = JSON_LEADER;
         break;
+    // start GPSB, the frames of a relay:// feed
+    case GPSB_LEADER_1:
+        if (GPSB_SYNC2 == c) {
+            lexer->state = GPSB_LEADER_2;
+        } else {
+            return character_pushback(lexer, GROUND_STATE);
+        }
+        break;
+    case GPSB_LEADER_2:
+        // no class 0, and room for classes to come
+        if (0 == c ||
+            0x20 <= c) {
+            return character_pushback(lexer, GROUND_STATE);
+        }
+        lexer->state = GPSB_CLASS_ID;
+        break;
+    case GPSB_CLASS_ID:
+        if (GPSB_VERSION != c) {
+            return character_pushback(lexer, GROUND_STATE);
+        }
+        lexer->state = GPSB_VERSION_ID;
+        break;
+    case GPSB_VERSION_ID:
+        lexer->length = (size_t)c;
+        lexer->state = GPSB_LENGTH_1;
+        break;
+    case GPSB_LENGTH_1:
+        lexer->length += (size_t)c << 8;
+        lexer->state = GPSB_LENGTH_2;
+        break;
+    case GPSB_LENGTH_2:
+        lexer->length += (size_t)c << 16;
+        lexer->state = GPSB_LENGTH_3;
+        break;
+    case GPSB_LENGTH_3:
+        lexer->length += (size_t)c << 24;
+        if (GPSB_MAX - GPSB_HEADER < lexer->length) {
+            // bad length
+            return character_pushback(lexer, GROUND_STATE);
+        }
+        lexer->state = 0 == lexer->length ? GPSB_RECOGNIZED : GPSB_PAYLOAD;
+        break;
+    case GPSB_PAYLOAD:
+        if (0 == --lexer->length) {
+            lexer->state = GPSB_RECOGNIZED;
+        }
+        break;
+    // end GPSB
 #ifdef STASH_ENABLE
     case STASH_RECOGNIZED:
         if ('$' != c) {
@@ -2552,6 +2607,10 @@ void packet_parse(struct gps_lexer_t *lexer)
 #endif  // GREIS_ENABLE
 
         case GROUND_STATE:
+            if (GROUND_STATE != oldstate) {
+                // was part way into a packet
+                lexer->resync_counter++;
+            }
             character_discard(lexer);
             break;
 
@@ -2615,6 +2674,13 @@ void packet_parse(struct gps_lexer_t *lexer)
             acc_dis = ACCEPT;
             break;
 
+        case GPSB_RECOGNIZED:
+            // no checksum, TCP has one, the items are checked on use
+            packet_type = GPSB_PACKET;
+            lexer->state = GROUND_STATE;
+            acc_dis = ACCEPT;
+            break;
+
 #ifdef NAVCOM_ENABLE
         case NAVCOM_RECOGNIZED:
             // By the time we got here we know checksum is OK
@@ -3306,12 +3372,22 @@ static ssize_t packet_get1_chunked(struct gps_device_t *session)
             GPSD_LOG(LOG_WARN, &lexer->errout,
                      "PACKET: packet_get1_chunked(fd %d) errno: %s(%d)\n",
                      fd, strerror(errno), errno);
+            FLIGHTREC(session, FLIGHTREC_READERR, errno, NULL, 0);
             return -1;   // unrecoverable error.
         }
     }  // else
 
     // Got some data.
+    if (0 < recvd) {
+        FLIGHTREC(session, FLIGHTREC_READ, recvd,
+                  lexer->inbuffer + lexer->inbuflen, (size_t)recvd);
+        CAPTURE(session, lexer->inbuffer + lexer->inbuflen, (size_t)recvd);
+    }
     lexer->inbuflen += recvd;
+    session->stats.bytes_read += recvd;
+    if (0 < recvd) {
+        (void)clock_gettime(CLOCK_MONOTONIC, &session->stats.read_mono);
+    }
 
     GPSD_LOG(LOG_IO, &lexer->errout,
              "PACKET: packet_get1_chunked(fd %d) recvd %zd inbuflen %zd "
@@ -3566,6 +3642,161 @@ static ssize_t packet_get1_chunked(struct gps_device_t *session)
     return (ssize_t)lexer->outbuflen;
 }
 
+/* take what the kernel said about the datagrams, or data, just
+ * received: the receive time, from SO_TIMESTAMPNS, or SO_TIMESTAMP, and
+ * the count of datagrams it dropped, from SO_RXQ_OVFL.
+ */
+static void read_control(struct gps_device_t *session, struct msghdr *msg)
+{
+    struct cmsghdr *cmsg;
+
+    for (cmsg = CMSG_FIRSTHDR(msg);
+         NULL != cmsg;
+         cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (SOL_SOCKET != cmsg->cmsg_level) {
+            continue;
+        }
+#if defined(SCM_TIMESTAMPNS)
+        if (SCM_TIMESTAMPNS == cmsg->cmsg_type) {
+            memcpy(&session->lexer.rx_time, CMSG_DATA(cmsg),
+                   sizeof(session->lexer.rx_time));
+        }
+#elif defined(SCM_TIMESTAMP)
+        if (SCM_TIMESTAMP == cmsg->cmsg_type) {
+            struct timeval tv;
+
+            memcpy(&tv, CMSG_DATA(cmsg), sizeof(tv));
+            TVTOTS(&session->lexer.rx_time, &tv);
+        }
+#endif  // SCM_TIMESTAMP
+#ifdef SO_RXQ_OVFL
+        if (SO_RXQ_OVFL == cmsg->cmsg_type) {
+            uint32_t ovfl;
+
+            // the count since the socket opened, unsigned math wraps
+            memcpy(&ovfl, CMSG_DATA(cmsg), sizeof(ovfl));
+            if (ovfl != session->rxq_ovfl) {
+                GPSD_LOG(LOG_WARN, &session->lexer.errout,
+                         "PACKET: %s, kernel dropped %u datagrams\n",
+                         session->gpsdata.dev.path,
+                         (unsigned)(ovfl - session->rxq_ovfl));
+                session->stats.udp_dropped += ovfl - session->rxq_ovfl;
+                session->rxq_ovfl = ovfl;
+            }
+        }
+#endif  // SO_RXQ_OVFL
+    }
+}
+
+/* read() that also returns the kernel receive time of the data.
+ * lexer.rx_time is left alone if nothing was read, or the kernel sent
+ * no timestamp.
+ */
+static ssize_t read_stamped(struct gps_device_t *session, unsigned char *buf,
+                            size_t len)
+{
+    struct msghdr msg;
+    struct iovec iov;
+    union {
+        struct cmsghdr align;   // CMSG_SPACE() is not a constant everywhere
+        char buf[64];
+    } control;
+    ssize_t recvd;
+
+    iov.iov_base = buf;
+    iov.iov_len = len;
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.buf;
+    msg.msg_controllen = sizeof(control.buf);
+
+    recvd = recvmsg(session->gpsdata.gps_fd, &msg, 0);
+    if (0 < recvd) {
+        read_control(session, &msg);
+    }
+    return recvd;
+}
+
+#ifdef HAVE_RECVMMSG
+/* read up to UDP_BATCH datagrams, with one recvmmsg(), into the slots
+ * of session->udp, then as many as fit, whole and in order, into buf.
+ * Those that do not fit wait there, and the next call takes them before
+ * it reads more.  A datagram is never split across reads.  One longer
+ * than UDP_SLOT, more than a read() took, is cut short, and counted.
+ * lexer.rx_time is that of the last one read.
+ *
+ * Return: bytes put in buf, or -1 with errno set
+ */
+static ssize_t read_datagrams(struct gps_device_t *session,
+                              unsigned char *buf, size_t len)
+{
+    struct udp_batch_t *udp = session->udp;
+    unsigned char *end = buf;
+
+    if (udp->next >= udp->count) {
+        struct mmsghdr msgs[UDP_BATCH];
+        struct iovec iov[UDP_BATCH];
+        union {
+            struct cmsghdr align;
+            char buf[64];
+        } control[UDP_BATCH];
+        unsigned i;
+        int got;
+
+        memset(msgs, 0, sizeof(msgs));
+        for (i = 0; i < UDP_BATCH; i++) {
+            iov[i].iov_base = udp->slot[i];
+            iov[i].iov_len = sizeof(udp->slot[i]);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+            msgs[i].msg_hdr.msg_control = control[i].buf;
+            msgs[i].msg_hdr.msg_controllen = sizeof(control[i].buf);
+        }
+        udp->next = 0;
+        udp->count = 0;
+        got = recvmmsg(session->gpsdata.gps_fd, msgs, UDP_BATCH, 0, NULL);
+        if (0 >= got) {
+            return got;
+        }
+        for (i = 0; i < (unsigned)got; i++) {
+            if (0 != (MSG_TRUNC & msgs[i].msg_hdr.msg_flags)) {
+                GPSD_LOG(LOG_WARN, &session->lexer.errout,
+                         "PACKET: %s, datagram cut to %u bytes\n",
+                         session->gpsdata.dev.path, msgs[i].msg_len);
+                session->stats.udp_truncated++;
+            }
+            read_control(session, &msgs[i].msg_hdr);
+            udp->len[i] = msgs[i].msg_len;
+        }
+        udp->count = (unsigned)got;
+        GPSD_LOG(LOG_IO, &session->lexer.errout,
+                 "PACKET: %s, %d datagrams\n",
+                 session->gpsdata.dev.path, got);
+    }
+    while (udp->next < udp->count) {
+        size_t dlen = udp->len[udp->next];
+
+        if ((size_t)(buf + len - end) < dlen) {
+            if (end > buf) {
+                // the rest next time
+                break;
+            }
+            // the input buffer was not empty, the most a read() took
+            GPSD_LOG(LOG_WARN, &session->lexer.errout,
+                     "PACKET: %s, datagram cut to %zu bytes\n",
+                     session->gpsdata.dev.path, len);
+            session->stats.udp_truncated++;
+            dlen = len;
+        }
+        memcpy(end, udp->slot[udp->next], dlen);
+        end += dlen;
+        udp->next++;
+    }
+    return end - buf;
+}
+#endif  // HAVE_RECVMMSG
+
 /* grab a packet;
  * return: greater than zero: length
  *         > 0  == got a packet.
@@ -3581,6 +3812,7 @@ ssize_t packet_get1(struct gps_device_t *session)
     char scratchbuf[MAX_PACKET_LENGTH * 4 + 1];
     int fd = session->gpsdata.gps_fd;
     struct gps_lexer_t *lexer = &session->lexer;
+    bool batched = false;
 
     if (true == lexer->chunked) {
         // De-chunking too complicate to do unline below.
@@ -3595,7 +3827,25 @@ ssize_t packet_get1(struct gps_device_t *session)
     }
     /* O_NONBLOCK set, so this should not block.
      * Best not to block on an unresponsive GNSS receiver */
-    recvd = read(fd, lexer->inbuffer + lexer->inbuflen, wanted);
+    if (SOURCE_UDP == session->sourcetype &&
+        0 < packet_buffered_input(lexer)) {
+        /* the lexer takes all the input it has before saying it has
+         * no packet, so finish the last batch before reading more */
+        recvd = 0;
+        batched = true;
+#ifdef HAVE_RECVMMSG
+    } else if (SOURCE_UDP == session->sourcetype &&
+               NULL != session->udp) {
+        recvd = read_datagrams(session, lexer->inbuffer + lexer->inbuflen,
+                               wanted);
+#endif  // HAVE_RECVMMSG
+    } else if (session->rx_stamped) {
+        // tcp:// or udp://, keep the kernel receive time of this read
+        recvd = read_stamped(session, lexer->inbuffer + lexer->inbuflen,
+                             wanted);
+    } else {
+        recvd = read(fd, lexer->inbuffer + lexer->inbuflen, wanted);
+    }
 
     if (-1 >= recvd) {
         if (EAGAIN == errno ||
@@ -3607,15 +3857,21 @@ ssize_t packet_get1(struct gps_device_t *session)
             GPSD_LOG(LOG_WARN, &lexer->errout,
                      "PACKET: packet_get1(fd %d) errno: %s(%d)\n",
                      fd, strerror(errno), errno);
+            FLIGHTREC(session, FLIGHTREC_READERR, errno, NULL, 0);
             return -1;
         }
-    } else {
+    } else if (!batched) {
+        FLIGHTREC(session, FLIGHTREC_READ, recvd,
+                  lexer->inbuffer + lexer->inbuflen, (size_t)recvd);
+        CAPTURE(session, lexer->inbuffer + lexer->inbuflen, (size_t)recvd);
         GPSD_LOG(LOG_RAW1, &lexer->errout,
                  "PACKET: Read %lld chars to buffer[%zd] (total %lld): %s\n",
                  recvd, lexer->inbuflen, lexer->inbuflen + recvd,
                  gpsd_packetdump(scratchbuf, sizeof(scratchbuf),
                                  lexer->inbufptr, (size_t) recvd));
         lexer->inbuflen += recvd;
+        session->stats.bytes_read += recvd;
+        (void)clock_gettime(CLOCK_MONOTONIC, &session->stats.read_mono);
     }
     GPSD_LOG(LOG_SPIN, &lexer->errout,
              "PACKET: packet_get1(fd %d) recvd %lld %s(%d)\n",
@@ -0,0 +1,181 @@
+/*
+ * relay.c - the numbered binary frames for relay:// feeds, for the daemon
+ *
+ * A watcher with "relay":true, another gpsd reading this one as a
+ * relay:// feed, gets the TPV, SKY, ATT, IMU and RAW reports of all the
+ * devices as binary frames, each with the next number.  The frames of a
+ * report are rendered once, into the backlog, for all those watchers.
+ * Frames that came from a relay:// feed here are copied as they are,
+ * only renumbered.
+ *
+ * The backlog keeps the last RELAY_BACKLOG bytes of frames, so a feed
+ * that reconnects gets the ones after the last one it got, if they are
+ * still there.  Nothing is kept until the first relay watcher.
+ *
+ * Only the main thread relays.
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+#include "../include/gpsd_config.h"  // must be before all includes
+
+#include <string.h>
+
+#include "../include/gpsd.h"
+#include "../include/gps_binary.h"     // needs gpsd.h
+
+// the shortest frames are a little over 32 bytes
+#define RELAY_FRAMES    (RELAY_BACKLOG / 32)
+// room for a frame, and its number
+#define RELAY_ROOM      (GPSB_MAX - 10)
+
+static char backlog[RELAY_BACKLOG];
+static size_t head;                     // where the next frame goes
+// the frames in the backlog, oldest first
+static struct relay_frame_t {
+    size_t off;
+    size_t len;
+} frames[RELAY_FRAMES];
+static unsigned first, count;
+static unsigned long first_seq = 1;     // the number of frames[first]
+static bool started;
+
+// forget the oldest frame
+static void relay_pop(void)
+{
+    first = (first + 1) % RELAY_FRAMES;
+    count--;
+    first_seq++;
+}
+
+/* room for the next frame, GPSB_MAX bytes.  Frames the room overlaps
+ * are forgotten.  The frames past head are from the last time round,
+ * so they are always the oldest. */
+static char *relay_room(void)
+{
+    if (RELAY_BACKLOG - head < GPSB_MAX) {
+        // start again at the front, forget the ones past head
+        while (0 < count &&
+               frames[first].off >= head) {
+            relay_pop();
+        }
+        head = 0;
+    }
+    while (0 < count &&
+           frames[first].off >= head &&
+           frames[first].off < head + GPSB_MAX) {
+        relay_pop();
+    }
+    if (RELAY_FRAMES == count) {
+        relay_pop();
+    }
+    return backlog + head;
+}
+
+// number the frame of len bytes just put in the room, and keep it
+static void relay_push(size_t len)
+{
+    struct relay_frame_t *frame = &frames[(first + count) % RELAY_FRAMES];
+
+    len = gpsb_seq_put(backlog + head, len, GPSB_MAX, first_seq + count);
+    if (0 == len) {
+        // no room for the number, can not happen
+        return;
+    }
+    frame->off = head;
+    frame->len = len;
+    count++;
+    head += len;
+}
+
+// keep the frames from now on, a relay watcher is here
+void relay_start(void)
+{
+    started = true;
+}
+
+/* render the frames of a report of a device, what binary_report()
+ * would send, but of all the classes, leap is the leap seconds, negative
+ * if unknown.
+ * Return: the number of the frame before them */
+unsigned long relay_report(struct gps_device_t *device, gps_mask_t changed,
+                           int leap)
+{
+    struct gps_data_t *datap = &device->gpsdata;
+    unsigned long before = first_seq + count - 1;
+    int i;
+
+    if (!started) {
+        return before;
+    }
+    if (0 != (changed & REPORT_IS)) {
+        relay_push(gpsb_tpv_dump(datap, leap, relay_room(), RELAY_ROOM));
+        if (0 != (changed & ATTITUDE_SET)) {
+            relay_push(gpsb_att_dump(datap, &datap->attitude, GPSB_ATT,
+                                     relay_room(), RELAY_ROOM));
+        }
+    }
+    if (0 != (changed & (DOP_SET | SATELLITE_SET))) {
+        relay_push(gpsb_sky_dump(datap, relay_room(), RELAY_ROOM));
+    }
+    if (0 != (changed & RAW_IS)) {
+        relay_push(gpsb_raw_dump(datap, relay_room(), RELAY_ROOM));
+    }
+    if (0 != (changed & IMU_SET)) {
+        for (i = 0; i < (int)ROWS(datap->imu); i++) {
+            if ('\0' == datap->imu[i].msg[0]) {
+                break;
+            }
+            relay_push(gpsb_att_dump(datap, &datap->imu[i], GPSB_IMU,
+                                     relay_room(), RELAY_ROOM));
+        }
+    }
+    return before;
+}
+
+/* keep the frame a relay:// feed device just read, renumbered
+ * Return: the number of the frame before it */
+unsigned long relay_forward(const struct gps_device_t *device)
+{
+    unsigned long before = first_seq + count - 1;
+    size_t len = device->lexer.outbuflen;
+
+    if (!started ||
+        GPSB_MAX < len) {
+        return before;
+    }
+    (void)memcpy(relay_room(), device->lexer.outbuffer, len);
+    relay_push(len);
+    return before;
+}
+
+/* The frames after *seq that follow each other in the backlog, so
+ * one write() sends them.  *seq is set to the last of them, *len to
+ * their length.  Frames no longer kept are skipped.
+ * Return: the first of them, NULL if there are none */
+const char *relay_replay(unsigned long *seq, size_t *len)
+{
+    const struct relay_frame_t *frame, *last;
+    unsigned long i, n;
+
+    if (0 == count ||
+        *seq >= first_seq + count - 1) {
+        return NULL;
+    }
+    i = *seq < first_seq ? 0 : *seq + 1 - first_seq;
+    frame = last = &frames[(first + i) % RELAY_FRAMES];
+    for (n = i + 1; n < count; n++) {
+        const struct relay_frame_t *next = &frames[(first + n) % RELAY_FRAMES];
+
+        if (next->off != last->off + last->len) {
+            break;
+        }
+        last = next;
+    }
+    *seq = first_seq + n - 1;
+    *len = last->off + last->len - frame->off;
+    return backlog + frame->off;
+}
+
+// vim: set expandtab shiftwidth=4
@@ -0,0 +1,260 @@
+/*
+ * rtcm_relay.c - relay RTCM corrections from sources to the devices
+ * that take them
+ *
+ * A frame is copied once, out of the lexer of the source, into a
+ * reference counted frame, and each sink queues a pointer to it.  A sink
+ * whose writer is gpsd_write() gets its queue written with writev(), as
+ * far as the device takes it without blocking, and the rest when its fd
+ * is writable.  A full queue loses whole frames, counted.  Sinks with
+ * their own writer, that rewrap the frames, are written directly.
+ *
+ * What gpsd_serial_write() queued for a sink goes first, only a frame
+ * already part way out is finished ahead of it.
+ *
+ * The source is never a sink of its own frames.  A sink can take only
+ * some message types, see rtcm_relay_filter().
+ *
+ * Only the main thread relays.
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+#include "../include/gpsd_config.h"  // must be before all includes
+
+#include <errno.h>
+#include <stdlib.h>                  // for strtoul()
+#include <string.h>
+#include <sys/types.h>
+#include <sys/uio.h>                 // for writev()
+
+#include "../include/flightrec.h"
+#include "../include/gpsd.h"
+
+#define RTCM_FRAME_MAX  (RTCM2_MAX > RTCM3_MAX ? RTCM2_MAX : RTCM3_MAX)
+// enough that a frame is there for every sink with a full queue
+#define RTCM_FRAMES     (MAX_DEVICES * RTCM_QUEUE + 1)
+
+struct rtcm_frame_t {
+    int refs;                           // sinks with it queued, 0 if free
+    size_t len;
+    unsigned char data[RTCM_FRAME_MAX];
+};
+
+static struct rtcm_frame_t frames[RTCM_FRAMES];
+
+// a free frame, with a copy of the lexer output of source
+static struct rtcm_frame_t *frame_get(const struct gps_device_t *source)
+{
+    struct rtcm_frame_t *frame;
+
+    for (frame = frames; frame < frames + RTCM_FRAMES; frame++) {
+        if (0 == frame->refs) {
+            frame->len = source->lexer.outbuflen;
+            (void)memcpy(frame->data, source->lexer.outbuffer, frame->len);
+            return frame;
+        }
+    }
+    return NULL;
+}
+
+// take the oldest frame off the queue of a sink
+static void sink_pop(struct rtcm_sink_t *sink)
+{
+    sink->queue[sink->first]->refs--;
+    sink->queue[sink->first] = NULL;
+    sink->first = (sink->first + 1) % RTCM_QUEUE;
+    sink->count--;
+    sink->offset = 0;
+}
+
+/* write what the device takes of its queue, without blocking.  Called
+ * when a frame is queued, and when the fd of the device is writable. */
+void rtcm_relay_drain(struct gps_device_t *session)
+{
+    struct rtcm_sink_t *sink = &session->rtcm_sink;
+    struct iovec iov[RTCM_QUEUE];
+    ssize_t status;
+    int i, n = sink->count;
+
+    if (0 >= n) {
+        return;
+    }
+    if (0 < session->outq.len) {
+        if (0 == sink->offset) {
+            // gpsd_serial_drain() calls back when its queue is out
+            return;
+        }
+        // finish the frame part way out, and no more
+        n = 1;
+    }
+    for (i = 0; i < n; i++) {
+        struct rtcm_frame_t *frame =
+            sink->queue[(sink->first + i) % RTCM_QUEUE];
+
+        iov[i].iov_base = frame->data;
+        iov[i].iov_len = frame->len;
+    }
+    iov[0].iov_base = (char *)iov[0].iov_base + sink->offset;
+    iov[0].iov_len -= sink->offset;
+
+    status = writev(session->gpsdata.gps_fd, iov, n);
+    if (0 > status) {
+        if (EAGAIN == errno ||
+            EWOULDBLOCK == errno ||
+            EINTR == errno) {
+            return;
+        }
+        GPSD_LOG(LOG_ERROR, &session->context->errout,
+                 "RTCM relay to %s failed: %s(%d), %d frames lost\n",
+                 session->gpsdata.dev.path, strerror(errno), errno,
+                 sink->count);
+        session->stats.rtcm_dropped += sink->count;
+        rtcm_relay_flush(session);
+        return;
+    }
+    // retire the frames that are all written
+    for (i = 0; i < n && (size_t)status >= iov[i].iov_len; i++) {
+        struct rtcm_frame_t *frame = sink->queue[sink->first];
+
+        status -= iov[i].iov_len;
+        FLIGHTREC(session, FLIGHTREC_WRITE, frame->len, frame->data,
+                  frame->len);
+        GPSD_LOG(LOG_IO, &session->context->errout,
+                 "<= DGPS/NTRIP: %zd bytes of RTCM relayed to %s\n",
+                 frame->len, session->gpsdata.dev.path);
+        session->stats.rtcm_relayed++;
+        sink_pop(sink);
+    }
+    if (0 < sink->count) {
+        sink->offset += (size_t)status;
+    }
+}
+
+// drop the queue of a device, when it is closed
+void rtcm_relay_flush(struct gps_device_t *session)
+{
+    while (0 < session->rtcm_sink.count) {
+        sink_pop(&session->rtcm_sink);
+    }
+}
+
+/* set the message types a device takes, from a comma separated list
+ * of RTCM 2 or RTCM 3 message numbers.  An empty list takes all.
+ *
+ * Return: 0 = OK
+ *         -1: bad list, the filter is unchanged
+ */
+int rtcm_relay_filter(struct rtcm_sink_t *sink, const char *list)
+{
+    unsigned short types[RTCM_FILTER];
+    const char *sp = list;
+    int ntypes = 0;
+
+    while ('\0' != *sp) {
+        char *end;
+        unsigned long type = strtoul(sp, &end, 10);
+
+        if (end == sp ||
+            0 == type ||
+            4095 < type ||
+            RTCM_FILTER <= ntypes ||
+            (',' != *end && '\0' != *end)) {
+            return -1;
+        }
+        types[ntypes++] = (unsigned short)type;
+        sp = ',' == *end ? end + 1 : end;
+    }
+    (void)memcpy(sink->types, types, sizeof(types[0]) * ntypes);
+    sink->ntypes = ntypes;
+    return 0;
+}
+
+// does a sink take a message type?
+static bool sink_takes(const struct rtcm_sink_t *sink, unsigned type)
+{
+    int i;
+
+    if (0 == sink->ntypes) {
+        return true;
+    }
+    for (i = 0; i < sink->ntypes; i++) {
+        if (type == sink->types[i]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* relay the RTCM frame source just read to all the other devices that
+ * take it.  The frame is in the lexer output buffer of source. */
+void rtcm_relay(struct gps_device_t *source, struct gps_device_t *devices,
+                int ndevices)
+{
+    struct rtcm_frame_t *frame = NULL;
+    unsigned type;
+    int i;
+
+    if (RTCM3_PACKET == source->lexer.type) {
+        type = source->gpsdata.rtcm3.type;
+    } else {
+        type = source->gpsdata.rtcm2.type;
+    }
+
+    for (i = 0; i < ndevices; i++) {
+        struct gps_device_t *dp = &devices[i];
+        struct rtcm_sink_t *sink = &dp->rtcm_sink;
+
+        if (dp == source ||
+            '\0' == dp->gpsdata.dev.path[0] ||
+            dp->opening ||
+            0 > dp->gpsdata.gps_fd ||
+            dp->connecting ||
+            dp->context->readonly ||
+            NULL == dp->device_type ||
+            NULL == dp->device_type->rtcm_writer) {
+            continue;
+        }
+        if (!sink_takes(sink, type)) {
+            dp->stats.rtcm_filtered++;
+            continue;
+        }
+        if (gpsd_write != dp->device_type->rtcm_writer) {
+            // the driver rewraps the frame, let it write it
+            if (0 > dp->device_type->rtcm_writer(dp,
+                        (const char *)source->lexer.outbuffer,
+                        source->lexer.outbuflen)) {
+                GPSD_LOG(LOG_ERROR, &dp->context->errout,
+                         "<= DGPS/NTRIP: Write to RTCM sink failed, "
+                         " type %s\n",
+                         dp->device_type->type_name);
+                dp->stats.rtcm_dropped++;
+            } else {
+                dp->stats.rtcm_relayed++;
+            }
+            continue;
+        }
+        if (RTCM_QUEUE <= sink->count) {
+            GPSD_LOG(LOG_PROG, &dp->context->errout,
+                     "RTCM relay to %s behind, type %u dropped\n",
+                     dp->gpsdata.dev.path, type);
+            dp->stats.rtcm_dropped++;
+            continue;
+        }
+        if (NULL == frame &&
+            NULL == (frame = frame_get(source))) {
+            // can not happen, there are enough frames for full queues
+            dp->stats.rtcm_dropped++;
+            continue;
+        }
+        frame->refs++;
+        sink->queue[(sink->first + sink->count) % RTCM_QUEUE] = frame;
+        sink->count++;
+        if (1 == sink->count) {
+            rtcm_relay_drain(dp);
+        }
+    }
+}
+
+// vim: set expandtab shiftwidth=4
@@ -18,6 +18,7 @@
 #include <string.h>
 #include <sys/ioctl.h>
 #include <sys/param.h>               // defines BSD
+#include <sys/select.h>              // for pselect() per POSIX
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -707,6 +708,9 @@ void gpsd_set_speed(struct gps_device_t *session,
         parity != session->gpsdata.dev.parity ||
         stopbits != session->gpsdata.dev.stopbits) {
 
+        // what was written at the old speed goes out at the old speed
+        (void)gpsd_serial_flush(session);
+
         /*
          *  "Don't mess with this conditional! Speed zero is supposed to mean
          *   to leave the port speed at whatever it currently is."
@@ -1098,12 +1102,165 @@ int gpsd_serial_open(struct gps_device_t *session)
     return session->gpsdata.gps_fd;
 }
 
+// log a write to the device, ok is false if it failed
+static void serial_write_log(struct gps_device_t *session, const char *buf,
+                             size_t len, bool ok)
+{
+    char scratchbuf[MAX_PACKET_LENGTH*2+1];
+
+    GPSD_LOG(LOG_IO, &session->context->errout,
+             "SER: => GPS: %s%s\n",
+             gpsd_packetdump(scratchbuf, sizeof(scratchbuf),
+                             (const unsigned char *)buf,
+                             len), ok ? "" : " FAILED");
+}
+
+/* wait, up to timeout, until the device takes more
+ * Return: true if it is writable */
+static bool serial_writable(const struct gps_device_t *session,
+                            long timeout_ns)
+{
+    fd_set wfds;
+    struct timespec ts_timeout;
+
+    FD_ZERO(&wfds);
+    FD_SET(session->gpsdata.gps_fd, &wfds);
+    ts_timeout.tv_sec = timeout_ns / NS_IN_SEC;
+    ts_timeout.tv_nsec = timeout_ns % NS_IN_SEC;
+    return 0 < pselect(session->gpsdata.gps_fd + 1, NULL, &wfds, NULL,
+                       &ts_timeout, NULL);
+}
+
+/* Write what the device takes of its output queue, without blocking.
+ * Called when the fd of the device is writable.  Waits while an RTCM
+ * relay frame is part way out, so the two do not interleave.
+ * Return: bytes still queued
+ */
+size_t gpsd_serial_drain(struct gps_device_t *session)
+{
+    struct serial_outq_t *outq = &session->outq;
+    ssize_t status;
+
+    if (0 == outq->len ||
+        0 < session->rtcm_sink.offset) {
+        return outq->len;
+    }
+    status = write(session->gpsdata.gps_fd, outq->buf + outq->first,
+                   outq->len);
+    if (0 > status) {
+        if (EAGAIN == errno ||
+            EWOULDBLOCK == errno ||
+            EINTR == errno) {
+            return outq->len;
+        }
+        // cast for 32-bit intptr_t
+        GPSD_LOG(LOG_ERROR, &session->context->errout,
+                 "SER: gpsd_serial_drain(%ld) write() failed: %s(%d), "
+                 "%zu bytes lost\n",
+                 (long)session->gpsdata.gps_fd, strerror(errno), errno,
+                 outq->len);
+        serial_write_log(session, outq->buf + outq->first, outq->len,
+                         false);
+        outq->first = outq->len = 0;
+        return 0;
+    }
+    serial_write_log(session, outq->buf + outq->first, (size_t)status,
+                     true);
+    session->stats.out_written += (unsigned long)status;
+    outq->first += (size_t)status;
+    outq->len -= (size_t)status;
+    if (0 == outq->len) {
+        outq->first = 0;
+        if (0 < session->rtcm_sink.count) {
+            // the RTCM relay waited for this
+            rtcm_relay_drain(session);
+        }
+    }
+    return outq->len;
+}
+
+/* Write all of the output queue of a device, and wait until the device
+ * sent it, for gpsd_set_speed() and gpsd_close().  Gives up when the
+ * device takes nothing for a second.
+ * Return: bytes still queued, lost if not 0
+ */
+size_t gpsd_serial_flush(struct gps_device_t *session)
+{
+    struct serial_outq_t *outq = &session->outq;
+
+    if (0 > session->gpsdata.gps_fd) {
+        outq->first = outq->len = 0;
+        return 0;
+    }
+    if (0 < outq->len) {
+        session->stats.out_waits++;
+        // an RTCM relay frame part way out goes first
+        while (0 < session->rtcm_sink.offset &&
+               serial_writable(session, NS_IN_SEC)) {
+            rtcm_relay_drain(session);
+        }
+        while (0 < gpsd_serial_drain(session) &&
+               0 == session->rtcm_sink.offset &&
+               serial_writable(session, NS_IN_SEC)) {
+            continue;
+        }
+        if (0 < outq->len) {
+            size_t lost = outq->len;
+
+            // cast for 32-bit intptr_t
+            GPSD_LOG(LOG_ERROR, &session->context->errout,
+                     "SER: gpsd_serial_flush(%ld) device stuck, "
+                     "%zu bytes lost\n",
+                     (long)session->gpsdata.gps_fd, lost);
+            outq->first = outq->len = 0;
+            return lost;
+        }
+    }
+    if (0 < gpsd_serial_isatty(session) &&
+        0 != tcdrain(session->gpsdata.gps_fd)) {
+        // cast for 32-bit intptr_t
+        GPSD_LOG(LOG_ERROR, &session->context->errout,
+                 "SER: gpsd_serial_flush(%ld) tcdrain() failed: %s(%d)\n",
+                 (long)session->gpsdata.gps_fd, strerror(errno), errno);
+    }
+    return 0;
+}
+
+/* bytes written to the device it has not sent yet, in its output queue
+ * and, for a tty, in the kernel */
+size_t gpsd_serial_pending(const struct gps_device_t *session)
+{
+    size_t pending = session->outq.len;
+#ifdef TIOCOUTQ
+    int kernel = 0;
+
+    if (0 <= session->gpsdata.gps_fd &&
+        0 < gpsd_serial_isatty(session) &&
+        0 == ioctl(session->gpsdata.gps_fd, TIOCOUTQ, &kernel) &&
+        0 < kernel) {
+        pending += (size_t)kernel;
+    }
+#endif  // TIOCOUTQ
+    return pending;
+}
+
+/* write to the device.
+ *
+ * With context->async_write, as the daemon does, what the device does
+ * not take without blocking is queued, after anything already queued,
+ * and written by gpsd_serial_drain() when the fd is writable.  Only when
+ * the queue is full does this wait for the device, in
+ * gpsd_serial_flush().  Otherwise this blocks until the device sent it.
+ *
+ * Return: len, the bytes written or queued
+ *         less than len on failure
+ */
 ssize_t gpsd_serial_write(struct gps_device_t * session,
                           const char *buf, const size_t len)
 {
+    struct serial_outq_t *outq;
     ssize_t status;
-    bool ok;
-    char scratchbuf[MAX_PACKET_LENGTH*2+1];
+    size_t done;
 
     if (NULL == session ||
         NULL == session->context ||
@@ -1112,25 +1269,99 @@ ssize_t gpsd_serial_write(struct gps_device_t * session,
         return 0;
     }
 
-    status = write(session->gpsdata.gps_fd, buf, len);
-    ok = (status == (ssize_t) len);
-    if (0 < gpsd_serial_isatty(session)) {
-        // do we really need to block on tcdrain?
-        if (0 != tcdrain(session->gpsdata.gps_fd)) {
-            // cast for 32-bit intptr_t
-            GPSD_LOG(LOG_ERROR, &session->context->errout,
-                     "SER: gpsd_serial_write(%ld) tcdrain() failed: %s(%d)\n",
-                     (long)session->gpsdata.gps_fd,
-                     strerror(errno), errno);
+    if (!session->context->async_write ||
+        session->opening) {
+        // a bring-up worker may block
+        status = write(session->gpsdata.gps_fd, buf, len);
+        if (0 < gpsd_serial_isatty(session)) {
+            // do we really need to block on tcdrain?
+            if (0 != tcdrain(session->gpsdata.gps_fd)) {
+                // cast for 32-bit intptr_t
+                GPSD_LOG(LOG_ERROR, &session->context->errout,
+                         "SER: gpsd_serial_write(%ld) tcdrain() failed: "
+                         "%s(%d)\n",
+                         (long)session->gpsdata.gps_fd,
+                         strerror(errno), errno);
+            }
+        }
+        serial_write_log(session, buf, len, status == (ssize_t)len);
+        if (0 < status) {
+            session->stats.out_written += (unsigned long)status;
         }
+        return status;
     }
 
-    GPSD_LOG(LOG_IO, &session->context->errout,
-             "SER: => GPS: %s%s\n",
-             gpsd_packetdump(scratchbuf, sizeof(scratchbuf),
-                             (const unsigned char *)buf,
-                             len), ok ? "" : " FAILED");
-    return status;
+    outq = &session->outq;
+    done = 0;
+    if (0 == outq->len &&
+        0 == session->rtcm_sink.offset) {
+        // nothing ahead of it, write what the device takes now
+        status = write(session->gpsdata.gps_fd, buf, len);
+        if (0 > status) {
+            if (EAGAIN != errno &&
+                EWOULDBLOCK != errno &&
+                EINTR != errno) {
+                // cast for 32-bit intptr_t
+                GPSD_LOG(LOG_ERROR, &session->context->errout,
+                         "SER: gpsd_serial_write(%ld) write() failed: "
+                         "%s(%d)\n",
+                         (long)session->gpsdata.gps_fd,
+                         strerror(errno), errno);
+                serial_write_log(session, buf, len, false);
+                return status;
+            }
+        } else {
+            done = (size_t)status;
+            session->stats.out_written += (unsigned long)status;
+            serial_write_log(session, buf, done, true);
+        }
+    }
+    if (done == len) {
+        return (ssize_t)len;
+    }
+
+    if (SERIAL_OUTQ - outq->len < len - done) {
+        // no room, wait for the device to take the queue
+        (void)gpsd_serial_flush(session);
+    }
+    if (SERIAL_OUTQ - outq->len < len - done) {
+        // longer than the queue, the rest waits for the device
+        session->stats.out_waits++;
+        while (done < len &&
+               serial_writable(session, NS_IN_SEC)) {
+            status = write(session->gpsdata.gps_fd, buf + done, len - done);
+            if (0 < status) {
+                serial_write_log(session, buf + done, (size_t)status, true);
+                session->stats.out_written += (unsigned long)status;
+                done += (size_t)status;
+            } else if (0 > status &&
+                       EAGAIN != errno &&
+                       EWOULDBLOCK != errno &&
+                       EINTR != errno) {
+                break;
+            }
+        }
+        if (done < len) {
+            serial_write_log(session, buf + done, len - done, false);
+        }
+        return (ssize_t)done;
+    }
+    if (SERIAL_OUTQ - outq->first - outq->len < len - done) {
+        // room, but not at the end
+        (void)memmove(outq->buf, outq->buf + outq->first, outq->len);
+        outq->first = 0;
+    }
+    (void)memcpy(outq->buf + outq->first + outq->len, buf + done,
+                 len - done);
+    outq->len += len - done;
+    session->stats.out_queued += (unsigned long)(len - done);
+    if (outq->len > session->stats.out_max) {
+        session->stats.out_max = outq->len;
+    }
+    GPSD_LOG(LOG_RAW, &session->context->errout,
+             "SER: gpsd_serial_write(%ld) queued %zu, %zu waiting\n",
+             (long)session->gpsdata.gps_fd, len - done, outq->len);
+    return (ssize_t)len;
 }
 
 /*
@@ -1274,6 +1505,11 @@ void gpsd_close(struct gps_device_t *session)
         return;
     }
 
+    if (!session->context->readonly) {
+        // Be sure all output is sent.
+        (void)gpsd_serial_flush(session);
+    }
+
     if (0 < gpsd_serial_isatty(session)) {
 #ifdef TIOCNXCL
         // This command resets the exclusive use of a terminal.
@@ -1285,16 +1521,6 @@ void gpsd_close(struct gps_device_t *session)
                          strerror(errno), errno);
         }
 #endif  // TIOCNXCL
-        if (!session->context->readonly) {
-            // Be sure all output is sent.
-            if (0 != tcdrain(session->gpsdata.gps_fd)) {
-                // cast for 32-bit intptr_t
-                GPSD_LOG(LOG_ERROR, &session->context->errout,
-                         "SER: gpsd_close(%ld) tcdrain() failed: %s(%d)\n",
-                         (long)session->gpsdata.gps_fd,
-                         strerror(errno), errno);
-            }
-        }
 
         // Save current terminal parameters.  Why?
         if (0 != tcgetattr(session->gpsdata.gps_fd, &session->ttyset_old)) {
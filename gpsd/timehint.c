@@ -11,6 +11,7 @@
 #include "../include/gpsd_config.h"   // must be before all includes
 
 #include <errno.h>
+#include <fcntl.h>
 #include <libgen.h>
 #include <math.h>
 #include <stdbool.h>
@@ -18,6 +19,7 @@
 #include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>          // for sockaddr_un
 #include <sys/wait.h>
 #include <time.h>        // for timespec
 #include <unistd.h>
@@ -227,6 +229,40 @@ void ntpshm_session_init(struct gps_device_t *session)
     session->shm_pps_unit = -1;
 }
 
+/* insist that leap seconds only happen in june and december
+ * GPS emits leap pending for 3 months prior to insertion
+ * NTP expects leap pending for only 1 month prior to insertion
+ * Per http://bugs.ntp.org/1090
+ *
+ * ITU-R TF.460-6, Section 2.1, says leap seconds can be primarily
+ * in Jun/Dec but may be in March or September
+ *
+ * The month only changes at midnight, so gmtime_r() once per day.
+ */
+static int leap_filter(struct leap_cache_t *cache, time_t real,
+                       int leap_notify)
+{
+    time_t day;
+
+    if (LEAP_NOWARNING == leap_notify) {
+        // the usual case, nothing to decide
+        return leap_notify;
+    }
+    day = real / 86400;
+    if (day != cache->day) {
+        struct tm tm;
+
+        (void)gmtime_r(&real, &tm);
+        cache->leap_month = (5 == tm.tm_mon || 11 == tm.tm_mon);
+        cache->day = day;
+    }
+    if (!cache->leap_month) {
+        // Not june, not December, no way
+        return LEAP_NOWARNING;
+    }
+    return leap_notify;
+}
+
 /* put a received fix time into shared memory for NTP
  *  unit is the SHM unit to use
  *  precision is the NTP precision
@@ -243,7 +279,10 @@ void ntpshm_put(struct gps_device_t *session, int unit, int precision,
     volatile struct shmTime *shmseg;
     char real_str[TIMESPEC_LEN];
     char clock_str[TIMESPEC_LEN];
-
+    // the PPS unit is only written from the PPS thread
+    bool pps = unit == session->shm_pps_unit;
+    struct refclock_count_t *count;
+    int leap_notify;
 
     if (!VALID_UNIT(unit)) {
         GPSD_LOG(LOG_WARN, &session->context->errout,
@@ -251,8 +290,23 @@ void ntpshm_put(struct gps_device_t *session, int unit, int precision,
         return;
     }
 
+    if (pps) {
+        count = &session->shm_pps_count;
+        leap_notify = leap_filter(&session->leap_pps, td->real.tv_sec,
+                                  session->context->leap_notify);
+    } else {
+        count = &session->shm_clock_count;
+        leap_notify = leap_filter(&session->leap_clock, td->real.tv_sec,
+                                  session->context->leap_notify);
+    }
+
     shmseg = session->context->shmTime[unit];
-    ntp_write(shmseg, td, precision, session->context->leap_notify);
+    if (1 == shmseg->valid) {
+        // ntpd, or chronyd, never read the previous sample
+        count->dropped++;
+    }
+    ntp_write(shmseg, td, precision, leap_notify);
+    count->delivered++;
 
     GPSD_LOG(LOG_PROG, &session->context->errout,
              "NTP:SHM: ntpshm_put(NTP%d, %d) %s, %s @ %s\n",
@@ -274,8 +328,23 @@ struct sock_sample {
     int magic;      // must be SOCK_MAGIC
 };
 
+/* Clock samples waiting to go to chronyd in one sendmmsg().
+ * Only the main thread queues, or flushes, them.
+ * PPS samples are never queued, they go out from the PPS thread. */
+#define CHRONY_BATCH_MAX        MAX_DEVICES
+#define CHRONY_BATCH_WAIT       200000000L      // nSec, oldest sample
+static struct chrony_batch_t {
+    struct gps_device_t *session;
+    struct sock_sample sample;
+    struct sockaddr_un addr;
+} chrony_batch[CHRONY_BATCH_MAX];
+static unsigned chrony_batch_count;
+static unsigned chrony_batch_socks;     // open clock sockets
+static int chrony_batch_fd = -1;        // unconnected, sends to all of them
+
 // for chrony SOCK interface, which allows nSec timekeeping
-static int chrony_open(struct gps_device_t *session, const char *prefix)
+static int chrony_open(struct gps_device_t *session, const char *prefix,
+                       char *path, size_t pathlen)
 {
     // open the chrony socket
     char chrony_path[GPS_PATH_MAX];
@@ -311,12 +380,156 @@ static int chrony_open(struct gps_device_t *session, const char *prefix)
             GPSD_LOG(LOG_PROG, &session->context->errout,
                      "NTP:%s using chrony socket: %s\n",
                      session->gpsdata.dev.path, chrony_path);
+            if (NULL != path) {
+                (void)strlcpy(path, chrony_path, pathlen);
+            }
         }
     }
 
     return fd;
 }
 
+/* a batched send failed, errno is still set.
+ * After dropping root, the socket file may no longer be writable, but the
+ * connection made at open time still is.  Use that from now on. */
+static void chrony_unbatch(struct gps_context_t *context,
+                           struct chrony_batch_t *entry)
+{
+    struct gps_device_t *session = entry->session;
+
+    if ((EACCES == errno ||
+         EPERM == errno) &&
+        0 < session->chrony_clock_fd) {
+        GPSD_LOG(LOG_WARN, &context->errout,
+                 "NTP: chrony_flush(%s) %s(%d), not batching it\n",
+                 entry->addr.sun_path, strerror(errno), errno);
+        session->chrony_clock_path[0] = '\0';
+        if (0 <= send(session->chrony_clock_fd, &entry->sample,
+                      sizeof(entry->sample), 0)) {
+            session->chrony_clock_count.delivered++;
+            return;
+        }
+    }
+    GPSD_LOG(LOG_ERROR, &context->errout,
+             "NTP: chrony_flush(%s) %s(%d)\n",
+             entry->addr.sun_path, strerror(errno), errno);
+    session->chrony_clock_count.dropped++;
+}
+
+/* send all queued clock samples to chronyd
+ * unless force, wait until every clock socket has a sample queued,
+ * or the oldest sample is CHRONY_BATCH_WAIT old.
+ */
+void chrony_flush(struct gps_context_t *context, bool force)
+{
+    unsigned i, sent;
+
+    if (0 == chrony_batch_count) {
+        return;
+    }
+    if (!force &&
+        chrony_batch_count < chrony_batch_socks) {
+        timespec_t ts_now, ts_first;
+
+        (void)clock_gettime(CLOCK_REALTIME, &ts_now);
+        TVTOTS(&ts_first, &chrony_batch[0].sample.tv);
+        if (CHRONY_BATCH_WAIT > timespec_diff_ns(ts_now, ts_first)) {
+            return;
+        }
+    }
+
+    if (0 > chrony_batch_fd) {
+        chrony_batch_fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+        if (0 > chrony_batch_fd) {
+            GPSD_LOG(LOG_ERROR, &context->errout,
+                     "NTP: chrony_flush() socket() %s(%d)\n",
+                     strerror(errno), errno);
+        } else {
+            // never let a stuck chronyd stall the main loop
+            (void)fcntl(chrony_batch_fd, F_SETFL,
+                        fcntl(chrony_batch_fd, F_GETFL) | O_NONBLOCK);
+        }
+    }
+
+    sent = 0;
+    if (0 <= chrony_batch_fd) {
+#ifdef HAVE_SENDMMSG
+        struct mmsghdr msgs[CHRONY_BATCH_MAX];
+        struct iovec iov[CHRONY_BATCH_MAX];
+
+        memset(msgs, 0, sizeof(msgs));
+        for (i = 0; i < chrony_batch_count; i++) {
+            iov[i].iov_base = &chrony_batch[i].sample;
+            iov[i].iov_len = sizeof(chrony_batch[i].sample);
+            msgs[i].msg_hdr.msg_name = &chrony_batch[i].addr;
+            msgs[i].msg_hdr.msg_namelen = sizeof(chrony_batch[i].addr);
+            msgs[i].msg_hdr.msg_iov = &iov[i];
+            msgs[i].msg_hdr.msg_iovlen = 1;
+        }
+        while (sent < chrony_batch_count) {
+            int ret = sendmmsg(chrony_batch_fd, msgs + sent,
+                               chrony_batch_count - sent, 0);
+
+            if (0 < ret) {
+                for (i = sent; i < sent + (unsigned)ret; i++) {
+                    chrony_batch[i].session->chrony_clock_count.delivered++;
+                }
+                sent += (unsigned)ret;
+                continue;
+            }
+            // the first unsent message failed, skip it
+            chrony_unbatch(context, &chrony_batch[sent]);
+            sent++;
+        }
+#else  // HAVE_SENDMMSG
+        for (i = 0; i < chrony_batch_count; i++) {
+            if (0 > sendto(chrony_batch_fd, &chrony_batch[i].sample,
+                           sizeof(chrony_batch[i].sample), 0,
+                           (struct sockaddr *)&chrony_batch[i].addr,
+                           sizeof(chrony_batch[i].addr))) {
+                chrony_unbatch(context, &chrony_batch[i]);
+            } else {
+                chrony_batch[i].session->chrony_clock_count.delivered++;
+            }
+        }
+        sent = i;
+#endif  // HAVE_SENDMMSG
+    }
+    for (i = sent; i < chrony_batch_count; i++) {
+        chrony_batch[i].session->chrony_clock_count.dropped++;
+    }
+    GPSD_LOG(LOG_PROG, &context->errout,
+             "NTP: chrony_flush() %u samples\n", chrony_batch_count);
+    chrony_batch_count = 0;
+}
+
+// queue a clock sample for chrony_flush()
+static void chrony_queue(struct gps_device_t *session,
+                         const struct sock_sample *sample)
+{
+    struct chrony_batch_t *entry;
+    unsigned i;
+
+    for (i = 0; i < chrony_batch_count; i++) {
+        if (session == chrony_batch[i].session) {
+            // this device is a cycle ahead, keep the samples in order
+            chrony_flush(session->context, true);
+            break;
+        }
+    }
+    if (CHRONY_BATCH_MAX <= chrony_batch_count) {
+        chrony_flush(session->context, true);
+    }
+    entry = &chrony_batch[chrony_batch_count++];
+    entry->session = session;
+    entry->sample = *sample;
+    memset(&entry->addr, 0, sizeof(entry->addr));
+    entry->addr.sun_family = AF_UNIX;
+    (void)strlcpy(entry->addr.sun_path, session->chrony_clock_path,
+                  sizeof(entry->addr.sun_path));
+    // flushes at once when every clock socket has its sample
+    chrony_flush(session->context, false);
+}
 
 /* td is the real time and clock time of the edge
  * offset is actual_ts - clock_ts
@@ -326,29 +539,21 @@ void chrony_send(struct gps_device_t *session, int fd, struct timedelta_t *td)
     char real_str[TIMESPEC_LEN];
     char clock_str[TIMESPEC_LEN];
     struct sock_sample sample;
-    struct tm tm;
-    int leap_notify = session->context->leap_notify;
-
-    /*
-     * insist that leap seconds only happen in june and december
-     * GPS emits leap pending for 3 months prior to insertion
-     * NTP expects leap pending for only 1 month prior to insertion
-     * Per http://bugs.ntp.org/1090
-     *
-     * ITU-R TF.460-6, Section 2.1, says leap seconds can be primarily
-     * in Jun/Dec but may be in March or September
-     */
-    (void)gmtime_r( &(td->real.tv_sec), &tm);
-    if (5 != tm.tm_mon &&
-        11 != tm.tm_mon) {
-        // Not june, not December, no way
-        leap_notify = LEAP_NOWARNING;
-    }
-
+    // the PPS socket is only written from the PPS thread
+    bool pps = fd == session->chrony_pps_fd;
+    struct refclock_count_t *count;
 
     // chrony expects tv-sec since Jan 1970
     sample.pulse = 0;
-    sample.leap = leap_notify;
+    if (pps) {
+        count = &session->chrony_pps_count;
+        sample.leap = leap_filter(&session->leap_pps, td->real.tv_sec,
+                                  session->context->leap_notify);
+    } else {
+        count = &session->chrony_clock_count;
+        sample.leap = leap_filter(&session->leap_clock, td->real.tv_sec,
+                                  session->context->leap_notify);
+    }
     sample.magic = SOCK_MAGIC;
     /* chronyd wants a timeval, not a timspec, not to worry, it is
      * just the top of the second */
@@ -364,10 +569,19 @@ void chrony_send(struct gps_device_t *session, int fd, struct timedelta_t *td)
              fd, timespec_str(&td->real, real_str, sizeof(real_str)),
              timespec_str(&td->clock, clock_str, sizeof(clock_str)),
              sample.offset);
+    if (!pps &&
+        session->context->batch_refclock &&
+        '\0' != session->chrony_clock_path[0]) {
+        chrony_queue(session, &sample);
+        return;
+    }
     if (-1 >= send(fd, &sample, sizeof (sample), 0)) {
 	GPSD_LOG(LOG_ERROR, &session->context->errout,
                  "NTP: chrony_send(%d) %s(%d)\n",
 		 fd, strerror(errno), errno);
+        count->dropped++;
+    } else {
+        count->delivered++;
     }
 }
 
@@ -403,6 +617,11 @@ static char *report_hook(volatile struct pps_thread_t *pps_thread,
         }
     }
 
+    /* the drivers put the qErr of the next pulse in gpsdata, as
+     * ship_pps_message() reports it */
+    timestats_pps(&session->timestats, td, session->gpsdata.qErr,
+                  &session->gpsdata.qErr_time);
+
     // FIXME?  how to log socket AND shm reported?
     log1 = "accepted";
     if (0 <= session->chrony_pps_fd) {
@@ -458,8 +677,12 @@ void ntpshm_link_deactivate(struct gps_device_t *session)
         session->shm_pps_unit = -1;
     }
     if (0 < session->chrony_clock_fd) {
+        // nothing queued may outlive its device
+        chrony_flush(context, true);
         (void)close(session->chrony_clock_fd);
         session->chrony_clock_fd = -1;
+        session->chrony_clock_path[0] = '\0';
+        chrony_batch_socks--;
     }
     if (0 < session->chrony_pps_fd) {
         (void)close(session->chrony_pps_fd);
@@ -498,7 +721,12 @@ void ntpshm_link_activate(struct gps_device_t *session)
     if (SOURCE_PPS != session->sourcetype) {
         // allocate a shared-memory segment for "NMEA" time data
         session->shm_clock_unit = ntpshm_alloc(session);
-        session->chrony_clock_fd = chrony_open(session, "chrony.clk.");
+        session->chrony_clock_fd =
+            chrony_open(session, "chrony.clk.", session->chrony_clock_path,
+                        sizeof(session->chrony_clock_path));
+        if (0 < session->chrony_clock_fd) {
+            chrony_batch_socks++;
+        }
 
         if (VALID_UNIT(session->shm_clock_unit)) {
             GPSD_LOG(LOG_PROG, &context->errout,
@@ -535,7 +763,7 @@ void ntpshm_link_activate(struct gps_device_t *session)
         /* The chrony socket name should indicate PPS source, but it is kept
          * this way for compatibility with configurations created when only one
          * socket per device could be used */
-        session->chrony_pps_fd = chrony_open(session, "chrony.");
+        session->chrony_pps_fd = chrony_open(session, "chrony.", NULL, 0);
 
         if (VALID_UNIT(session->shm_pps_unit) ||
             0 < session->chrony_pps_fd) {
@@ -0,0 +1,188 @@
+/*
+ * timestats.c - incremental time quality statistics, per device
+ *
+ * The in-band time series is fed from ntp_latch(), in the main thread.
+ * The PPS series are fed from the PPS thread report hook.  Readers
+ * take a snapshot under the same lock, then do the arithmetic.
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+#include "../include/gpsd_config.h"  // must be before all includes
+
+#include <math.h>
+#include <pthread.h>
+#include <string.h>
+
+#include "../include/gpsd.h"
+#include "../include/timespec.h"
+
+static pthread_mutex_t timestats_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// restart the decimator cascade, the accumulated sums are kept
+static void tstats_restart(struct tstats_series_t *series, int64_t ref_ns)
+{
+    int i;
+
+    series->ref_ns = ref_ns;
+    for (i = 0; i < TSTATS_LEVELS; i++) {
+        series->level[i].have_pend = false;
+        series->level[i].nlast = 0;
+    }
+}
+
+/* push one phase sample, and one block mean, into octave lvl
+ * every second pair moves up one octave */
+static void tstats_level_push(struct tstats_series_t *series, int lvl,
+                              double x, double m)
+{
+    while (TSTATS_LEVELS > lvl) {
+        struct tstats_level_t *lp = &series->level[lvl];
+
+        if (2 == lp->nlast) {
+            double dx = x - 2 * lp->x[1] + lp->x[0];
+            double dm = m - 2 * lp->m[1] + lp->m[0];
+
+            lp->sum_x += dx * dx;
+            lp->sum_m += dm * dm;
+            lp->n++;
+        } else {
+            lp->nlast++;
+        }
+        lp->x[0] = lp->x[1];
+        lp->x[1] = x;
+        lp->m[0] = lp->m[1];
+        lp->m[1] = m;
+
+        if (!lp->have_pend) {
+            lp->pend_x = x;
+            lp->pend_m = m;
+            lp->have_pend = true;
+            break;
+        }
+        // pair complete, decimate phase, average the block means
+        lp->have_pend = false;
+        x = lp->pend_x;
+        m = (lp->pend_m + m) / 2;
+        lvl++;
+    }
+}
+
+// add one offset sample to a series
+static void tstats_add(struct tstats_series_t *series,
+                       const struct timedelta_t *td, int64_t offset_ns)
+{
+    double offset = (double)offset_ns / 1e9;
+    double phase;
+    time_t gap;
+
+    if (0 == series->count) {
+        series->min = offset;
+        series->max = offset;
+        tstats_restart(series, offset_ns);
+    } else {
+        gap = td->real.tv_sec - series->last_sec;
+        if (0 == gap) {
+            // only one sample per second, keeps the taus honest
+            return;
+        }
+        if (0 > gap ||
+            TSTATS_MAX_GAP < gap) {
+            // time went backwards, or device was away a long time
+            tstats_restart(series, offset_ns);
+        } else {
+            if (1 < gap) {
+                series->missed += gap - 1;
+                tstats_restart(series, offset_ns);
+            } else {
+                double jitter_us = fabs(offset - series->last) * 1e6;
+                int bin = 0;
+
+                while (1.0 <= jitter_us &&
+                       (TSTATS_JITTER_BINS - 1) > bin) {
+                    jitter_us /= 2;
+                    bin++;
+                }
+                series->jitter[bin]++;
+            }
+        }
+        if (offset < series->min) {
+            series->min = offset;
+        }
+        if (offset > series->max) {
+            series->max = offset;
+        }
+    }
+    series->count++;
+    series->last_sec = td->real.tv_sec;
+    series->last = offset;
+    series->sum += offset;
+    series->sumsq += offset * offset;
+
+    // remove the reference so large offsets do not lose precision
+    phase = (double)(offset_ns - series->ref_ns) / 1e9;
+    tstats_level_push(series, 0, phase, phase);
+}
+
+// in-band time offset, called from ntp_latch()
+void timestats_toff(struct timestats_t *stats, const struct timedelta_t *td)
+{
+    int64_t offset_ns = timespec_diff_ns(td->real, td->clock);
+
+    (void)pthread_mutex_lock(&timestats_mutex);
+    tstats_add(&stats->toff, td, offset_ns);
+    (void)pthread_mutex_unlock(&timestats_mutex);
+}
+
+/* PPS offset, called from the PPS thread.
+ * qErr, in pS, is used if qErr_time is for this pulse. */
+void timestats_pps(struct timestats_t *stats, const struct timedelta_t *td,
+                   long qErr, const struct timespec *qErr_time)
+{
+    int64_t offset_ns = timespec_diff_ns(td->real, td->clock);
+
+    (void)pthread_mutex_lock(&timestats_mutex);
+    tstats_add(&stats->pps, td, offset_ns);
+    if (NULL != qErr_time &&
+        qErr_time->tv_sec == td->real.tv_sec) {
+        // the pulse came qErr late, so the system clock was that much fast
+        tstats_add(&stats->ppsq, td, offset_ns + qErr / 1000);
+    }
+    (void)pthread_mutex_unlock(&timestats_mutex);
+}
+
+// consistent copy of the statistics, for reporting
+void timestats_snapshot(const struct timestats_t *stats,
+                        struct timestats_t *copy)
+{
+    (void)pthread_mutex_lock(&timestats_mutex);
+    *copy = *stats;
+    (void)pthread_mutex_unlock(&timestats_mutex);
+}
+
+// Allan deviation at tau = 2^lvl seconds, NAN if no data yet
+double tstats_adev(const struct tstats_series_t *series, int lvl)
+{
+    const struct tstats_level_t *lp = &series->level[lvl];
+    double tau = ldexp(1.0, lvl);
+
+    if (0 == lp->n) {
+        return NAN;
+    }
+    return sqrt(lp->sum_x / (2 * tau * tau * lp->n));
+}
+
+// time deviation at tau = 2^lvl seconds, NAN if no data yet
+double tstats_tdev(const struct tstats_series_t *series, int lvl)
+{
+    const struct tstats_level_t *lp = &series->level[lvl];
+
+    if (0 == lp->n) {
+        return NAN;
+    }
+    // TDEV^2 = tau^2 / 3 * MVAR, MVAR = <d^2> / (2 * tau^2)
+    return sqrt(lp->sum_m / (6 * lp->n));
+}
+
+// vim: set expandtab shiftwidth=4
@@ -0,0 +1,300 @@
+/*
+ * udpout.c - publish reports to UDP unicast, broadcast or multicast
+ * destinations, for the daemon
+ *
+ * With -U the daemon sends the reports of all its devices to each
+ * destination, as JSON, like a ?WATCH={"json":true} client gets, or as
+ * NMEA 0183 and AIVDM, like a ?WATCH={"nmea":true} client gets.  A
+ * destination can take only some report classes.  Each report is
+ * rendered once for all the destinations that take the same format and
+ * classes, into one datagram, and one sendmmsg() sends it to all of them.
+ *
+ * Destinations are resolved at startup.  Nothing is ever read from the
+ * sockets, so there is nothing to poll.  Only the main thread publishes.
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+#include "../include/gpsd_config.h"  // must be before all includes
+
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>                   // for getaddrinfo()
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "../include/gpsd.h"
+#include "../include/gps_json.h"
+#include "../include/strfuncs.h"
+
+#define UDPOUT_MAX      (GPS_JSON_RESPONSE_MAX * 4)     // bytes per datagram
+
+static struct udpout_dest_t {
+    char spec[GPS_PATH_MAX];            // as given to -U
+    bool nmea;                          // NMEA and AIVDM, else JSON
+    unsigned int classes;               // GPS_CLASS_* it takes
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+    int af;                             // index in socks[]
+    unsigned long sent;                 // datagrams sent
+    unsigned long errors;               // ... that failed
+} dests[UDPOUT_DESTS];
+static int ndests;
+// unconnected, one for each address family, sendmmsg() takes one fd
+static socket_t socks[2] = {-1, -1};
+
+// the rendered report for each destination, shared when alike
+static struct udpout_render_t {
+    size_t len;
+    char buf[UDPOUT_MAX];
+} renders[UDPOUT_DESTS];
+
+/* add a destination, from -U.  spec is json:// or nmea://, then host,
+ * a port, and an optional comma separated list of report classes:
+ *   json://239.192.0.1:5000
+ *   nmea://[ff02::1%eth0]:10110:AIS
+ *
+ * Return: 0 = OK
+ *         -1 = bad spec, or it does not resolve
+ */
+int udpout_add(const char *spec, const struct gpsd_errout_t *errout)
+{
+    struct udpout_dest_t *dest = &dests[ndests];
+    char buf[GPS_PATH_MAX];
+    char *host, *port, *classes;
+    struct addrinfo hints, *result;
+    int af, ret;
+
+    if (UDPOUT_DESTS <= ndests) {
+        GPSD_LOG(LOG_ERROR, errout, "UDPOUT: more than %d destinations\n",
+                 UDPOUT_DESTS);
+        return -1;
+    }
+    if (str_starts_with(spec, "json://")) {
+        dest->nmea = false;
+    } else if (str_starts_with(spec, "nmea://")) {
+        dest->nmea = true;
+    } else {
+        GPSD_LOG(LOG_ERROR, errout,
+                 "UDPOUT: %s is not json:// or nmea://\n", spec);
+        return -1;
+    }
+    (void)strlcpy(buf, spec + 7, sizeof(buf));
+    if (-1 == parse_uri_dest(buf, &host, &port, &classes) ||
+        NULL == port) {
+        GPSD_LOG(LOG_ERROR, errout, "UDPOUT: %s has no port\n", spec);
+        return -1;
+    }
+    dest->classes = json_class_mask(NULL == classes ? "" : classes);
+    if (0 == dest->classes) {
+        GPSD_LOG(LOG_ERROR, errout, "UDPOUT: %s takes no known class\n",
+                 spec);
+        return -1;
+    }
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_DGRAM;
+    ret = getaddrinfo(host, port, &hints, &result);
+    if (0 != ret) {
+        GPSD_LOG(LOG_ERROR, errout, "UDPOUT: %s: %s\n", spec,
+                 gai_strerror(ret));
+        return -1;
+    }
+    if (sizeof(dest->addr) < result->ai_addrlen ||
+        (AF_INET != result->ai_family &&
+         AF_INET6 != result->ai_family)) {
+        freeaddrinfo(result);
+        return -1;
+    }
+    (void)memcpy(&dest->addr, result->ai_addr, result->ai_addrlen);
+    dest->addrlen = result->ai_addrlen;
+    freeaddrinfo(result);
+
+    af = AF_INET6 == dest->addr.ss_family;
+    if (0 > socks[af]) {
+        int on = 1;
+
+        socks[af] = socket(dest->addr.ss_family, SOCK_DGRAM, 0);
+        if (0 > socks[af]) {
+            GPSD_LOG(LOG_ERROR, errout, "UDPOUT: socket(): %s(%d)\n",
+                     strerror(errno), errno);
+            return -1;
+        }
+        // a full send buffer loses a datagram, it never blocks the daemon
+        (void)fcntl(socks[af], F_SETFL,
+                    fcntl(socks[af], F_GETFL) | O_NONBLOCK);
+        if (0 == af) {
+            (void)setsockopt(socks[af], SOL_SOCKET, SO_BROADCAST, &on,
+                             sizeof(on));
+        }
+        // multicast goes out with the system default TTL, usually 1 hop
+    }
+    dest->af = af;
+    (void)strlcpy(dest->spec, spec, sizeof(dest->spec));
+    GPSD_LOG(LOG_INF, errout, "UDPOUT: %s reports to %s\n",
+             dest->nmea ? "NMEA" : "JSON", spec);
+    ndests++;
+    return 0;
+}
+
+// render what a destination takes of a report into render
+static void udpout_render(const struct udpout_dest_t *dest,
+                          struct gps_device_t *device, gps_mask_t changed,
+                          struct udpout_render_t *render)
+{
+    static const struct gps_policy_t policy = {.watcher = true,
+                                               .json = true};
+    int type = device->lexer.type;
+    char *bp = render->buf;
+
+    bp[0] = '\0';
+    if (0 != (changed & PASSTHROUGH_IS)) {
+        /* JSON from a gpsd:// source, its class is not known here.
+         * Frames from a relay:// feed are not JSON. */
+        if (!dest->nmea &&
+            GPSB_PACKET != type) {
+            (void)snprintf(bp, sizeof(render->buf), "%s\r\n",
+                           (const char *)device->lexer.outbuffer);
+        }
+    } else if (dest->nmea) {
+        if (NMEA_PACKET == type ||
+            AIVDM_PACKET == type) {
+            // sentences go as they came
+            if (0 != (dest->classes &
+                      (AIVDM_PACKET == type ? GPS_CLASS_AIS :
+                       ~GPS_CLASS_AIS))) {
+                (void)strlcpy(bp, (const char *)device->lexer.outbuffer,
+                              sizeof(render->buf));
+            }
+        } else if (GPS_PACKET_TYPE(type) &&
+                   !TEXTUAL_PACKET_TYPE(type)) {
+            // what pseudonmea_report() sends a watcher
+            if (0 != (changed & REPORT_IS) &&
+                0 != (dest->classes & GPS_CLASS_TPV)) {
+                nmea_tpv_dump(device, bp, sizeof(render->buf));
+            }
+            if (0 != (changed & (DOP_SET | SATELLITE_SET | USED_IS)) &&
+                0 != (dest->classes & GPS_CLASS_SKY)) {
+                size_t len = strnlen(bp, sizeof(render->buf));
+
+                nmea_sky_dump(device, bp + len, sizeof(render->buf) - len);
+            }
+            if (0 != (changed & SUBFRAME_SET) &&
+                0 != (dest->classes & GPS_CLASS_SUBFRAME)) {
+                size_t len = strnlen(bp, sizeof(render->buf));
+
+                nmea_subframe_dump(device, bp + len,
+                                   sizeof(render->buf) - len);
+            }
+#ifdef AIVDM_ENABLE
+            if (0 != (changed & AIS_SET) &&
+                0 != (dest->classes & GPS_CLASS_AIS)) {
+                size_t len = strnlen(bp, sizeof(render->buf));
+
+                nmea_ais_dump(device, bp + len, sizeof(render->buf) - len);
+            }
+#endif  // AIVDM_ENABLE
+        }
+    } else if (0 != (changed & ~(ONLINE_SET | PACKET_SET | CLEAR_IS))) {
+        // what a watcher gets, with the default policy
+        if (0 == (changed & AIS_SET) ||
+            24 != device->gpsdata.ais.type ||
+            both == device->gpsdata.ais.type24.part) {
+            json_data_report(changed, device, &policy, dest->classes, false,
+                             bp, sizeof(render->buf));
+        }
+    }
+    render->len = strnlen(bp, sizeof(render->buf));
+}
+
+/* send the report of device to all the destinations that take it,
+ * called for every packet, like the reports to the watchers */
+void udpout_report(struct gps_device_t *device, gps_mask_t changed)
+{
+    struct mmsghdr msgs[UDPOUT_DESTS];
+    struct iovec iov[UDPOUT_DESTS];
+    struct udpout_dest_t *sent[UDPOUT_DESTS];
+    int af, i, j;
+
+    for (i = 0; i < ndests; i++) {
+        // render it once for all the destinations that take the same
+        for (j = 0; j < i; j++) {
+            if (dests[j].nmea == dests[i].nmea &&
+                dests[j].classes == dests[i].classes) {
+                break;
+            }
+        }
+        if (j < i) {
+            iov[i] = iov[j];
+        } else {
+            udpout_render(&dests[i], device, changed, &renders[i]);
+            iov[i].iov_base = renders[i].buf;
+            iov[i].iov_len = renders[i].len;
+        }
+    }
+
+    for (af = 0; af < 2; af++) {
+        unsigned count = 0;
+        unsigned done = 0;
+
+        for (i = 0; i < ndests; i++) {
+            if (af != dests[i].af ||
+                0 == iov[i].iov_len) {
+                continue;
+            }
+            memset(&msgs[count], 0, sizeof(msgs[count]));
+            msgs[count].msg_hdr.msg_name = &dests[i].addr;
+            msgs[count].msg_hdr.msg_namelen = dests[i].addrlen;
+            msgs[count].msg_hdr.msg_iov = &iov[i];
+            msgs[count].msg_hdr.msg_iovlen = 1;
+            sent[count++] = &dests[i];
+        }
+        while (done < count) {
+#ifdef HAVE_SENDMMSG
+            int ret = sendmmsg(socks[af], msgs + done, count - done, 0);
+#else   // HAVE_SENDMMSG
+            int ret = 0 > sendmsg(socks[af], &msgs[done].msg_hdr, 0) ? -1 : 1;
+#endif  // HAVE_SENDMMSG
+
+            if (0 < ret) {
+                for (i = 0; i < ret; i++) {
+                    sent[done + i]->sent++;
+                }
+                done += (unsigned)ret;
+                continue;
+            }
+            // the first unsent one failed, skip it
+            if (0 == sent[done]->errors++) {
+                GPSD_LOG(LOG_WARN, &device->context->errout,
+                         "UDPOUT: send failed: %s(%d)\n",
+                         strerror(errno), errno);
+            }
+            done++;
+        }
+    }
+}
+
+// append the counters of the destinations to a daemon STATS object
+void udpout_stats(char *reply, size_t replylen)
+{
+    int i;
+
+    if (0 == ndests) {
+        return;
+    }
+    (void)strlcat(reply, ",\"udpout\":[", replylen);
+    for (i = 0; i < ndests; i++) {
+        str_appendf(reply, replylen,
+                    "{\"dest\":\"%s\",\"sent\":%lu,\"errors\":%lu},",
+                    dests[i].spec, dests[i].sent, dests[i].errors);
+    }
+    str_rstrip_char(reply, ',');
+    (void)strlcat(reply, "]", replylen);
+}
+
+// vim: set expandtab shiftwidth=4
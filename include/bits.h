@@ -43,6 +43,9 @@ extern double getled64(const char *, int);
 
 #define putle16(buf, off, w) do {putbyte(buf, (off)+1, (unsigned int)(w) >> 8); putbyte(buf, (off), (w));} while (0)
 #define putle32(buf, off, l) do {putle16(buf, (off)+2, (unsigned int)(l) >> 16); putle16(buf, (off), (l));} while (0)
+#define putle64(buf, off, ll) do {putle32(buf, (off)+4, (unsigned long long)(ll) >> 32); putle32(buf, (off), (ll));} while (0)
+extern void putlef32(char *, int, float);
+extern void putled64(char *, int, double);
 
 // big-endian access
 #define getbes16(buf, off)      ((int16_t)(((uint16_t)getub(buf, (off)) << 8) | (uint16_t)getub(buf, (off)+1)))
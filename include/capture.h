@@ -0,0 +1,99 @@
+/* capture.h - the gpsd raw input capture file format
+ *
+ * With -C DIR the daemon writes, per device, every chunk read() returns
+ * into an append-only capture file, with the CLOCK_REALTIME and
+ * CLOCK_MONOTONIC time of the read.  gpsdecode -C and gpsfake replay
+ * captures with their original timing, scaled, or as fast as possible.
+ *
+ * All fields are little endian.  A file is a CAPTURE_HEADER_LEN byte
+ * header, then records.  A record is a CAPTURE_REC_LEN byte header
+ * followed by len bytes of payload, unpadded.
+ *
+ * When the capture is closed cleanly the last record is an index, one
+ * entry about every CAPTURE_INDEX_NS of capture, each the time and file
+ * offset of a data record, and the file ends with a CAPTURE_TRAILER_LEN
+ * trailer pointing at it.  A capture cut short by a crash has no index,
+ * readers then scan.
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+#ifndef _GPSD_CAPTURE_H_
+#define _GPSD_CAPTURE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CAPTURE_MAGIC           "GPSDCAP1"
+#define CAPTURE_VERSION         1
+#define CAPTURE_PATH            128             // GPS_PATH_MAX
+
+// file header
+#define CAPTURE_HEADER_LEN      256
+#define CAPTURE_H_MAGIC         0               // 8 bytes, CAPTURE_MAGIC
+#define CAPTURE_H_VERSION       8               // u32
+#define CAPTURE_H_LEN           12              // u32, CAPTURE_HEADER_LEN
+#define CAPTURE_H_REAL          16              // s64, realtime at open, nS
+#define CAPTURE_H_MONO          24              // s64, monotonic at open, nS
+#define CAPTURE_H_DEVICE        32              // CAPTURE_PATH bytes
+
+// record header
+#define CAPTURE_REC_LEN         24
+#define CAPTURE_R_LEN           0               // u32, payload bytes
+#define CAPTURE_R_TYPE          4               // u16, CAPTURE_DATA, etc.
+#define CAPTURE_R_REAL          8               // s64, realtime, nS
+#define CAPTURE_R_MONO          16              // s64, monotonic, nS
+
+#define CAPTURE_DATA            1               // bytes of one read()
+#define CAPTURE_INDEX           2               // the index
+
+// index entries, the payload of the CAPTURE_INDEX record
+#define CAPTURE_INDEX_NS        1000000000LL    // 1 second apart
+#define CAPTURE_IDX_LEN         16
+#define CAPTURE_I_MONO          0               // s64, monotonic, nS
+#define CAPTURE_I_OFFSET        8               // u64, file offset of record
+
+// trailer, the last bytes of an indexed capture
+#define CAPTURE_TRAILER_MAGIC   "GPSDIDX1"
+#define CAPTURE_TRAILER_LEN     16
+#define CAPTURE_T_MAGIC         0               // 8 bytes
+#define CAPTURE_T_OFFSET        8               // u64, offset of the index
+
+// largest payload a reader accepts
+#define CAPTURE_PAYLOAD_MAX     65536
+
+// a capture being read
+struct capture_reader_t {
+    FILE *fp;
+    char device[CAPTURE_PATH];
+    int64_t real_ns;                    // realtime at open
+    int64_t mono_ns;                    // monotonic at open
+};
+
+// one data record read back
+struct capture_rec_t {
+    int64_t real_ns;
+    int64_t mono_ns;
+    size_t len;
+};
+
+extern bool capture_reader_open(struct capture_reader_t *, const char *);
+extern bool capture_reader_seek(struct capture_reader_t *, int64_t);
+extern int capture_reader_next(struct capture_reader_t *,
+                               struct capture_rec_t *,
+                               unsigned char *, size_t);
+extern void capture_reader_close(struct capture_reader_t *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _GPSD_CAPTURE_H_
+// capture.h ends here
+// vim: set expandtab shiftwidth=4
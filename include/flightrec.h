@@ -0,0 +1,83 @@
+/* flightrec.h - the gpsd flight recorder, a binary trace ring in SHM
+ *
+ * With -R the daemon records what each device does, the bytes read,
+ * the packets the lexer returns, driver switches, writes and the end
+ * of each poll, into a ring in a System V shared-memory segment.  A
+ * record is a fixed header, the raw argument, and the raw bytes, so
+ * recording costs a clock_gettime() and a memcpy(), no formatting.
+ * gpsflightrec(1) attaches to the segment and prints the ring, so the
+ * recorder can stay on in production and be read after the fact.
+ *
+ * The segment is a struct flightrec_t.  Records are 8 byte aligned in
+ * the ring, each a struct flightrec_rec followed by len bytes of
+ * payload, padded.  Positions are byte counts since the start, taken
+ * modulo FLIGHTREC_RING.  The daemon is the only writer.  It moves
+ * tail past the records it is about to overwrite, writes the record,
+ * then moves head.  A reader loads head, copies the ring, then loads
+ * tail: the records in [tail, head) of its copy are whole.
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+#ifndef _GPSD_FLIGHTREC_H_
+#define _GPSD_FLIGHTREC_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLIGHTREC_KEY           0x47505346      // "GPSF"
+#define FLIGHTREC_MAGIC         0x52465047u     // "GPFR"
+#define FLIGHTREC_VERSION       1
+#define FLIGHTREC_RING          (1 << 20)       // bytes, a power of 2
+#define FLIGHTREC_DEVICES       16
+#define FLIGHTREC_PATH          128             // GPS_PATH_MAX
+// longest payload kept, longer ones are cut, arg keeps the length
+#define FLIGHTREC_PAYLOAD       4096
+
+// record events
+#define FLIGHTREC_OPEN          1       // device opened, arg is the fd
+#define FLIGHTREC_CLOSE         2       // device closed
+#define FLIGHTREC_READ          3       // bytes read, arg is the count
+#define FLIGHTREC_READERR       4       // read error, arg is errno
+#define FLIGHTREC_PACKET        5       // lexer packet, arg is its type
+#define FLIGHTREC_BADPACKET     6       // bad checksum or length
+#define FLIGHTREC_DRIVER        7       // driver switch, payload the name
+#define FLIGHTREC_POLL          8       // end of gpsd_poll(), arg the mask
+#define FLIGHTREC_WRITE         9       // bytes written to the device
+#define FLIGHTREC_EVENTS        10
+
+struct flightrec_rec {
+    uint16_t len;                       // payload bytes
+    uint8_t event;                      // FLIGHTREC_*
+    uint8_t device;                     // index in flightrec_t.devices
+    uint32_t reserved;
+    int64_t mono_ns;                    // CLOCK_MONOTONIC
+    uint64_t arg;
+};
+
+struct flightrec_t {
+    uint32_t magic;                     // FLIGHTREC_MAGIC
+    uint32_t version;                   // FLIGHTREC_VERSION
+    uint32_t ring_size;                 // FLIGHTREC_RING
+    uint32_t reserved;
+    int64_t real_ns;                    // CLOCK_REALTIME - CLOCK_MONOTONIC
+    volatile uint64_t head;             // end of the newest record
+    volatile uint64_t tail;             // start of the oldest record
+    char devices[FLIGHTREC_DEVICES][FLIGHTREC_PATH];
+    unsigned char ring[FLIGHTREC_RING];
+};
+
+// round a record up to the ring alignment
+#define FLIGHTREC_ALIGN(n)      (((n) + 7) & ~(uint64_t)7)
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _GPSD_FLIGHTREC_H_
+// flightrec.h ends here
+// vim: set expandtab shiftwidth=4
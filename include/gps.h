@@ -111,9 +111,15 @@ extern "C" {
  *       Move gst_t out of gps_data_t union.
  *       Add ROWS(), IN() macrosa
  *       MAXCHANNELS bumped from 140 to 185, for ZED-F9T
+ * 14.1  Add gps_class_filter(), GPS_CLASS_* and privdata_t.skip_classes
+ *       Add gps_read_batch() and privdata_t.start
+ *       Add GPS_CLASS_SUBFRAME, GPS_CLASS_LOG, gps_stream() sends the
+ *       class filter to gpsd
+ *       Add WATCH_BINARY, binary TPV, SKY, ATT, IMU and RAW reports
+ *       Add WATCH_TRACE, latency trace stages in TPV
  */
 #define GPSD_API_MAJOR_VERSION  14      // bump on incompatible changes
-#define GPSD_API_MINOR_VERSION  0       // bump on compatible changes
+#define GPSD_API_MINOR_VERSION  1       // bump on compatible changes
 
 #define MAXCHANNELS     184     // u-blox 9 tracks 140 signals
 #define MAXUSERDEVS     4       // max devices per user
@@ -2781,8 +2787,28 @@ typedef uint32_t watch_t;
 #define WATCH_DEVICE    (watch_t)0x000800u       // watch specific device
 #define WATCH_SPLIT24   (watch_t)0x001000u       // split AIS Type 24s
 #define WATCH_PPS       (watch_t)0x002000u       // enable PPS JSON
+#define WATCH_BINARY    (watch_t)0x004000u       // TPV, SKY, etc. binary
+#define WATCH_TRACE     (watch_t)0x008000u       // latency trace in TPV
 #define WATCH_NEWSTYLE  (watch_t)0x010000u       // force JSON streaming
 
+/* report classes for gps_class_filter(), decoded by default.
+ * gps_stream() also asks gpsd to send only these.
+ * VERSION, DEVICES, DEVICE, WATCH and ERROR are always decoded. */
+#define GPS_CLASS_TPV   0x0001u
+#define GPS_CLASS_SKY   0x0002u
+#define GPS_CLASS_GST   0x0004u
+#define GPS_CLASS_ATT   0x0008u
+#define GPS_CLASS_IMU   0x0010u
+#define GPS_CLASS_AIS   0x0020u
+#define GPS_CLASS_RTCM2 0x0040u
+#define GPS_CLASS_RTCM3 0x0080u
+#define GPS_CLASS_TOFF  0x0100u
+#define GPS_CLASS_PPS   0x0200u
+#define GPS_CLASS_OSC   0x0400u
+#define GPS_CLASS_RAW   0x0800u
+#define GPS_CLASS_SUBFRAME 0x1000u
+#define GPS_CLASS_LOG   0x2000u
+#define GPS_CLASS_ALL   0x3fffu
 
 // describe a gpsd source
 struct fixsource_t
@@ -2808,6 +2834,9 @@ struct privdata_t
     // SHM handler
     void *shmseg;
     int tick;
+    // GPS_CLASS_* not to decode, see gps_class_filter()
+    unsigned int skip_classes;
+    ssize_t start;         // offset of the first waiting byte in buffer
 };
 
 #ifdef USE_QT
@@ -2973,11 +3002,14 @@ extern int gps_open(const char *, const char *,
 extern int gps_close(struct gps_data_t *);
 extern int gps_send(struct gps_data_t *, const char *, ... );
 extern int gps_read(struct gps_data_t *, char *message, int message_len);
+extern int gps_read_batch(struct gps_data_t *,
+                          void (*)(struct gps_data_t *));
 extern const char *gps_hexdump(char *, size_t, const unsigned char *, size_t);
 extern ssize_t gps_hexpack(const char *, unsigned char *, size_t);
 extern int gps_unpack(const char *, struct gps_data_t *);
 extern bool gps_waiting(const struct gps_data_t *, int);
 extern int gps_stream(struct gps_data_t *, watch_t, const char *);
+extern int gps_class_filter(struct gps_data_t *, unsigned int);
 extern int gps_mainloop(struct gps_data_t *, int,
                         void (*)(struct gps_data_t *));
 extern const char *gps_data(const struct gps_data_t *);
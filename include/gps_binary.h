@@ -0,0 +1,97 @@
+/* gps_binary.h - binary report frames for libgps and gpsd
+ *
+ * A watcher that sets "binary":true in its ?WATCH gets TPV, SKY, ATT,
+ * IMU and RAW reports as frames, instead of JSON.  Everything else,
+ * including the responses to commands, stays JSON.
+ *
+ * A frame is an 8 byte header, then the items, all little endian:
+ *
+ *    0  u8   GPSB_SYNC1, never the first byte of a JSON object
+ *    1  u8   GPSB_SYNC2
+ *    2  u8   class, GPSB_TPV, etc.
+ *    3  u8   GPSB_VERSION
+ *    4  u32  length of the items
+ *
+ * Each item is a u8 tag, a u8 type, then the value.  The type gives
+ * the value length, so a decoder skips tags it does not know.  Tags
+ * below GPSB_TAG_DEVICE index the field table of the class, see
+ * libgps_binary.c.  Tables are only ever appended to.  A field at its
+ * default, a NAN, or one the fix mode does not support, is not sent.
+ *
+ * A watcher that also sets "relay":true, a gpsd reading a relay://
+ * feed, gets the frames of all the devices, each numbered by a
+ * GPSB_TAG_SEQ item at its end, so it can ask to resume after the last
+ * one it got when it reconnects.
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+#ifndef _GPSD_GPS_BINARY_H_
+#define _GPSD_GPS_BINARY_H_
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GPSB_SYNC1      0xe7
+#define GPSB_SYNC2      0x67
+#define GPSB_VERSION    1
+#define GPSB_HEADER     8
+// largest frame, so one fits where a JSON response does
+#define GPSB_MAX        GPS_JSON_RESPONSE_MAX
+
+// frame classes
+#define GPSB_TPV        1
+#define GPSB_SKY        2
+#define GPSB_ATT        3
+#define GPSB_IMU        4
+#define GPSB_RAW        5
+
+// the GPS_CLASS_* that have a binary encoding
+#define GPSB_CLASSES    (GPS_CLASS_TPV | GPS_CLASS_SKY | GPS_CLASS_ATT | \
+                         GPS_CLASS_IMU | GPS_CLASS_RAW)
+
+// item types, and the length of their values
+#define GPSB_BOOL       1       // 1
+#define GPSB_U8         2       // 1
+#define GPSB_I8         3       // 1
+#define GPSB_I16        4       // 2
+#define GPSB_I32        5       // 4
+#define GPSB_U32        6       // 4
+#define GPSB_I64        7       // 8
+#define GPSB_U64        8       // 8
+#define GPSB_F32        9       // 4, a double in memory
+#define GPSB_F64        10      // 8
+#define GPSB_TS         11      // 12, i64 seconds then i32 nanoseconds
+#define GPSB_STR        12      // u8 length, then that many bytes
+#define GPSB_NEXT       13      // 0, starts the next array element
+
+// tags common to all classes
+#define GPSB_TAG_DEVICE 0xf0    // GPSB_STR, device path
+#define GPSB_TAG_LEAP   0xf1    // GPSB_I32, leap seconds, TPV only
+#define GPSB_TAG_NSAT   0xf2    // GPSB_I32, satellites follow, SKY only
+#define GPSB_TAG_SEQ    0xf3    // GPSB_U64, relay sequence number, last
+#define GPSB_TAG_NEXT   0xff    // GPSB_NEXT
+
+int gpsb_frame_len(const char *, size_t);
+size_t gpsb_tpv_dump(const struct gps_data_t *, int, char *, size_t);
+size_t gpsb_sky_dump(const struct gps_data_t *, char *, size_t);
+size_t gpsb_att_dump(const struct gps_data_t *, const struct attitude_t *,
+                     int, char *, size_t);
+size_t gpsb_raw_dump(const struct gps_data_t *, char *, size_t);
+int libgps_binary_unpack(const char *, size_t, struct gps_data_t *);
+unsigned int gpsb_frame_class(const char *);
+size_t gpsb_seq_put(char *, size_t, size_t, unsigned long);
+unsigned long gpsb_seq_get(const char *, size_t);
+size_t gpsb_device_prefix(char *, size_t, size_t, const char *);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _GPSD_GPS_BINARY_H_
+// gps_binary.h ends here
+// vim: set expandtab shiftwidth=4
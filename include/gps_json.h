@@ -12,6 +12,11 @@ extern "C" {
 #endif
 
 struct gps_device_t;
+struct watch_rate_t;
+struct watch_request_t;
+
+// json_class_list() of all the classes, and the NUL
+#define GPS_JSON_CLASSES_MAX    80
 
 int json_ais_read(const char *, char *, size_t, struct ais_t *,
                   const char **);
@@ -20,12 +25,15 @@ void json_aivdm_dump(const struct ais_t *, const char *, bool,
 void json_att_dump(const struct gps_data_t *, char *, size_t,
                    const struct attitude_t *, const char *);
 void json_data_report(const gps_mask_t, struct gps_device_t *,
-                      const struct gps_policy_t *, char *, size_t);
+                      const struct gps_policy_t *, const unsigned int,
+                      bool, char *, size_t);
 void json_device_dump(const struct gps_device_t *, char *, size_t);
 int json_device_read(const char *, struct devconfig_t *,
                      const char **);
 void json_noise_dump(const struct gps_data_t *, char *, size_t);
 void json_oscillator_dump(const struct gps_data_t *, char *, size_t);
+unsigned int json_class_mask(const char *);
+void json_class_list(unsigned int, char *, size_t);
 char *json_policy_to_watch(struct gps_policy_t *ccp,
                            char *outbuf, size_t outbuf_len);
 void json_raw_dump(const struct gps_data_t *, char *, size_t);
@@ -35,16 +43,23 @@ int json_rtcm3_read(const char *, char *, size_t, struct rtcm3_t *,
                     const char **);
 char *json_stringify(char *, size_t, const char *);
 void json_tpv_dump(const gps_mask_t, struct gps_device_t *,
-                   const struct gps_policy_t *, char *, size_t);
+                   const struct gps_policy_t *, bool, char *, size_t);
 void json_sky_dump(const struct gps_device_t *, char *, size_t);
 void json_subframe_dump(const struct gps_data_t *, const bool scaled,
                         char buf[], size_t);
-void json_watch_dump(const struct gps_policy_t *, char *, size_t);
+bool json_tstats_dump(const struct gps_device_t *, char *, size_t);
+bool json_stats_dump(const struct gps_device_t *, char *, size_t);
+void json_watch_dump(const struct gps_policy_t *,
+                     const struct watch_rate_t *, unsigned int, bool,
+                     bool, char *, size_t);
 int json_watch_read(const char *, struct gps_policy_t *,
-                    const char **);
+                    struct watch_request_t *, const char **);
+int json_device_rtcm_read(const char *, struct gps_device_t *);
 void json_version_dump(char *, size_t);
 int libgps_json_unpack(const char *, struct gps_data_t *,
                        const char **);
+void libgps_sky_mask(struct gps_data_t *, bool);
+void libgps_tpv_mask(struct gps_data_t *);
 #ifdef __cplusplus
 }
 #endif
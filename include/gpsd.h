@@ -38,6 +38,7 @@ extern "C" {
 #include "os_compat.h"
 #include "ppsthread.h"
 #include "timespec.h"
+#include "timestats.h"
 
 /*
  * Constants for the VERSION response
@@ -115,6 +116,42 @@ extern "C" {
  *      add shm_clock_lastsec and shm_pps_lastsec to gps_device_t;
  *      add queue, regression, to gps_device_t
  *      add ALL_PACKET
+ *      add timestats to gps_device_t
+ *      add batch_refclock to gps_context_t
+ *      add chrony_clock_path, leap caches and refclock counters
+ *      to gps_device_t, add chrony_flush()
+ *      add rx_time to gps_lexer_t, rx_stamped to gps_device_t
+ *      add watch_rate_t, watch_request_t
+ *      add devstats_t, latency_t, stats to gps_device_t, resync_counter and
+ *      discard_counter to gps_lexer_t, add gpsd_latency_add()
+ *      add packet_type_names[], metrics_daemon_t, metrics_http()
+ *      add read_mono, pkt_read, parse_mono, lex and write to devstats_t
+ *      add flightrec to gps_context_t, flightrec_slot to gps_device_t,
+ *      add flightrec_*() and FLIGHTREC()
+ *      add capture_dir to gps_context_t, capture to gps_device_t,
+ *      add capture_*() and CAPTURE()
+ *      add netasync to gps_context_t, netconn and connecting to
+ *      gps_device_t, add netasync_*(), NL_PENDING, netlib_connectaddr()
+ *      add NTRIP_CONN_RESOLVING, ntrip_connected(), dgpsip_connected()
+ *      add wfds argument to gpsd_await_data()
+ *      add caster_rover_t, caster_*()
+ *      add rtcm_sink_t, rtcm_sink to gps_device_t, rtcm_relay*(),
+ *      add rtcm_relayed, rtcm_dropped, rtcm_filtered to devstats_t
+ *      add UDP_BATCH, UDP_SLOT, UDP_RCVBUF, udp_batch_t, rxq_ovfl and
+ *      udp to gps_device_t
+ *      add udp_dropped, udp_truncated to devstats_t
+ *      add UDPOUT_DESTS, udpout_*()
+ *      add GPSB_PACKET, SERVICE_RELAY, relay to gps_device_t,
+ *      relay_lost to devstats_t, relay_open(), relay_connected(),
+ *      RELAY_BACKLOG, relay_*()
+ *      add ntrip_mount_t, NTRIP_MOUNTS, NTRIP_STALE, mounts, nmounts,
+ *      mount to ntrip, ntrip_parse_mounts(), ntrip_packet(), ntrip_stale()
+ *      add serial_outq_t, SERIAL_OUTQ, outq to gps_device_t, async_write
+ *      to gps_context_t, out_* to devstats_t, gpsd_serial_drain(),
+ *      gpsd_serial_flush(), gpsd_serial_pending()
+ *      add devasync to gps_context_t, opening and unwanted to gps_device_t,
+ *      add devasync_*(), gpsd_activate1()
+ *      add FRONTENDS_MAX, frontend_hooks_t, frontend_*()
  */
 
 #define JSON_DATE_MAX   24      // ISO8601 timestamp with 2 decimal places
@@ -192,6 +229,13 @@ enum isgpsstat_t {
  */
 #define MAX_PACKET_LENGTH       9216    // 4 + 16 + (256 * 32) + 2 + fudge
 
+/* udp:// sources are read a batch of datagrams at a time, with
+ * recvmmsg(), into slots, then into the input buffer as they fit.  A
+ * slot takes as much as one read() into the input buffer did. */
+#define UDP_BATCH               8       // datagrams per read
+#define UDP_SLOT                (MAX_PACKET_LENGTH * 2)  // room for each
+#define UDP_RCVBUF              (1024 * 1024)   // SO_RCVBUF asked for
+
 /*
  * UTC of second 0 of week 0 of the first rollover period of GPS time.
  * Used to compute UTC from GPS time. Also, the threshold value
@@ -246,8 +290,9 @@ struct gps_lexer_t {
 #define RTCM2_PACKET            21
 #define RTCM3_PACKET            22
 #define JSON_PACKET             23
+#define GPSB_PACKET             24      // binary report frame, relay://
 // end of non GPS type packets, AIVDM is GPS type??
-#define PACKET_TYPES            24      // increment this as necessary
+#define PACKET_TYPES            25      // increment this as necessary
 
 #define TEXTUAL_PACKET_TYPE(n)  ((((n)>=NMEA_PACKET) && ((n)<=MAX_TEXTUAL_TYPE)) || (n)==JSON_PACKET)
 #define GPS_PACKET_TYPE(n)      (((n)>=NMEA_PACKET) && ((n)<=MAX_GPSPACKET_TYPE))
@@ -265,10 +310,14 @@ struct gps_lexer_t {
     size_t outbuflen;
     unsigned long char_counter;         // count characters processed
     unsigned long retry_counter;        // count sniff retries
+    // gpsd_poll() drains these two into gps_device_t.stats
+    unsigned long resync_counter;       // count syncs lost mid-packet
+    unsigned long discard_counter;      // count characters thrown away
     unsigned counter;                   // packets since last driver switch
     struct gpsd_errout_t errout;        // how to report errors
     timespec_t start_time;              // time of first input, sort of
     timespec_t pkt_time;                // time of last packet parsed
+    timespec_t rx_time;                 // kernel receive time, last read
     unsigned long start_char;           // char counter at first input
     /*
      * ISGPS200 decoding context.
@@ -326,7 +375,140 @@ extern int packet_sniff(struct gps_lexer_t *);
 
 #define AIVDM_CHANNELS  2               // A, B
 
+// refclock samples handed to ntpd/chronyd, per SHM unit or chrony socket
+struct refclock_count_t {
+    unsigned long delivered;
+    unsigned long dropped;      // send failed, or SHM sample never read
+};
+
+/* daemon performance counters of a device, for ?STATS.
+ * Only the main thread touches these, so they need no lock.
+ * Latencies are counted in octave bins of microseconds, from the
+ * lexer returning a packet, or from the read() that completed it:
+ * bin 0 is under 1 uS, bin n is under 2^n uS,
+ * the last bin takes everything slower. */
+#define STATS_LATENCY_BINS      16
+struct latency_t {
+    unsigned long bins[STATS_LATENCY_BINS];
+    uint64_t sum_ns;
+};
+struct devstats_t {
+    unsigned long bytes_read;
+    unsigned long packets[PACKET_TYPES];    // by packet type
+    unsigned long bad_packets;              // bad checksum, or bad length
+    unsigned long resyncs;                  // lexer lost sync mid-packet
+    unsigned long discards;                 // characters skipped hunting
+    unsigned long driver_switches;
+    unsigned long cycles;                   // reporting cycles
+    unsigned long rtcm_relayed;             // RTCM frames relayed to it
+    unsigned long rtcm_dropped;             // ... lost, queue full or error
+    unsigned long rtcm_filtered;            // ... not of a type it takes
+    unsigned long udp_dropped;              // datagrams the kernel dropped
+    unsigned long udp_truncated;            // ... cut short
+    unsigned long relay_lost;               // relay:// frames never got
+    unsigned long out_written;              // bytes written to it
+    unsigned long out_queued;               // ... that waited in outq
+    unsigned long out_waits;                // times outq was waited out
+    size_t out_max;                         // most bytes in outq
+    // the trace stages of the last packet, CLOCK_MONOTONIC
+    timespec_t read_mono;                   // last read() that got data
+    timespec_t pkt_read;                    // read() that completed it
+    timespec_t pkt_mono;                    // lexer returned it
+    timespec_t parse_mono;                  // end of gpsd_poll()
+    struct latency_t lex;                   // read() to lexer
+    struct latency_t parse;                 // to end of gpsd_poll()
+    struct latency_t report;                // to last client write
+    struct latency_t write;                 // read() to each TPV write()
+};
+
+/* the RTCM relay queue of a device that takes corrections, the frames
+ * are shared by all sinks, see rtcm_relay.c */
+#define RTCM_QUEUE              8       // frames queued per sink
+#define RTCM_FILTER             16      // message types a sink can select
+struct rtcm_frame_t;
+struct rtcm_sink_t {
+    struct rtcm_frame_t *queue[RTCM_QUEUE];
+    int first;                          // index of the oldest frame
+    int count;                          // frames queued
+    size_t offset;                      // bytes of the oldest one written
+    int ntypes;                         // 0 takes all types
+    unsigned short types[RTCM_FILTER];  // the message types it takes
+};
+
+/* the output queue of a device, what gpsd_serial_write() could not
+ * write at once, see serial.c */
+#define SERIAL_OUTQ             4096    // bytes queued per device
+struct serial_outq_t {
+    size_t first;                       // offset of the oldest byte
+    size_t len;                         // bytes queued
+    char buf[SERIAL_OUTQ];
+};
+
+/* name lookup state of a network source, tcp://, ntrip:// or dgpsip://.
+ * The daemon resolves names in the resolver thread of net_async.c,
+ * the answer is kept for reconnects. */
+#define NETCONN_ADDRS           4       // addresses kept per lookup
+struct netconn_t {
+    char host[GPS_PATH_MAX];
+    char service[32];
+    bool resolving;                     // lookup queued, or running
+    unsigned gen;                       // of the lookup, drops stale answers
+    int status;                         // 0, or NL_* of the last lookup
+    time_t resolved;                    // time of the last lookup
+    int naddrs;
+    int addr;                           // the one connect() is trying
+    socklen_t addrlen[NETCONN_ADDRS];
+    struct sockaddr_storage addrs[NETCONN_ADDRS];
+};
+
+// the datagrams of a udp:// source read by one recvmmsg(), see packet.c
+struct udp_batch_t {
+    unsigned char slot[UDP_BATCH][UDP_SLOT];
+    size_t len[UDP_BATCH];
+    unsigned next;                      // the first not yet taken
+    unsigned count;                     // datagrams read
+};
+
+/* per subscriber ?WATCH rate control, one minimum interval per class.
+ * An interval of 0 reports every update. */
+#define WATCH_RATE_TPV          0       // TPV, and ATT which rides with it
+#define WATCH_RATE_SKY          1
+#define WATCH_RATE_GST          2
+#define WATCH_RATE_IMU          3
+#define WATCH_RATE_RAW          4
+#define WATCH_RATE_CLASSES      5
+// a report this fraction of an interval early is still due, absorbs jitter
+#define WATCH_RATE_SLACK        0.1
+
+struct watch_rate_t {
+    double interval[WATCH_RATE_CLASSES];    // seconds, 0 is unlimited
+    bool coalesce;          // send held back classes as soon as they are due
+    bool limited;           // any interval set
+};
+
+/* the fields of a ?WATCH that are not in its gps_policy_t, how a
+ * subscriber wants its reports.  json_watch_read() takes them in the
+ * same pass, and every ?WATCH resets them. */
+struct watch_request_t {
+    struct watch_rate_t rate;
+    unsigned int skip;          // the GPS_CLASS_* not to send
+    bool binary;
+    bool trace;
+    bool relay;                 // from a relay:// feed
+    unsigned long resume;       // ... the last frame it got
+};
+
+// leap month decision, cached by UTC day
+struct leap_cache_t {
+    time_t day;                 // days since the epoch
+    bool leap_month;            // June or December
+};
+
 struct gps_device_t;
+struct flightrec_t;
+struct capture_t;
+struct netasync_t;
+struct devasync_t;
 
 struct gps_context_t {
     int valid;                          // member validity flags
@@ -339,6 +521,11 @@ struct gps_context_t {
     // if true, remove fix gate to time, for some RTC backed receivers.
     // DANGEROUS
     bool batteryRTC;
+    // if true, coalesce chrony SOCK clock samples into one sendmmsg()
+    bool batch_refclock;
+    // if true, queue what devices do not take at once, see
+    // gpsd_serial_write(), the daemon drains the queues
+    bool async_write;
     speed_t fixed_port_speed;           // Fixed port speed, if non-zero
     char fixed_port_framing[4];         // Fixed port framing, if non-blank
     // DGPS status
@@ -368,6 +555,10 @@ struct gps_context_t {
 #endif
     ssize_t (*serial_write)(struct gps_device_t *,
                             const char *buf, const size_t len);
+    struct flightrec_t *flightrec;      // flight recorder SHM, or NULL
+    const char *capture_dir;            // capture device input here, or NULL
+    struct netasync_t *netasync;        // resolver thread, or NULL
+    struct devasync_t *devasync;        // bring-up workers, or NULL
 };
 
 // state for resolving interleaved Type 24 packets
@@ -505,6 +696,7 @@ typedef enum {SERVICE_UNKNOWN = 0,
               SERVICE_SENSOR,        // local, or network, sensor
               SERVICE_DGPSIP,        // dgpsip://
               SERVICE_NTRIP,         // ntrip://
+              SERVICE_RELAY,         // relay://
 } servicetype_t;
 
 /*
@@ -551,6 +743,22 @@ struct ntrip_stream_t
     int bitrate;
 };
 
+#define NTRIP_MOUNTS    4       // mountpoints of one ntrip:// source
+#define NTRIP_STALE     2       // seconds without data, then fail over
+
+/* a mountpoint of an ntrip:// source that lists several, in priority
+ * order, to fail over between */
+struct ntrip_mount_t
+{
+    struct ntrip_stream_t stream;   // as parsed, then as probed
+    timespec_t sent;                // CLOCK_MONOTONIC, when the GET went
+    timespec_t last;                // CLOCK_MONOTONIC, the last packet
+    double latency;                 // seconds from the GET to the first
+    unsigned long packets;          // packets got from it
+    unsigned long bytes;            // ... and their bytes
+    unsigned long failovers;        // times it was given up on
+};
+
 
 // session object, encapsulates all global state
 struct gps_device_t {
@@ -589,9 +797,30 @@ struct gps_device_t {
     int shm_pps_unit;
     time_t shm_clock_lastsec;         // the last second written to SHM(clock)
     time_t shm_pps_lastsec;           // the last second written to SHM(pps)
+    bool rx_stamped;                  // fd has kernel receive timestamps
+    unsigned rxq_ovfl;                // SO_RXQ_OVFL count last seen
+    struct udp_batch_t *udp;          // udp://, the last batch read
     int chrony_clock_fd;              // for talking to chrony
     int chrony_pps_fd;
+    char chrony_clock_path[GPS_PATH_MAX];   // for batched clock samples
+    struct refclock_count_t shm_clock_count;
+    struct refclock_count_t shm_pps_count;
+    struct refclock_count_t chrony_clock_count;
+    struct refclock_count_t chrony_pps_count;
+    // main thread uses leap_clock, PPS thread uses leap_pps
+    struct leap_cache_t leap_clock;
+    struct leap_cache_t leap_pps;
     volatile struct pps_thread_t pps_thread;
+    struct timestats_t timestats;     // time quality statistics
+    struct devstats_t stats;          // daemon performance counters
+    int flightrec_slot;               // index in the flight recorder
+    struct capture_t *capture;        // raw input capture, or NULL
+    struct netconn_t netconn;         // name lookup of a network source
+    bool connecting;                  // non-blocking connect() on gps_fd
+    bool opening;                     // a bring-up worker has it
+    bool unwanted;                    // removed while opening
+    struct rtcm_sink_t rtcm_sink;     // RTCM relayed to this device
+    struct serial_outq_t outq;        // written, waiting for the device
     /*
      * msgbuf needs to hold the hex decode of inbuffer
      * so msgbuf must be 2x the size of inbuffer
@@ -878,14 +1107,23 @@ struct gps_device_t {
             NTRIP_CONN_ERR,
             NTRIP_CONN_CLOSED,         // connection closed
             NTRIP_CONN_INPROGRESS,     // connection in progress
+            NTRIP_CONN_RESOLVING,      // waiting on the resolver thread
         } conn_state;   // connection state for multi stage connect
         bool works; // marks a working connection, so we try to reconnect once
         bool sourcetable_parse; // have we read the sourcetable header?
+        // the mountpoints, the one in use, mount, is copied to stream
+        struct ntrip_mount_t mounts[NTRIP_MOUNTS];
+        int nmounts;
+        int mount;
     } ntrip;
     // State of a DGPSIP connection
     struct {
         bool reported;
     } dgpsip;
+    // State of a relay:// feed, kept over reconnects
+    struct {
+        unsigned long seq;              // last frame number got, 0 if none
+    } relay;
 };
 
 extern ssize_t packet_get1(struct gps_device_t *);
@@ -960,12 +1198,16 @@ extern void netgnss_report(struct gps_context_t *,
 extern void netgnss_autoconnect(struct gps_context_t *, double, double);
 
 extern socket_t dgpsip_open(struct gps_device_t *, const char *);
+extern int dgpsip_connected(struct gps_device_t *);
 extern void dgpsip_report(struct gps_context_t *,
                          struct gps_device_t *,
                          struct gps_device_t *);
 extern void dgpsip_autoconnect(struct gps_context_t *,
                                double, double, const char *);
 extern socket_t ntrip_open(struct gps_device_t *, char *);
+extern int ntrip_connected(struct gps_device_t *);
+extern socket_t relay_open(struct gps_device_t *, const char *);
+extern int relay_connected(struct gps_device_t *);
 extern void ntrip_report(struct gps_context_t *,
                          struct gps_device_t *,
                          struct gps_device_t *);
@@ -976,6 +1218,9 @@ extern int gpsd_serial_open(struct gps_device_t *);
 extern void gpsd_tty_init(struct gps_device_t *);
 extern ssize_t gpsd_serial_write(struct gps_device_t *,
                                  const char *, const size_t);
+extern size_t gpsd_serial_drain(struct gps_device_t *);
+extern size_t gpsd_serial_flush(struct gps_device_t *);
+extern size_t gpsd_serial_pending(const struct gps_device_t *);
 extern bool gpsd_next_hunt_setting(struct gps_device_t *);
 extern int gpsd_switch_driver(struct gps_device_t *, char *);
 extern void gpsd_set_speed(struct gps_device_t *, speed_t, char, unsigned int);
@@ -1028,6 +1273,9 @@ extern socket_t netlib_connectsock1(int, const char *, const char *,
                                     const char *, int, bool,
                                     char *, size_t);
 // end FIXME
+extern socket_t netlib_connectaddr(const struct sockaddr *, socklen_t,
+                                   char *, size_t);
+#define NL_PENDING      -7      // name lookup in progress, not an error
 extern socket_t netlib_localsocket(const char *, int);
 extern const char *netlib_errstr(const int);
 
@@ -1053,12 +1301,17 @@ extern unsigned int ais_binary_encode(struct ais_t *ais, unsigned char *bits,
 extern void ntrip_close(struct gps_device_t *);
 extern int ntrip_parse_url(const struct gpsd_errout_t *,
                            struct ntrip_stream_t *, const char *);
+extern int ntrip_parse_mounts(const struct gpsd_errout_t *,
+                              struct ntrip_mount_t *, int, const char *);
+extern void ntrip_packet(struct gps_device_t *);
+extern bool ntrip_stale(struct gps_device_t *);
 extern void ntp_latch(struct gps_device_t *device,  struct timedelta_t *td);
 extern void ntpshm_context_init(struct gps_context_t *);
 extern void ntpshm_session_init(struct gps_device_t *);
 extern void ntpshm_put(struct gps_device_t *, int unit, int precision,
                        struct timedelta_t *);
 extern void chrony_send(struct gps_device_t *, int fd, struct timedelta_t *);
+extern void chrony_flush(struct gps_context_t *, bool);
 extern void ntpshm_link_deactivate(struct gps_device_t *);
 extern void ntpshm_link_activate(struct gps_device_t *);
 
@@ -1084,6 +1337,139 @@ extern bool shm_acquire(struct gps_context_t *);
 extern void shm_release(struct gps_context_t *);
 extern void shm_update(struct gps_context_t *, struct gps_data_t *);
 
+// flightrec.c, see flightrec.h
+extern bool flightrec_acquire(struct gps_context_t *);
+extern void flightrec_release(struct gps_context_t *);
+extern void flightrec_open(struct gps_device_t *);
+extern void flightrec_record(struct gps_device_t *, int, uint64_t,
+                             const void *, size_t);
+// record an event, if the recorder is on, packet_get() has no context
+#define FLIGHTREC(session, event, arg, data, len)                       \
+    do {                                                                \
+        if (unlikely(NULL != (session)->context &&                      \
+                     NULL != (session)->context->flightrec &&           \
+                     !(session)->opening)) {                            \
+            flightrec_record(session, event, (uint64_t)(arg), data, len); \
+        }                                                               \
+    } while (0)
+
+// capture.c, see capture.h
+extern void capture_open(struct gps_device_t *, const char *);
+extern void capture_write(struct gps_device_t *, const void *, size_t);
+extern void capture_close(struct gps_device_t *);
+// capture the bytes of a read(), if capture is on
+#define CAPTURE(session, data, len)                                     \
+    do {                                                                \
+        if (unlikely(NULL != (session)->capture)) {                     \
+            capture_write(session, data, len);                          \
+        }                                                               \
+    } while (0)
+
+// net_async.c, name lookups off the main loop
+extern int netasync_init(struct gps_context_t *,
+                         void (*)(struct gps_device_t *));
+extern socket_t netasync_connectsock(struct gps_device_t *, const char *,
+                                     const char *, char *, size_t);
+extern void netasync_poll(struct gps_context_t *);
+extern int netasync_connected(struct gps_device_t *);
+
+// dev_async.c, device bring-up off the main loop
+extern int devasync_init(struct gps_context_t *,
+                         void (*)(struct gps_device_t *, int));
+extern bool devasync_open(struct gps_device_t *, const int);
+extern void devasync_poll(struct gps_context_t *);
+extern void devasync_wait(struct gps_context_t *);
+
+// rtcm_relay.c, RTCM from sources to the devices that take it
+extern void rtcm_relay(struct gps_device_t *, struct gps_device_t *, int);
+extern void rtcm_relay_drain(struct gps_device_t *);
+extern void rtcm_relay_flush(struct gps_device_t *);
+extern int rtcm_relay_filter(struct rtcm_sink_t *, const char *);
+
+// gpsd_json.c, names of the *_PACKET types
+extern const char *packet_type_names[PACKET_TYPES];
+
+// metricsexport.c
+#define METRICS_MAX     65536           // largest metrics page
+// daemon wide counters, for ?STATS and the metrics page
+struct metrics_daemon_t {
+    int clients;                // connected, filled in for the page
+    int watchers;               // ... with a ?WATCH enabled
+    unsigned long wakeups;      // returns from gpsd_await_data()
+    unsigned long timeouts;     // ... with nothing to read
+    unsigned long accepted;     // client connections
+    unsigned long detached;     // client disconnections
+    unsigned long written;      // bytes written to clients
+    unsigned long eagain;       // client writes that would have blocked
+};
+extern size_t metrics_http(const char *, const struct metrics_daemon_t *,
+                           const struct gps_device_t *, int, char *, size_t);
+
+// ntripcaster.c, the -c NTRIP caster
+#define CASTER_ROVERS   8               // rovers served at once
+#define CASTER_BACKLOG  8192            // bytes queued for a slow rover
+#define CASTER_TIMEOUT  10              // seconds a rover may make no progress
+struct caster_rover_t {
+    socket_t fd;                // -1 if unused
+    bool streaming;             // sending the frames of mount
+    bool chunked;               // NTRIP 2.0, chunked transfer encoding
+    bool closing;               // close once the backlog is written
+    time_t since;               // accepted, or last write progress
+    unsigned long frames;       // RTCM3 frames sent
+    unsigned long dropped;      // ... lost, the backlog was full
+    char mount[GPS_PATH_MAX];
+    size_t len;                 // bytes in buf
+    char buf[CASTER_BACKLOG];   // the request, then the backlog
+};
+extern void caster_mountpoint(const struct gps_device_t *, char *, size_t);
+extern bool caster_read(struct caster_rover_t *, const struct gps_device_t *,
+                        int, const struct gpsd_errout_t *);
+extern bool caster_frame(struct caster_rover_t *, const unsigned char *,
+                         size_t);
+extern bool caster_flush(struct caster_rover_t *);
+
+// udpout.c, the -U report publisher
+#define UDPOUT_DESTS    16              // -U destinations
+extern int udpout_add(const char *, const struct gpsd_errout_t *);
+extern void udpout_report(struct gps_device_t *, gps_mask_t);
+extern void udpout_stats(char *, size_t);
+
+// relay.c, the numbered frames for relay:// feeds
+#define RELAY_BACKLOG   (64 * 1024)     // bytes of frames kept to resume
+extern void relay_start(void);
+extern unsigned long relay_report(struct gps_device_t *, gps_mask_t, int);
+extern unsigned long relay_forward(const struct gps_device_t *);
+extern const char *relay_replay(unsigned long *, size_t *);
+
+// frontend.c, the -W client front ends
+#define FRONTENDS_MAX   16              // -W front ends
+struct frontend_hooks_t {
+    // core: a request of a client of a front end, only the core can do
+    void (*request)(int, int, int, bool, const char *);
+    // front end: report what changed in a device the core published
+    void (*report)(struct gps_device_t *, gps_mask_t);
+    // front end: a notify_watchers() of the core
+    void (*message)(struct gps_device_t *, bool, bool, unsigned int,
+                    const char *);
+    // front end: the answer of the core to a request of a client
+    void (*reply)(int, int, const char *);
+};
+extern int frontend_init(int, struct gps_context_t *, struct gps_device_t *,
+                         int, const struct frontend_hooks_t *);
+extern pid_t frontend_fork(int);
+extern void frontend_report(struct gps_device_t *, gps_mask_t);
+extern void frontend_message(struct gps_device_t *, bool, bool, unsigned int,
+                             const char *);
+extern void frontend_reply(int, int, int, const char *);
+extern void frontend_wake(void);
+extern void frontend_requests(void);
+extern void frontend_stop(void);
+extern int frontend_wakefd(void);
+extern bool frontend_forward(int, int, bool, const char *, size_t);
+extern bool frontend_read(void);
+extern bool frontend_open(const struct gps_device_t *);
+extern bool frontend_device_dump(const struct gps_device_t *, char *, size_t);
+
 // dbusexport.c
 #if defined(DBUS_EXPORT_ENABLE)
 int initialize_dbus_connection (void);
@@ -1107,6 +1493,7 @@ extern int gpsd_open(struct gps_device_t *);
 #define O_PROBEONLY     1
 #define O_OPTIMIZE      2
 extern int gpsd_activate(struct gps_device_t *, const int);
+extern int gpsd_activate1(struct gps_device_t *, const int);
 extern void gpsd_deactivate(struct gps_device_t *);
 
 #define AWAIT_TIMEOUT 2
@@ -1114,12 +1501,14 @@ extern void gpsd_deactivate(struct gps_device_t *);
 #define AWAIT_NOT_READY 0
 #define AWAIT_FAILED    -1
 extern int gpsd_await_data(fd_set *,
+                           fd_set *,
                            fd_set *,
                            int,
                            fd_set *,
                            struct gpsd_errout_t *,
                            timespec_t);
 extern gps_mask_t gpsd_poll(struct gps_device_t *);
+extern void gpsd_latency_add(struct latency_t *, const timespec_t *);
 #define DEVICE_EOF      -3
 #define DEVICE_ERROR    -2
 #define DEVICE_UNREADY  -1
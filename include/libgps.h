@@ -21,6 +21,8 @@ extern int gps_sock_open(const char *, const char *, struct gps_data_t *);
 extern int gps_sock_close(struct gps_data_t *);
 extern int gps_sock_send(struct gps_data_t *, const char *);
 extern int gps_sock_read(struct gps_data_t *, char *message, int message_len);
+extern int gps_sock_read_batch(struct gps_data_t *,
+                               void (*)(struct gps_data_t *));
 extern bool gps_sock_waiting(const struct gps_data_t *, int);
 extern int gps_sock_stream(struct gps_data_t *, unsigned int, const char *);
 extern const char *gps_sock_data(const struct gps_data_t *);
@@ -42,8 +44,10 @@ extern int json_ais_read(const char *, char *, size_t, struct ais_t *,
 // debugging apparatus for the client library
 #define DEBUG_CALLS     1       // shallowest debug level
 #define DEBUG_JSON      5       // minimum level for verbose JSON debugging
-#define libgps_debug_trace(args) (void) libgps_trace args
 extern int libgps_debuglevel;
+// skip the call, and evaluating its arguments, when not debugging
+#define libgps_debug_trace(args) \
+    ((0 < libgps_debuglevel) ? (void)libgps_trace args : (void)0)
 extern void libgps_dump_state(struct gps_data_t *);
 
 #ifdef __cplusplus
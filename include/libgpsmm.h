@@ -63,5 +63,75 @@ class gpsmm {
             return to_user;
         };
 };
+
+#if !defined(USE_QT) && 201103L <= __cplusplus
+#include <functional>
+#include <memory>
+
+/* gpsmm_async - event driven client, for your own poll()/epoll loop.
+ *
+ * Put fd() in your loop, call process_ready() when it is readable.
+ * Each complete message is dispatched to the callback of its class.
+ * Callbacks get references into the one gps_data_t owned by the
+ * object, no copies are made.  They stay valid until the next call
+ * of process_ready() or feed().
+ *
+ * Only classes with a callback are decoded, the rest are skipped
+ * after a look at the class tag, unless decode_all(true).
+ *
+ * Movable, not copyable.  A moved-from object is closed: fd() is -1,
+ * process_ready() and feed() return -1, data() is all zero.
+ */
+class gpsmm_async {
+    public:
+        typedef std::function<void(const struct gps_fix_t &)> tpv_cb;
+        typedef std::function<void(const struct gps_data_t &)> sky_cb;
+        typedef std::function<void(const struct attitude_t &)> att_cb;
+        typedef std::function<void(const struct ais_t &)> ais_cb;
+
+        // not connected, use feed() to decode JSON from elsewhere
+        gpsmm_async(void);
+        gpsmm_async(const char *host, const char *port);
+        gpsmm_async(gpsmm_async &&other) noexcept;
+        gpsmm_async &operator=(gpsmm_async &&other) noexcept;
+        gpsmm_async(const gpsmm_async &) = delete;
+        gpsmm_async &operator=(const gpsmm_async &) = delete;
+        ~gpsmm_async();
+
+        bool is_open(void) const { return connected; }
+        int fd(void) const;                     // -1 when not connected
+        bool stream(int flags);                 // set watcher and policy
+        bool send(const char *request);
+        // read what is waiting, without blocking, and dispatch it.
+        // Return messages dispatched, or -1 on error or disconnect.
+        int process_ready(void);
+        // dispatch complete lines from buf, keep any partial line
+        int feed(const char *buf, size_t len);
+        // last decoded state, set holds only what the last message changed
+        const struct gps_data_t &data(void) const;
+        void decode_all(bool all) { all_classes = all; }
+
+        void on_tpv(tpv_cb cb) { tpv = std::move(cb); }
+        void on_sky(sky_cb cb) { sky = std::move(cb); }
+        void on_att(att_cb cb) { att = std::move(cb); }
+        void on_ais(ais_cb cb) { ais = std::move(cb); }
+    private:
+        std::unique_ptr<struct gps_data_t> state;
+        std::unique_ptr<char[]> inbuf;  // incoming, 2 * GPS_JSON_RESPONSE_MAX
+        size_t start;                   // first byte not yet dispatched
+        size_t end;                     // one past the last byte received
+        bool discarding;                // in a line too long, drop to '\n'
+        bool connected;
+        bool all_classes;
+        tpv_cb tpv;
+        sky_cb sky;
+        att_cb att;
+        ais_cb ais;
+
+        void release(void);
+        int dispatch(void);
+};
+#endif  // USE_QT, C++11
+
 #endif // _GPSD_GPSMM_H_
 // vim: set expandtab shiftwidth=4
@@ -251,6 +251,16 @@
    JSON_SPECIAL,          // inside a JSON special literal (true,false,null)
    JSON_RECOGNIZED,       // JSON packet recognized
 
+   GPSB_LEADER_1,         // first leader byte found
+   GPSB_LEADER_2,         // second leader byte found
+   GPSB_CLASS_ID,         // class read
+   GPSB_VERSION_ID,       // version read
+   GPSB_LENGTH_1,         // first length byte read (le)
+   GPSB_LENGTH_2,         // second length byte read (le)
+   GPSB_LENGTH_3,         // third length byte read (le)
+   GPSB_PAYLOAD,          // gathering items
+   GPSB_RECOGNIZED,       // binary report frame recognized
+
 #ifdef STASH_ENABLE
    STASH_RECOGNIZED,      // stashable prefix recognized
 #endif
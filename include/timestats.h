@@ -0,0 +1,76 @@
+/*
+ * timestats.h - incremental time quality statistics, per device
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ *
+ * Each series is fed at most one offset sample (real - clock) per
+ * second.  Allan and time deviation are estimated from a cascade of
+ * octave spaced decimators, so memory is O(log(tau)), not O(tau).
+ * The estimators are the non-overlapping ones.
+ */
+
+#ifndef TIMESTATS_H
+#define TIMESTATS_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#ifndef TIMEDELTA_DEFINED
+#define TIMEDELTA_DEFINED
+struct timedelta_t {
+    struct timespec     real;
+    struct timespec     clock;
+};
+#endif  // TIMEDELTA_DEFINED
+
+#define TSTATS_LEVELS       11      // taus 1, 2, 4, ... 1024 seconds
+#define TSTATS_JITTER_BINS  20      // <1 uS, then octaves of uS
+// gaps longer than this, in seconds, are a restart, not missed pulses
+#define TSTATS_MAX_GAP      3600
+
+// one octave of the Allan/TDEV decimator cascade
+struct tstats_level_t {
+    double pend_x;          // phase waiting for its pair
+    double pend_m;          // block mean waiting for its pair
+    bool have_pend;
+    unsigned nlast;         // valid entries in x[] and m[], 0 to 2
+    double x[2];            // last two decimated phase samples, seconds
+    double m[2];            // last two block means, seconds
+    double sum_x;           // sum of squared 2nd differences of x
+    double sum_m;           // sum of squared 2nd differences of m
+    unsigned long n;        // number of 2nd differences summed
+};
+
+struct tstats_series_t {
+    unsigned long count;    // samples accepted
+    unsigned long missed;   // one second slots without a sample
+    time_t last_sec;        // real second of the last sample
+    int64_t ref_ns;         // phase reference, first offset after restart
+    double last;            // last offset, seconds
+    double sum;             // sum of offsets, seconds
+    double sumsq;           // sum of squared offsets, seconds^2
+    double min;
+    double max;
+    // |offset(n) - offset(n-1)|, bin 0 < 1 uS, bin i < 2^i uS
+    unsigned long jitter[TSTATS_JITTER_BINS];
+    struct tstats_level_t level[TSTATS_LEVELS];
+};
+
+struct timestats_t {
+    struct tstats_series_t toff;    // in-band time, from ntp_latch()
+    struct tstats_series_t pps;     // PPS edges, from the PPS thread
+    struct tstats_series_t ppsq;    // PPS edges corrected by qErr
+};
+
+extern void timestats_toff(struct timestats_t *, const struct timedelta_t *);
+extern void timestats_pps(struct timestats_t *, const struct timedelta_t *,
+                          long, const struct timespec *);
+extern void timestats_snapshot(const struct timestats_t *,
+                               struct timestats_t *);
+extern double tstats_adev(const struct tstats_series_t *, int);
+extern double tstats_tdev(const struct tstats_series_t *, int);
+
+#endif  // TIMESTATS_H
+// vim: set expandtab shiftwidth=4
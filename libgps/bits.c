@@ -133,6 +133,22 @@ double getbed64(const char *buf, int off)
     return l_d.d;
 }
 
+void putlef32(char *buf, int off, float val)
+{
+    union int_float i_f;
+
+    i_f.f = val;
+    putle32(buf, off, i_f.i);
+}
+
+void putled64(char *buf, int off, double val)
+{
+    union long_double l_d;
+
+    l_d.d = val;
+    putle64(buf, off, l_d.l);
+}
+
 void putbef32(char *buf, int off, float val)
 {
     union int_float i_f;
@@ -133,6 +133,27 @@ void errout_reset(struct gpsd_errout_t *errout) {
     errout->report = basic_report;
 }
 
+/* packet.c records to the flight recorder, FFI devices never have one,
+ * see FLIGHTREC() */
+void flightrec_record(struct gps_device_t *session, int event, uint64_t arg,
+                      const void *data, size_t len)
+{
+    (void)session;
+    (void)event;
+    (void)arg;
+    (void)data;
+    (void)len;
+}
+
+// nor a raw input capture, see CAPTURE()
+void capture_write(struct gps_device_t *session, const void *data,
+                   size_t len)
+{
+    (void)session;
+    (void)data;
+    (void)len;
+}
+
 /* Export structure sizes for FFI. Two of these are unused now.
  * Pythons gps.packet.lexer_t storage class needs fvi_size_buffer */
 const size_t fvi_size_device = sizeof(struct gps_device_t);
@@ -107,7 +107,113 @@ static void json_trace(int errlevel, const char *fmt, ...)
     }
 }
 
-#define json_debug_trace(args) (void) json_trace args
+// skip the call, and evaluating its arguments, when not debugging
+#define json_debug_trace(args) \
+    ((0 < debuglevel) ? (void)json_trace args : (void)0)
+
+/* Attribute name index, built once per parse of an object.
+ *
+ * Attribute tables are mostly automatic arrays, filled with new
+ * target addresses on each call, so an index can not be kept across
+ * calls without locking.  Building one is a single pass over the
+ * table, lookups are then a short hash chain instead of a strcmp()
+ * against every entry before the match. */
+#define JSON_INDEX_BUCKETS  64          // power of 2
+#define JSON_INDEX_MAX      256         // larger tables are scanned
+#define JSON_INDEX_NONE     0xffff
+
+struct json_index_t {
+    bool valid;                         // false: table too large
+    unsigned short count;               // entries, index of the terminator
+    unsigned short wildcard;            // first "" t_ignore entry
+    unsigned short head[JSON_INDEX_BUCKETS];
+    unsigned short next[JSON_INDEX_MAX];    // chains in table order
+};
+
+static unsigned json_index_hash(const char *name)
+{
+    unsigned h = 0;
+
+    while ('\0' != *name) {
+        h = h * 31 + (unsigned char)*name++;
+    }
+    return h & (JSON_INDEX_BUCKETS - 1);
+}
+
+static void json_index_build(const struct json_attr_t *attrs,
+                             struct json_index_t *index)
+{
+    unsigned short tail[JSON_INDEX_BUCKETS];
+    unsigned i;
+
+    for (i = 0; i < JSON_INDEX_BUCKETS; i++) {
+        index->head[i] = JSON_INDEX_NONE;
+    }
+    index->wildcard = JSON_INDEX_NONE;
+    index->valid = false;
+    for (i = 0; NULL != attrs[i].attribute; i++) {
+        unsigned h;
+
+        if (JSON_INDEX_MAX <= i) {
+            return;
+        }
+        if (t_ignore == attrs[i].type &&
+            '\0' == attrs[i].attribute[0] &&
+            JSON_INDEX_NONE == index->wildcard) {
+            index->wildcard = i;
+        }
+        h = json_index_hash(attrs[i].attribute);
+        index->next[i] = JSON_INDEX_NONE;
+        if (JSON_INDEX_NONE == index->head[h]) {
+            index->head[h] = i;
+        } else {
+            index->next[tail[h]] = i;
+        }
+        tail[h] = i;
+    }
+    index->count = i;
+    index->valid = true;
+}
+
+/* find the first entry matching name, or the first "" t_ignore entry,
+ * whichever comes first, like a scan of the table would.
+ * Return the terminator if neither. */
+static const struct json_attr_t *
+json_index_find(const struct json_attr_t *attrs,
+                const struct json_index_t *index, const char *name)
+{
+    const struct json_attr_t *cursor;
+    unsigned found, i;
+
+    if (!index->valid) {
+        for (cursor = attrs; cursor->attribute != NULL; cursor++) {
+            json_debug_trace((2, "Checking against %s\n",
+                              cursor->attribute));
+            if (strcmp(cursor->attribute, name) == 0) {
+                break;
+            }
+            if (cursor->type == t_ignore &&
+                strncmp(cursor->attribute, "", 1) == 0) {
+                break;
+            }
+        }
+        return cursor;
+    }
+
+    found = index->count;
+    for (i = index->head[json_index_hash(name)];
+         JSON_INDEX_NONE != i;
+         i = index->next[i]) {
+        if (0 == strcmp(attrs[i].attribute, name)) {
+            found = i;
+            break;
+        }
+    }
+    if (index->wildcard < found) {
+        found = index->wildcard;
+    }
+    return &attrs[found];
+}
 
 static char *json_target_address(const struct json_attr_t *cursor,
                                  const struct json_array_t
@@ -202,6 +308,7 @@ static int json_internal_read_object(const char *cp,
     unsigned int u;
     const struct json_enum_t *mp;
     char *lptr;
+    struct json_index_t index;
 
     if (NULL != end) {
         *end = NULL;    // give it a well-defined value on parse failure
@@ -274,6 +381,8 @@ static int json_internal_read_object(const char *cp,
                 }
         }
 
+    json_index_build(attrs, &index);
+
     json_debug_trace((1, "JSON parse of '%s' begins.\n", cp));
 
     // parse input JSON
@@ -325,17 +434,7 @@ static int json_internal_read_object(const char *cp,
                 *pattr++ = '\0';
                 json_debug_trace((1, "Collected attribute name %s\n",
                                   attrbuf));
-                for (cursor = attrs; cursor->attribute != NULL; cursor++) {
-                    json_debug_trace((2, "Checking against %s\n",
-                                      cursor->attribute));
-                    if (strcmp(cursor->attribute, attrbuf) == 0) {
-                        break;
-                    }
-                    if (cursor->type == t_ignore &&
-                        strncmp(cursor->attribute, "", 1) == 0) {
-                        break;
-                    }
-                }
+                cursor = json_index_find(attrs, &index, attrbuf);
                 if (NULL == cursor->attribute) {
                     json_debug_trace((1,
                                       "Unknown attribute name '%s'"
@@ -0,0 +1,905 @@
+/*
+ * libgps_binary.c - binary report frames, see gps_binary.h
+ *
+ * gpsd uses the encoders, libgps the decoder.  Both walk the same
+ * field tables, which map the wire tags straight onto gps_fix_t,
+ * satellite_t, meas_t and attitude_t, so they can not disagree.
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+#include "../include/gpsd_config.h"  // must be before all includes
+
+#include <math.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "../include/gpsd.h"
+#include "../include/bits.h"
+#include "../include/gps_binary.h"
+#include "../include/gps_json.h"
+
+struct gpsb_field_t {
+    unsigned char type;         // GPSB_*
+    unsigned char min_mode;     // TPV: fix mode the field needs
+    short dflt;                 // integer types: not sent, and if absent
+    unsigned short size;        // GPSB_STR: size of the buffer
+    size_t offset;
+};
+
+#define GPSB_FIELD(type, st, member, mode, dflt) \
+    {type, mode, dflt, sizeof(((st *)0)->member), offsetof(st, member)}
+
+// value length of each type, GPSB_STR is variable
+static const unsigned char gpsb_type_len[] = {
+    0, 1, 1, 1, 2, 4, 4, 8, 8, 4, 8, 12, 0, 0};
+
+/* The index in a table is the tag on the wire.
+ * Append only, never reorder or remove. */
+
+#define TPV(type, member, mode, dflt) \
+    GPSB_FIELD(type, struct gps_fix_t, member, mode, dflt)
+// *INDENT-OFF*
+static const struct gpsb_field_t tpv_fields[] = {
+    TPV(GPSB_TS,  time,           0,       0),
+    TPV(GPSB_I32, mode,           0,       MODE_NOT_SEEN),
+    TPV(GPSB_I32, status,         0,       STATUS_UNK),
+    TPV(GPSB_F32, ept,            0,       0),
+    TPV(GPSB_F64, latitude,       MODE_2D, 0),
+    TPV(GPSB_F64, longitude,      MODE_2D, 0),
+    TPV(GPSB_F64, altHAE,         MODE_2D, 0),
+    TPV(GPSB_F64, altMSL,         MODE_2D, 0),
+    TPV(GPSB_F32, epx,            MODE_2D, 0),
+    TPV(GPSB_F32, epy,            MODE_2D, 0),
+    TPV(GPSB_F32, epv,            MODE_2D, 0),
+    TPV(GPSB_F32, track,          MODE_2D, 0),
+    TPV(GPSB_F32, magnetic_track, MODE_2D, 0),
+    TPV(GPSB_F32, magnetic_var,   MODE_2D, 0),
+    TPV(GPSB_F32, speed,          MODE_2D, 0),
+    TPV(GPSB_F32, climb,          MODE_3D, 0),
+    TPV(GPSB_F32, epd,            MODE_2D, 0),
+    TPV(GPSB_F32, eps,            MODE_2D, 0),
+    TPV(GPSB_F32, epc,            MODE_3D, 0),
+    TPV(GPSB_F64, ecef.x,         MODE_3D, 0),
+    TPV(GPSB_F64, ecef.y,         MODE_3D, 0),
+    TPV(GPSB_F64, ecef.z,         MODE_3D, 0),
+    TPV(GPSB_F32, ecef.vx,        MODE_3D, 0),
+    TPV(GPSB_F32, ecef.vy,        MODE_3D, 0),
+    TPV(GPSB_F32, ecef.vz,        MODE_3D, 0),
+    TPV(GPSB_F32, ecef.pAcc,      MODE_3D, 0),
+    TPV(GPSB_F32, ecef.vAcc,      MODE_3D, 0),
+    TPV(GPSB_F64, NED.relPosN,    MODE_3D, 0),
+    TPV(GPSB_F64, NED.relPosE,    MODE_3D, 0),
+    TPV(GPSB_F64, NED.relPosD,    MODE_3D, 0),
+    TPV(GPSB_F64, NED.relPosL,    MODE_3D, 0),
+    TPV(GPSB_F64, NED.relPosH,    MODE_3D, 0),
+    TPV(GPSB_F32, NED.velN,       MODE_3D, 0),
+    TPV(GPSB_F32, NED.velE,       MODE_3D, 0),
+    TPV(GPSB_F32, NED.velD,       MODE_3D, 0),
+    TPV(GPSB_F32, geoid_sep,      MODE_3D, 0),
+    TPV(GPSB_F32, eph,            MODE_2D, 0),
+    TPV(GPSB_F32, sep,            MODE_2D, 0),
+    TPV(GPSB_STR, datum,          MODE_2D, 0),
+    TPV(GPSB_F32, depth,          MODE_2D, 0),
+    TPV(GPSB_F32, dgps_age,       MODE_2D, 0),
+    TPV(GPSB_I32, dgps_station,   MODE_2D, -1),
+    TPV(GPSB_I32, base.status,    MODE_2D, STATUS_UNK),
+    TPV(GPSB_F64, base.east,      MODE_2D, 0),
+    TPV(GPSB_F64, base.north,     MODE_2D, 0),
+    TPV(GPSB_F64, base.up,        MODE_2D, 0),
+    TPV(GPSB_F64, base.length,    MODE_2D, 0),
+    TPV(GPSB_F32, base.course,    MODE_2D, 0),
+    TPV(GPSB_F32, base.ratio,     MODE_2D, 0),
+    TPV(GPSB_F32, wanglem,        0,       0),
+    TPV(GPSB_F32, wangler,        0,       0),
+    TPV(GPSB_F32, wanglet,        0,       0),
+    TPV(GPSB_F32, wspeedr,        0,       0),
+    TPV(GPSB_F32, wspeedt,        0,       0),
+    TPV(GPSB_F32, wtemp,          0,       0),
+    TPV(GPSB_F32, temp,           0,       0),
+    TPV(GPSB_I32, ant_stat,       0,       ANT_UNK),
+    TPV(GPSB_I32, jam,            0,       -1),
+    TPV(GPSB_I64, clockbias,      0,       0),
+    TPV(GPSB_I64, clockdrift,     0,       0),
+};
+
+#define SKY(type, member, dflt) \
+    GPSB_FIELD(type, struct gps_data_t, member, 0, dflt)
+static const struct gpsb_field_t sky_fields[] = {
+    SKY(GPSB_TS,  skyview_time,   0),
+    SKY(GPSB_F32, dop.xdop,       0),
+    SKY(GPSB_F32, dop.ydop,       0),
+    SKY(GPSB_F32, dop.pdop,       0),
+    SKY(GPSB_F32, dop.hdop,       0),
+    SKY(GPSB_F32, dop.vdop,       0),
+    SKY(GPSB_F32, dop.tdop,       0),
+    SKY(GPSB_F32, dop.gdop,       0),
+};
+
+#define SAT(type, member, dflt) \
+    GPSB_FIELD(type, struct satellite_t, member, 0, dflt)
+static const struct gpsb_field_t sat_fields[] = {
+    SAT(GPSB_I16,  PRN,           0),
+    SAT(GPSB_U8,   gnssid,        0),
+    SAT(GPSB_U8,   svid,          0),
+    SAT(GPSB_U8,   sigid,         0),
+    SAT(GPSB_I8,   freqid,        -1),
+    SAT(GPSB_F32,  azimuth,       0),
+    SAT(GPSB_F32,  elevation,     0),
+    SAT(GPSB_F64,  pr,            0),
+    SAT(GPSB_F32,  prRate,        0),
+    SAT(GPSB_F32,  prRes,         0),
+    SAT(GPSB_I8,   qualityInd,    -1),
+    SAT(GPSB_F32,  ss,            0),
+    SAT(GPSB_BOOL, used,          0),
+    SAT(GPSB_U8,   health,        SAT_HEALTH_UNK),
+};
+
+#define ATT(type, member, dflt) \
+    GPSB_FIELD(type, struct attitude_t, member, 0, dflt)
+static const struct gpsb_field_t att_fields[] = {
+    ATT(GPSB_TS,  mtime,          0),
+    ATT(GPSB_U64, timeTag,        0),
+    ATT(GPSB_STR, msg,            0),
+    ATT(GPSB_F32, acc_len,        0),
+    ATT(GPSB_F32, acc_x,          0),
+    ATT(GPSB_F32, acc_y,          0),
+    ATT(GPSB_F32, acc_z,          0),
+    ATT(GPSB_F32, depth,          0),
+    ATT(GPSB_F32, dip,            0),
+    ATT(GPSB_F32, gyro_temp,      0),
+    ATT(GPSB_F32, gyro_x,         0),
+    ATT(GPSB_F32, gyro_y,         0),
+    ATT(GPSB_F32, gyro_z,         0),
+    ATT(GPSB_F32, heading,        0),
+    ATT(GPSB_F32, mheading,       0),
+    ATT(GPSB_F32, mag_len,        0),
+    ATT(GPSB_F32, mag_x,          0),
+    ATT(GPSB_F32, mag_y,          0),
+    ATT(GPSB_F32, mag_z,          0),
+    ATT(GPSB_F32, pitch,          0),
+    ATT(GPSB_F32, roll,           0),
+    ATT(GPSB_F32, rot,            0),
+    ATT(GPSB_F32, temp,           0),
+    ATT(GPSB_F32, yaw,            0),
+    ATT(GPSB_I8,  mag_st,         0),
+    ATT(GPSB_I8,  pitch_st,       0),
+    ATT(GPSB_I8,  roll_st,        0),
+    ATT(GPSB_I8,  yaw_st,         0),
+    ATT(GPSB_I32, base.status,    STATUS_UNK),
+    ATT(GPSB_F64, base.east,      0),
+    ATT(GPSB_F64, base.north,     0),
+    ATT(GPSB_F64, base.up,        0),
+    ATT(GPSB_F64, base.length,    0),
+    ATT(GPSB_F32, base.course,    0),
+    ATT(GPSB_F32, base.ratio,     0),
+};
+
+static const struct gpsb_field_t raw_fields[] = {
+    GPSB_FIELD(GPSB_TS, struct rawdata_t, mtime, 0, 0),
+};
+
+#define MEAS(type, member, dflt) \
+    GPSB_FIELD(type, struct meas_t, member, 0, dflt)
+static const struct gpsb_field_t meas_fields[] = {
+    MEAS(GPSB_U8,  gnssid,        0),
+    MEAS(GPSB_U8,  svid,          0),
+    MEAS(GPSB_U8,  sigid,         0),
+    MEAS(GPSB_U8,  snr,           0),
+    MEAS(GPSB_U8,  freqid,        0),
+    MEAS(GPSB_U8,  lli,           0),
+    MEAS(GPSB_STR, obs_code,      0),
+    MEAS(GPSB_F64, codephase,     0),
+    MEAS(GPSB_F64, carrierphase,  0),
+    MEAS(GPSB_F64, pseudorange,   0),
+    MEAS(GPSB_F64, deltarange,    0),
+    MEAS(GPSB_F64, doppler,       0),
+    MEAS(GPSB_U32, locktime,      0),
+    MEAS(GPSB_F64, l2c,           0),
+    MEAS(GPSB_F64, c2c,           0),
+    MEAS(GPSB_U32, satstat,       0),
+};
+// *INDENT-ON*
+
+/* Append the fields of base that are not at their default.
+ * Return: the new end, NULL if they do not fit */
+static char *gpsb_put_fields(const struct gpsb_field_t *fields,
+                             size_t nfields, const void *base, int mode,
+                             char *p, const char *end)
+{
+    size_t tag;
+
+    for (tag = 0; tag < nfields; tag++) {
+        const struct gpsb_field_t *f = &fields[tag];
+        const char *src = (const char *)base + f->offset;
+        size_t len = gpsb_type_len[f->type];
+        long long ival = 0;
+        double dval = 0.0;
+        const timespec_t *ts = NULL;
+
+        if (mode < f->min_mode) {
+            continue;
+        }
+        switch (f->type) {
+        case GPSB_BOOL:
+            ival = *(const bool *)src;
+            break;
+        case GPSB_U8:
+            ival = *(const unsigned char *)src;
+            break;
+        case GPSB_I8:
+            ival = *(const signed char *)src;
+            break;
+        case GPSB_I16:
+            ival = *(const int16_t *)src;
+            break;
+        case GPSB_I32:
+            ival = *(const int *)src;
+            break;
+        case GPSB_U32:
+            ival = *(const unsigned *)src;
+            break;
+        case GPSB_I64:
+            ival = *(const long *)src;
+            break;
+        case GPSB_U64:
+            ival = (long long)*(const unsigned long *)src;
+            break;
+        case GPSB_F32:
+            // FALLTHROUGH
+        case GPSB_F64:
+            dval = *(const double *)src;
+            if (0 == isfinite(dval)) {
+                continue;
+            }
+            break;
+        case GPSB_TS:
+            ts = (const timespec_t *)src;
+            if (0 == ts->tv_sec &&
+                0 == ts->tv_nsec) {
+                continue;
+            }
+            break;
+        case GPSB_STR:
+            len = strnlen(src, f->size);
+            if (0 == len) {
+                continue;
+            }
+            if (255 < len) {
+                len = 255;
+            }
+            len++;
+            break;
+        default:
+            continue;
+        }
+        if (GPSB_F32 > f->type &&
+            f->dflt == ival) {
+            continue;
+        }
+        if (end - p < (ptrdiff_t)(2 + len)) {
+            return NULL;
+        }
+        p[0] = (char)tag;
+        p[1] = (char)f->type;
+        switch (f->type) {
+        case GPSB_BOOL:
+            // FALLTHROUGH
+        case GPSB_U8:
+            // FALLTHROUGH
+        case GPSB_I8:
+            putbyte(p, 2, ival);
+            break;
+        case GPSB_I16:
+            putle16(p, 2, ival);
+            break;
+        case GPSB_I32:
+            // FALLTHROUGH
+        case GPSB_U32:
+            putle32(p, 2, ival);
+            break;
+        case GPSB_I64:
+            // FALLTHROUGH
+        case GPSB_U64:
+            putle64(p, 2, ival);
+            break;
+        case GPSB_F32:
+            putlef32(p, 2, (float)dval);
+            break;
+        case GPSB_F64:
+            putled64(p, 2, dval);
+            break;
+        case GPSB_TS:
+            putle64(p, 2, ts->tv_sec);
+            putle32(p, 10, ts->tv_nsec);
+            break;
+        case GPSB_STR:
+            putbyte(p, 2, len - 1);
+            memcpy(p + 3, src, len - 1);
+            break;
+        }
+        p += 2 + len;
+    }
+    return p;
+}
+
+// append a common tag
+static char *gpsb_put_tag(char *p, const char *end, unsigned char tag,
+                          unsigned char type, long ival, const char *str)
+{
+    size_t len = gpsb_type_len[type];
+
+    if (GPSB_STR == type) {
+        len = strnlen(str, 255) + 1;
+    }
+    if (NULL == p ||
+        end - p < (ptrdiff_t)(2 + len)) {
+        return NULL;
+    }
+    p[0] = (char)tag;
+    p[1] = (char)type;
+    if (GPSB_I32 == type) {
+        putle32(p, 2, ival);
+    } else if (GPSB_STR == type) {
+        putbyte(p, 2, len - 1);
+        memcpy(p + 3, str, len - 1);
+    }
+    return p + 2 + len;
+}
+
+// start a frame, with the device path
+static char *gpsb_start(const struct gps_data_t *gpsdata, int cls,
+                        char *buf, size_t buflen)
+{
+    if (GPSB_HEADER > buflen) {
+        return NULL;
+    }
+    putbyte(buf, 0, GPSB_SYNC1);
+    putbyte(buf, 1, GPSB_SYNC2);
+    putbyte(buf, 2, cls);
+    putbyte(buf, 3, GPSB_VERSION);
+    if ('\0' == gpsdata->dev.path[0]) {
+        return buf + GPSB_HEADER;
+    }
+    return gpsb_put_tag(buf + GPSB_HEADER, buf + buflen, GPSB_TAG_DEVICE,
+                        GPSB_STR, 0, gpsdata->dev.path);
+}
+
+// finish a frame, return its length, 0 if it did not fit
+static size_t gpsb_finish(char *buf, const char *p)
+{
+    if (NULL == p) {
+        return 0;
+    }
+    putle32(buf, 4, p - buf - GPSB_HEADER);
+    return (size_t)(p - buf);
+}
+
+// encode a TPV, leap is the leap seconds, negative if unknown
+size_t gpsb_tpv_dump(const struct gps_data_t *gpsdata, int leap,
+                     char *buf, size_t buflen)
+{
+    const char *end = buf + buflen;
+    char *p = gpsb_start(gpsdata, GPSB_TPV, buf, buflen);
+
+    if (NULL != p &&
+        0 <= leap) {
+        p = gpsb_put_tag(p, end, GPSB_TAG_LEAP, GPSB_I32, leap, NULL);
+    }
+    if (NULL != p) {
+        p = gpsb_put_fields(tpv_fields, ROWS(tpv_fields), &gpsdata->fix,
+                            gpsdata->fix.mode, p, end);
+    }
+    return gpsb_finish(buf, p);
+}
+
+/* encode a SKY.  Satellites that do not fit are left out,
+ * like the JSON it never exceeds the buffer */
+size_t gpsb_sky_dump(const struct gps_data_t *gpsdata,
+                     char *buf, size_t buflen)
+{
+    const char *end = buf + buflen;
+    char *p = gpsb_start(gpsdata, GPSB_SKY, buf, buflen);
+    int i, reported = 0;
+
+    if (NULL != p) {
+        p = gpsb_put_fields(sky_fields, ROWS(sky_fields), gpsdata, 0,
+                            p, end);
+    }
+    if (NULL == p ||
+        0 == (gpsdata->set & SATELLITE_SET)) {
+        return gpsb_finish(buf, p);
+    }
+    for (i = 0; i < gpsdata->satellites_visible; i++) {
+        if (0 != gpsdata->skyview[i].PRN) {
+            reported++;
+        }
+    }
+    p = gpsb_put_tag(p, end, GPSB_TAG_NSAT, GPSB_I32, reported, NULL);
+    for (i = 0; NULL != p && i < gpsdata->satellites_visible; i++) {
+        char *sat;
+
+        if (0 == gpsdata->skyview[i].PRN) {
+            // blank slot
+            continue;
+        }
+        sat = gpsb_put_tag(p, end, GPSB_TAG_NEXT, GPSB_NEXT, 0, NULL);
+        if (NULL != sat) {
+            sat = gpsb_put_fields(sat_fields, ROWS(sat_fields),
+                                  &gpsdata->skyview[i], 0, sat, end);
+        }
+        if (NULL == sat) {
+            // full, end on the last whole satellite
+            break;
+        }
+        p = sat;
+    }
+    return gpsb_finish(buf, p);
+}
+
+// encode an ATT or IMU, cls is GPSB_ATT or GPSB_IMU
+size_t gpsb_att_dump(const struct gps_data_t *gpsdata,
+                     const struct attitude_t *att, int cls,
+                     char *buf, size_t buflen)
+{
+    char *p = gpsb_start(gpsdata, cls, buf, buflen);
+
+    if (NULL != p) {
+        p = gpsb_put_fields(att_fields, ROWS(att_fields), att, 0,
+                            p, buf + buflen);
+    }
+    return gpsb_finish(buf, p);
+}
+
+// encode a RAW, measurements that do not fit are left out
+size_t gpsb_raw_dump(const struct gps_data_t *gpsdata,
+                     char *buf, size_t buflen)
+{
+    const char *end = buf + buflen;
+    char *p;
+    int i;
+
+    if (0 == gpsdata->raw.mtime.tv_sec) {
+        // no data to dump
+        return 0;
+    }
+    p = gpsb_start(gpsdata, GPSB_RAW, buf, buflen);
+    if (NULL != p) {
+        p = gpsb_put_fields(raw_fields, ROWS(raw_fields), &gpsdata->raw, 0,
+                            p, end);
+    }
+    for (i = 0; NULL != p && i < MAXCHANNELS; i++) {
+        char *meas;
+
+        if (0 == gpsdata->raw.meas[i].svid ||
+            255 == gpsdata->raw.meas[i].svid) {
+            // skip empty and GLONASS 255
+            continue;
+        }
+        meas = gpsb_put_tag(p, end, GPSB_TAG_NEXT, GPSB_NEXT, 0, NULL);
+        if (NULL != meas) {
+            meas = gpsb_put_fields(meas_fields, ROWS(meas_fields),
+                                   &gpsdata->raw.meas[i], 0, meas, end);
+        }
+        if (NULL == meas) {
+            break;
+        }
+        p = meas;
+    }
+    return gpsb_finish(buf, p);
+}
+
+/* Length of the frame at the start of buf, avail bytes long.
+ * Return: the whole length, 0 if it is not all there yet,
+ *         -1 if it is not a frame this version can read */
+int gpsb_frame_len(const char *buf, size_t avail)
+{
+    unsigned long len;
+
+    if (GPSB_HEADER > avail) {
+        return 0;
+    }
+    if (GPSB_SYNC1 != getub(buf, 0) ||
+        GPSB_SYNC2 != getub(buf, 1) ||
+        GPSB_VERSION != getub(buf, 3)) {
+        return -1;
+    }
+    len = getleu32(buf, 4) + GPSB_HEADER;
+    if (GPSB_MAX < len) {
+        return -1;
+    }
+    if (avail < len) {
+        return 0;
+    }
+    return (int)len;
+}
+
+// set the fields of base to their defaults
+static void gpsb_clear_fields(const struct gpsb_field_t *fields,
+                              size_t nfields, void *base)
+{
+    size_t i;
+
+    for (i = 0; i < nfields; i++) {
+        const struct gpsb_field_t *f = &fields[i];
+        char *dst = (char *)base + f->offset;
+
+        switch (f->type) {
+        case GPSB_BOOL:
+            *(bool *)dst = 0 != f->dflt;
+            break;
+        case GPSB_U8:
+            *(unsigned char *)dst = (unsigned char)f->dflt;
+            break;
+        case GPSB_I8:
+            *(signed char *)dst = (signed char)f->dflt;
+            break;
+        case GPSB_I16:
+            *(int16_t *)dst = f->dflt;
+            break;
+        case GPSB_I32:
+            *(int *)dst = f->dflt;
+            break;
+        case GPSB_U32:
+            *(unsigned *)dst = (unsigned)f->dflt;
+            break;
+        case GPSB_I64:
+            *(long *)dst = f->dflt;
+            break;
+        case GPSB_U64:
+            *(unsigned long *)dst = (unsigned long)f->dflt;
+            break;
+        case GPSB_F32:
+            // FALLTHROUGH
+        case GPSB_F64:
+            *(double *)dst = NAN;
+            break;
+        case GPSB_TS:
+            memset(dst, 0, sizeof(timespec_t));
+            break;
+        case GPSB_STR:
+            dst[0] = '\0';
+            break;
+        }
+    }
+}
+
+// store one item in base, if its tag and type match the table
+static void gpsb_get_field(const struct gpsb_field_t *fields,
+                           size_t nfields, void *base, unsigned tag,
+                           unsigned type, const char *val)
+{
+    const struct gpsb_field_t *f;
+    char *dst;
+
+    if (nfields <= tag ||
+        fields[tag].type != type) {
+        // newer, or garbled
+        return;
+    }
+    f = &fields[tag];
+    dst = (char *)base + f->offset;
+    switch (type) {
+    case GPSB_BOOL:
+        *(bool *)dst = 0 != getub(val, 0);
+        break;
+    case GPSB_U8:
+        *(unsigned char *)dst = getub(val, 0);
+        break;
+    case GPSB_I8:
+        *(signed char *)dst = getsb(val, 0);
+        break;
+    case GPSB_I16:
+        *(int16_t *)dst = getles16(val, 0);
+        break;
+    case GPSB_I32:
+        *(int *)dst = (int)getles32(val, 0);
+        break;
+    case GPSB_U32:
+        *(unsigned *)dst = (unsigned)getleu32(val, 0);
+        break;
+    case GPSB_I64:
+        *(long *)dst = (long)getles64(val, 0);
+        break;
+    case GPSB_U64:
+        *(unsigned long *)dst = (unsigned long)getleu64(val, 0);
+        break;
+    case GPSB_F32:
+        *(double *)dst = getlef32(val, 0);
+        break;
+    case GPSB_F64:
+        *(double *)dst = getled64(val, 0);
+        break;
+    case GPSB_TS:
+        ((timespec_t *)dst)->tv_sec = (time_t)getles64(val, 0);
+        ((timespec_t *)dst)->tv_nsec = getles32(val, 8);
+        break;
+    case GPSB_STR:
+    {
+        size_t len = getub(val, 0);
+
+        if (f->size <= len) {
+            len = f->size - 1;
+        }
+        memcpy(dst, val + 1, len);
+        dst[len] = '\0';
+        break;
+    }
+    }
+}
+
+// the GPS_CLASS_* of each frame class, for gps_class_filter()
+static const unsigned int gpsb_class_masks[] = {
+    0, GPS_CLASS_TPV, GPS_CLASS_SKY, GPS_CLASS_ATT, GPS_CLASS_IMU,
+    GPS_CLASS_RAW};
+
+/* Decode one frame, as found by gpsb_frame_len(), into gpsdata.
+ * Return: 0 on success, -1 if it is garbled */
+int libgps_binary_unpack(const char *buf, size_t len,
+                         struct gps_data_t *gpsdata)
+{
+    const struct gpsb_field_t *fields;
+    size_t nfields;
+    void *base;
+    // the array elements, if any
+    const struct gpsb_field_t *efields = NULL;
+    size_t nefields = 0, esize = 0;
+    char *earray = NULL;
+    int elem = -1;
+    bool have_sats = false;
+    const char *p = buf + GPSB_HEADER;
+    const char *end = buf + len;
+    int cls = getub(buf, 2);
+
+    if (NULL != gpsdata->privdata &&
+        0 < cls &&
+        (int)ROWS(gpsb_class_masks) > cls &&
+        0 != (gpsdata->privdata->skip_classes & gpsb_class_masks[cls])) {
+        // not wanted, do not decode it
+        return 0;
+    }
+    switch (cls) {
+    case GPSB_TPV:
+        fields = tpv_fields;
+        nfields = ROWS(tpv_fields);
+        base = &gpsdata->fix;
+        break;
+    case GPSB_SKY:
+        fields = sky_fields;
+        nfields = ROWS(sky_fields);
+        base = gpsdata;
+        efields = sat_fields;
+        nefields = ROWS(sat_fields);
+        esize = sizeof(gpsdata->skyview[0]);
+        earray = (char *)gpsdata->skyview;
+        memset(&gpsdata->skyview, 0, sizeof(gpsdata->skyview));
+        break;
+    case GPSB_ATT:
+        fields = att_fields;
+        nfields = ROWS(att_fields);
+        base = &gpsdata->attitude;
+        break;
+    case GPSB_IMU:
+        // the client only uses the first slot.
+        fields = att_fields;
+        nfields = ROWS(att_fields);
+        base = &gpsdata->imu[0];
+        break;
+    case GPSB_RAW:
+        fields = raw_fields;
+        nfields = ROWS(raw_fields);
+        base = &gpsdata->raw;
+        efields = meas_fields;
+        nefields = ROWS(meas_fields);
+        esize = sizeof(gpsdata->raw.meas[0]);
+        earray = (char *)gpsdata->raw.meas;
+        memset(&gpsdata->raw, 0, sizeof(gpsdata->raw));
+        break;
+    default:
+        // a class from the future
+        return 0;
+    }
+    gpsb_clear_fields(fields, nfields, base);
+
+    while (2 <= end - p) {
+        unsigned tag = getub(p, 0);
+        unsigned type = getub(p, 1);
+        size_t vlen;
+
+        if (GPSB_NEXT < type ||
+            0 == type) {
+            return -1;
+        }
+        vlen = gpsb_type_len[type];
+        if (GPSB_STR == type) {
+            if (3 > end - p) {
+                return -1;
+            }
+            vlen = 1 + getub(p, 2);
+        }
+        if ((ptrdiff_t)(2 + vlen) > end - p) {
+            return -1;
+        }
+        p += 2;
+        if (GPSB_TAG_NEXT == tag) {
+            if (NULL != efields &&
+                MAXCHANNELS > elem + 1) {
+                elem++;
+                gpsb_clear_fields(efields, nefields, earray + elem * esize);
+            }
+        } else if (GPSB_TAG_DEVICE == tag) {
+            if (GPSB_STR == type) {
+                size_t n = getub(p, 0);
+
+                if (sizeof(gpsdata->dev.path) <= n) {
+                    n = sizeof(gpsdata->dev.path) - 1;
+                }
+                memcpy(gpsdata->dev.path, p + 1, n);
+                gpsdata->dev.path[n] = '\0';
+            }
+        } else if (GPSB_TAG_LEAP == tag) {
+            if (GPSB_I32 == type) {
+                gpsdata->leap_seconds = (int)getles32(p, 0);
+            }
+        } else if (GPSB_TAG_NSAT == tag) {
+            have_sats = true;
+        } else if (0 <= elem) {
+            gpsb_get_field(efields, nefields, earray + elem * esize,
+                           tag, type, p);
+        } else {
+            gpsb_get_field(fields, nfields, base, tag, type, p);
+        }
+        p += vlen;
+    }
+
+    switch (cls) {
+    case GPSB_TPV:
+        // DEPRECATED, undefined
+        gpsdata->fix.altitude = 0 != isfinite(gpsdata->fix.altMSL) ?
+                                gpsdata->fix.altMSL : gpsdata->fix.altHAE;
+        libgps_tpv_mask(gpsdata);
+        break;
+    case GPSB_SKY:
+        libgps_sky_mask(gpsdata, have_sats);
+        break;
+    case GPSB_ATT:
+        gpsdata->set |= ATTITUDE_SET;
+        break;
+    case GPSB_IMU:
+        gpsdata->set |= IMU_SET;
+        break;
+    case GPSB_RAW:
+        gpsdata->set |= RAW_SET;
+        break;
+    }
+    return 0;
+}
+
+// the GPS_CLASS_* of the frame at the start of buf, 0 if unknown
+unsigned int gpsb_frame_class(const char *buf)
+{
+    int cls = getub(buf, 2);
+
+    if (0 >= cls ||
+        (int)ROWS(gpsb_class_masks) <= cls) {
+        return 0;
+    }
+    return gpsb_class_masks[cls];
+}
+
+/* The offset of the first item with tag in a frame, as found by
+ * gpsb_frame_len().  Return: -1 if there is none, or it is garbled */
+static ptrdiff_t gpsb_find_tag(const char *buf, size_t len, unsigned tag)
+{
+    const char *p = buf + GPSB_HEADER;
+    const char *end = buf + len;
+
+    while (2 <= end - p) {
+        unsigned type = getub(p, 1);
+        size_t vlen;
+
+        if (GPSB_NEXT < type ||
+            0 == type) {
+            return -1;
+        }
+        vlen = gpsb_type_len[type];
+        if (GPSB_STR == type) {
+            if (3 > end - p) {
+                return -1;
+            }
+            vlen = 1 + getub(p, 2);
+        }
+        if ((ptrdiff_t)(2 + vlen) > end - p) {
+            return -1;
+        }
+        if (tag == getub(p, 0)) {
+            return p - buf;
+        }
+        p += 2 + vlen;
+    }
+    return -1;
+}
+
+/* Number a frame len bytes long, in a buffer buflen long, with seq.
+ * A number it has is replaced, else one is appended.
+ * Return: the new length, 0 if it does not fit */
+size_t gpsb_seq_put(char *buf, size_t len, size_t buflen, unsigned long seq)
+{
+    ptrdiff_t off = gpsb_find_tag(buf, len, GPSB_TAG_SEQ);
+
+    if (0 > off) {
+        off = (ptrdiff_t)len;
+        if (buflen < len + 10 ||
+            GPSB_MAX < len + 10) {
+            return 0;
+        }
+        len += 10;
+    } else if (GPSB_U64 != getub(buf, off + 1)) {
+        return 0;
+    }
+    putbyte(buf, off, GPSB_TAG_SEQ);
+    putbyte(buf, off + 1, GPSB_U64);
+    putle64(buf, off + 2, seq);
+    putle32(buf, 4, len - GPSB_HEADER);
+    return len;
+}
+
+// the sequence number of a frame, 0 if it has none
+unsigned long gpsb_seq_get(const char *buf, size_t len)
+{
+    ptrdiff_t off = gpsb_find_tag(buf, len, GPSB_TAG_SEQ);
+
+    if (0 > off ||
+        GPSB_U64 != getub(buf, off + 1)) {
+        return 0;
+    }
+    return (unsigned long)getleu64(buf, off + 2);
+}
+
+/* Put prefix and a # in front of the device path of a frame len bytes
+ * long, in a buffer buflen long, unless it is there already, as the
+ * JSON from a gpsd:// feed gets it.
+ * Return: the new length, len if it is unchanged */
+size_t gpsb_device_prefix(char *buf, size_t len, size_t buflen,
+                          const char *prefix)
+{
+    ptrdiff_t off = gpsb_find_tag(buf, len, GPSB_TAG_DEVICE);
+    size_t plen = strnlen(prefix, 255);
+    size_t olen, nlen;
+    char *val;
+
+    if (0 > off ||
+        GPSB_STR != getub(buf, off + 1) ||
+        254 <= plen) {
+        return len;
+    }
+    val = buf + off + 3;
+    olen = getub(buf, off + 2);
+    if (olen > plen &&
+        0 == memcmp(val, prefix, plen) &&
+        '#' == val[plen]) {
+        // done already, maybe this is gpsmon
+        return len;
+    }
+    nlen = plen + 1 + olen;
+    if (255 < nlen) {
+        nlen = 255;
+    }
+    if (buflen < len + nlen - olen ||
+        GPSB_MAX < len + nlen - olen) {
+        return len;
+    }
+    // move the rest of the frame, and the old path, out of the way
+    memmove(val + nlen, val + olen, len - (size_t)(off + 3) - olen);
+    memmove(val + plen + 1, val, nlen - plen - 1);
+    memcpy(val, prefix, plen);
+    val[plen] = '#';
+    putbyte(buf, off + 2, nlen);
+    len += nlen - olen;
+    putle32(buf, 4, len - GPSB_HEADER);
+    return len;
+}
+
+// vim: set expandtab shiftwidth=4
@@ -323,6 +323,38 @@ int gps_read(struct gps_data_t *gpsdata, char *message, int message_len)
     return status;
 }
 
+/* read, then unpack every complete message waiting, calling hook,
+ * if not NULL, after each one.
+ *
+ * Return: number of messages, 0 if none
+ * Return: negative -- fail, as gps_read()
+ */
+int gps_read_batch(struct gps_data_t *gpsdata,
+                   void (*hook)(struct gps_data_t *))
+{
+    int status;
+
+    if (NULL == PRIVATE(gpsdata) ||
+        (NULL != gpsdata->source.server &&
+         0 == strcmp(gpsdata->source.server, GPSD_LOCAL_FILE)) ||
+        BAD_SOCKET((intptr_t)(gpsdata->gps_fd))) {
+        // local file, shared memory, or error: one message at a time
+        status = gps_read(gpsdata, NULL, 0);
+        if (0 >= status) {
+            return status;
+        }
+        if (NULL != hook) {
+            hook(gpsdata);
+        }
+        return 1;
+    }
+
+    status = gps_sock_read_batch(gpsdata, hook);
+
+    libgps_debug_trace((DEBUG_CALLS, "gps_read_batch() -> %d\n", status));
+    return status;
+}
+
 /* send a command to the gpsd instance
  *
  * Return: 0 -- success
@@ -375,6 +407,21 @@ int gps_stream(struct gps_data_t *gpsdata, watch_t flags,
     return status;
 }
 
+/* decode only the report classes in the GPS_CLASS_* mask, skip the
+ * rest after a look at their class tag.  GPS_CLASS_ALL to undo.
+ *
+ * Return: 0 -- success
+ * Return: negative -- fail
+ */
+int gps_class_filter(struct gps_data_t *gpsdata, unsigned int classes)
+{
+    if (NULL == PRIVATE(gpsdata)) {
+        return -1;
+    }
+    PRIVATE(gpsdata)->skip_classes = ~classes & GPS_CLASS_ALL;
+    return 0;
+}
+
 // return the contents of the client data buffer
 const char *gps_data(const struct gps_data_t *gpsdata CONDITIONALLY_UNUSED)
 {
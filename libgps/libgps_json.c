@@ -31,6 +31,127 @@ PERMISSIONS
 #include "../include/gps_json.h"
 #include "../include/timespec.h"
 
+/* set gpsdata->set from what a TPV report filled in
+ * Shared by the JSON and the binary decoders. */
+void libgps_tpv_mask(struct gps_data_t *gpsdata)
+{
+    gpsdata->set = STATUS_SET;
+    if (0 != gpsdata->fix.time.tv_sec) {
+        gpsdata->set |= TIME_SET;
+    }
+    if (0 != isfinite(gpsdata->fix.ept)) {
+        gpsdata->set |= TIMERR_SET;
+    }
+    if (0 != isfinite(gpsdata->fix.longitude)) {
+        gpsdata->set |= LATLON_SET;
+    }
+    if (0 != isfinite(gpsdata->fix.altitude) ||
+        0 != isfinite(gpsdata->fix.altHAE) ||
+        0 != isfinite(gpsdata->fix.depth) ||
+        0 != isfinite(gpsdata->fix.altMSL)) {
+        gpsdata->set |= ALTITUDE_SET;
+    }
+    if (0 != isfinite(gpsdata->fix.epx) &&
+        0 != isfinite(gpsdata->fix.epy)) {
+        gpsdata->set |= HERR_SET;
+    }
+    if (0 != isfinite(gpsdata->fix.epv)) {
+        gpsdata->set |= VERR_SET;
+    }
+    if (0 != isfinite(gpsdata->fix.track)) {
+        gpsdata->set |= TRACK_SET;
+    }
+    if (0 != isfinite(gpsdata->fix.magnetic_track) ||
+        0 != isfinite(gpsdata->fix.magnetic_var)) {
+        gpsdata->set |= MAGNETIC_TRACK_SET;
+    }
+    if (0 != isfinite(gpsdata->fix.speed)) {
+        gpsdata->set |= SPEED_SET;
+    }
+    if (0 != isfinite(gpsdata->fix.climb)) {
+        gpsdata->set |= CLIMB_SET;
+    }
+    if (0 != isfinite(gpsdata->fix.epd)) {
+        gpsdata->set |= TRACKERR_SET;
+    }
+    if (0 != isfinite(gpsdata->fix.eps)) {
+        gpsdata->set |= SPEEDERR_SET;
+    }
+    if (0 != isfinite(gpsdata->fix.epc)) {
+        gpsdata->set |= CLIMBERR_SET;
+    }
+    if (MODE_NOT_SEEN != gpsdata->fix.mode) {
+        gpsdata->set |= MODE_SET;
+    }
+    if (0 != isfinite(gpsdata->fix.wanglem) ||
+        0 != isfinite(gpsdata->fix.wangler) ||
+        0 != isfinite(gpsdata->fix.wanglet) ||
+        0 != isfinite(gpsdata->fix.wspeedr) ||
+        0 != isfinite(gpsdata->fix.wspeedt)) {
+        gpsdata->set |= NAVDATA_SET;
+    }
+    if (0 != isfinite(gpsdata->fix.NED.relPosN) ||
+        0 != isfinite(gpsdata->fix.NED.relPosE) ||
+        0 != isfinite(gpsdata->fix.NED.relPosD) ||
+        0 != isfinite(gpsdata->fix.NED.relPosH) ||
+        0 != isfinite(gpsdata->fix.NED.relPosL) ||
+        0 != isfinite(gpsdata->fix.NED.velN) ||
+        0 != isfinite(gpsdata->fix.NED.velE) ||
+        0 != isfinite(gpsdata->fix.NED.velD)) {
+        gpsdata->set |= NED_SET;
+    }
+    if ((0 != isfinite(gpsdata->fix.ecef.x)) &&
+        (0 != isfinite(gpsdata->fix.ecef.y)) &&
+        (0 != isfinite(gpsdata->fix.ecef.z))) {
+        // All, or none.  Clients can just do their own isfinite()s
+        gpsdata->set |= ECEF_SET;
+    }
+    if ((0 != isfinite(gpsdata->fix.ecef.vx)) &&
+        (0 != isfinite(gpsdata->fix.ecef.vy)) &&
+        (0 != isfinite(gpsdata->fix.ecef.vz))) {
+        // All, or none.  Clients can just do their own isfinite()s
+        gpsdata->set |= VECEF_SET;
+    }
+}
+
+/* finish a SKY report: set gpsdata->set, count the satellites.
+ * Shared by the JSON and the binary decoders. */
+void libgps_sky_mask(struct gps_data_t *gpsdata, bool have_sats)
+{
+    int i;
+
+    if (1 == isfinite(gpsdata->dop.hdop) ||
+        1 == isfinite(gpsdata->dop.xdop) ||
+        1 == isfinite(gpsdata->dop.ydop) ||
+        1 == isfinite(gpsdata->dop.vdop) ||
+        1 == isfinite(gpsdata->dop.tdop) ||
+        1 == isfinite(gpsdata->dop.pdop) ||
+        1 == isfinite(gpsdata->dop.gdop)) {
+        // got at least one DOP
+        gpsdata->set |= DOP_SET;
+    }
+
+    gpsdata->satellites_visible = 0;
+
+    if (!have_sats) {
+        // no sats in the SKY, likely just dops.  Maybe uSat
+        gpsdata->set &= ~SATELLITE_SET;
+        return;
+    }
+    gpsdata->satellites_used = 0;
+
+    gpsdata->set |= SATELLITE_SET;
+    // recalculate used and visible, do not use nSat, uSat
+    for (i = 0; i < MAXCHANNELS; i++) {
+        if (0 < gpsdata->skyview[i].PRN) {
+            gpsdata->satellites_visible++;
+        }
+        if (gpsdata->skyview[i].used) {
+            gpsdata->satellites_used++;
+        }
+    }
+}
+
 static int json_tpv_read(const char *buf, struct gps_data_t *gpsdata,
                          const char **endptr)
 {
@@ -357,7 +478,7 @@ static int json_sky_read(const char *buf, struct gps_data_t *gpsdata,
         {NULL},
         // *INDENT-ON*
     };
-    int status, i;
+    int status;
 
     memset(&gpsdata->skyview, 0, sizeof(gpsdata->skyview));
 
@@ -365,38 +486,7 @@ static int json_sky_read(const char *buf, struct gps_data_t *gpsdata,
     if (0 != status) {
         return status;
     }
-
-    if (1 == isfinite(gpsdata->dop.hdop) ||
-        1 == isfinite(gpsdata->dop.xdop) ||
-        1 == isfinite(gpsdata->dop.ydop) ||
-        1 == isfinite(gpsdata->dop.vdop) ||
-        1 == isfinite(gpsdata->dop.tdop) ||
-        1 == isfinite(gpsdata->dop.pdop) ||
-        1 == isfinite(gpsdata->dop.gdop)) {
-        // got at least one DOP
-        gpsdata->set |= DOP_SET;
-    }
-
-    gpsdata->satellites_visible = 0;
-
-    if (-1 == nSat) {
-        // no sats in the SKY, likely just dops.  Maybe uSat
-        gpsdata->set &= ~SATELLITE_SET;
-        return 0;
-    }
-    gpsdata->satellites_used = 0;
-
-    gpsdata->set |= SATELLITE_SET;
-    // recalculate used and visible, do not use nSat, uSat
-    for (i = 0; i < MAXCHANNELS; i++) {
-        if (0 < gpsdata->skyview[i].PRN) {
-            gpsdata->satellites_visible++;
-        }
-        if (gpsdata->skyview[i].used) {
-            gpsdata->satellites_used++;
-        }
-    }
-
+    libgps_sky_mask(gpsdata, -1 != nSat);
     return 0;
 }
 
@@ -788,96 +878,66 @@ int json_oscillator_read(const char *buf, struct gps_data_t *gpsdata,
 #define PASS(n) (((n) == 0) || ((n) == JSON_ERR_BADATTR))
 #define FILTER(n) ((n) == JSON_ERR_BADATTR ? 0 : n)
 
+// the classes gps_class_filter() can skip
+static const struct {
+    const char *tag;
+    unsigned int mask;
+} json_classes[] = {
+    {"\"class\":\"TPV\"", GPS_CLASS_TPV},
+    {"\"class\":\"SKY\"", GPS_CLASS_SKY},
+    {"\"class\":\"GST\"", GPS_CLASS_GST},
+    {"\"class\":\"ATT\"", GPS_CLASS_ATT},
+    {"\"class\":\"IMU\"", GPS_CLASS_IMU},
+    {"\"class\":\"AIS\"", GPS_CLASS_AIS},
+    {"\"class\":\"RTCM2\"", GPS_CLASS_RTCM2},
+    {"\"class\":\"RTCM3\"", GPS_CLASS_RTCM3},
+    {"\"class\":\"TOFF\"", GPS_CLASS_TOFF},
+    {"\"class\":\"PPS\"", GPS_CLASS_PPS},
+    {"\"class\":\"OSC\"", GPS_CLASS_OSC},
+    {"\"class\":\"RAW\"", GPS_CLASS_RAW},
+    {"\"class\":\"SUBFRAME\"", GPS_CLASS_SUBFRAME},
+    {"\"class\":\"LOG\"", GPS_CLASS_LOG},
+};
+
 // the only entry point - unpack a JSON object into gpsdata_t substructures
 int libgps_json_unpack(const char *buf,
                        struct gps_data_t *gpsdata, const char **end)
 {
     int status;
-    char *classtag = strstr(buf, "\"class\":");
+    const char *classtag;
+
+    // gpsd always sends the class first, avoid the search
+    if (str_starts_with(buf, "{\"class\":")) {
+        classtag = buf + 1;
+    } else {
+        classtag = strstr(buf, "\"class\":");
+        if (NULL == classtag) {
+            return -1;
+        }
+    }
 
-    if (NULL == classtag) {
-        return -1;
+    if (NULL != gpsdata->privdata &&
+        0 != gpsdata->privdata->skip_classes) {
+        unsigned i;
+
+        for (i = 0; i < ROWS(json_classes); i++) {
+            if (str_starts_with(classtag, json_classes[i].tag)) {
+                if (0 == (gpsdata->privdata->skip_classes &
+                          json_classes[i].mask)) {
+                    break;
+                }
+                // not wanted, do not parse it
+                if (NULL != end) {
+                    *end = NULL;
+                }
+                return 0;
+            }
+        }
     }
 
     if (str_starts_with(classtag, "\"class\":\"TPV\"")) {
         status = json_tpv_read(buf, gpsdata, end);
-        gpsdata->set = STATUS_SET;
-        if (0 != gpsdata->fix.time.tv_sec) {
-            gpsdata->set |= TIME_SET;
-        }
-        if (0 != isfinite(gpsdata->fix.ept)) {
-            gpsdata->set |= TIMERR_SET;
-        }
-        if (0 != isfinite(gpsdata->fix.longitude)) {
-            gpsdata->set |= LATLON_SET;
-        }
-        if (0 != isfinite(gpsdata->fix.altitude) ||
-            0 != isfinite(gpsdata->fix.altHAE) ||
-            0 != isfinite(gpsdata->fix.depth) ||
-            0 != isfinite(gpsdata->fix.altMSL)) {
-            gpsdata->set |= ALTITUDE_SET;
-        }
-        if (0 != isfinite(gpsdata->fix.epx) &&
-            0 != isfinite(gpsdata->fix.epy)) {
-            gpsdata->set |= HERR_SET;
-        }
-        if (0 != isfinite(gpsdata->fix.epv)) {
-            gpsdata->set |= VERR_SET;
-        }
-        if (0 != isfinite(gpsdata->fix.track)) {
-            gpsdata->set |= TRACK_SET;
-        }
-        if (0 != isfinite(gpsdata->fix.magnetic_track) ||
-            0 != isfinite(gpsdata->fix.magnetic_var)) {
-            gpsdata->set |= MAGNETIC_TRACK_SET;
-        }
-        if (0 != isfinite(gpsdata->fix.speed)) {
-            gpsdata->set |= SPEED_SET;
-        }
-        if (0 != isfinite(gpsdata->fix.climb)) {
-            gpsdata->set |= CLIMB_SET;
-        }
-        if (0 != isfinite(gpsdata->fix.epd)) {
-            gpsdata->set |= TRACKERR_SET;
-        }
-        if (0 != isfinite(gpsdata->fix.eps)) {
-            gpsdata->set |= SPEEDERR_SET;
-        }
-        if (0 != isfinite(gpsdata->fix.epc)) {
-            gpsdata->set |= CLIMBERR_SET;
-        }
-        if (MODE_NOT_SEEN != gpsdata->fix.mode) {
-            gpsdata->set |= MODE_SET;
-        }
-        if (0 != isfinite(gpsdata->fix.wanglem) ||
-            0 != isfinite(gpsdata->fix.wangler) ||
-            0 != isfinite(gpsdata->fix.wanglet) ||
-            0 != isfinite(gpsdata->fix.wspeedr) ||
-            0 != isfinite(gpsdata->fix.wspeedt)) {
-            gpsdata->set |= NAVDATA_SET;
-        }
-        if (0 != isfinite(gpsdata->fix.NED.relPosN) ||
-            0 != isfinite(gpsdata->fix.NED.relPosE) ||
-            0 != isfinite(gpsdata->fix.NED.relPosD) ||
-            0 != isfinite(gpsdata->fix.NED.relPosH) ||
-            0 != isfinite(gpsdata->fix.NED.relPosL) ||
-            0 != isfinite(gpsdata->fix.NED.velN) ||
-            0 != isfinite(gpsdata->fix.NED.velE) ||
-            0 != isfinite(gpsdata->fix.NED.velD)) {
-            gpsdata->set |= NED_SET;
-        }
-        if ((0 != isfinite(gpsdata->fix.ecef.x)) &&
-            (0 != isfinite(gpsdata->fix.ecef.y)) &&
-            (0 != isfinite(gpsdata->fix.ecef.z))) {
-            // All, or none.  Clients can just do their own isfinite()s
-            gpsdata->set |= ECEF_SET;
-        }
-        if ((0 != isfinite(gpsdata->fix.ecef.vx)) &&
-            (0 != isfinite(gpsdata->fix.ecef.vy)) &&
-            (0 != isfinite(gpsdata->fix.ecef.vz))) {
-            // All, or none.  Clients can just do their own isfinite()s
-            gpsdata->set |= VECEF_SET;
-        }
+        libgps_tpv_mask(gpsdata);
         return FILTER(status);
     }
     if (str_starts_with(classtag, "\"class\":\"GST\"")) {
@@ -921,7 +981,7 @@ int libgps_json_unpack(const char *buf,
         return FILTER(status);
     }
     if (str_starts_with(classtag, "\"class\":\"WATCH\"")) {
-        status = json_watch_read(buf, &gpsdata->policy, end);
+        status = json_watch_read(buf, &gpsdata->policy, NULL, end);
         if (PASS(status)) {
             gpsdata->set &= ~UNION_SET;
             gpsdata->set |= POLICY_SET;
@@ -33,6 +33,7 @@
 
 #include "../include/gps.h"
 #include "../include/gpsd.h"          // FIXME: clients chould not use gpsd.h!
+#include "../include/gps_binary.h"
 #include "../include/libgps.h"
 #include "../include/strfuncs.h"
 #include "../include/timespec.h"      // for NS_IN_SEC
@@ -176,232 +177,304 @@ int gps_sock_close(struct gps_data_t *gpsdata)
 #endif  // USE_QT
 }
 
-// wait for and read data being streamed from the daemon
-int gps_sock_read(struct gps_data_t *gpsdata, char *message, int message_len)
+/* The read buffer holds PRIVATE(gpsdata)->waiting bytes, starting at
+ * PRIVATE(gpsdata)->start.  Complete messages are unpacked in place and
+ * start moves past them.  The unread tail is moved to the front only
+ * when the free space at the end can not hold a whole message. */
+
+// read what the daemon sent, as much as fits
+static int gps_sock_fill(struct gps_data_t *gpsdata)
 {
-    char *eol;
-    ssize_t response_length;
+    struct privdata_t *priv = PRIVATE(gpsdata);
     int status = -1;
-    char *eptr;
-
-    errno = 0;
-    gpsdata->set &= ~PACKET_SET;
-
-    // scan to find end of message (\n), or end of buffer
-    eol = PRIVATE(gpsdata)->buffer;
-    eptr = eol + PRIVATE(gpsdata)->waiting;
+    long long buf_avail;
 
-    while ((eol < eptr) && (*eol != '\n')) {
-        eol++;
+    if ((ssize_t)sizeof(priv->buffer) - priv->start - priv->waiting <
+        GPS_JSON_RESPONSE_MAX &&
+        0 < priv->start) {
+        memmove(priv->buffer, priv->buffer + priv->start, priv->waiting);
+        priv->start = 0;
     }
 
-    if (eol >= eptr) {
-        // no full message found, try to fill buffer
-        if ((ssize_t)sizeof(PRIVATE(gpsdata)->buffer) <=
-            PRIVATE(gpsdata)->waiting) {
-            // buffer is full but still didn't get a message
-            return -1;
-        }
+    /* this is contorted to placate Coverity. The problem is
+     * that you can request more data from recv() than recv() can
+     * tell you it received. This is: sssize_t_max < size_t max.
+     * To avoid "integer overflow" and :sign mismatch" warnings we
+     * do things in long long. */
+    buf_avail = sizeof(priv->buffer) - priv->start - priv->waiting;
+    if (0 >= buf_avail) {
+        // buffer is full but still didn't get a message
+        return -1;
+    }
 
 #ifdef USE_QT
-        status =
-            ((QTcpSocket *)(gpsdata->gps_fd))->read(PRIVATE(gpsdata)->buffer +
-                 PRIVATE(gpsdata)->waiting,
-                 sizeof(PRIVATE(gpsdata)->buffer) - PRIVATE(gpsdata)->waiting);
-#else   // USE_QT
-        {
-            /* this is contorted to placate Coverity. The problem is
-             * that you can request more data from recv() than recv() can
-             * tell you it received. This is: sssize_t_max < size_t max.
-             * To avoid "integer overflow" and :sign mismatch" warnings we
-             * do things in long long. */
-
-            long long buf_avail;
-
-            buf_avail = sizeof(PRIVATE(gpsdata)->buffer) -
-                        PRIVATE(gpsdata)->waiting;
-
-            if (0 >=  buf_avail) {
-                // no space for new data
-                status = 0;
-            } else {
-                long long sstatus;
-
-                sstatus = recv(gpsdata->gps_fd,
-                   PRIVATE(gpsdata)->buffer + PRIVATE(gpsdata)->waiting,
-                   buf_avail, 0);
-                if (0 > sstatus ||
-                    buf_avail < sstatus) {
-                    // Pacify Coverity about overflow
-                    status = -1;
-                } else {
-                    status = sstatus;
-                }
-            }
+    status =
+        ((QTcpSocket *)(gpsdata->gps_fd))->read(priv->buffer + priv->start +
+                                                priv->waiting, buf_avail);
+    if (0 > status) {
+        /* All negative statuses are error for QT
+         *
+         * read: https://doc.qt.io/qt-5/qiodevice.html#read
+         *
+         * Reads at most maxSize bytes from the device into data,
+         * and returns the number of bytes read.
+         * If an error occurs, such as when attempting to read from
+         * a device opened in WriteOnly mode, this function returns -1.
+         *
+         * 0 is returned when no more data is available for reading.
+         * However, reading past the end of the stream is considered
+         * an error, so this function returns -1 in those cases
+         * (that is, reading on a closed socket or after a process
+         * has died).
+         */
+        return -1;
+    }
+#else   // not USE_QT
+    {
+        long long sstatus;
+
+        sstatus = recv(gpsdata->gps_fd,
+                       priv->buffer + priv->start + priv->waiting,
+                       buf_avail, 0);
+        if (0 > sstatus ||
+            buf_avail < sstatus) {
+            // Pacify Coverity about overflow
+            status = -1;
+        } else {
+            status = sstatus;
         }
-#endif  // USE_QT
+    }
 
 #ifdef HAVE_WINSOCK2_H
-        int wserr = WSAGetLastError();
+    int wserr = WSAGetLastError();
 #endif  // HAVE_WINSOCK2_H
 
-#ifdef USE_QT
-        if (0 > status) {
-            /* All negative statuses are error for QT
-             *
-             * read: https://doc.qt.io/qt-5/qiodevice.html#read
-             *
-             * Reads at most maxSize bytes from the device into data,
-             * and returns the number of bytes read.
-             * If an error occurs, such as when attempting to read from
-             * a device opened in WriteOnly mode, this function returns -1.
-             *
-             * 0 is returned when no more data is available for reading.
-             * However, reading past the end of the stream is considered
-             * an error, so this function returns -1 in those cases
-             * (that is, reading on a closed socket or after a process
-             * has died).
-             */
-            return -1;
-        }
-
-#else   // not USE_QT
-        if (0 >= status) {
-            /* 0 or negative
-             *
-             * read:
-             *  https://pubs.opengroup.org/onlinepubs/007908775/xsh/read.html
-             *
-             * If nbyte is 0, read() will return 0 and have no other results.
-             * ...
-             * When attempting to read a file (other than a pipe or FIFO)
-             * that supports non-blocking reads and has no data currently
-             * available:
-             *    - If O_NONBLOCK is set,
-             *            read() will return a -1 and set errno to [EAGAIN].
-             *    - If O_NONBLOCK is clear,
-             *            read() will block the calling thread until some
-             *            data becomes available.
-             *    - The use of the O_NONBLOCK flag has no effect if there
-             *       is some data available.
-             * ...
-             * If a read() is interrupted by a signal before it reads any
-             * data, it will return -1 with errno set to [EINTR].
-             * If a read() is interrupted by a signal after it has
-             * successfully read some data, it will return the number of
-             * bytes read.
-             *
-             * recv:
-             *   https://pubs.opengroup.org/onlinepubs/007908775/xns/recv.html
-             *
-             * If no messages are available at the socket and O_NONBLOCK
-             * is not set on the socket's file descriptor, recv() blocks
-             * until a message arrives.
-             * If no messages are available at the socket and O_NONBLOCK
-             * is set on the socket's file descriptor, recv() fails and
-             * sets errno to [EAGAIN] or [EWOULDBLOCK].
-             * ...
-             * Upon successful completion, recv() returns the length of
-             * the message in bytes. If no messages are available to be
-             * received and the peer has performed an orderly shutdown,
-             * recv() returns 0. Otherwise, -1 is returned and errno is
-             * set to indicate the error.
-             *
-             * Summary:
-             * if nbytes 0 and read return 0 -> out of the free buffer
-             * space but still didn't get correct json -> report an error
-             * -> return -1
-             * if read return 0 but requested some bytes to read -> other
-             * side disconnected -> report an error -> return -1
-             * if read return -1 and errno is in [EAGAIN, EINTR, EWOULDBLOCK]
-             * -> not an error, we'll retry later -> return 0
-             * if read return -1 and errno is not in [EAGAIN, EINTR,
-             * EWOULDBLOCK] -> error -> return -1
-             *
-             */
-
-            /*
-             * check for not error cases first: EAGAIN, EINTR, etc
-             */
-             if (0 > status ) {
+    if (0 >= status) {
+        /* 0 or negative
+         *
+         * read:
+         *  https://pubs.opengroup.org/onlinepubs/007908775/xsh/read.html
+         *
+         * If nbyte is 0, read() will return 0 and have no other results.
+         * ...
+         * When attempting to read a file (other than a pipe or FIFO)
+         * that supports non-blocking reads and has no data currently
+         * available:
+         *    - If O_NONBLOCK is set,
+         *            read() will return a -1 and set errno to [EAGAIN].
+         *    - If O_NONBLOCK is clear,
+         *            read() will block the calling thread until some
+         *            data becomes available.
+         *    - The use of the O_NONBLOCK flag has no effect if there
+         *       is some data available.
+         * ...
+         * If a read() is interrupted by a signal before it reads any
+         * data, it will return -1 with errno set to [EINTR].
+         * If a read() is interrupted by a signal after it has
+         * successfully read some data, it will return the number of
+         * bytes read.
+         *
+         * recv:
+         *   https://pubs.opengroup.org/onlinepubs/007908775/xns/recv.html
+         *
+         * If no messages are available at the socket and O_NONBLOCK
+         * is not set on the socket's file descriptor, recv() blocks
+         * until a message arrives.
+         * If no messages are available at the socket and O_NONBLOCK
+         * is set on the socket's file descriptor, recv() fails and
+         * sets errno to [EAGAIN] or [EWOULDBLOCK].
+         * ...
+         * Upon successful completion, recv() returns the length of
+         * the message in bytes. If no messages are available to be
+         * received and the peer has performed an orderly shutdown,
+         * recv() returns 0. Otherwise, -1 is returned and errno is
+         * set to indicate the error.
+         *
+         * Summary:
+         * if nbytes 0 and read return 0 -> out of the free buffer
+         * space but still didn't get correct json -> report an error
+         * -> return -1
+         * if read return 0 but requested some bytes to read -> other
+         * side disconnected -> report an error -> return -1
+         * if read return -1 and errno is in [EAGAIN, EINTR, EWOULDBLOCK]
+         * -> not an error, we'll retry later -> return 0
+         * if read return -1 and errno is not in [EAGAIN, EINTR,
+         * EWOULDBLOCK] -> error -> return -1
+         *
+         */
+
+        /*
+         * check for not error cases first: EAGAIN, EINTR, etc
+         */
+        if (0 > status ) {
 #ifdef HAVE_WINSOCK2_H
-                if (WSAEINTR  == wserr ||
-                    WSAEWOULDBLOCK == wserr) {
-                    return 0;
-                }
+            if (WSAEINTR  == wserr ||
+                WSAEWOULDBLOCK == wserr) {
+                return 0;
+            }
 #else
-                if (EINTR == errno ||
-                    EAGAIN == errno ||
-                    EWOULDBLOCK == errno) {
-                    return 0;
-                }
+            if (EINTR == errno ||
+                EAGAIN == errno ||
+                EWOULDBLOCK == errno) {
+                return 0;
+            }
 #endif  // HAVE_WINSOCK2_H
-             }
-
-             // disconnect or error
-             return -1;
         }
+
+        // disconnect or error
+        return -1;
+    }
 #endif  // USE_QT
 
-        // if we just received data from the socket, it's in the buffer
-        PRIVATE(gpsdata)->waiting += status;
+    // if we just received data from the socket, it's in the buffer
+    priv->waiting += status;
+    return status;
+}
 
-        // there's new buffered data waiting, check for full message
-        eol = PRIVATE(gpsdata)->buffer;
-        eptr = eol + PRIVATE(gpsdata)->waiting;
+// is a whole message, JSON line or binary frame, buffered?
+static bool gps_sock_complete(const struct privdata_t *priv)
+{
+    const char *line = priv->buffer + priv->start;
 
-        while ((eol < eptr) && ('\n' != *eol)) {
-            eol++;
-        }
+    if (0 >= priv->waiting) {
+        return false;
+    }
+    if ((char)GPSB_SYNC1 == line[0]) {
+        // a garbled frame counts, gps_sock_next() reports it
+        return 0 != gpsb_frame_len(line, priv->waiting);
+    }
+    return NULL != memchr(line, '\n', priv->waiting);
+}
 
-        if (eol >= eptr) {
+/* unpack the next complete message in the buffer, if any.
+ * A binary frame leaves message empty.
+ * Return: 0 -- no complete message
+ * Return: length of the message, or negative on unpack error */
+static int gps_sock_next(struct gps_data_t *gpsdata, char *message,
+                         int message_len)
+{
+    struct privdata_t *priv = PRIVATE(gpsdata);
+    char *line = priv->buffer + priv->start;
+    char *eol;
+    ssize_t response_length;
+    int status;
+
+    if (0 >= priv->waiting) {
+        return 0;
+    }
+    if ((char)GPSB_SYNC1 == line[0]) {
+        // a binary frame, see gps_binary.h
+        int frame_len = gpsb_frame_len(line, priv->waiting);
+
+        if (0 == frame_len) {
+            // still no full frame
+            return 0;
+        }
+        if (0 > frame_len) {
+            // no way to resync, drop what we have
+            priv->start = 0;
+            priv->waiting = 0;
+            return -1;
+        }
+        if (NULL != message &&
+            0 < message_len) {
+            message[0] = '\0';
+        }
+        (void)clock_gettime(CLOCK_REALTIME, &gpsdata->online);
+        status = libgps_binary_unpack(line, frame_len, gpsdata);
+        response_length = frame_len;
+    } else {
+        eol = (char *)memchr(line, '\n', priv->waiting);
+        if (NULL == eol) {
             // still no full message, give up for now
             return 0;
         }
+
+        // eol now points to trailing \n in a full message
+        *eol = '\0';
+        if (NULL != message) {
+            strlcpy(message, line, message_len);
+        }
+        (void)clock_gettime(CLOCK_REALTIME, &gpsdata->online);
+        // unpack the JSON message
+        status = gps_unpack(line, gpsdata);
+
+        // the 1 is for the \n
+        response_length = eol - line + 1;
     }
 
-    // eol now points to trailing \n in a full message
-    *eol = '\0';
-    if (NULL != message) {
-        strlcpy(message, PRIVATE(gpsdata)->buffer, message_len);
+    // calculate length of good data still in buffer
+    priv->waiting -= response_length;
+    if (0 >= priv->waiting) {
+        // no waiting data, or overflow, start over at the front
+        priv->start = 0;
+        priv->waiting = 0;
+        // and clear the buffer, gps_data() is what is left unread
+        priv->buffer[0] = '\0';
+    } else {
+        priv->start += response_length;
     }
-    (void)clock_gettime(CLOCK_REALTIME, &gpsdata->online);
-    // unpack the JSON message
-    status = gps_unpack(PRIVATE(gpsdata)->buffer, gpsdata);
+    gpsdata->set |= PACKET_SET;
 
-    /*
-        why the 1?
+    return (0 == status) ? (int)response_length : status;
+}
 
-                |0|1|2|3|4|5| 6|7|
-                |1|2|3|4|5|6|\n|X|
-           buffer^         eol^
+// wait for and read data being streamed from the daemon
+int gps_sock_read(struct gps_data_t *gpsdata, char *message, int message_len)
+{
+    int status;
 
-        buffer = 0
-        eol = 6
+    errno = 0;
+    gpsdata->set &= ~PACKET_SET;
 
-        eol-buffer = 6-0 = 6, size of the line data is 7 bytes with \n
+    status = gps_sock_next(gpsdata, message, message_len);
+    if (0 != status) {
+        return status;
+    }
 
-        eol-buffer+1 = 6-0+1 = 7
+    // no full message buffered, try to fill buffer
+    status = gps_sock_fill(gpsdata);
+    if (0 >= status) {
+        return status;
+    }
+    return gps_sock_next(gpsdata, message, message_len);
+}
 
-    */
+/* Read once, if no full message is buffered, then unpack every
+ * complete message.  hook, if not NULL, is called after each.
+ * Return: the number of messages, 0 if none, or negative on error */
+int gps_sock_read_batch(struct gps_data_t *gpsdata,
+                        void (*hook)(struct gps_data_t *))
+{
+    struct privdata_t *priv = PRIVATE(gpsdata);
+    int count = 0;
 
-    response_length = eol - PRIVATE(gpsdata)->buffer + 1;
+    errno = 0;
+    gpsdata->set &= ~PACKET_SET;
 
-    // calculate length of good data still in buffer
-    PRIVATE(gpsdata)->waiting -= response_length;
+    if (!gps_sock_complete(priv)) {
+        int status = gps_sock_fill(gpsdata);
 
-    if (0 >= PRIVATE(gpsdata)->waiting) {
-        // no waiting data, or overflow, clear the buffer, just in case
-        *PRIVATE(gpsdata)->buffer = '\0';
-        PRIVATE(gpsdata)->waiting = 0;
-    } else {
-        memmove(PRIVATE(gpsdata)->buffer,
-                PRIVATE(gpsdata)->buffer + response_length,
-                PRIVATE(gpsdata)->waiting);
+        if (0 >= status) {
+            return status;
+        }
     }
-    gpsdata->set |= PACKET_SET;
+    for (;;) {
+        int status = gps_sock_next(gpsdata, NULL, 0);
 
-    return (0 == status) ? (int)response_length : status;
+        if (0 == status) {
+            break;
+        }
+        if (0 > status) {
+            return status;
+        }
+        count++;
+        if (NULL != hook) {
+            hook(gpsdata);
+        }
+        gpsdata->set &= ~PACKET_SET;
+    }
+    return count;
 }
 
 /* unpack a gpsd response into a status structure, buf must be writeable.
@@ -448,7 +521,7 @@ int gps_unpack(const char *buf, struct gps_data_t *gpsdata)
 const char *gps_sock_data(const struct gps_data_t *gpsdata)
 {
     // no length data, so pretty useless...
-    return PRIVATE(gpsdata)->buffer;
+    return PRIVATE(gpsdata)->buffer + PRIVATE(gpsdata)->start;
 }
 
 /* send a command to the gpsd instance
@@ -488,11 +561,19 @@ int gps_sock_send(struct gps_data_t *gpsdata, const char *buf)
     return -1;
 }
 
-// ask gpsd to stream reports at you, hiding the command details
+/* the longest ?WATCH gps_sock_stream() sends: every flag, a device
+ * path, and every class */
+#define WATCH_COMMAND_MAX       (256 + GPS_PATH_MAX + GPS_JSON_CLASSES_MAX)
+
+/* ask gpsd to stream reports at you, hiding the command details
+ *
+ * Return: 0 -- success
+ * Return: negative -- fail, or the command did not fit
+ */
 int gps_sock_stream(struct gps_data_t *gpsdata, watch_t flags,
                     const char *d)
 {
-    char buf[GPS_JSON_COMMAND_MAX] = "?WATCH={\"enable\":";
+    char buf[WATCH_COMMAND_MAX] = "?WATCH={\"enable\":";
 
     if (0 == (flags & (WATCH_JSON | WATCH_NMEA | WATCH_RAW))) {
         flags |= WATCH_JSON;
@@ -523,6 +604,12 @@ int gps_sock_stream(struct gps_data_t *gpsdata, watch_t flags,
         if (flags & WATCH_PPS) {
             (void)strlcat(buf, ",\"pps\":false", sizeof(buf));
         }
+        if (flags & WATCH_BINARY) {
+            (void)strlcat(buf, ",\"binary\":false", sizeof(buf));
+        }
+        if (flags & WATCH_TRACE) {
+            (void)strlcat(buf, ",\"trace\":false", sizeof(buf));
+        }
         // no device here?
     } else {                    // if (0 != (flags & WATCH_ENABLE)) */
         (void)strlcat(buf, "true", sizeof(buf));
@@ -550,11 +637,40 @@ int gps_sock_stream(struct gps_data_t *gpsdata, watch_t flags,
         if (flags & WATCH_PPS) {
             (void)strlcat(buf, ",\"pps\":true", sizeof(buf));
         }
+        if (flags & WATCH_BINARY) {
+            (void)strlcat(buf, ",\"binary\":true", sizeof(buf));
+        }
+        if (flags & WATCH_TRACE) {
+            (void)strlcat(buf, ",\"trace\":true", sizeof(buf));
+        }
         if (flags & WATCH_DEVICE) {
             str_appendf(buf, sizeof(buf), ",\"device\":\"%s\"", d);
+            if (sizeof(buf) - 1 <= strnlen(buf, sizeof(buf))) {
+                // a device name too long for gpsd anyway
+                return -1;
+            }
         }
+        if (0 != PRIVATE(gpsdata)->skip_classes) {
+            // gps_class_filter() was called, have gpsd send only those
+            char list[GPS_JSON_CLASSES_MAX];
+
+            json_class_list(~PRIVATE(gpsdata)->skip_classes & GPS_CLASS_ALL,
+                            list, sizeof(list));
+            if ('\0' != list[0]) {
+                str_appendf(buf, sizeof(buf), ",\"classes\":\"%s\"", list);
+                if (sizeof(list) - 1 <= strnlen(list, sizeof(list)) ||
+                    sizeof(buf) - 1 <= strnlen(buf, sizeof(buf))) {
+                    return -1;
+                }
+            }
+        }
+    }
+    // a cut command would be rejected, do not send it
+    if (sizeof(buf) <= strlcat(buf, "};", sizeof(buf))) {
+        libgps_debug_trace((DEBUG_CALLS,
+                            "gps_sock_stream() command too long\n"));
+        return -1;
     }
-    (void)strlcat(buf, "};", sizeof(buf));
     libgps_debug_trace((DEBUG_CALLS, "gps_sock_stream() command: %s\n", buf));
     return gps_send(gpsdata, buf);
 }
@@ -575,12 +691,11 @@ int gps_sock_mainloop(struct gps_data_t *gpsdata, int timeout,
         if (!gps_waiting(gpsdata, timeout)) {
             return -1;
         }
-        status = gps_read(gpsdata, NULL, 0);
+        status = gps_read_batch(gpsdata, hook);
 
         if (0 > status) {
             break;
         }
-        (*hook)(gpsdata);
     }
     return -2;
 }
@@ -8,7 +8,12 @@
 #include "../include/gpsd_config.h"  // must be before all includes
 
 #include <assert.h>                  // for assert()
+#include <cerrno>
 #include <cstdlib>
+#include <cstring>
+#ifndef USE_QT
+#include <sys/socket.h>              // for recv()
+#endif
 #include "../include/libgpsmm.h"
 
 struct gps_data_t* gpsmm::gps_inner_open(const char *host, const char *port)
@@ -93,4 +98,279 @@ gpsmm::~gpsmm()
         delete to_user;
     }
 }
+
+#if !defined(USE_QT) && 201103L <= __cplusplus
+
+#define ASYNC_BUFSIZE   (2 * GPS_JSON_RESPONSE_MAX)
+
+enum async_class {ASYNC_OTHER, ASYNC_TPV, ASYNC_SKY, ASYNC_ATT, ASYNC_AIS};
+
+/* Classify a response line by its class tag, without parsing it.
+ * gpsd always puts the class first, so usually no search is needed. */
+static enum async_class async_classify(const char *line)
+{
+    static const char tag[] = "\"class\":\"";
+    const char *cls;
+
+    if ('{' == line[0] &&
+        0 == strncmp(line + 1, tag, sizeof(tag) - 1)) {
+        cls = line + sizeof(tag);
+    } else if (NULL != (cls = strstr(line, tag))) {
+        cls += sizeof(tag) - 1;
+    } else {
+        return ASYNC_OTHER;
+    }
+    if (0 == strncmp(cls, "TPV\"", 4)) {
+        return ASYNC_TPV;
+    }
+    if (0 == strncmp(cls, "SKY\"", 4)) {
+        return ASYNC_SKY;
+    }
+    if (0 == strncmp(cls, "ATT\"", 4)) {
+        return ASYNC_ATT;
+    }
+    if (0 == strncmp(cls, "AIS\"", 4)) {
+        return ASYNC_AIS;
+    }
+    return ASYNC_OTHER;
+}
+
+gpsmm_async::gpsmm_async(void)
+    : state(new struct gps_data_t()), inbuf(new char[ASYNC_BUFSIZE]),
+      start(0), end(0), discarding(false), connected(false),
+      all_classes(false)
+{
+}
+
+gpsmm_async::gpsmm_async(const char *host, const char *port)
+    : gpsmm_async()
+{
+    connected = (0 == gps_open(host, port, state.get()));
+    if (connected &&
+        0 > state->gps_fd) {
+        // shared memory or D-Bus, nothing to poll() on
+        release();
+    }
+}
+
+gpsmm_async::gpsmm_async(gpsmm_async &&other) noexcept
+    : state(std::move(other.state)), inbuf(std::move(other.inbuf)),
+      start(other.start), end(other.end), discarding(other.discarding),
+      connected(other.connected), all_classes(other.all_classes),
+      tpv(std::move(other.tpv)),
+      sky(std::move(other.sky)), att(std::move(other.att)),
+      ais(std::move(other.ais))
+{
+    other.connected = false;
+    other.discarding = false;
+    other.start = other.end = 0;
+}
+
+gpsmm_async &gpsmm_async::operator=(gpsmm_async &&other) noexcept
+{
+    if (this != &other) {
+        release();
+        state = std::move(other.state);
+        inbuf = std::move(other.inbuf);
+        start = other.start;
+        end = other.end;
+        discarding = other.discarding;
+        connected = other.connected;
+        all_classes = other.all_classes;
+        tpv = std::move(other.tpv);
+        sky = std::move(other.sky);
+        att = std::move(other.att);
+        ais = std::move(other.ais);
+        other.connected = false;
+        other.discarding = false;
+        other.start = other.end = 0;
+    }
+    return *this;
+}
+
+gpsmm_async::~gpsmm_async()
+{
+    release();
+}
+
+void gpsmm_async::release(void)
+{
+    if (connected) {
+        (void)gps_close(state.get());
+        connected = false;
+    }
+}
+
+int gpsmm_async::fd(void) const
+{
+    return connected && state ? state->gps_fd : -1;
+}
+
+const struct gps_data_t &gpsmm_async::data(void) const
+{
+    // what a moved-from object has to show
+    static const struct gps_data_t empty = {};
+
+    return state ? *state : empty;
+}
+
+bool gpsmm_async::stream(int flags)
+{
+    // dispatch() reads JSON lines only
+    flags &= ~WATCH_BINARY;
+    return connected && -1 != gps_stream(state.get(), flags, NULL);
+}
+
+bool gpsmm_async::send(const char *request)
+{
+    return connected && -1 != gps_send(state.get(), request);
+}
+
+/* Decode and dispatch each complete line in inbuf, in place.
+ * Whatever is left is a partial line, it is moved down only
+ * when the free space at the end runs short.  A line too long
+ * to ever fit is dropped, up to and including its '\n'. */
+int gpsmm_async::dispatch(void)
+{
+    char *buf = inbuf.get();
+    int count = 0;
+
+    if (discarding) {
+        char *eol = (char *)memchr(buf + start, '\n', end - start);
+
+        if (NULL == eol) {
+            // still in it
+            start = end = 0;
+            return 0;
+        }
+        start = eol - buf + 1;
+        discarding = false;
+    }
+    while (start < end) {
+        char *line = buf + start;
+        char *eol = (char *)memchr(line, '\n', end - start);
+        enum async_class cls;
+
+        if (NULL == eol) {
+            break;
+        }
+        *eol = '\0';
+        start = eol - buf + 1;
+
+        cls = async_classify(line);
+        if (!all_classes &&
+            !((ASYNC_TPV == cls && tpv) ||
+              (ASYNC_SKY == cls && sky) ||
+              (ASYNC_ATT == cls && att) ||
+              (ASYNC_AIS == cls && ais))) {
+            // nobody asked for it, do not parse it
+            continue;
+        }
+        state->set = 0;
+        (void)clock_gettime(CLOCK_REALTIME, &state->online);
+        (void)gps_unpack(line, state.get());
+        state->set |= ONLINE_SET | PACKET_SET;
+        count++;
+
+        switch (cls) {
+        case ASYNC_TPV:
+            if (tpv) {
+                tpv(state->fix);
+            }
+            break;
+        case ASYNC_SKY:
+            if (sky) {
+                sky(*state);
+            }
+            break;
+        case ASYNC_ATT:
+            if (att && 0 != (state->set & ATTITUDE_SET)) {
+                att(state->attitude);
+            }
+            break;
+        case ASYNC_AIS:
+            if (ais && 0 != (state->set & AIS_SET)) {
+                ais(state->ais);
+            }
+            break;
+        default:
+            break;
+        }
+    }
+
+    if (start == end) {
+        start = end = 0;
+    } else if (GPS_JSON_RESPONSE_MAX > ASYNC_BUFSIZE - end) {
+        if (0 == start) {
+            // a line longer than any gpsd response, drop it
+            end = 0;
+            discarding = true;
+        } else {
+            end -= start;
+            memmove(buf, buf + start, end);
+            start = 0;
+        }
+    }
+    return count;
+}
+
+int gpsmm_async::process_ready(void)
+{
+    int count = 0;
+
+    if (!connected ||
+        !state) {
+        return -1;
+    }
+    for (;;) {
+        size_t room = ASYNC_BUFSIZE - end;
+        ssize_t got = recv(state->gps_fd, inbuf.get() + end, room,
+                           MSG_DONTWAIT);
+
+        if (0 == got) {
+            // gpsd went away
+            return -1;
+        }
+        if (0 > got) {
+            if (EINTR == errno) {
+                continue;
+            }
+            if (EAGAIN == errno ||
+                EWOULDBLOCK == errno) {
+                break;
+            }
+            return -1;
+        }
+        end += got;
+        count += dispatch();
+        if ((size_t)got < room) {
+            // drained, do not starve the rest of the caller's loop
+            break;
+        }
+    }
+    return count;
+}
+
+int gpsmm_async::feed(const char *buf, size_t len)
+{
+    int count = 0;
+
+    if (!state) {
+        return -1;
+    }
+    while (0 < len) {
+        size_t chunk = ASYNC_BUFSIZE - end;
+
+        if (chunk > len) {
+            chunk = len;
+        }
+        memcpy(inbuf.get() + end, buf, chunk);
+        end += chunk;
+        buf += chunk;
+        len -= chunk;
+        count += dispatch();
+    }
+    return count;
+}
+#endif  // USE_QT, C++11
 // vim: set expandtab shiftwidth=4
@@ -49,6 +49,45 @@
 # endif
 #endif
 
+/* set the options gpsd wants on a socket it connects
+ * type -- SOCK_STREAM or SOCK_DGRAM
+ */
+static void netlib_sockopts(socket_t s, int type)
+{
+    int one;
+
+#ifdef IPTOS_LOWDELAY
+    {
+        int opt = IPTOS_LOWDELAY;
+
+        (void)setsockopt(s, IPPROTO_IP, IP_TOS, &opt, sizeof(opt));
+#ifdef IPV6_TCLASS
+        (void)setsockopt(s, IPPROTO_IPV6, IPV6_TCLASS, &opt, sizeof(opt));
+#endif
+    }
+#endif
+#ifdef TCP_NODELAY
+    /*
+     * This is a good performance enhancement when the socket is going to
+     * be used to pass a lot of short commands.  It prevents them from being
+     * delayed by the Nagle algorithm until they can be aggreagated into
+     * a large packet.  See https://en.wikipedia.org/wiki/Nagle%27s_algorithm
+     * for discussion.
+     */
+    if (SOCK_STREAM == type) {
+        one = 1;
+        (void)setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (char *)&one,
+                         sizeof(one));
+    }
+#endif
+    if (SOCK_STREAM == type) {
+        // Set keepalive on TCP connections.  Maybe detect disconnects better.
+        one = 1;
+        (void)setsockopt(s, IPPROTO_TCP, SO_KEEPALIVE, (char *)&one,
+                         sizeof(one));
+    }
+}
+
 /* connect to host, using service (port) on protocol (TCP/UDP)
  * af - Adress Family
  * host - host to connect to
@@ -204,36 +243,7 @@ socket_t netlib_connectsock1(int af, const char *host, const char *service,
         return ret;
     }
 
-#ifdef IPTOS_LOWDELAY
-    {
-        int opt = IPTOS_LOWDELAY;
-
-        (void)setsockopt(s, IPPROTO_IP, IP_TOS, &opt, sizeof(opt));
-#ifdef IPV6_TCLASS
-        (void)setsockopt(s, IPPROTO_IPV6, IPV6_TCLASS, &opt, sizeof(opt));
-#endif
-    }
-#endif
-#ifdef TCP_NODELAY
-    /*
-     * This is a good performance enhancement when the socket is going to
-     * be used to pass a lot of short commands.  It prevents them from being
-     * delayed by the Nagle algorithm until they can be aggreagated into
-     * a large packet.  See https://en.wikipedia.org/wiki/Nagle%27s_algorithm
-     * for discussion.
-     */
-    if (SOCK_STREAM == type) {
-        one = 1;
-        (void)setsockopt(s, IPPROTO_TCP, TCP_NODELAY, (char *)&one,
-                         sizeof(one));
-    }
-#endif
-    if (SOCK_STREAM == type) {
-        // Set keepalive on TCP connections.  Maybe detect disconnects better.
-        one = 1;
-        (void)setsockopt(s, IPPROTO_TCP, SO_KEEPALIVE, (char *)&one,
-                         sizeof(one));
-    }
+    netlib_sockopts(s, type);
 
     if (1 < nonblock) {
         // set socket to noblocking
@@ -256,6 +266,66 @@ socket_t netlib_connectsock(int af, const char *host, const char *service,
     return netlib_connectsock1(af, host, service, protocol, 2, false, NULL, 0);
 }
 
+/* start a non-blocking TCP connect() to one already resolved address
+ * sa, salen -- the address, as from getaddrinfo()
+ * addrbuf -- 50 char buf to put string of IP address conencting
+ *            INET6_ADDRSTRLEN
+ * addrbuf_sz -- sizeof(adddrbuf)
+ *
+ * The caller waits for the socket to become writable, then reads
+ * SO_ERROR to learn if the connect() worked.
+ *
+ * return socket on success, connect() may still be in progress
+ *        less than zero on error (NL_*)
+ */
+socket_t netlib_connectaddr(const struct sockaddr *sa, socklen_t salen,
+                            char *addrbuf, size_t addrbuf_sz)
+{
+    struct protoent *ppe;
+    int proto, one;
+    socket_t s;
+
+    if (NULL != addrbuf) {
+        sockaddr_t fsin;
+
+        (void)memset(&fsin, 0, sizeof(fsin));
+        (void)memcpy(&fsin, sa, salen < sizeof(fsin) ? salen : sizeof(fsin));
+        (void)socka2a(&fsin, addrbuf, addrbuf_sz);
+    }
+    ppe = getprotobyname("tcp");
+    proto = (ppe) ? ppe->p_proto : IPPROTO_TCP;
+    s = socket(sa->sa_family, SOCK_STREAM, proto);
+    if (BAD_SOCKET(s)) {
+        return NL_NOSOCK;
+    }
+    one = 1;
+    if (-1 == setsockopt(s, SOL_SOCKET, SO_REUSEADDR, (char *)&one,
+                         sizeof(one))) {
+        (void)close(s);
+        return NL_NOSOCKOPT;
+    }
+#ifdef HAVE_FCNTL
+    (void)fcntl(s, F_SETFL, fcntl(s, F_GETFL) | O_NONBLOCK);
+#elif defined(HAVE_WINSOCK2_H)
+    {
+        u_long one1 = 1;
+
+        (void)ioctlsocket(s, FIONBIO, &one1);
+    }
+#endif
+    if (0 != connect(s, sa, salen) &&
+        EINPROGRESS != errno) {
+#ifdef HAVE_WINSOCK2_H
+        (void)closesocket(s);
+#else
+        (void)close(s);
+#endif
+        return NL_NOCONNECT;
+    }
+    netlib_sockopts(s, SOCK_STREAM);
+    return s;
+}
+
 //  Convert NL_* error code to a string
 const char *netlib_errstr(const int err)
 {
@@ -272,6 +342,8 @@ const char *netlib_errstr(const int err)
         return "error SETSOCKOPT SO_REUSEADDR";
     case NL_NOCONNECT:
         return "can't connect to host/port pair";
+    case NL_PENDING:
+        return "name lookup in progress";
     default:
         break;
     }
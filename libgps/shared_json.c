@@ -19,6 +19,7 @@ PERMISSIONS
 
 #include <math.h>
 #include <stdbool.h>
+#include <string.h>         // for strcspn()
 
 #include "../include/gpsd.h"
 #include "../include/gps_json.h"
@@ -92,18 +93,62 @@ int json_device_read(const char *buf,
     return 0;
 }
 
+/* the rate control of a ?WATCH, from its intervals.  A class without
+ * its own interval takes the default one. */
+static void json_watch_rate(struct watch_rate_t *rate, double interval,
+                            const double *cls)
+{
+    int i;
+
+    rate->limited = false;
+    for (i = 0; i < WATCH_RATE_CLASSES; i++) {
+        double ival = 0 != isfinite(cls[i]) ? cls[i] : interval;
+
+        if (0 == isfinite(ival) ||
+            0.0 > ival) {
+            ival = 0.0;
+        }
+        rate->interval[i] = ival;
+        if (0.0 < ival) {
+            rate->limited = true;
+        }
+    }
+}
+
+/* parse a ?WATCH, or a WATCH response, in one pass.  The fields only
+ * gpsd uses go in req, the client side passes NULL for it.
+ *
+ * Return: 0 = OK, else a JSON_ERR_*
+ */
 int json_watch_read(const char *buf,
                     struct gps_policy_t *ccp,
+                    struct watch_request_t *req,
                     const char **endptr)
 {
+    struct watch_request_t scratch;
+    double interval;
+    double cls[WATCH_RATE_CLASSES];
+    char list[128];
     // *INDENT-OFF*
     struct json_attr_t chanconfig_attrs[] = {
         {"class",          t_check,    .dflt.check = "WATCH"},
 
+        {"binary",         t_boolean,  .addr.boolean = &scratch.binary,
+                                          .dflt.boolean = false},
+        {"classes",        t_string,   .addr.string = list,
+                                          .len = sizeof(list)},
+        {"coalesce",       t_boolean,  .addr.boolean = &scratch.rate.coalesce,
+                                          .dflt.boolean = false},
         {"device",         t_string,   .addr.string = ccp->devpath,
                                           .len = sizeof(ccp->devpath)},
         {"enable",         t_boolean,  .addr.boolean = &ccp->watcher,
                                           .dflt.boolean = true},
+        {"gst_interval",   t_real,     .addr.real = &cls[WATCH_RATE_GST],
+                                          .dflt.real = NAN},
+        {"imu_interval",   t_real,     .addr.real = &cls[WATCH_RATE_IMU],
+                                          .dflt.real = NAN},
+        {"interval",       t_real,     .addr.real = &interval,
+                                          .dflt.real = 0.0},
         {"json",           t_boolean,  .addr.boolean = &ccp->json,
                                           .nodefault = true},
         {"nmea",           t_boolean,  .addr.boolean = &ccp->nmea,
@@ -111,11 +156,23 @@ int json_watch_read(const char *buf,
         {"pps",            t_boolean,  .addr.boolean = &ccp->pps},
         {"raw",            t_integer,  .addr.integer = &ccp->raw,
                                           .nodefault = true},
+        {"raw_interval",   t_real,     .addr.real = &cls[WATCH_RATE_RAW],
+                                          .dflt.real = NAN},
+        {"relay",          t_boolean,  .addr.boolean = &scratch.relay,
+                                          .dflt.boolean = false},
         {"remote",         t_string,   .addr.string = ccp->remote,
                                           .len = sizeof(ccp->remote)},
+        {"resume",         t_ulongint, .addr.ulongint = &scratch.resume,
+                                          .dflt.ulongint = 0},
         {"scaled",         t_boolean,  .addr.boolean = &ccp->scaled},
+        {"sky_interval",   t_real,     .addr.real = &cls[WATCH_RATE_SKY],
+                                          .dflt.real = NAN},
         {"split24",        t_boolean,  .addr.boolean = &ccp->split24},
         {"timing",         t_boolean,  .addr.boolean = &ccp->timing},
+        {"tpv_interval",   t_real,     .addr.real = &cls[WATCH_RATE_TPV],
+                                          .dflt.real = NAN},
+        {"trace",          t_boolean,  .addr.boolean = &scratch.trace,
+                                          .dflt.boolean = false},
         // ignore unknown keys, for cross-version compatibility
         {"", t_ignore},
         {NULL},
@@ -124,7 +181,81 @@ int json_watch_read(const char *buf,
     int status;
 
     status = json_read_object(buf, chanconfig_attrs, endptr);
-    return status;
+    if (0 != status ||
+        NULL == req) {
+        return status;
+    }
+    json_watch_rate(&scratch.rate, interval, cls);
+    scratch.skip = ~json_class_mask(list) & GPS_CLASS_ALL;
+    *req = scratch;     // struct copy
+    return 0;
+}
+
+// the GPS_CLASS_* names, as in "class" and the ?WATCH "classes" list
+static const struct {
+    const char *name;
+    unsigned int mask;
+} class_names[] = {
+    {"TPV", GPS_CLASS_TPV},
+    {"SKY", GPS_CLASS_SKY},
+    {"GST", GPS_CLASS_GST},
+    {"ATT", GPS_CLASS_ATT},
+    {"IMU", GPS_CLASS_IMU},
+    {"AIS", GPS_CLASS_AIS},
+    {"RTCM2", GPS_CLASS_RTCM2},
+    {"RTCM3", GPS_CLASS_RTCM3},
+    {"TOFF", GPS_CLASS_TOFF},
+    {"PPS", GPS_CLASS_PPS},
+    {"OSC", GPS_CLASS_OSC},
+    {"RAW", GPS_CLASS_RAW},
+    {"SUBFRAME", GPS_CLASS_SUBFRAME},
+    {"LOG", GPS_CLASS_LOG},
+};
+
+/* Translate a comma separated list of class names to a GPS_CLASS_* mask.
+ * Unknown names are ignored, for cross-version compatibility.
+ * An empty list is all classes.
+ */
+unsigned int json_class_mask(const char *list)
+{
+    unsigned int mask = 0;
+
+    if ('\0' == *list) {
+        return GPS_CLASS_ALL;
+    }
+    while ('\0' != *list) {
+        size_t len = strcspn(list, ",");
+        unsigned i;
+
+        for (i = 0; i < ROWS(class_names); i++) {
+            if (len == strlen(class_names[i].name) &&
+                0 == strncmp(list, class_names[i].name, len)) {
+                mask |= class_names[i].mask;
+                break;
+            }
+        }
+        list += len;
+        if (',' == *list) {
+            list++;
+        }
+    }
+    return mask;
+}
+
+// Translate a GPS_CLASS_* mask to a comma separated list (outbuf)
+void json_class_list(unsigned int mask, char *outbuf, size_t outbuf_len)
+{
+    unsigned i;
+
+    outbuf[0] = '\0';
+    for (i = 0; i < ROWS(class_names); i++) {
+        if (0 != (mask & class_names[i].mask)) {
+            if ('\0' != outbuf[0]) {
+                (void)strlcat(outbuf, ",", outbuf_len);
+            }
+            (void)strlcat(outbuf, class_names[i].name, outbuf_len);
+        }
+    }
 }
 
 /* Translate a gps_policy_t to a WATCH string (outbuf)
@@ -0,0 +1,80 @@
+#!/bin/sh
+#
+# test_caster.sh - check the gpsd -c NTRIP caster with curl as the rover
+#
+# usage: test_caster.sh gpsfake logfile
+#
+# Plays logfile, which must have RTCM3 in it, through gpsfake, with gpsd
+# casting, then fetches the sourcetable and streams the mountpoint as an
+# NTRIP 2.0 and an NTRIP 1.0 rover, and checks they get RTCM3 frames.
+#
+# This file is Copyright by the GPSD project
+# SPDX-License-Identifier: BSD-2-clause
+
+GPSFAKE=${1:-./gpsfake}
+LOG=${2:-test/daemon/ublox-zed-f9t-rtcm3.log}
+# ports unlikely to be in use, and different per run
+GPSD_PORT=$((20000 + $$ % 10000))
+CASTER_PORT=$((GPSD_PORT + 10000))
+OUT=${TMPDIR:-/tmp}/test_caster.$$
+
+fail() {
+    echo "test_caster.sh: FAIL: $*"
+    kill -INT "$FAKE" 2>/dev/null
+    rm -f "$OUT" "$OUT.head"
+    exit 1
+}
+
+# the first byte of a file, in hex
+first_byte() {
+    od -A n -t x1 -N 1 "$1" | tr -d ' '
+}
+
+"$GPSFAKE" -q -n -c 0.05 -P "$GPSD_PORT" -o "--caster $CASTER_PORT" "$LOG" \
+    >/dev/null 2>&1 &
+FAKE=$!
+
+# wait for the listener, and for a mountpoint
+tries=0
+while :; do
+    sleep 1
+    if curl -s -H "Ntrip-Version: Ntrip/2.0" -D "$OUT.head" -o "$OUT" \
+            "http://127.0.0.1:$CASTER_PORT/" &&
+       grep -q '^STR;' "$OUT"; then
+        break
+    fi
+    tries=$((tries + 1))
+    [ 10 -gt $tries ] || fail "no sourcetable from gpsd -c $CASTER_PORT"
+done
+
+grep -q '^HTTP/1.1 200' "$OUT.head" || fail "sourcetable status"
+grep -qi '^Content-Type: gnss/sourcetable' "$OUT.head" ||
+    fail "sourcetable content type"
+grep -q '^ENDSOURCETABLE' "$OUT" || fail "no ENDSOURCETABLE"
+MOUNT=$(sed -n 's/^STR;\([^;]*\);.*RTCM 3.*/\1/p' "$OUT" | head -n 1)
+[ -n "$MOUNT" ] || fail "no RTCM 3 mountpoint"
+
+# NTRIP 2.0, chunked, curl takes the chunks apart
+curl -s -m 3 -H "Ntrip-Version: Ntrip/2.0" -D "$OUT.head" -o "$OUT" \
+    "http://127.0.0.1:$CASTER_PORT/$MOUNT"
+grep -qi '^Transfer-Encoding: chunked' "$OUT.head" || fail "v2 not chunked"
+[ "$(first_byte "$OUT")" = "d3" ] || fail "v2 stream is not RTCM3"
+
+# NTRIP 1.0, raw, curl takes "ICY 200 OK" for HTTP/0.9 and keeps it
+curl -s -m 3 --http0.9 -H "User-Agent: NTRIP test_caster" -o "$OUT" \
+    "http://127.0.0.1:$CASTER_PORT/$MOUNT"
+[ "$(head -n 1 "$OUT" | tr -d '\r')" = "ICY 200 OK" ] || fail "v1 status"
+# the headers end, then the frames start
+od -A n -t x1 -v "$OUT" | tr -d ' \n' | grep -q '0d0a0d0ad3' ||
+    fail "v1 stream is not RTCM3"
+
+curl -s -H "Ntrip-Version: Ntrip/2.0" -D "$OUT.head" -o /dev/null \
+    "http://127.0.0.1:$CASTER_PORT/nosuchmount"
+grep -q '^HTTP/1.1 404' "$OUT.head" || fail "no 404 for nosuchmount"
+
+kill -INT "$FAKE" 2>/dev/null
+rm -f "$OUT" "$OUT.head"
+echo "test_caster.sh: OK"
+exit 0
+
+# vim: set expandtab shiftwidth=4
@@ -0,0 +1,89 @@
+#!/bin/sh
+#
+# test_frontend.sh - check a gpsd serving its clients from -W front ends
+#
+# usage: test_frontend.sh gpsfake logfile [python]
+#
+# Plays logfile, which must be NMEA with fixes, through gpsfake, to a
+# gpsd with two front ends, and checks that each of several JSON watchers
+# gets the TPV of the device, and that a ?DEVICE= and a ?TSTATS are
+# answered, through the core, with the device.
+#
+# This file is Copyright by the GPSD project
+# SPDX-License-Identifier: BSD-2-clause
+
+GPSFAKE=${1:-./gpsfake}
+LOG=${2:-test/daemon/GPSmap-76S.log}
+PYTHON=${3:-python3}
+# a port unlikely to be in use, and different per run
+PORT=$((20000 + $$ % 10000))
+OUT=${TMPDIR:-/tmp}/test_frontend.$$
+
+fail() {
+    echo "test_frontend.sh: FAIL: $*"
+    kill -INT "$FAKE" 2>/dev/null
+    rm -f "$OUT"
+    exit 1
+}
+
+"$GPSFAKE" -q -n -c 0.05 -P "$PORT" -o "--workers 2" "$LOG" \
+    >/dev/null 2>&1 &
+FAKE=$!
+sleep 2
+
+# 4 watchers at once, each wants 3 TPV, then the answer to ?DEVICE=
+"$PYTHON" -c '
+import json, socket, sys
+port = int(sys.argv[1])
+clients = []
+for _ in range(4):
+    s = socket.create_connection(("127.0.0.1", port), 20)
+    s.sendall(b"?WATCH={\"enable\":true,\"json\":true};\n")
+    clients.append(s.makefile("rb"))
+path = None
+for f in clients:
+    tpv = 0
+    while tpv < 3:
+        line = f.readline()
+        if not line:
+            sys.exit("watcher got no TPV")
+        msg = json.loads(line)
+        if "TPV" == msg["class"] and "mode" in msg:
+            path = msg["device"]
+            tpv += 1
+s = socket.create_connection(("127.0.0.1", port), 20)
+f = s.makefile("rb")
+s.sendall(b"?DEVICE={\"path\":\"%s\"};\n" % path.encode())
+while True:
+    line = f.readline()
+    if not line:
+        sys.exit("no answer to ?DEVICE=")
+    msg = json.loads(line)
+    if "DEVICE" == msg["class"]:
+        break
+    if "ERROR" == msg["class"]:
+        sys.exit(msg["message"])
+s.sendall(b"?TSTATS;\n")
+while True:
+    tline = f.readline()
+    if not tline:
+        sys.exit("no answer to ?TSTATS")
+    msg = json.loads(tline)
+    if "TSTATS" == msg["class"]:
+        if path != msg.get("device"):
+            sys.exit("?TSTATS without the device")
+        break
+    if "ERROR" == msg["class"]:
+        sys.exit(msg["message"])
+with open(sys.argv[2], "w") as out:
+    out.write(line.decode())
+' "$PORT" "$OUT" || fail "clients of the front ends not served"
+
+grep -q '"class":"DEVICE"' "$OUT" || fail "?DEVICE= not answered"
+
+kill -INT "$FAKE" 2>/dev/null
+rm -f "$OUT"
+echo "test_frontend.sh: OK"
+exit 0
+
+# vim: set expandtab shiftwidth=4
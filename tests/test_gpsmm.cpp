@@ -11,6 +11,16 @@
 
 #include <getopt.h>
 #include <iostream>
+#if !defined(USE_QT) && 201103L <= __cplusplus
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <poll.h>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#define ASYNC_TESTS
+#endif
 
 #include "../include/libgpsmm.h"
 #include "../include/timespec.h"
@@ -138,30 +148,286 @@ static void libgps_dump_state(struct gps_data_t *collect)
     }
 }
 
+#ifdef ASYNC_TESTS
+// event loop with gpsmm_async, typed callbacks
+static int async_loop(const struct fixsource_t *source, uint looper)
+{
+    gpsmm_async gps_rec(source->server, source->port);
+    char ts_str[TIMESPEC_LEN];
+
+    gps_rec.on_tpv([&ts_str](const struct gps_fix_t &fix) {
+        (void)fprintf(stdout, "TPV: mode %d time %s lat/lon %lf %lf\n",
+                      fix.mode,
+                      timespec_str(&fix.time, ts_str, sizeof(ts_str)),
+                      fix.latitude, fix.longitude);
+    });
+    gps_rec.on_sky([](const struct gps_data_t &sky) {
+        (void)fprintf(stdout, "SKY: %d visible %d used\n",
+                      sky.satellites_visible, sky.satellites_used);
+    });
+    gps_rec.on_att([](const struct attitude_t &att) {
+        (void)fprintf(stdout, "ATT: heading %lf pitch %lf roll %lf\n",
+                      att.heading, att.pitch, att.roll);
+    });
+    gps_rec.on_ais([](const struct ais_t &ais) {
+        (void)fprintf(stdout, "AIS: type %u mmsi %u\n",
+                      ais.type, ais.mmsi);
+    });
+
+    // moving it must keep the connection and the callbacks
+    gpsmm_async moved(std::move(gps_rec));
+
+    if (!moved.is_open() ||
+        !moved.stream(WATCH_ENABLE|WATCH_JSON)) {
+        cerr << "No GPSD running.\n";
+        return 1;
+    }
+    for (uint ll = 0; ll < looper; ll++) {
+        struct pollfd pfd = {moved.fd(), POLLIN, 0};
+
+        if (0 >= poll(&pfd, 1, 5000)) {
+            continue;
+        }
+        if (0 > moved.process_ready()) {
+            cerr << "Read error.\n";
+            return 1;
+        }
+    }
+    cout << "Exiting\n";
+    return 0;
+}
+
+/* Read the JSON lines of a file of gpsd output, as a .chk file,
+ * into json, one per line.
+ *
+ * Return: the count of lines */
+static unsigned long json_lines(const char *path, std::string &json)
+{
+    std::ifstream in(path);
+    std::stringstream ss;
+    unsigned long lines = 0;
+
+    ss << in.rdbuf();
+    for (std::string line; std::getline(ss, line); ) {
+        if ('{' == line[0]) {
+            json += line + "\n";
+            lines++;
+        }
+    }
+    return lines;
+}
+
+/* Replay a file of gpsd JSON through gpsmm_async, whole, and in
+ * 7 byte pieces so most lines arrive split over feed() calls.
+ * A line longer than any gpsd response goes first, made of TPVs
+ * that must not be seen.  Each way must dispatch every TPV and SKY
+ * of the file, and end on the same fix time. */
+static int async_replay(const char *path)
+{
+    static const size_t pieces[] = {0, 7};    // 0 is whole
+    std::string json;
+    std::string overlong;
+    unsigned long lines = json_lines(path, json);
+    unsigned long want_tpv = 0, want_sky = 0;
+    timespec_t last[2] = {{0, 0}, {0, 0}};
+    int failure = 0;
+
+    if (0 == lines) {
+        cerr << path << ": no JSON in file\n";
+        return 1;
+    }
+    while (3 * GPS_JSON_RESPONSE_MAX > overlong.size()) {
+        overlong += "{\"class\":\"TPV\",\"mode\":1}";
+    }
+    overlong += "\n";
+    for (size_t pos = 0; pos < json.size(); pos = json.find('\n', pos) + 1) {
+        if (0 == json.compare(pos, 14, "{\"class\":\"TPV\"")) {
+            want_tpv++;
+        } else if (0 == json.compare(pos, 14, "{\"class\":\"SKY\"")) {
+            want_sky++;
+        }
+    }
+
+    for (uint i = 0; i < sizeof(pieces) / sizeof(pieces[0]); i++) {
+        size_t piece = 0 == pieces[i] ? json.size() : pieces[i];
+        gpsmm_async gps;
+        unsigned long tpv = 0, sky = 0;
+        int msgs = 0;
+
+        gps.on_tpv([&tpv, &last, i](const struct gps_fix_t &fix) {
+            tpv++;
+            if (TS_NZ(&fix.time)) {
+                last[i] = fix.time;
+            }
+        });
+        gps.on_sky([&sky](const struct gps_data_t &) { sky++; });
+        for (size_t pos = 0; pos < overlong.size(); pos += piece) {
+            msgs += gps.feed(overlong.data() + pos,
+                             std::min(piece, overlong.size() - pos));
+        }
+        for (size_t pos = 0; pos < json.size(); pos += piece) {
+            msgs += gps.feed(json.data() + pos,
+                             std::min(piece, json.size() - pos));
+        }
+
+        // what is left behind by a move is closed, and empty
+        gpsmm_async moved(std::move(gps));
+
+        if (0 == (moved.data().set & PACKET_SET) ||
+            -1 != gps.fd() ||
+            -1 != gps.process_ready() ||
+            -1 != gps.feed(json.data(), json.size()) ||
+            0 != gps.data().set ||
+            TS_NZ(&gps.data().fix.time)) {
+            (void)fputs("FAIL: moved-from object not empty\n", stderr);
+            failure++;
+        }
+        if (want_tpv != tpv ||
+            want_sky != sky ||
+            (unsigned long)msgs != tpv + sky) {
+            (void)fprintf(stderr,
+                          "FAIL: %zu byte pieces, %d messages, "
+                          "%lu/%lu TPV, %lu/%lu SKY\n",
+                          piece, msgs, tpv, want_tpv, sky, want_sky);
+            failure++;
+        }
+    }
+    if (!TS_NZ(&last[0]) ||
+        !TS_EQ(&last[0], &last[1])) {
+        (void)fputs("FAIL: the last fix time differs in pieces\n", stderr);
+        failure++;
+    }
+    if (0 == failure) {
+        (void)fprintf(stdout, "%lu lines, %lu TPV, %lu SKY\n",
+                      lines, want_tpv, want_sky);
+    }
+    return 0 == failure ? 0 : 1;
+}
+
+/* Decode a file of gpsd JSON, as from a .chk file, repeats times.
+ * Compare gpsmm style (decode everything, copy the struct out) with
+ * gpsmm_async decoding everything, and decoding TPV only. */
+static int async_bench(const char *path, uint repeats)
+{
+    std::string json;
+    std::string copy;
+    unsigned long tpv_all = 0, tpv_only = 0;
+    unsigned long lines = json_lines(path, json);
+    int msgs = 0;
+
+    if (0 == lines) {
+        cerr << path << ": no JSON in file\n";
+        return 1;
+    }
+
+    typedef std::chrono::steady_clock clk;
+    std::unique_ptr<struct gps_data_t> legacy(new struct gps_data_t());
+    std::unique_ptr<struct gps_data_t> user(new struct gps_data_t());
+    clk::time_point t0 = clk::now();
+
+    for (uint r = 0; r < repeats; r++) {
+        size_t pos = 0, eol;
+
+        copy = json;            // gps_unpack() writes on its input
+        while (std::string::npos != (eol = copy.find('\n', pos))) {
+            copy[eol] = '\0';
+            (void)gps_unpack(&copy[pos], legacy.get());
+            *user = *legacy;    // what gpsmm::read() does
+            pos = eol + 1;
+        }
+    }
+    clk::time_point t1 = clk::now();
+
+    gpsmm_async all;
+    all.decode_all(true);
+    all.on_tpv([&tpv_all](const struct gps_fix_t &) { tpv_all++; });
+    for (uint r = 0; r < repeats; r++) {
+        msgs += all.feed(json.data(), json.size());
+    }
+    clk::time_point t2 = clk::now();
+
+    gpsmm_async tpv;
+    tpv.on_tpv([&tpv_only](const struct gps_fix_t &) { tpv_only++; });
+    for (uint r = 0; r < repeats; r++) {
+        (void)tpv.feed(json.data(), json.size());
+    }
+    clk::time_point t3 = clk::now();
+
+    double n = (double)lines * repeats;
+    auto rate = [n](clk::time_point a, clk::time_point b) {
+        return n / std::chrono::duration<double>(b - a).count();
+    };
+    (void)fprintf(stdout, "%lu lines x %u\n", lines, repeats);
+    (void)fprintf(stdout, "gpsmm copy:      %12.0f lines/s\n", rate(t0, t1));
+    (void)fprintf(stdout, "async all:       %12.0f lines/s\n", rate(t1, t2));
+    (void)fprintf(stdout, "async TPV only:  %12.0f lines/s\n", rate(t2, t3));
+
+    if ((unsigned long)msgs != lines * repeats ||
+        tpv_all != tpv_only) {
+        (void)fprintf(stderr, "FAIL: %d messages, %lu/%lu TPV\n",
+                      msgs, tpv_all, tpv_only);
+        return 1;
+    }
+    return 0;
+}
+#endif  // ASYNC_TESTS
 
 int main(int argc, char *argv[])
 {
     uint looper = UINT_MAX;
+#ifdef ASYNC_TESTS
+    bool async = false;
+    const char *bench = NULL;
+#endif
 
     // A typical C++ program may look to use a more native option parsing method
     // such as boost::program_options
     // But for this test program we don't want extra dependencies
     // Hence use C style getopt for (build) simplicity
     int option;
-    while ((option = getopt(argc, argv, "l:h?")) != -1) {
+    while ((option = getopt(argc, argv, "ab:l:h?")) != -1) {
         switch (option) {
+#ifdef ASYNC_TESTS
+        case 'a':
+            async = true;
+            break;
+        case 'b':
+            bench = optarg;
+            break;
+#endif
         case 'l':
             looper = atoi(optarg);
             break;
         case '?':
         case 'h':
         default:
-            cout << "usage: " << argv[0] << " [-l n]\n";
+            cout << "usage: " << argv[0] << " [-a] [-b jsonfile] [-l n] "
+                    "[server[:port[:device]]]\n"
+                 << "       " << argv[0] << " -a jsonfile\n";
             exit(EXIT_FAILURE);
             break;
         }
     }
 
+#ifdef ASYNC_TESTS
+    if (NULL != bench) {
+        // -l is the repeat count here
+        return async_bench(bench, UINT_MAX == looper ? 100 : looper);
+    }
+#endif
+
+#ifdef ASYNC_TESTS
+    struct stat sb;
+
+    if (async &&
+        optind < argc &&
+        0 == stat(argv[optind], &sb) &&
+        S_ISREG(sb.st_mode)) {
+        // gpsd JSON from a file, no gpsd
+        return async_replay(argv[optind]);
+    }
+#endif
+
     struct fixsource_t source;
     // Grok the server, port, and device.
     if (optind < argc) {
@@ -170,6 +436,12 @@ int main(int argc, char *argv[])
         gpsd_source_spec(NULL, &source);
     }
 
+#ifdef ASYNC_TESTS
+    if (async) {
+        return async_loop(&source, looper);
+    }
+#endif
+
     // gpsmm gps_rec("localhost", DEFAULT_GPSD_PORT);
     gpsmm gps_rec(source.server, source.port);
 
@@ -15,6 +15,7 @@
 
 #include "../include/gps.h"       // for safe_atof()
 #include "../include/gpsd.h"
+#include "../include/gps_binary.h"
 #include "../include/gps_json.h"
 
 // Note: JSON_MINIMAL no longer exists
@@ -475,10 +476,42 @@ static const struct json_attr_t json_attrs_25[] = {
     {NULL},
 };
 
+// Case 37: attribute lookup, first match wins, "" t_ignore hides the rest
+
+static char *json_str37 =
+    "{\"class\":\"TST\",\"alpha\":1,\"beta\":2,\"gamma\":3}";
+
+int alpha37, beta37, gamma37, delta37;
+static const struct json_attr_t json_attrs_37[] = {
+    {"class", t_check, .dflt.check = "TST"},
+    {"beta", t_integer, .addr.integer = &beta37, .dflt.integer = -1},
+    {"alpha", t_integer, .addr.integer = &alpha37, .dflt.integer = -1},
+    {"", t_ignore},
+    {"delta", t_integer, .addr.integer = &delta37, .dflt.integer = -1},
+    {"gamma", t_integer, .addr.integer = &gamma37, .dflt.integer = -1},
+    {NULL},
+};
+
+// Case 38: unknown attribute, no t_ignore
+
+static char *json_str38 = "{\"class\":\"TPV\",\"bogus\":1}";
 
 char str32[] = "\f\n\r\t\v";
 // *INDENT-ON*
 
+// Cases 39 to 43: binary frames, decoded into bindata
+static struct gps_data_t bindata;
+static char frame[GPSB_MAX];
+
+// check the length of the frame just encoded, then decode it
+static void binary_decode(size_t len)
+{
+    assert_other("frame len", gpsb_frame_len(frame, len), (int)len);
+    assert_other("short frame", gpsb_frame_len(frame, len - 1), 0);
+    memset((void *)&bindata, 0, sizeof(bindata));
+    assert_case(libgps_binary_unpack(frame, len, &bindata));
+}
+
 static void jsontest(int i)
 {
     int status = 0;      // libgps_json_unpack() returned status
@@ -897,7 +930,115 @@ static void jsontest(int i)
         }
         break;
 
-#define MAXTEST 36
+    case 37: // attribute lookup order
+        status = json_read_object(json_str37, json_attrs_37, NULL);
+        assert_case(status);
+        assert_int("alpha", "t_integer", alpha37, 1);
+        assert_int("beta", "t_integer", beta37, 2);
+        assert_int("gamma", "t_integer", gamma37, -1);
+        break;
+
+    case 38: // unknown attribute
+        status = json_read_object(json_str38, json_attrs_25, NULL);
+        assert_int("status", "t_integer", status, JSON_ERR_BADATTR);
+        break;
+
+    case 39: // TPV, JSON to binary and back
+        status = libgps_json_unpack(json_str1, &gpsdata, NULL);
+        assert_case(status);
+        binary_decode(gpsb_tpv_dump(&gpsdata, 18, frame, sizeof(frame)));
+        assert_string("device", bindata.dev.path, "GPS#1");
+        assert_int("leap", "GPSB_I32", bindata.leap_seconds, 18);
+        assert_int("mode", "GPSB_I32", bindata.fix.mode, 3);
+        assert_ts("time", bindata.fix.time, gpsdata.fix.time);
+        assert_real("lat", bindata.fix.latitude, 7.568074350);
+        assert_real("lon", bindata.fix.longitude, 46.498203637);
+        assert_real("altHAE", bindata.fix.altHAE, 1327.780);
+        assert_real("epx", bindata.fix.epx, 21.0);
+        assert_real("wtemp", bindata.fix.wtemp, 3.0);
+        assert_boolean("speed", isfinite(bindata.fix.speed), false);
+        assert_uint("set", "gps_mask_t", bindata.set & LATLON_SET,
+                    LATLON_SET);
+        break;
+
+    case 40: // SKY, JSON to binary and back
+        status = libgps_json_unpack(json_str2, &gpsdata, NULL);
+        assert_case(status);
+        binary_decode(gpsb_sky_dump(&gpsdata, frame, sizeof(frame)));
+        assert_ts("time", bindata.skyview_time, gpsdata.skyview_time);
+        assert_int("visible", "t_integer", bindata.satellites_visible, 7);
+        assert_int("used", "t_integer", bindata.satellites_used, 6);
+        assert_int("PRN[0]", "GPSB_I16", bindata.skyview[0].PRN, 10);
+        assert_real("az[0]", bindata.skyview[0].azimuth, 196);
+        assert_int("freqid[0]", "GPSB_I8", bindata.skyview[0].freqid, -1);
+        assert_int("PRN[6]", "GPSB_I16", bindata.skyview[6].PRN, 21);
+        assert_real("el[6]", bindata.skyview[6].elevation, 10);
+        assert_real("ss[6]", bindata.skyview[6].ss, 0);
+        assert_boolean("used[6]", bindata.skyview[6].used, false);
+        break;
+
+    case 41: // ATT and IMU
+        gpsdata.attitude.mtime.tv_sec = 1700000000;
+        gpsdata.attitude.heading = 271.25;
+        gpsdata.attitude.pitch = NAN;
+        gpsdata.attitude.mag_st = 'N';
+        gpsdata.attitude.base.east = 1.125;
+        (void)strlcpy(gpsdata.attitude.msg, "PASHR",
+                      sizeof(gpsdata.attitude.msg));
+        binary_decode(gpsb_att_dump(&gpsdata, &gpsdata.attitude, GPSB_ATT,
+                                    frame, sizeof(frame)));
+        assert_uint("set", "gps_mask_t", bindata.set, ATTITUDE_SET);
+        assert_string("msg", bindata.attitude.msg, "PASHR");
+        assert_real("heading", bindata.attitude.heading, 271.25);
+        assert_boolean("pitch", isfinite(bindata.attitude.pitch), false);
+        assert_int("mag_st", "GPSB_I8", bindata.attitude.mag_st, 'N');
+        assert_real("east", bindata.attitude.base.east, 1.125);
+        binary_decode(gpsb_att_dump(&gpsdata, &gpsdata.attitude, GPSB_IMU,
+                                    frame, sizeof(frame)));
+        assert_uint("set", "gps_mask_t", bindata.set, IMU_SET);
+        assert_real("heading", bindata.imu[0].heading, 271.25);
+        break;
+
+    case 42: // RAW, the empty and GLONASS 255 slots are left out
+        gpsdata.raw.mtime.tv_sec = 1700000000;
+        gpsdata.raw.mtime.tv_nsec = 123456789;
+        gpsdata.raw.meas[0].svid = 255;
+        gpsdata.raw.meas[2].gnssid = 2;
+        gpsdata.raw.meas[2].svid = 11;
+        gpsdata.raw.meas[2].pseudorange = 23456789.125;
+        gpsdata.raw.meas[2].locktime = 64500;
+        (void)strlcpy(gpsdata.raw.meas[2].obs_code, "1C",
+                      sizeof(gpsdata.raw.meas[2].obs_code));
+        binary_decode(gpsb_raw_dump(&gpsdata, frame, sizeof(frame)));
+        assert_ts("mtime", bindata.raw.mtime, gpsdata.raw.mtime);
+        assert_int("svid[0]", "GPSB_U8", bindata.raw.meas[0].svid, 11);
+        assert_int("gnssid[0]", "GPSB_U8", bindata.raw.meas[0].gnssid, 2);
+        assert_string("obs_code[0]", bindata.raw.meas[0].obs_code, "1C");
+        assert_real("pseudorange[0]", bindata.raw.meas[0].pseudorange,
+                    23456789.125);
+        assert_uint("locktime[0]", "GPSB_U32", bindata.raw.meas[0].locktime,
+                    64500);
+        assert_int("svid[1]", "GPSB_U8", bindata.raw.meas[1].svid, 0);
+        break;
+
+    case 43: // framing errors
+        status = libgps_json_unpack(json_str1, &gpsdata, NULL);
+        assert_case(status);
+        n = (int)gpsb_tpv_dump(&gpsdata, -1, frame, sizeof(frame));
+        // too small for the header and device, nothing is written
+        assert_other("no room", (int)gpsb_tpv_dump(&gpsdata, -1, buffer, 10),
+                     0);
+        assert_other("header", gpsb_frame_len(frame, GPSB_HEADER - 1), 0);
+        frame[GPSB_HEADER + 1] = 0;         // no such type
+        assert_other("bad type", libgps_binary_unpack(frame, n, &bindata),
+                     -1);
+        frame[3] = GPSB_VERSION + 1;
+        assert_other("version", gpsb_frame_len(frame, n), -1);
+        frame[0] = '{';
+        assert_other("sync", gpsb_frame_len(frame, n), -1);
+        break;
+
+#define MAXTEST 43
 
     default:
         (void)fputs("Unknown test number\n", stderr);
@@ -905,13 +1046,176 @@ static void jsontest(int i)
     }
 }
 
+/* Parse throughput over a file of gpsd JSON, such as the .chk files
+ * of the daemon regression tests.  Lines not starting with '{' are
+ * skipped. */
+static void jsonbench(const char *path, int repeats)
+{
+    FILE *fp = fopen(path, "r");
+    static char line[GPS_JSON_RESPONSE_MAX * 2];
+    struct timespec start, stop;
+    unsigned long lines = 0, fails = 0;
+    double elapsed;
+    int r;
+
+    if (NULL == fp) {
+        (void)fprintf(stderr, "can not open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (r = 0; r < repeats; r++) {
+        rewind(fp);
+        while (NULL != fgets(line, sizeof(line), fp)) {
+            const char *end;
+
+            if ('{' != line[0]) {
+                continue;
+            }
+            lines++;
+            if (0 != libgps_json_unpack(line, &gpsdata, &end)) {
+                fails++;
+            }
+        }
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &stop);
+    (void)fclose(fp);
+
+    elapsed = (stop.tv_sec - start.tv_sec) +
+              (stop.tv_nsec - start.tv_nsec) / 1e9;
+    (void)printf("%lu objects, %lu not parsed, %.3f sec, %.0f objects/sec\n",
+                 lines, fails, elapsed, lines / elapsed);
+}
+
+/* Size and decode time of the reports in a file of gpsd JSON that
+ * have a binary encoding, as JSON and as binary frames. */
+static void binbench(const char *path, int repeats)
+{
+    FILE *fp = fopen(path, "r");
+    static char line[GPS_JSON_RESPONSE_MAX * 2];
+    static const struct {
+        const char *prefix;
+        int cls;
+    } classes[] = {
+        {"{\"class\":\"TPV\"", GPSB_TPV},
+        {"{\"class\":\"SKY\"", GPSB_SKY},
+        {"{\"class\":\"ATT\"", GPSB_ATT},
+        {"{\"class\":\"IMU\"", GPSB_IMU},
+        {"{\"class\":\"RAW\"", GPSB_RAW},
+    };
+    size_t frames_size = 1024 * 1024, frames_len = 0, json_len = 0;
+    char *frames = malloc(frames_size);
+    char *lines = malloc(frames_size * 4);
+    size_t lines_len = 0;
+    unsigned long objects = 0;
+    struct timespec start, stop;
+    double json_time, bin_time;
+    int r;
+
+    if (NULL == fp) {
+        (void)fprintf(stderr, "can not open %s\n", path);
+        exit(EXIT_FAILURE);
+    }
+    if (NULL == frames ||
+        NULL == lines) {
+        (void)fprintf(stderr, "out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    while (NULL != fgets(line, sizeof(line), fp)) {
+        size_t len = strlen(line), n = 0;
+        unsigned i;
+
+        for (i = 0; i < ROWS(classes); i++) {
+            if (0 == strncmp(line, classes[i].prefix,
+                             strlen(classes[i].prefix))) {
+                break;
+            }
+        }
+        if (ROWS(classes) == i ||
+            frames_size - frames_len < GPSB_MAX ||
+            frames_size * 4 - lines_len <= len) {
+            continue;
+        }
+        memset((void *)&gpsdata, 0, sizeof(gpsdata));
+        if (0 != libgps_json_unpack(line, &gpsdata, NULL)) {
+            continue;
+        }
+        switch (classes[i].cls) {
+        case GPSB_TPV:
+            n = gpsb_tpv_dump(&gpsdata, -1, frames + frames_len, GPSB_MAX);
+            break;
+        case GPSB_SKY:
+            n = gpsb_sky_dump(&gpsdata, frames + frames_len, GPSB_MAX);
+            break;
+        case GPSB_ATT:
+            n = gpsb_att_dump(&gpsdata, &gpsdata.attitude, GPSB_ATT,
+                              frames + frames_len, GPSB_MAX);
+            break;
+        case GPSB_IMU:
+            n = gpsb_att_dump(&gpsdata, &gpsdata.imu[0], GPSB_IMU,
+                              frames + frames_len, GPSB_MAX);
+            break;
+        case GPSB_RAW:
+            n = gpsb_raw_dump(&gpsdata, frames + frames_len, GPSB_MAX);
+            break;
+        }
+        if (0 == n) {
+            continue;
+        }
+        frames_len += n;
+        memcpy(lines + lines_len, line, len + 1);
+        lines_len += len + 1;
+        json_len += len;
+        objects++;
+    }
+    (void)fclose(fp);
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (r = 0; r < repeats; r++) {
+        size_t off;
+
+        for (off = 0; off < lines_len; off += strlen(lines + off) + 1) {
+            (void)libgps_json_unpack(lines + off, &gpsdata, NULL);
+        }
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &stop);
+    json_time = (stop.tv_sec - start.tv_sec) +
+                (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+    (void)clock_gettime(CLOCK_MONOTONIC, &start);
+    for (r = 0; r < repeats; r++) {
+        size_t off;
+        int n;
+
+        for (off = 0; off < frames_len; off += n) {
+            n = gpsb_frame_len(frames + off, frames_len - off);
+            if (0 >= n) {
+                break;
+            }
+            (void)libgps_binary_unpack(frames + off, n, &gpsdata);
+        }
+    }
+    (void)clock_gettime(CLOCK_MONOTONIC, &stop);
+    bin_time = (stop.tv_sec - start.tv_sec) +
+               (stop.tv_nsec - start.tv_nsec) / 1e9;
+
+    (void)printf("%lu reports, JSON %zu bytes %.3f sec, "
+                 "binary %zu bytes %.3f sec\n",
+                 objects, json_len, json_time, frames_len, bin_time);
+    free(frames);
+    free(lines);
+}
+
 int main(int argc UNUSED, char *argv[]UNUSED)
 {
     int option;
     int individual = 0;
+    const char *bench = NULL;
 
-    while ((option = getopt(argc, argv, "D:hn:V?")) != -1) {
+    while ((option = getopt(argc, argv, "b:D:hn:V?")) != -1) {
         switch (option) {
+        case 'b':
+            bench = optarg;
+            break;
         case 'D':
             debug = atoi(optarg);
             gps_enable_debug(debug, stdout);
@@ -925,7 +1229,9 @@ int main(int argc UNUSED, char *argv[]UNUSED)
             FALLTHROUGH
         default:
             (void)fprintf(stderr,
-                        "usage: %s [-D lvl] [-n tst] [-V]\n"
+                        "usage: %s [-b file] [-D lvl] [-n tst] [-V]\n"
+                        "       -b file     benchmark parsing JSON in file, and\n"
+                        "                   the same reports as binary\n"
                         "       -D lvl      set debug level\n"
                         "       -n tst      run only test tst\n"
                         "       -V          Print version and exit\n",
@@ -938,6 +1244,12 @@ int main(int argc UNUSED, char *argv[]UNUSED)
         }
     }
 
+    if (NULL != bench) {
+        jsonbench(bench, 10);
+        binbench(bench, 10);
+        exit(EXIT_SUCCESS);
+    }
+
     (void)fprintf(stderr, "JSON unit tests\n");
 
     if (individual) {
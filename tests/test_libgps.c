@@ -14,6 +14,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>
 #include <unistd.h>
 
 #include "../include/gps.h"
@@ -30,6 +31,130 @@ static void onsig(int sig)
  * pointer fields. */
 static struct gps_data_t gpsdata;
 
+/* a gps_data_t on one end of a socket pair, the other end, peer, plays
+ * the daemon
+ * Return: 0 -- success
+ * Return: negative -- fail */
+static int selftest_open(struct gps_data_t *client, int *peer)
+{
+    int sv[2];
+
+    (void)memset(client, 0, sizeof(*client));
+    if (0 != socketpair(AF_UNIX, SOCK_STREAM, 0, sv)) {
+        return -1;
+    }
+    client->gps_fd = sv[0];
+    client->privdata = (struct privdata_t *)calloc(1,
+                                                   sizeof(struct privdata_t));
+    if (NULL == client->privdata) {
+        return -1;
+    }
+    *peer = sv[1];
+    return 0;
+}
+
+// gps_stream() with every flag and a long class list, sends it all
+static int selftest_stream(void)
+{
+    static const char *dev =
+        "/dev/serial/by-id/usb-u-blox_AG_-_www.u-blox.com_"
+        "u-blox_GNSS_receiver-if00";
+    struct gps_data_t client;
+    char cmd[BUFSIZ];
+    char longdev[GPS_PATH_MAX * 8];
+    ssize_t len;
+    int peer;
+    int failures = 0;
+
+    if (0 != selftest_open(&client, &peer)) {
+        (void)fputs("test_libgps: stream: no socket pair\n", stderr);
+        return 1;
+    }
+    // all but one class, for the longest list
+    (void)gps_class_filter(&client, GPS_CLASS_ALL & ~GPS_CLASS_TPV);
+    if (0 != gps_stream(&client,
+                        WATCH_ENABLE | WATCH_JSON | WATCH_NMEA | WATCH_RARE |
+                        WATCH_RAW | WATCH_SCALED | WATCH_TIMING |
+                        WATCH_SPLIT24 | WATCH_PPS | WATCH_BINARY |
+                        WATCH_TRACE | WATCH_DEVICE, dev)) {
+        (void)fputs("test_libgps: stream: gps_stream() failed\n", stderr);
+        failures++;
+    } else if (0 >= (len = read(peer, cmd, sizeof(cmd) - 1))) {
+        (void)fputs("test_libgps: stream: nothing sent\n", stderr);
+        failures++;
+    } else {
+        cmd[len] = '\0';
+        if (NULL == strstr(cmd, dev) ||
+            NULL == strstr(cmd, "\"trace\":true") ||
+            NULL == strstr(cmd, ",SUBFRAME,LOG\"};")) {
+            (void)fprintf(stderr, "test_libgps: stream: cut: %s\n", cmd);
+            failures++;
+        }
+    }
+
+    // one that can not fit is not sent
+    (void)memset(longdev, 'x', sizeof(longdev) - 1);
+    longdev[sizeof(longdev) - 1] = '\0';
+    if (0 == gps_stream(&client, WATCH_ENABLE | WATCH_DEVICE, longdev)) {
+        (void)fputs("test_libgps: stream: too long a ?WATCH sent\n", stderr);
+        failures++;
+    }
+    (void)gps_close(&client);
+    (void)close(peer);
+    return failures;
+}
+
+// gps_data() is the unread data, none once the buffer drains
+static int selftest_drain(void)
+{
+    static const char two[] =
+        "{\"class\":\"VERSION\",\"release\":\"3.25\","
+        "\"proto_major\":3,\"proto_minor\":15}\r\n"
+        "{\"class\":\"ERROR\",\"message\":\"test\"}\r\n";
+    struct gps_data_t client;
+    int peer;
+    int failures = 0;
+
+    if (0 != selftest_open(&client, &peer)) {
+        (void)fputs("test_libgps: drain: no socket pair\n", stderr);
+        return 1;
+    }
+    if ((ssize_t)(sizeof(two) - 1) != write(peer, two, sizeof(two) - 1)) {
+        (void)fputs("test_libgps: drain: write failed\n", stderr);
+        failures++;
+    } else if (0 >= gps_read(&client, NULL, 0)) {
+        (void)fputs("test_libgps: drain: no first message\n", stderr);
+        failures++;
+    } else if (NULL == strstr(gps_data(&client), "\"ERROR\"")) {
+        (void)fprintf(stderr, "test_libgps: drain: unread data is %s\n",
+                      gps_data(&client));
+        failures++;
+    } else if (0 >= gps_read(&client, NULL, 0)) {
+        (void)fputs("test_libgps: drain: no second message\n", stderr);
+        failures++;
+    } else if ('\0' != gps_data(&client)[0]) {
+        (void)fprintf(stderr, "test_libgps: drain: stale data %s\n",
+                      gps_data(&client));
+        failures++;
+    }
+    (void)gps_close(&client);
+    (void)close(peer);
+    return failures;
+}
+
+// the library checks of -t
+static int selftest(void)
+{
+    int failures = 0;
+
+    failures += selftest_stream();
+    failures += selftest_drain();
+    if (0 == failures) {
+        (void)puts("test_libgps: self test OK");
+    }
+    return failures;
+}
+
 int main(int argc, char *argv[])
 {
     struct gps_data_t collect;
@@ -48,7 +173,7 @@ int main(int argc, char *argv[])
     (void)signal(SIGBUS, onsig);
 #endif
 
-    while (-1 != (option = getopt(argc, argv, "bf:hsD:?"))) {
+    while (-1 != (option = getopt(argc, argv, "bf:hstD:?"))) {
 	switch (option) {
 	case 'b':
 	    batchmode = true;
@@ -68,6 +193,8 @@ int main(int argc, char *argv[])
 		         sizeof(collect.devices), sizeof(struct gps_policy_t),
 		         sizeof(struct version_t), sizeof(struct gst_t));
 	    exit(EXIT_SUCCESS);
+	case 't':
+	    exit(0 == selftest() ? EXIT_SUCCESS : EXIT_FAILURE);
 	case 'D':
 	    debug = atoi(optarg);
 	    break;
@@ -75,7 +202,7 @@ int main(int argc, char *argv[])
 	case 'h':
 	default:
 	    (void)fputs("usage: test_libgps [-b] [-f fwdmsg] [-D lvl] "
-                        "[-s] [server[:port:[device]]]\n", stderr);
+                        "[-s] [-t] [server[:port:[device]]]\n", stderr);
 	    exit(EXIT_FAILURE);
 	}
     }
@@ -0,0 +1,77 @@
+#!/bin/sh
+#
+# test_metrics.sh - check the gpsd -M OpenMetrics listener with curl
+#
+# usage: test_metrics.sh gpsfake logfile
+#
+# Plays logfile through gpsfake, with gpsd serving metrics, then scrapes
+# the page while the log plays and checks it.
+#
+# This file is Copyright by the GPSD project
+# SPDX-License-Identifier: BSD-2-clause
+
+GPSFAKE=${1:-./gpsfake}
+LOG=${2:-test/daemon/GPSmap-76S.log}
+# ports unlikely to be in use, and different per run
+GPSD_PORT=$((20000 + $$ % 10000))
+METRICS_PORT=$((GPSD_PORT + 10000))
+OUT=${TMPDIR:-/tmp}/test_metrics.$$
+
+fail() {
+    echo "test_metrics.sh: FAIL: $*"
+    kill -INT "$FAKE" 2>/dev/null
+    rm -f "$OUT" "$OUT.head"
+    exit 1
+}
+
+"$GPSFAKE" -q -n -c 0.1 -P "$GPSD_PORT" -o "-M $METRICS_PORT" "$LOG" \
+    >/dev/null 2>&1 &
+FAKE=$!
+
+# wait for the listener, and for some packets
+tries=0
+while :; do
+    sleep 1
+    if curl -s -D "$OUT.head" -o "$OUT" \
+            "http://127.0.0.1:$METRICS_PORT/metrics" &&
+       grep -q '^gpsd_device_packets_total{.*type="NMEA"}' "$OUT"; then
+        break
+    fi
+    tries=$((tries + 1))
+    [ 10 -gt $tries ] || fail "no metrics from gpsd -M $METRICS_PORT"
+done
+
+grep -q '^HTTP/1.0 200' "$OUT.head" || fail "status"
+grep -qi '^Content-Type: application/openmetrics-text' "$OUT.head" ||
+    fail "content type"
+[ "$(tail -n 1 "$OUT")" = "# EOF" ] || fail "no # EOF"
+grep -q '^gpsd_device_info{device="[^"]*",driver="[^"]' "$OUT" ||
+    fail "no gpsd_device_info"
+grep -q '^gpsd_clients [0-9]' "$OUT" || fail "no gpsd_clients"
+grep -q '^gpsd_device_read_bytes_total{.*} [1-9]' "$OUT" ||
+    fail "no bytes read"
+for stage in lex parse report write; do
+    grep -q "^gpsd_device_${stage}_latency_seconds_bucket{.*le=\"+Inf\"}" \
+        "$OUT" || fail "no $stage latency histogram"
+done
+# every sample must follow the TYPE line of its family
+awk '/^# TYPE/ { family = $3; next }
+     /^#/ { next }
+     { name = $1; sub(/[{ ].*/, "", name);
+       if (0 != index(name, family) || "" == family) { next }
+       print "sample " name " outside family " family; bad = 1 }
+     END { exit bad }' "$OUT" || fail "sample outside its family"
+
+# a slow client still gets all of the page
+curl -s --limit-rate 2k -o "$OUT" "http://127.0.0.1:$METRICS_PORT/metrics"
+[ "$(tail -n 1 "$OUT")" = "# EOF" ] || fail "slow client, no # EOF"
+
+curl -s -D "$OUT.head" -o /dev/null "http://127.0.0.1:$METRICS_PORT/x"
+grep -q '^HTTP/1.0 404' "$OUT.head" || fail "no 404 for /x"
+
+kill -INT "$FAKE" 2>/dev/null
+rm -f "$OUT" "$OUT.head"
+echo "test_metrics.sh: OK"
+exit 0
+
+# vim: set expandtab shiftwidth=4
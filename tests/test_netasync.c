@@ -0,0 +1,197 @@
+/*
+ * Unit test for net_async.c, the non-blocking connect() of network
+ * sources, over the loopback.
+ *
+ * This file is Copyright by the GPSD project
+ * SPDX-License-Identifier: BSD-2-clause
+ */
+
+// first so the #defs work
+#include "../include/gpsd_config.h"
+
+#include <arpa/inet.h>
+#include <limits.h>          // for INT_MIN
+#include <netinet/in.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../include/compiler.h"       // for FALLTHROUGH
+#include "../include/gpsd.h"
+
+static struct gps_context_t context;
+// too big for the stack
+static struct gps_device_t session;
+
+/* a loopback TCP socket, listening or not, its address in sin
+ *
+ * Return: the socket, -1 on failure
+ */
+static int loopback(bool listening, struct sockaddr_in *sin)
+{
+    socklen_t len = sizeof(*sin);
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+
+    if (0 > s) {
+        return -1;
+    }
+    memset(sin, 0, sizeof(*sin));
+    sin->sin_family = AF_INET;
+    sin->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (0 != bind(s, (struct sockaddr *)sin, sizeof(*sin)) ||
+        0 != getsockname(s, (struct sockaddr *)sin, &len) ||
+        (listening &&
+         0 != listen(s, 1))) {
+        (void)close(s);
+        return -1;
+    }
+    return s;
+}
+
+/* connect session to the addresses of sins, as if a lookup of
+ * "test:2101" had returned them, until netasync_connected() gives up
+ * waiting or is done
+ *
+ * Return: the last netasync_connected(), or the NL_* of the start
+ */
+static int connect_all(struct sockaddr_in *sins, int n)
+{
+    struct netconn_t *nc = &session.netconn;
+    char addrbuf[50];
+    socket_t s;
+    int i, ret = DEVICE_UNCHANGED;
+
+    memset(nc, 0, sizeof(*nc));
+    (void)strlcpy(nc->host, "test", sizeof(nc->host));
+    (void)strlcpy(nc->service, "2101", sizeof(nc->service));
+    for (i = 0; i < n; i++) {
+        (void)memcpy(&nc->addrs[i], &sins[i], sizeof(sins[i]));
+        nc->addrlen[i] = sizeof(sins[i]);
+    }
+    nc->naddrs = n;
+    nc->resolved = time(NULL);
+
+    s = netasync_connectsock(&session, "test", "2101", addrbuf,
+                             sizeof(addrbuf));
+    if (0 > s) {
+        return (int)s;
+    }
+    session.gpsdata.gps_fd = s;
+    // one round per address, and one to spare
+    for (i = 0; i <= n && session.connecting; i++) {
+        struct timeval tv = {2, 0};
+        fd_set wfds;
+
+        FD_ZERO(&wfds);
+        FD_SET(s, &wfds);
+        if (0 >= select(s + 1, NULL, &wfds, NULL, &tv)) {
+            break;
+        }
+        ret = netasync_connected(&session);
+    }
+    (void)close(s);
+    session.gpsdata.gps_fd = UNALLOCATED_FD;
+    return ret;
+}
+
+// a refused first address, the second takes the connect
+static int test_next_address(int verbose)
+{
+    struct sockaddr_in sins[2];
+    int refused, listener;
+    int fail_count = 0;
+    int ret;
+
+    printf("\n\nTest netasync_connected() next address\n");
+    // bound, not listening, so connect() is refused
+    refused = loopback(false, &sins[0]);
+    listener = loopback(true, &sins[1]);
+    if (0 > refused ||
+        0 > listener) {
+        puts("no loopback sockets");
+        return 1;
+    }
+
+    ret = connect_all(sins, 2);
+    if (DEVICE_READY != ret ||
+        1 != session.netconn.addr ||
+        0 == session.netconn.resolved) {
+        printf("refused, listening: %d, address %d, s/b %d, 1\n",
+               ret, session.netconn.addr, DEVICE_READY);
+        fail_count++;
+    } else if (verbose) {
+        puts("  refused, listening: connected to the second");
+    }
+
+    ret = connect_all(sins, 1);
+    if (DEVICE_ERROR != ret ||
+        0 != session.netconn.resolved) {
+        printf("refused: %d, resolved %ld, s/b %d, 0\n",
+               ret, (long)session.netconn.resolved, DEVICE_ERROR);
+        fail_count++;
+    } else if (verbose) {
+        puts("  refused: failed, to be looked up again");
+    }
+
+    (void)close(refused);
+    (void)close(listener);
+    if (fail_count) {
+        printf("netasync_connected() test failed %d tests\n", fail_count);
+    } else {
+        puts("netasync_connected() test succeeded\n");
+    }
+    return fail_count;
+}
+
+int main(int argc, char *argv[])
+{
+    int fail_count = 0;
+    int verbose = 0;
+    int option;
+
+    while ((option = getopt(argc, argv, "h?vV")) != -1) {
+        switch (option) {
+        default:
+                fail_count = 1;
+                FALLTHROUGH
+        case '?':
+                FALLTHROUGH
+        case 'h':
+            (void)fputs("usage: test_netasync [-v] [-V]\n", stderr);
+            exit(fail_count);
+        case 'V':
+            (void)fprintf( stderr, "test_netasync %s\n", VERSION);
+            exit(EXIT_SUCCESS);
+        case 'v':
+            verbose = 1;
+            break;
+        }
+    }
+
+    context.errout.debug = INT_MIN;     // turn off error reporting
+    context.errout.label = "test";
+    session.context = &context;
+    session.gpsdata.gps_fd = UNALLOCATED_FD;
+    (void)strlcpy(session.gpsdata.dev.path, "tcp://test:2101",
+                  sizeof(session.gpsdata.dev.path));
+    if (0 > netasync_init(&context, NULL)) {
+        puts("netasync_init() failed");
+        exit(1);
+    }
+
+    fail_count = test_next_address(verbose);
+
+    if (fail_count) {
+        printf("netasync tests failed %d tests\n", fail_count);
+        exit(1);
+    }
+    printf("netasync tests succeeded\n");
+    exit(0);
+}
+
+// vim: set expandtab shiftwidth=4
@@ -11,11 +11,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/socket.h>     // for socketpair()
 #include <sys/stat.h>       // for open()
 #include <sys/types.h>
 #include <unistd.h>
 
 #include "../include/gpsd.h"
+#include "../include/gps_json.h"     // for json_stats_dump()
 
 static int verbose = 0;
 
@@ -254,6 +256,26 @@ static struct map singletests[] = {
         .garbage_offset = 0,
         .type = RTCM3_PACKET,
     },
+    // binary report frame tests
+    {
+        .legend = "GPSB TPV frame, device and relay sequence number",
+        .test = {
+            0xe7, 0x67, 0x01, 0x01, 0x10, 0x00, 0x00, 0x00,
+            0xf0, 0x0c, 0x03, 0x61, 0x62, 0x63,
+            0xf3, 0x08, 0x2a, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+        .testlen = 24,
+        .garbage_offset = 0,
+        .type = GPSB_PACKET,
+    },
+    {
+        .legend = "GPSB frame with a bad version",
+        .test = {
+            0xe7, 0x67, 0x01, 0x02, 0x06, 0x00, 0x00, 0x00,
+            0xf0, 0x0c, 0x03, 0x61, 0x62, 0x63},
+        .testlen = 14,
+        .garbage_offset = 0,
+        .type = BAD_PACKET,
+    },
 };
 
 static struct map runontests[] = {
@@ -397,6 +419,333 @@ static int property_check(void)
     return status;
 }
 
+#ifdef HAVE_RECVMMSG
+/* fill buf with NMEA sentences, len bytes in all
+ *
+ * Return: bytes put in buf
+ */
+static size_t fill_datagram(char *buf, size_t len)
+{
+    const char *body = "GPGGA,000000.00,,,,,0,00,99.99,,,,,,";
+    size_t n = 0;
+
+    while (len - n >= strlen(body) + 7) {
+        unsigned char sum = 0;
+        const char *p;
+
+        for (p = body; '\0' != *p; p++) {
+            sum ^= (unsigned char)*p;
+        }
+        n += snprintf(buf + n, len - n, "$%s*%02X\r\n", body, sum);
+    }
+    return n;
+}
+
+/* udp:// input, datagrams read in batches, some longer than one
+ * Ethernet frame, some more than the input buffer holds at once
+ *
+ * Return: the count of failures
+ */
+static int udp_check(void)
+{
+    static struct gps_device_t session;   // too big for the stack
+    struct gpsd_errout_t errout = {0};
+    static const size_t lens[][3] = {
+        {82, 3000, 82},
+        {8000, 8000, 8000},
+    };
+    char buf[8000];
+    unsigned i, j;
+    int failure = 0;
+
+    for (i = 0; i < ROWS(lens); i++) {
+        int fds[2];
+        size_t sent = 0;
+        int loops;
+
+        memset(&session, 0, sizeof(session));
+        errout_reset(&errout);
+        errout.debug = verbose;
+        lexer_init(&session.lexer, &errout);
+        session.sourcetype = SOURCE_UDP;
+        session.udp = calloc(1, sizeof(struct udp_batch_t));
+        if (NULL == session.udp ||
+            0 != socketpair(AF_UNIX, SOCK_DGRAM, 0, fds) ||
+            0 != fcntl(fds[0], F_SETFL, O_NONBLOCK)) {
+            (void)fputs("udp: no socket\n", stdout);
+            return 1;
+        }
+        session.gpsdata.gps_fd = fds[0];
+        for (j = 0; j < ROWS(lens[i]); j++) {
+            size_t n = fill_datagram(buf, lens[i][j]);
+
+            if ((ssize_t)n != send(fds[1], buf, n, 0)) {
+                (void)fputs("udp: send failed\n", stdout);
+                failure++;
+            }
+            sent += n;
+        }
+        // one packet a call, the guard only stops a runaway
+        for (loops = 0; loops < 1000; loops++) {
+            if (0 >= packet_get1(&session)) {
+                break;
+            }
+        }
+        if (sent != session.stats.bytes_read ||
+            0 != session.stats.udp_truncated) {
+            printf("udp %u: read %lu of %zu bytes, %lu cut short\n",
+                   i, session.stats.bytes_read, sent,
+                   session.stats.udp_truncated);
+            failure++;
+        } else {
+            printf("udp %u: %zu bytes read whole.\n", i, sent);
+        }
+        (void)close(fds[0]);
+        (void)close(fds[1]);
+        free(session.udp);
+    }
+    return failure;
+}
+#endif  // HAVE_RECVMMSG
+
+// ts set to ns before now, on CLOCK_MONOTONIC
+static void mono_ago(timespec_t *ts, long long ns)
+{
+    (void)clock_gettime(CLOCK_MONOTONIC, ts);
+    ts->tv_sec -= (time_t)(ns / NS_IN_SEC);
+    ts->tv_nsec -= (long)(ns % NS_IN_SEC);
+    TS_NORM(ts);
+}
+
+/* the packet counters: where gpsd_latency_add() puts a latency, bin n
+ * takes 2^(n-1) to 2^n uS, the last all the longer ones, then the
+ * ?STATS object of json_stats_dump()
+ *
+ * Return: the count of failures
+ */
+static int stats_check(void)
+{
+    static const struct {
+        long long ns;
+        int bin;
+    } lats[] = {
+        // in the middle of their bins, far from the edges
+        {300000LL, 9},                  // 256 to 512 uS
+        {3000000LL, 12},                // 2048 to 4096 uS
+        {10 * NS_IN_SEC, STATS_LATENCY_BINS - 1},
+    };
+    static struct gps_device_t session;   // too big for the stack
+    static struct gps_context_t context;
+    const char *want =
+        "{\"class\":\"STATS\",\"device\":\"/dev/ttyS1\",\"bytes\":100,"
+        "\"packets\":{\"NMEA\":3,\"UBX\":1},\"bad\":1,\"resyncs\":0,"
+        "\"discards\":7,\"switches\":0,\"cycles\":2,"
+        "\"lex\":[0,0,1],\"parse\":[0],\"report\":[0],\"write\":[4]}\r\n";
+    char reply[GPS_JSON_RESPONSE_MAX];
+    struct latency_t latency;
+    timespec_t start;
+    unsigned i;
+    int bin, failure = 0;
+
+    for (i = 0; i < ROWS(lats); i++) {
+        memset(&latency, 0, sizeof(latency));
+        mono_ago(&start, lats[i].ns);
+        gpsd_latency_add(&latency, &start);
+        for (bin = 0; bin < STATS_LATENCY_BINS - 1; bin++) {
+            if (0 != latency.bins[bin]) {
+                break;
+            }
+        }
+        if (lats[i].bin != bin ||
+            1 != latency.bins[bin] ||
+            (uint64_t)lats[i].ns > latency.sum_ns) {
+            printf("latency %lld nS: bin %d, s/b %d\n",
+                   lats[i].ns, bin, lats[i].bin);
+            failure++;
+        } else {
+            printf("latency %lld nS: bin %d.\n", lats[i].ns, bin);
+        }
+    }
+    // no packet read yet, nothing to count
+    memset(&latency, 0, sizeof(latency));
+    memset(&start, 0, sizeof(start));
+    gpsd_latency_add(&latency, &start);
+    for (bin = 0; bin < STATS_LATENCY_BINS; bin++) {
+        if (0 != latency.bins[bin]) {
+            printf("latency, no packet: counted in bin %d\n", bin);
+            failure++;
+        }
+    }
+
+    session.context = &context;
+    session.gpsdata.gps_fd = -1;
+    (void)strlcpy(session.gpsdata.dev.path, "/dev/ttyS1",
+                  sizeof(session.gpsdata.dev.path));
+    session.stats.bytes_read = 100;
+    session.stats.packets[NMEA_PACKET] = 3;
+    session.stats.packets[UBX_PACKET] = 1;
+    session.stats.bad_packets = 1;
+    session.stats.discards = 7;
+    session.stats.cycles = 2;
+    session.stats.lex.bins[2] = 1;
+    session.stats.write.bins[0] = 4;
+    if (!json_stats_dump(&session, reply, sizeof(reply)) ||
+        0 != strcmp(reply, want)) {
+        printf("STATS: %s s/b %s", reply, want);
+        failure++;
+    } else {
+        (void)fputs("STATS rendered.\n", stdout);
+    }
+    // too small for it, nothing rather than cut short
+    if (json_stats_dump(&session, reply, 100) ||
+        '\0' != reply[0]) {
+        printf("STATS in 100 bytes: %s, s/b empty\n", reply);
+        failure++;
+    } else {
+        (void)fputs("STATS too long left empty.\n", stdout);
+    }
+    return failure;
+}
+
+/* the trace fields of a TPV, uS from the read() that completed the
+ * packet to the lexer, to the end of the parse, and to the render
+ *
+ * Return: the count of failures
+ */
+static int trace_check(void)
+{
+    static struct gps_device_t session;   // too big for the stack
+    static struct gps_context_t context;
+    struct gps_policy_t policy;
+    char reply[GPS_JSON_RESPONSE_MAX];
+    int failure = 0;
+
+    memset(&policy, 0, sizeof(policy));
+    session.context = &context;
+    (void)strlcpy(session.gpsdata.dev.path, "/dev/ttyS1",
+                  sizeof(session.gpsdata.dev.path));
+    mono_ago(&session.stats.pkt_read, 1000000LL);
+    session.stats.pkt_mono = session.stats.pkt_read;
+    session.stats.pkt_mono.tv_nsec += 100000;
+    TS_NORM(&session.stats.pkt_mono);
+    session.stats.parse_mono = session.stats.pkt_read;
+    session.stats.parse_mono.tv_nsec += 300000;
+    TS_NORM(&session.stats.parse_mono);
+    json_tpv_dump(0, &session, &policy, true, reply, sizeof(reply));
+    if (NULL == strstr(reply, ",\"traceLex\":100,\"traceParse\":300,"
+                              "\"traceRender\":")) {
+        printf("TPV trace: %s", reply);
+        failure++;
+    } else {
+        (void)fputs("TPV trace rendered.\n", stdout);
+    }
+    json_tpv_dump(0, &session, &policy, false, reply, sizeof(reply));
+    if (NULL != strstr(reply, "trace")) {
+        printf("TPV, no trace: %s", reply);
+        failure++;
+    }
+    // no packet read yet, nothing to trace
+    memset(&session.stats.pkt_read, 0, sizeof(session.stats.pkt_read));
+    json_tpv_dump(0, &session, &policy, true, reply, sizeof(reply));
+    if (NULL != strstr(reply, "trace")) {
+        printf("TPV trace, no packet: %s", reply);
+        failure++;
+    }
+    return failure;
+}
+
+/* the output queue of a device, with async_write, over a socket the
+ * other end does not read: gpsd_serial_write() queues, in order, what
+ * it does not take, gpsd_serial_drain() writes it once it takes more,
+ * and ?STATS reports it
+ *
+ * Return: the count of failures
+ */
+static int outq_check(void)
+{
+    static struct gps_device_t session;   // too big for the stack
+    static struct gps_context_t context;
+    static char fill[65536], got[65536];
+    const char *first = "$PUBX,41,1,0003,0003,115200,0*1C\r\n";
+    const char *second = "$PUBX,40,GSV,0,0,0,0,0,0*59\r\n";
+    size_t queued = strlen(first) + strlen(second);
+    char reply[GPS_JSON_RESPONSE_MAX];
+    char want[80];
+    ssize_t rd;
+    int fds[2];
+    int failure = 0;
+
+    if (0 != socketpair(AF_UNIX, SOCK_STREAM, 0, fds) ||
+        0 != fcntl(fds[0], F_SETFL, O_NONBLOCK) ||
+        0 != fcntl(fds[1], F_SETFL, O_NONBLOCK)) {
+        (void)fputs("outq: no socket\n", stdout);
+        return 1;
+    }
+    errout_reset(&context.errout);
+    context.errout.debug = verbose;
+    context.async_write = true;
+    session.context = &context;
+    session.gpsdata.gps_fd = fds[0];
+    (void)strlcpy(session.gpsdata.dev.path, "/dev/ttyS2",
+                  sizeof(session.gpsdata.dev.path));
+    // until the other end takes no more
+    memset(fill, 'x', sizeof(fill));
+    while (0 < write(fds[0], fill, sizeof(fill))) {
+        continue;
+    }
+
+    if ((ssize_t)strlen(first) !=
+            gpsd_serial_write(&session, first, strlen(first)) ||
+        (ssize_t)strlen(second) !=
+            gpsd_serial_write(&session, second, strlen(second)) ||
+        queued != session.outq.len ||
+        queued != session.stats.out_queued ||
+        queued != session.stats.out_max ||
+        queued != gpsd_serial_pending(&session) ||
+        0 != session.stats.out_written) {
+        printf("outq: queued %zu, out_queued %lu, out_written %lu, "
+               "s/b %zu, %zu, 0\n",
+               session.outq.len, session.stats.out_queued,
+               session.stats.out_written, queued, queued);
+        failure++;
+    } else {
+        printf("outq: %zu bytes queued.\n", queued);
+    }
+    (void)snprintf(want, sizeof(want),
+                   ",\"out\":{\"written\":0,\"queued\":%zu,\"waits\":0,"
+                   "\"max\":%zu,\"pending\":%zu}", queued, queued, queued);
+    if (!json_stats_dump(&session, reply, sizeof(reply)) ||
+        NULL == strstr(reply, want)) {
+        printf("outq: STATS %s s/b with %s\n", reply, want);
+        failure++;
+    }
+
+    // the other end takes it all, the queue follows the fill
+    while (0 < read(fds[1], got, sizeof(got))) {
+        continue;
+    }
+    if (0 != gpsd_serial_drain(&session) ||
+        0 != session.outq.len ||
+        queued != session.stats.out_written) {
+        printf("outq: drain left %zu, out_written %lu, s/b 0, %zu\n",
+               session.outq.len, session.stats.out_written, queued);
+        failure++;
+    }
+    rd = read(fds[1], got, sizeof(got));
+    if ((ssize_t)queued != rd ||
+        0 != strncmp(got, first, strlen(first)) ||
+        0 != strncmp(got + strlen(first), second, strlen(second))) {
+        printf("outq: drain wrote %zd bytes, s/b %zu, in order\n",
+               rd, queued);
+        failure++;
+    } else {
+        printf("outq: %zd bytes drained in order.\n", rd);
+    }
+    (void)close(fds[0]);
+    (void)close(fds[1]);
+    return failure;
+}
+
 int main(int argc, char *argv[])
 {
     struct map *mp;
@@ -404,7 +753,7 @@ int main(int argc, char *argv[])
     int option, singletest = 0;
 
     verbose = 0;
-    while ((option = getopt(argc, argv, "ce:t:v:")) != -1) {
+    while ((option = getopt(argc, argv, "ce:ost:uv:")) != -1) {
         switch (option) {
         case 'c':
             exit(property_check());
@@ -413,9 +762,20 @@ int main(int argc, char *argv[])
             (void)fwrite(mp->test, mp->testlen, sizeof(char), stdout);
             (void)fflush(stdout);
             exit(EXIT_SUCCESS);
+        case 'o':
+            exit(0 < outq_check() ? EXIT_FAILURE : EXIT_SUCCESS);
+        case 's':
+            exit(0 < stats_check() + trace_check() ? EXIT_FAILURE :
+                 EXIT_SUCCESS);
         case 't':
             singletest = atoi(optarg);
             break;
+        case 'u':
+#ifdef HAVE_RECVMMSG
+            exit(0 < udp_check() ? EXIT_FAILURE : EXIT_SUCCESS);
+#else
+            exit(EXIT_SUCCESS);
+#endif  // HAVE_RECVMMSG
         case 'v':
             verbose = atoi(optarg);
             break;
@@ -0,0 +1,65 @@
+#!/bin/sh
+#
+# test_relay.sh - check a gpsd reading another as a relay:// feed
+#
+# usage: test_relay.sh gpsfake logfile [python]
+#
+# Plays logfile, which must be NMEA with fixes, through gpsfake, has a
+# second gpsd read that one as a relay:// feed, and checks that a JSON
+# watcher of the second gets the TPV of the device of the first.
+#
+# This file is Copyright by the GPSD project
+# SPDX-License-Identifier: BSD-2-clause
+
+GPSFAKE=${1:-./gpsfake}
+LOG=${2:-test/daemon/GPSmap-76S.log}
+PYTHON=${3:-python3}
+GPSD=${GPSD_HOME:-gpsd}/gpsd
+# ports unlikely to be in use, and different per run
+EDGE_PORT=$((20000 + $$ % 10000))
+HUB_PORT=$((EDGE_PORT + 10000))
+OUT=${TMPDIR:-/tmp}/test_relay.$$
+
+fail() {
+    echo "test_relay.sh: FAIL: $*"
+    kill -INT "$FAKE" 2>/dev/null
+    kill "$HUB" 2>/dev/null
+    rm -f "$OUT"
+    exit 1
+}
+
+"$GPSFAKE" -q -n -c 0.05 -P "$EDGE_PORT" "$LOG" >/dev/null 2>&1 &
+FAKE=$!
+sleep 1
+"$GPSD" -N -n -S "$HUB_PORT" "relay://127.0.0.1:$EDGE_PORT" >/dev/null 2>&1 &
+HUB=$!
+sleep 1
+
+# write the first 5 TPV the hub sends into $OUT, give up after 20s
+"$PYTHON" -c '
+import socket, sys
+s = socket.create_connection(("127.0.0.1", int(sys.argv[1])), 20)
+s.sendall(b"?WATCH={\"enable\":true,\"json\":true};\n")
+f = s.makefile("rb")
+tpv = 0
+with open(sys.argv[2], "wb") as out:
+    while tpv < 5:
+        line = f.readline()
+        if not line:
+            sys.exit(1)
+        if b"\"class\":\"TPV\"" in line:
+            out.write(line)
+            tpv += 1
+' "$HUB_PORT" "$OUT" || fail "no TPV from the hub"
+
+grep -q "\"device\":\"relay://127.0.0.1:$EDGE_PORT#" "$OUT" ||
+    fail "TPV not from a device of the relay:// feed"
+grep -q '"mode":' "$OUT" || fail "TPV not decoded"
+
+kill -INT "$FAKE" 2>/dev/null
+kill "$HUB" 2>/dev/null
+rm -f "$OUT"
+echo "test_relay.sh: OK"
+exit 0
+
+# vim: set expandtab shiftwidth=4
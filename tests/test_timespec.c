@@ -1,6 +1,7 @@
 /*
  * Unit test for timespec's
  * Also for parse_uri_dest(), and ntrip_parse_url
+ * And timestats_pps()
  *
  * This file is Copyright 2010 by the GPSD project
  * SPDX-License-Identifier: BSD-2-clause
@@ -19,6 +20,7 @@
 
 #include "../include/compiler.h"       // for FALLTHROUGH
 #include "../include/gpsd.h"
+#include "../include/gps_json.h"           // for json_tstats_dump()
 
 #define TS_ZERO         {0,0}
 #define TS_ZERO_ONE     {0,1}
@@ -926,6 +928,139 @@ static int test_ntrip_parse_url(int verbose)
     return fail_count;
 }
 
+// ntrip_parse_mounts() tests
+
+struct test_ntrip_parse_mounts_t {
+    char *testlist;  // test list
+    int result;      // number of mountpoints
+    char *host2;     // host of the second, if any
+    char *mountpoint2;
+} tests_ntrip_parse_mounts[] = {
+    {"ntrip.com/MP", 1, NULL, NULL},
+    {"u:p@ntrip.com:2101/MP,[fe80::1]/MP2", 2, "fe80::1", "MP2"},
+    // the ones after the first may have their own scheme
+    {"ntrip.com/MP,ntrip://u:p@b.com/MP2,c.com/MP3", 3, "b.com", "MP2"},
+    // missing mountpoint of the second
+    {"ntrip.com/MP,b.com/", -1, NULL, NULL},
+    // more than NTRIP_MOUNTS
+    {"a.com/1,b.com/2,c.com/3,d.com/4,e.com/5", -1, NULL, NULL},
+    {NULL, 0, NULL, NULL},
+};
+
+static int test_ntrip_parse_mounts(int verbose)
+{
+    int fail_count = 0;
+    struct test_ntrip_parse_mounts_t *p = tests_ntrip_parse_mounts;
+    struct gpsd_errout_t errout;
+    struct ntrip_mount_t mounts[NTRIP_MOUNTS];
+
+    printf("\n\nTest ntrip_parse_mounts()\n");
+    memset(&errout, 0, sizeof(errout));
+    errout.debug = INT_MIN;             // turn off error reporting
+    errout.label = "test";              // turn off error reporting
+
+    while (NULL != p->testlist) {
+        int result = ntrip_parse_mounts(&errout, mounts, NTRIP_MOUNTS,
+                                        p->testlist);
+
+        if (p->result != result ||
+            (NULL != p->host2 &&
+             (0 != strcmp(p->host2, mounts[1].stream.host) ||
+              0 != strcmp(p->mountpoint2, mounts[1].stream.mountpoint)))) {
+            printf("ntrip_parse_mounts(%s) = %d failed, s/b %d\n",
+                   p->testlist, result, p->result);
+            fail_count++;
+        } else if (verbose) {
+            printf("  ntrip_parse_mounts(%s) = %d\n", p->testlist, result);
+        }
+        p++;
+    }
+    if (fail_count) {
+        printf("ntrip_parse_mounts() test failed %d tests\n", fail_count);
+    } else {
+        puts("ntrip_parse_mounts() test succeeded\n");
+    }
+    return fail_count;
+}
+
+/* timestats_pps() tests, a pulse goes to ppsq, corrected, only with
+ * the qErr of its own second.  Then json_tstats_dump() of it. */
+static int test_timestats_pps(int verbose)
+{
+    int fail_count = 0;
+    // too big for the stack
+    static struct gps_device_t session;
+    struct timedelta_t td;
+    char reply[GPS_JSON_RESPONSE_MAX];
+
+    printf("\n\nTest timestats_pps()\n");
+    (void)strlcpy(session.gpsdata.dev.path, "/dev/ttyS0",
+                  sizeof(session.gpsdata.dev.path));
+    session.shm_clock_unit = -1;
+    session.shm_pps_unit = -1;
+    session.chrony_clock_fd = -1;
+    session.chrony_pps_fd = -1;
+
+    // clock 1 mS slow, the pulse 2 uS late
+    td.real.tv_sec = 1000;
+    td.real.tv_nsec = 0;
+    td.clock.tv_sec = 999;
+    td.clock.tv_nsec = 999000000;
+    session.gpsdata.qErr = 2000000;             // pS
+    session.gpsdata.qErr_time.tv_sec = 1000;
+    session.gpsdata.qErr_time.tv_nsec = 0;
+    timestats_pps(&session.timestats, &td, session.gpsdata.qErr,
+                  &session.gpsdata.qErr_time);
+    if (1 != session.timestats.pps.count ||
+        1 != session.timestats.ppsq.count ||
+        1e-12 < fabs(session.timestats.ppsq.last - 0.001002)) {
+        printf("timestats_pps() matched: pps %lu, ppsq %lu %.9f, "
+               "s/b 1, 1 0.001002000\n",
+               session.timestats.pps.count, session.timestats.ppsq.count,
+               session.timestats.ppsq.last);
+        fail_count++;
+    } else if (verbose) {
+        printf("  timestats_pps() matched: ppsq %.9f\n",
+               session.timestats.ppsq.last);
+    }
+
+    // the next pulse, the qErr is still that of the last one
+    td.real.tv_sec = 1001;
+    td.clock.tv_sec = 1000;
+    timestats_pps(&session.timestats, &td, session.gpsdata.qErr,
+                  &session.gpsdata.qErr_time);
+    if (2 != session.timestats.pps.count ||
+        1 != session.timestats.ppsq.count) {
+        printf("timestats_pps() stale: pps %lu, ppsq %lu, s/b 2, 1\n",
+               session.timestats.pps.count, session.timestats.ppsq.count);
+        fail_count++;
+    } else if (verbose) {
+        puts("  timestats_pps() stale qErr not used");
+    }
+
+    if (!json_tstats_dump(&session, reply, sizeof(reply)) ||
+        NULL == strstr(reply, "\"ppsq\":{\"count\":1,") ||
+        0 != strcmp(reply + strlen(reply) - 4, "}}\r\n")) {
+        printf("json_tstats_dump() = %s failed\n", reply);
+        fail_count++;
+    } else if (verbose) {
+        printf("  json_tstats_dump() = %s", reply);
+    }
+    // too small for it, nothing rather than cut short
+    if (json_tstats_dump(&session, reply, 200) ||
+        '\0' != reply[0]) {
+        printf("json_tstats_dump(200) = %s failed, s/b empty\n", reply);
+        fail_count++;
+    }
+
+    if (fail_count) {
+        printf("timestats_pps() test failed %d tests\n", fail_count);
+    } else {
+        puts("timestats_pps() test succeeded\n");
+    }
+    return fail_count;
+}
+
 int main(int argc, char *argv[])
 {
     int fail_count = 0;
@@ -959,6 +1094,8 @@ int main(int argc, char *argv[])
     fail_count += test_gpsd_gpstime_resolv(verbose);
     fail_count += test_parse_uri_dest(verbose);
     fail_count += test_ntrip_parse_url(verbose);
+    fail_count += test_ntrip_parse_mounts(verbose);
+    fail_count += test_timestats_pps(verbose);
 
     if ( fail_count ) {
         printf("timespec tests failed %d tests\n", fail_count );
@@ -0,0 +1,67 @@
+#!/bin/sh
+#
+# test_udpout.sh - check the gpsd -U report publisher
+#
+# usage: test_udpout.sh gpsfake logfile [python]
+#
+# Plays logfile, which must be NMEA with fixes, through gpsfake, with gpsd
+# sending NMEA to one UDP port and JSON TPV to another, and checks what
+# arrives on each.
+#
+# This file is Copyright by the GPSD project
+# SPDX-License-Identifier: BSD-2-clause
+
+GPSFAKE=${1:-./gpsfake}
+LOG=${2:-test/daemon/GPSmap-76S.log}
+PYTHON=${3:-python3}
+# ports unlikely to be in use, and different per run
+GPSD_PORT=$((20000 + $$ % 10000))
+NMEA_PORT=$((GPSD_PORT + 10000))
+JSON_PORT=$((GPSD_PORT + 20000))
+OUT=${TMPDIR:-/tmp}/test_udpout.$$
+
+fail() {
+    echo "test_udpout.sh: FAIL: $*"
+    kill -INT "$FAKE" 2>/dev/null
+    rm -f "$OUT.nmea" "$OUT.json"
+    exit 1
+}
+
+# write the first 5 datagrams to port $1 into file $2, give up after 20s
+listen() {
+    "$PYTHON" -c '
+import socket, sys
+s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+s.bind(("127.0.0.1", int(sys.argv[1])))
+s.settimeout(20)
+with open(sys.argv[2], "wb") as out:
+    for i in range(5):
+        out.write(s.recv(65536))
+' "$1" "$2"
+}
+
+listen "$NMEA_PORT" "$OUT.nmea" &
+NMEA_PID=$!
+listen "$JSON_PORT" "$OUT.json" &
+JSON_PID=$!
+sleep 1
+
+"$GPSFAKE" -q -n -c 0.05 -P "$GPSD_PORT" \
+    -o "--udpout nmea://127.0.0.1:$NMEA_PORT \
+        --udpout json://127.0.0.1:$JSON_PORT:TPV" "$LOG" >/dev/null 2>&1 &
+FAKE=$!
+
+wait "$NMEA_PID" || fail "no NMEA datagrams"
+wait "$JSON_PID" || fail "no JSON datagrams"
+
+grep -q '^\$GP' "$OUT.nmea" || fail "NMEA datagrams are not NMEA"
+grep -q '"class":"TPV"' "$OUT.json" || fail "no TPV in JSON datagrams"
+grep -v '"class":"TPV"' "$OUT.json" | grep -q '"class"' &&
+    fail "JSON datagrams not only TPV"
+
+kill -INT "$FAKE" 2>/dev/null
+rm -f "$OUT.nmea" "$OUT.json"
+echo "test_udpout.sh: OK"
+exit 0
+
+# vim: set expandtab shiftwidth=4